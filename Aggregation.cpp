@@ -1,19 +1,27 @@
 #include "Aggregation.h"
+#include "Utils.h"
 #include <algorithm>
 #include <sstream>
 #include <unordered_map>
 #include <stdexcept>
 #include <cmath>
+#include <type_traits>
+#include "SimdKernels.h"
+
+// Numeric value of a text cell; false for anything that is not a number.
+static bool parseNumber(const std::string& text, double& out) {
+    return Column::parseFloat(trim(text), out);
+}
 
 double Aggregation::computeMean(const std::vector<std::string>& values) {
     double sum = 0;
     int count = 0;
+    double d;
     for (const auto& val : values) {
-        try {
-            double d = std::stod(val);
+        if (parseNumber(val, d)) {
             sum += d;
             count++;
-        } catch (...) {}
+        }
     }
     if (count == 0) return 0;
     return sum / count;
@@ -21,54 +29,49 @@ double Aggregation::computeMean(const std::vector<std::string>& values) {
 
 double Aggregation::computeMin(const std::vector<std::string>& values) {
     double min = INFINITY;
+    double d;
     for (const auto& val : values) {
-        try {
-            double d = std::stod(val);
-            if (d < min)
-                min = d;
-        } catch (...) {}
+        if (parseNumber(val, d) && d < min)
+            min = d;
     }
     return min;
 }
 
 double Aggregation::computeMax(const std::vector<std::string>& values) {
     double max = -INFINITY;
+    double d;
     for (const auto& val : values) {
-        try {
-            double d = std::stod(val);
-            if (d > max)
-                max = d;
-        } catch (...) {}
+        if (parseNumber(val, d) && d > max)
+            max = d;
     }
     return max;
 }
 
 double Aggregation::computeSum(const std::vector<std::string>& values) {
     double sum = 0;
+    double d;
     for (const auto& val : values) {
-        try {
-            sum += std::stod(val);
-        } catch (...) {}
+        if (parseNumber(val, d))
+            sum += d;
     }
     return sum;
 }
 
 std::string Aggregation::computeMedian(std::vector<std::string> values) {
     std::vector<double> nums;
+    nums.reserve(values.size());
+    double d;
     for (const auto& val : values) {
-        try {
-            double d = std::stod(val);
+        if (parseNumber(val, d))
             nums.push_back(d);
-        } catch (...) {}
     }
     if (nums.empty()) return "0";
-    std::sort(nums.begin(), nums.end());
-    double median;
-    int n = nums.size();
+    size_t n = nums.size();
+    // Only the middle element(s) need to be in place.
+    std::nth_element(nums.begin(), nums.begin() + n / 2, nums.end());
+    double median = nums[n / 2];
     if (n % 2 == 0)
-        median = (nums[n/2 - 1] + nums[n/2]) / 2;
-    else
-        median = nums[n/2];
+        median = (*std::max_element(nums.begin(), nums.begin() + n / 2) + median) / 2;
     std::ostringstream oss;
     oss << median;
     return oss.str();
@@ -88,4 +91,260 @@ std::string Aggregation::computeMode(const std::vector<std::string>& values) {
         }
     }
     return mode;
+}
+
+// Numeric value of a cell; text cells count only if they parse as a number.
+static bool numericValue(const Column& column, size_t row, double& out) {
+    if (column.isNull(row)) return false;
+    if (column.getType() == ColumnType::String)
+        return Column::parseFloat(column.getString(row), out);
+    out = column.getNumeric(row);
+    return true;
+}
+
+static void addExact(AggregateState& state, int64_t value) {
+    if (state.exact && __builtin_add_overflow(state.intSum, value, &state.intSum))
+        state.exact = false;
+}
+
+// Folds one non-NULL cell, already converted to 'd', into a numeric state.
+static void addNumeric(AggregateState& state, const Column& column, size_t row, double d) {
+    state.count++;
+    state.sum += d;
+    if (column.getType() == ColumnType::Int)
+        addExact(state, column.getInt(row));
+    else if (column.getType() == ColumnType::Bool)
+        addExact(state, static_cast<int64_t>(d));
+    if (d < state.min) state.min = d;
+    if (d > state.max) state.max = d;
+}
+
+void Aggregation::summarize(const Column& column, const size_t* rows, size_t begin, size_t end,
+                            AggregateState& state) {
+    NumericSummary summary;
+    if (!rows && column.getType() != ColumnType::String) {
+        switch (column.getType()) {
+            case ColumnType::Int:
+                SimdKernels::summarizeInt64(column.intData(), column.nullData(), begin, end, summary);
+                break;
+            case ColumnType::Float:
+                SimdKernels::summarizeDouble(column.floatData(), column.nullData(), begin, end, summary);
+                break;
+            case ColumnType::Bool:
+                SimdKernels::summarizeBool(column.boolData(), column.nullData(), begin, end, summary);
+                break;
+            case ColumnType::String:
+                break;
+        }
+        if (summary.count == 0)
+            return;
+        state.sum += summary.sum;
+        if (!summary.exact)
+            state.exact = false;
+        addExact(state, summary.intSum);
+        state.min = state.count ? std::min(state.min, summary.min) : summary.min;
+        state.max = state.count ? std::max(state.max, summary.max) : summary.max;
+        state.count += summary.count;
+        return;
+    }
+    // Selected rows (or text columns): a typed gather loop with no parsing
+    // unless the column holds text.
+    double d;
+    for (size_t i = begin; i < end; ++i) {
+        size_t row = rows ? rows[i] : i;
+        if (numericValue(column, row, d))
+            addNumeric(state, column, row, d);
+    }
+}
+
+void Aggregation::merge(AggregateState& into, const AggregateState& from) {
+    into.count += from.count;
+    into.sum += from.sum;
+    if (!from.exact)
+        into.exact = false;
+    addExact(into, from.intSum);
+    into.min = std::min(into.min, from.min);
+    into.max = std::max(into.max, from.max);
+    if (!from.minText.empty() && (into.minText.empty() || from.minText < into.minText))
+        into.minText = from.minText;
+    if (from.maxText > into.maxText)
+        into.maxText = from.maxText;
+    into.values.insert(into.values.end(), from.values.begin(), from.values.end());
+}
+
+AggregateFunction Aggregation::parseFunction(const std::string& expr, std::string& argument) {
+    size_t open = expr.find('(');
+    size_t close = expr.rfind(')');
+    if (open == std::string::npos || close == std::string::npos || close < open)
+        return AggregateFunction::None;
+    std::string func = toUpperCase(trim(expr.substr(0, open)));
+    argument = trim(expr.substr(open + 1, close - open - 1));
+    if (func == "COUNT")
+        return argument == "*" ? AggregateFunction::CountAll : AggregateFunction::Count;
+    if (func == "SUM") return AggregateFunction::Sum;
+    if (func == "AVG") return AggregateFunction::Avg;
+    if (func == "MIN") return AggregateFunction::Min;
+    if (func == "MAX") return AggregateFunction::Max;
+    if (func == "MEDIAN") return AggregateFunction::Median;
+    if (func == "MODE") return AggregateFunction::Mode;
+    return AggregateFunction::None;
+}
+
+std::string Aggregation::canonicalName(const std::string& expr) {
+    std::string argument;
+    if (parseFunction(expr, argument) == AggregateFunction::None)
+        return expr;
+    return toUpperCase(trim(expr.substr(0, expr.find('(')))) + "(" + argument + ")";
+}
+
+std::vector<std::string> Aggregation::findAggregates(const std::string& text) {
+    std::vector<std::string> found;
+    size_t pos = 0;
+    while ((pos = text.find('(', pos)) != std::string::npos) {
+        size_t start = pos;
+        while (start > 0 && (std::isalnum(static_cast<unsigned char>(text[start - 1])) || text[start - 1] == '_'))
+            start--;
+        size_t close = text.find(')', pos);
+        if (close == std::string::npos)
+            break;
+        std::string call = text.substr(start, close - start + 1);
+        std::string argument;
+        if (start < pos && parseFunction(call, argument) != AggregateFunction::None)
+            found.push_back(canonicalName(call));
+        pos = close + 1;
+    }
+    return found;
+}
+
+void Aggregation::accumulate(AggregateState& state, AggregateFunction func, const Column* column, size_t row) {
+    double d;
+    switch (func) {
+        case AggregateFunction::CountAll:
+            state.count++;
+            break;
+        case AggregateFunction::Count:
+            if (!column->isNull(row))
+                state.count++;
+            break;
+        case AggregateFunction::Min:
+        case AggregateFunction::Max:
+            if (column->getType() == ColumnType::String) {
+                if (column->isNull(row))
+                    break;
+                std::string value = column->get(row);
+                if (state.minText.empty() || value < state.minText)
+                    state.minText = value;
+                if (value > state.maxText)
+                    state.maxText = value;
+                break;
+            }
+            // fall through
+        case AggregateFunction::Sum:
+        case AggregateFunction::Avg:
+            if (numericValue(*column, row, d))
+                addNumeric(state, *column, row, d);
+            break;
+        case AggregateFunction::Median:
+        case AggregateFunction::Mode:
+            if (!column->isNull(row))
+                state.values.push_back(column->get(row));
+            break;
+        case AggregateFunction::None:
+            break;
+    }
+}
+
+namespace {
+
+template <typename T>
+void foldFixed(AggregateState* states, size_t stride, const size_t* groups, const T* values,
+               const uint64_t* nullBits, const size_t* rows, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        size_t row = rows[i];
+        if ((nullBits[row >> 6] >> (row & 63)) & 1)
+            continue;
+        AggregateState& state = states[groups[i] * stride];
+        double d = static_cast<double>(values[row]);
+        state.count++;
+        state.sum += d;
+        if (std::is_integral<T>::value)
+            addExact(state, static_cast<int64_t>(values[row]));
+        state.min = d < state.min ? d : state.min;
+        state.max = d > state.max ? d : state.max;
+    }
+}
+
+} // namespace
+
+void Aggregation::accumulateBatch(AggregateState* states, size_t stride, const size_t* groups,
+                                  AggregateFunction func, const Column* column, const size_t* rows, size_t count) {
+    switch (func) {
+        case AggregateFunction::CountAll:
+            for (size_t i = 0; i < count; ++i)
+                states[groups[i] * stride].count++;
+            break;
+        case AggregateFunction::Count:
+            for (size_t i = 0; i < count; ++i)
+                states[groups[i] * stride].count += !column->isNull(rows[i]);
+            break;
+        case AggregateFunction::Sum:
+        case AggregateFunction::Avg:
+        case AggregateFunction::Min:
+        case AggregateFunction::Max:
+            switch (column->getType()) {
+                case ColumnType::Int:
+                    foldFixed(states, stride, groups, column->intData(), column->nullData(), rows, count);
+                    break;
+                case ColumnType::Float:
+                    foldFixed(states, stride, groups, column->floatData(), column->nullData(), rows, count);
+                    break;
+                case ColumnType::Bool:
+                    foldFixed(states, stride, groups, column->boolData(), column->nullData(), rows, count);
+                    break;
+                case ColumnType::String:
+                    for (size_t i = 0; i < count; ++i)
+                        accumulate(states[groups[i] * stride], func, column, rows[i]);
+                    break;
+            }
+            break;
+        case AggregateFunction::Median:
+        case AggregateFunction::Mode:
+            for (size_t i = 0; i < count; ++i)
+                accumulate(states[groups[i] * stride], func, column, rows[i]);
+            break;
+        case AggregateFunction::None:
+            break;
+    }
+}
+
+std::string Aggregation::finalize(const AggregateState& state, AggregateFunction func, bool integers) {
+    switch (func) {
+        case AggregateFunction::CountAll:
+        case AggregateFunction::Count:
+            return std::to_string(state.count);
+        case AggregateFunction::Sum:
+            if (state.count == 0)
+                return "";
+            return integers && state.exact ? std::to_string(state.intSum) : std::to_string(state.sum);
+        case AggregateFunction::Avg:
+            if (state.count == 0)
+                return "";
+            return std::to_string((integers && state.exact ? static_cast<double>(state.intSum) : state.sum) /
+                                  state.count);
+        case AggregateFunction::Min:
+            if (!state.minText.empty())
+                return state.minText;
+            return state.count == 0 ? "" : std::to_string(state.min);
+        case AggregateFunction::Max:
+            if (!state.maxText.empty())
+                return state.maxText;
+            return state.count == 0 ? "" : std::to_string(state.max);
+        case AggregateFunction::Median:
+            return computeMedian(state.values);
+        case AggregateFunction::Mode:
+            return computeMode(state.values);
+        case AggregateFunction::None:
+            break;
+    }
+    return "";
 }
\ No newline at end of file
@@ -3,6 +3,26 @@
 
 #include <vector>
 #include <string>
+#include <cmath>
+#include "Column.h"
+
+enum class AggregateFunction { None, CountAll, Count, Sum, Avg, Min, Max, Median, Mode };
+
+// Running state of one aggregate over one group. MEDIAN and MODE need the
+// values themselves; every other function keeps constant-size state.
+struct AggregateState {
+    size_t count = 0;
+    double sum = 0;
+    // Exact sum of integer (INT and BOOLEAN) values; 'exact' is cleared
+    // once it leaves the int64 range, and 'sum' stands instead.
+    int64_t intSum = 0;
+    bool exact = true;
+    double min = INFINITY;
+    double max = -INFINITY;
+    std::string minText; // MIN and MAX over text columns; empty until a value is seen
+    std::string maxText;
+    std::vector<std::string> values;
+};
 
 class Aggregation {
 public:
@@ -12,6 +32,33 @@ public:
     static double computeSum(const std::vector<std::string>& values);
     static std::string computeMedian(std::vector<std::string> values);
     static std::string computeMode(const std::vector<std::string>& values);
+
+    // Folds the numeric values of rows[begin, end) (row ids begin..end when
+    // 'rows' is null) into 'state' straight from the column's storage.
+    // Fixed-width columns over contiguous rows use the SIMD kernels; NULLs and
+    // text that is not a number are skipped.
+    static void summarize(const Column& column, const size_t* rows, size_t begin, size_t end,
+                          AggregateState& state);
+    // Combines the states of two slices of the same group; 'from' follows 'into'.
+    static void merge(AggregateState& into, const AggregateState& from);
+
+    // Recognizes "FUNC(arg)" select expressions; returns None for anything else.
+    static AggregateFunction parseFunction(const std::string& expr, std::string& argument);
+    // Normalized spelling of an aggregate expression, e.g. "sum( x )" -> "SUM(x)".
+    static std::string canonicalName(const std::string& expr);
+    // Every aggregate call appearing in 'text' (e.g. a HAVING clause), canonicalized.
+    static std::vector<std::string> findAggregates(const std::string& text);
+    // Folds one row into 'state'. 'column' is null for COUNT(*). MIN and MAX
+    // over a text column compare the values as text.
+    static void accumulate(AggregateState& state, AggregateFunction func, const Column* column, size_t row);
+    // Batch form of accumulate(): folds rows[i] into states[groups[i] * stride]
+    // for every i < count, with the function and column type resolved once.
+    static void accumulateBatch(AggregateState* states, size_t stride, const size_t* groups,
+                                AggregateFunction func, const Column* column, const size_t* rows, size_t count);
+    // 'integers' when the argument is an INT or BOOLEAN column: SUM is then
+    // printed as an integer while it fits in int64. SUM and AVG of a group
+    // without non-NULL values are empty (NULL).
+    static std::string finalize(const AggregateState& state, AggregateFunction func, bool integers = false);
 };
 
 #endif // AGGREGATION_H
\ No newline at end of file
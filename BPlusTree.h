@@ -0,0 +1,367 @@
+#ifndef BPLUSTREE_H
+#define BPLUSTREE_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+// In-memory B+tree over (key, row id) entries. Duplicate keys are allowed:
+// entries are ordered by key and then by row id, so every entry is unique.
+// Nodes live in index-addressed pools, which keeps the tree copyable along
+// with its Table, and leaves are linked both ways for ordered scans.
+// Erase does not rebalance; underfull leaves are tolerated until the next
+// bulkLoad.
+template <typename Key>
+class BPlusTree {
+public:
+    // Entries per node. With 8-byte keys a leaf's key array is four cache lines
+    // and its row array another four, so a search touches only the keys.
+    static constexpr int Capacity = 32;
+
+    void clear() {
+        leaves.clear();
+        inners.clear();
+        root = firstLeaf = lastLeaf = -1;
+        height = 0;
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+
+    // Replaces the contents with 'entries', which must be sorted by (key, row).
+    void bulkLoad(const std::vector<std::pair<Key, size_t>>& entries) {
+        clear();
+        if (entries.empty())
+            return;
+        // Leave some slack in each node so that later inserts rarely split.
+        const int fill = Capacity - Capacity / 4;
+        std::vector<int> level;
+        std::vector<std::pair<Key, size_t>> firsts;
+        for (size_t i = 0; i < entries.size(); i += fill) {
+            int id = static_cast<int>(leaves.size());
+            leaves.emplace_back();
+            Leaf& leaf = leaves.back();
+            size_t end = std::min(entries.size(), i + fill);
+            for (size_t j = i; j < end; ++j) {
+                leaf.keys[leaf.count] = entries[j].first;
+                leaf.rows[leaf.count] = entries[j].second;
+                leaf.count++;
+            }
+            leaf.prev = id - 1;
+            if (id > 0)
+                leaves[id - 1].next = id;
+            level.push_back(id);
+            firsts.push_back(entries[i]);
+        }
+        firstLeaf = 0;
+        lastLeaf = static_cast<int>(leaves.size()) - 1;
+        count = entries.size();
+        while (level.size() > 1) {
+            std::vector<int> parents;
+            std::vector<std::pair<Key, size_t>> parentFirsts;
+            for (size_t i = 0; i < level.size(); i += fill + 1) {
+                int id = static_cast<int>(inners.size());
+                inners.emplace_back();
+                Inner& inner = inners.back();
+                size_t end = std::min(level.size(), i + fill + 1);
+                inner.children[0] = level[i];
+                for (size_t j = i + 1; j < end; ++j) {
+                    inner.keys[inner.count] = firsts[j].first;
+                    inner.rows[inner.count] = firsts[j].second;
+                    inner.children[inner.count + 1] = level[j];
+                    inner.count++;
+                }
+                parents.push_back(id);
+                parentFirsts.push_back(firsts[i]);
+            }
+            level.swap(parents);
+            firsts.swap(parentFirsts);
+            height++;
+        }
+        root = level[0];
+    }
+
+    void insert(const Key& key, size_t row) {
+        if (root < 0) {
+            leaves.emplace_back();
+            root = firstLeaf = lastLeaf = 0;
+            height = 0;
+        }
+        std::vector<std::pair<int, int>> path;
+        int leafId = findLeaf(key, row, &path);
+        count++;
+        if (leaves[leafId].count < Capacity) {
+            Leaf& leaf = leaves[leafId];
+            int pos = lowerBound(leaf, key, row);
+            for (int i = leaf.count; i > pos; --i) {
+                leaf.keys[i] = std::move(leaf.keys[i - 1]);
+                leaf.rows[i] = leaf.rows[i - 1];
+            }
+            leaf.keys[pos] = key;
+            leaf.rows[pos] = row;
+            leaf.count++;
+            return;
+        }
+
+        // Split the full leaf: gather Capacity + 1 entries and halve them.
+        std::vector<Key> keys;
+        std::vector<size_t> rows;
+        {
+            Leaf& leaf = leaves[leafId];
+            int pos = lowerBound(leaf, key, row);
+            for (int i = 0; i < leaf.count; ++i) {
+                if (i == pos) {
+                    keys.push_back(key);
+                    rows.push_back(row);
+                }
+                keys.push_back(std::move(leaf.keys[i]));
+                rows.push_back(leaf.rows[i]);
+            }
+            if (pos == leaf.count) {
+                keys.push_back(key);
+                rows.push_back(row);
+            }
+        }
+        int newId = static_cast<int>(leaves.size());
+        leaves.emplace_back();
+        Leaf& left = leaves[leafId];
+        Leaf& right = leaves[newId];
+        int mid = static_cast<int>(keys.size()) / 2;
+        left.count = 0;
+        for (int i = 0; i < mid; ++i) {
+            left.keys[left.count] = std::move(keys[i]);
+            left.rows[left.count++] = rows[i];
+        }
+        for (int i = mid; i < static_cast<int>(keys.size()); ++i) {
+            right.keys[right.count] = std::move(keys[i]);
+            right.rows[right.count++] = rows[i];
+        }
+        right.prev = leafId;
+        right.next = left.next;
+        if (left.next >= 0)
+            leaves[left.next].prev = newId;
+        else
+            lastLeaf = newId;
+        left.next = newId;
+
+        Key sepKey = right.keys[0];
+        size_t sepRow = right.rows[0];
+        int child = newId;
+        while (!path.empty()) {
+            int innerId = path.back().first;
+            int childPos = path.back().second;
+            path.pop_back();
+            if (inners[innerId].count < Capacity) {
+                Inner& inner = inners[innerId];
+                for (int i = inner.count; i > childPos; --i) {
+                    inner.keys[i] = std::move(inner.keys[i - 1]);
+                    inner.rows[i] = inner.rows[i - 1];
+                    inner.children[i + 1] = inner.children[i];
+                }
+                inner.keys[childPos] = sepKey;
+                inner.rows[childPos] = sepRow;
+                inner.children[childPos + 1] = child;
+                inner.count++;
+                return;
+            }
+            // Split the full inner node and push its middle separator up.
+            std::vector<Key> ikeys;
+            std::vector<size_t> irows;
+            std::vector<int> ichildren;
+            {
+                Inner& inner = inners[innerId];
+                ichildren.push_back(inner.children[0]);
+                for (int i = 0; i < inner.count; ++i) {
+                    if (i == childPos) {
+                        ikeys.push_back(sepKey);
+                        irows.push_back(sepRow);
+                        ichildren.push_back(child);
+                    }
+                    ikeys.push_back(std::move(inner.keys[i]));
+                    irows.push_back(inner.rows[i]);
+                    ichildren.push_back(inner.children[i + 1]);
+                }
+                if (childPos == inner.count) {
+                    ikeys.push_back(sepKey);
+                    irows.push_back(sepRow);
+                    ichildren.push_back(child);
+                }
+            }
+            int newInner = static_cast<int>(inners.size());
+            inners.emplace_back();
+            Inner& leftInner = inners[innerId];
+            Inner& rightInner = inners[newInner];
+            int imid = static_cast<int>(ikeys.size()) / 2;
+            leftInner.count = 0;
+            leftInner.children[0] = ichildren[0];
+            for (int i = 0; i < imid; ++i) {
+                leftInner.keys[i] = std::move(ikeys[i]);
+                leftInner.rows[i] = irows[i];
+                leftInner.children[i + 1] = ichildren[i + 1];
+                leftInner.count++;
+            }
+            rightInner.children[0] = ichildren[imid + 1];
+            for (int i = imid + 1; i < static_cast<int>(ikeys.size()); ++i) {
+                rightInner.keys[rightInner.count] = std::move(ikeys[i]);
+                rightInner.rows[rightInner.count] = irows[i];
+                rightInner.children[rightInner.count + 1] = ichildren[i + 1];
+                rightInner.count++;
+            }
+            sepKey = std::move(ikeys[imid]);
+            sepRow = irows[imid];
+            child = newInner;
+        }
+
+        // The root split: grow the tree by one level.
+        int newRoot = static_cast<int>(inners.size());
+        inners.emplace_back();
+        Inner& top = inners[newRoot];
+        top.keys[0] = sepKey;
+        top.rows[0] = sepRow;
+        top.children[0] = root;
+        top.children[1] = child;
+        top.count = 1;
+        root = newRoot;
+        height++;
+    }
+
+    bool erase(const Key& key, size_t row) {
+        if (root < 0)
+            return false;
+        Leaf& leaf = leaves[findLeaf(key, row, nullptr)];
+        int pos = lowerBound(leaf, key, row);
+        if (pos == leaf.count || leaf.rows[pos] != row || key < leaf.keys[pos] || leaf.keys[pos] < key)
+            return false;
+        for (int i = pos; i + 1 < leaf.count; ++i) {
+            leaf.keys[i] = std::move(leaf.keys[i + 1]);
+            leaf.rows[i] = leaf.rows[i + 1];
+        }
+        leaf.count--;
+        count--;
+        return true;
+    }
+
+    // Calls fn(row) for each entry whose key lies between the bounds, in
+    // ascending key order. A null bound is open.
+    template <typename Fn>
+    void scan(const Key* lo, bool loInclusive, const Key* hi, bool hiInclusive, Fn fn) const {
+        if (root < 0)
+            return;
+        int leafId = firstLeaf;
+        int pos = 0;
+        if (lo) {
+            size_t startRow = loInclusive ? 0 : SIZE_MAX;
+            leafId = findLeaf(*lo, startRow, nullptr);
+            pos = lowerBound(leaves[leafId], *lo, startRow);
+        }
+        while (leafId >= 0) {
+            const Leaf& leaf = leaves[leafId];
+            for (; pos < leaf.count; ++pos) {
+                const Key& k = leaf.keys[pos];
+                if (lo && !loInclusive && !(*lo < k))
+                    continue;
+                if (hi && (hiInclusive ? (*hi < k) : !(k < *hi)))
+                    return;
+                fn(leaf.rows[pos]);
+            }
+            leafId = leaf.next;
+            pos = 0;
+        }
+    }
+
+    // Replaces every row id r, separators included, with newIds[r]. The
+    // mapping must not decrease, so the entries stay in order.
+    void renumber(const std::vector<size_t>& newIds) {
+        for (auto& leaf : leaves) {
+            for (int i = 0; i < leaf.count; ++i)
+                leaf.rows[i] = newIds[leaf.rows[i]];
+        }
+        for (auto& inner : inners) {
+            for (int i = 0; i < inner.count; ++i)
+                inner.rows[i] = newIds[inner.rows[i]];
+        }
+    }
+
+    // Calls fn(row) for every entry, in ascending or descending order.
+    template <typename Fn>
+    void scanAll(bool ascending, Fn fn) const {
+        if (ascending) {
+            for (int id = firstLeaf; id >= 0; id = leaves[id].next) {
+                for (int i = 0; i < leaves[id].count; ++i)
+                    fn(leaves[id].rows[i]);
+            }
+        } else {
+            for (int id = lastLeaf; id >= 0; id = leaves[id].prev) {
+                for (int i = leaves[id].count - 1; i >= 0; --i)
+                    fn(leaves[id].rows[i]);
+            }
+        }
+    }
+
+private:
+    struct alignas(64) Leaf {
+        Key keys[Capacity];
+        size_t rows[Capacity];
+        int count = 0;
+        int prev = -1;
+        int next = -1;
+    };
+    struct alignas(64) Inner {
+        Key keys[Capacity];   // separator i is the smallest entry under children[i + 1]
+        size_t rows[Capacity];
+        int children[Capacity + 1];
+        int count = 0;        // number of separators
+    };
+
+    std::vector<Leaf> leaves;
+    std::vector<Inner> inners;
+    int root = -1;
+    int height = 0; // inner levels above the leaves
+    int firstLeaf = -1;
+    int lastLeaf = -1;
+    size_t count = 0;
+
+    static bool entryLess(const Key& ka, size_t ra, const Key& kb, size_t rb) {
+        if (ka < kb) return true;
+        if (kb < ka) return false;
+        return ra < rb;
+    }
+
+    // First position in 'leaf' whose entry is not less than (key, row).
+    static int lowerBound(const Leaf& leaf, const Key& key, size_t row) {
+        int lo = 0, hi = leaf.count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (entryLess(leaf.keys[mid], leaf.rows[mid], key, row))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    // Descends to the leaf that holds (or would hold) (key, row), recording
+    // the (inner node, child position) pairs on the way down.
+    int findLeaf(const Key& key, size_t row, std::vector<std::pair<int, int>>* path) const {
+        int node = root;
+        for (int level = 0; level < height; ++level) {
+            const Inner& inner = inners[node];
+            int lo = 0, hi = inner.count;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (entryLess(key, row, inner.keys[mid], inner.rows[mid]))
+                    hi = mid;
+                else
+                    lo = mid + 1;
+            }
+            if (path)
+                path->emplace_back(node, lo);
+            node = inner.children[lo];
+        }
+        return node;
+    }
+};
+
+#endif // BPLUSTREE_H
@@ -0,0 +1,160 @@
+#include "BufferPool.h"
+#include <cstring>
+#include <iostream>
+
+BufferPool::BufferPool(size_t frameCount) : frames(frameCount == 0 ? 1 : frameCount) {
+    for (auto& frame : frames)
+        frame.data.reset(new char[PageSize]);
+}
+
+BufferPool::~BufferPool() {
+    flushAll();
+}
+
+int BufferPool::openFile(const std::string& path, bool truncate) {
+    auto file = std::make_unique<File>();
+    file->path = path;
+    if (truncate) {
+        std::ofstream create(path, std::ios::binary | std::ios::trunc);
+    } else {
+        std::ofstream create(path, std::ios::binary | std::ios::app);
+    }
+    file->stream.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file->stream) {
+        std::cerr << "Error: Cannot open " << path << "." << std::endl;
+        return -1;
+    }
+    file->stream.seekg(0, std::ios::end);
+    file->pages = static_cast<uint32_t>(static_cast<size_t>(file->stream.tellg()) / PageSize);
+    int id = nextFileId++;
+    files[id] = std::move(file);
+    return id;
+}
+
+void BufferPool::closeFile(int fileId) {
+    flushFile(fileId);
+    for (auto& frame : frames) {
+        if (frame.fileId != fileId)
+            continue;
+        pageTable.erase(pageKey(frame.fileId, frame.pageNo));
+        frame.fileId = -1;
+        frame.pinCount = 0;
+        frame.referenced = false;
+    }
+    files.erase(fileId);
+}
+
+uint32_t BufferPool::pageCount(int fileId) const {
+    auto it = files.find(fileId);
+    return it == files.end() ? 0 : it->second->pages;
+}
+
+// CLOCK: sweep the frames, giving referenced pages a second chance, and take
+// the first unpinned one that has not been touched since the last sweep.
+size_t BufferPool::victimFrame() {
+    for (size_t scanned = 0; scanned < 2 * frames.size(); ++scanned) {
+        Frame& frame = frames[clockHand];
+        size_t current = clockHand;
+        clockHand = (clockHand + 1) % frames.size();
+        if (frame.fileId < 0)
+            return current;
+        if (frame.pinCount > 0)
+            continue;
+        if (frame.referenced) {
+            frame.referenced = false;
+            continue;
+        }
+        writeBack(frame);
+        pageTable.erase(pageKey(frame.fileId, frame.pageNo));
+        frame.fileId = -1;
+        return current;
+    }
+    // Every frame is pinned.
+    frames.emplace_back();
+    frames.back().data.reset(new char[PageSize]);
+    return frames.size() - 1;
+}
+
+void BufferPool::writeBack(Frame& frame) {
+    if (!frame.dirty || frame.fileId < 0)
+        return;
+    File& file = *files[frame.fileId];
+    file.stream.seekp(static_cast<std::streamoff>(frame.pageNo) * PageSize);
+    file.stream.write(frame.data.get(), PageSize);
+    frame.dirty = false;
+}
+
+char* BufferPool::fetchPage(int fileId, uint32_t pageNo) {
+    auto it = pageTable.find(pageKey(fileId, pageNo));
+    if (it != pageTable.end()) {
+        Frame& frame = frames[it->second];
+        frame.pinCount++;
+        frame.referenced = true;
+        hitCount++;
+        return frame.data.get();
+    }
+    auto fileIt = files.find(fileId);
+    if (fileIt == files.end() || pageNo >= fileIt->second->pages)
+        return nullptr;
+    missCount++;
+    size_t slot = victimFrame();
+    Frame& frame = frames[slot];
+    File& file = *fileIt->second;
+    file.stream.seekg(static_cast<std::streamoff>(pageNo) * PageSize);
+    file.stream.read(frame.data.get(), PageSize);
+    if (!file.stream) {
+        file.stream.clear();
+        std::memset(frame.data.get(), 0, PageSize);
+    }
+    frame.fileId = fileId;
+    frame.pageNo = pageNo;
+    frame.pinCount = 1;
+    frame.dirty = false;
+    frame.referenced = true;
+    pageTable[pageKey(fileId, pageNo)] = slot;
+    return frame.data.get();
+}
+
+char* BufferPool::newPage(int fileId, uint32_t& pageNo) {
+    auto fileIt = files.find(fileId);
+    if (fileIt == files.end())
+        return nullptr;
+    pageNo = fileIt->second->pages++;
+    size_t slot = victimFrame();
+    Frame& frame = frames[slot];
+    std::memset(frame.data.get(), 0, PageSize);
+    frame.fileId = fileId;
+    frame.pageNo = pageNo;
+    frame.pinCount = 1;
+    frame.dirty = true;
+    frame.referenced = true;
+    pageTable[pageKey(fileId, pageNo)] = slot;
+    return frame.data.get();
+}
+
+void BufferPool::unpinPage(int fileId, uint32_t pageNo, bool dirty) {
+    auto it = pageTable.find(pageKey(fileId, pageNo));
+    if (it == pageTable.end())
+        return;
+    Frame& frame = frames[it->second];
+    if (frame.pinCount > 0)
+        frame.pinCount--;
+    frame.dirty = frame.dirty || dirty;
+}
+
+void BufferPool::flushFile(int fileId) {
+    for (auto& frame : frames) {
+        if (frame.fileId == fileId)
+            writeBack(frame);
+    }
+    auto it = files.find(fileId);
+    if (it != files.end())
+        it->second->stream.flush();
+}
+
+void BufferPool::flushAll() {
+    for (auto& frame : frames)
+        writeBack(frame);
+    for (auto& entry : files)
+        entry.second->stream.flush();
+}
@@ -0,0 +1,101 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// Fixed-size page cache over the database's files. Pages are pinned while in
+// use and evicted with the CLOCK algorithm once every frame is taken; dirty
+// pages are written back on eviction or flush. If every frame is pinned the
+// pool grows by one frame rather than failing.
+class BufferPool {
+public:
+    static constexpr size_t PageSize = 8192;
+
+    explicit BufferPool(size_t frameCount = 1024);
+    ~BufferPool();
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Opens (creating if needed) a page file and returns its id, or -1.
+    int openFile(const std::string& path, bool truncate = false);
+    // Writes back the file's dirty pages and forgets its frames.
+    void closeFile(int fileId);
+    uint32_t pageCount(int fileId) const;
+
+    // Pins an existing page, reading it from disk on a miss.
+    char* fetchPage(int fileId, uint32_t pageNo);
+    // Appends a zeroed page to the file and pins it; it starts out dirty.
+    char* newPage(int fileId, uint32_t& pageNo);
+    void unpinPage(int fileId, uint32_t pageNo, bool dirty);
+    void flushFile(int fileId);
+    void flushAll();
+
+    size_t frameCount() const { return frames.size(); }
+    size_t hits() const { return hitCount; }
+    size_t misses() const { return missCount; }
+
+private:
+    struct Frame {
+        int fileId = -1;
+        uint32_t pageNo = 0;
+        int pinCount = 0;
+        bool dirty = false;
+        bool referenced = false;
+        std::unique_ptr<char[]> data;
+    };
+    struct File {
+        std::string path;
+        std::fstream stream;
+        uint32_t pages = 0;
+    };
+
+    std::vector<Frame> frames;
+    std::unordered_map<uint64_t, size_t> pageTable; // (file, page) -> frame
+    std::unordered_map<int, std::unique_ptr<File>> files;
+    int nextFileId = 0;
+    size_t clockHand = 0;
+    size_t hitCount = 0;
+    size_t missCount = 0;
+
+    static uint64_t pageKey(int fileId, uint32_t pageNo) {
+        return (static_cast<uint64_t>(fileId) << 32) | pageNo;
+    }
+    size_t victimFrame();
+    void writeBack(Frame& frame);
+};
+
+// Pins a page for the lifetime of the handle.
+class PageHandle {
+public:
+    PageHandle(BufferPool& pool, int fileId, uint32_t pageNo)
+        : pool(&pool), fileId(fileId), pageNo(pageNo), page(pool.fetchPage(fileId, pageNo)) {}
+    PageHandle(BufferPool& pool, int fileId)
+        : pool(&pool), fileId(fileId), page(pool.newPage(fileId, pageNo)), dirty(true) {}
+    ~PageHandle() { release(); }
+    PageHandle(const PageHandle&) = delete;
+    PageHandle& operator=(const PageHandle&) = delete;
+
+    char* data() const { return page; }
+    uint32_t number() const { return pageNo; }
+    void markDirty() { dirty = true; }
+    void release() {
+        if (page)
+            pool->unpinPage(fileId, pageNo, dirty);
+        page = nullptr;
+    }
+
+private:
+    BufferPool* pool;
+    int fileId;
+    uint32_t pageNo = 0;
+    char* page;
+    bool dirty = false;
+};
+
+#endif // BUFFERPOOL_H
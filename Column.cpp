@@ -0,0 +1,380 @@
+#include "Column.h"
+#include "Utils.h"
+#include <charconv>
+#include <cstring>
+#include <functional>
+
+ColumnType columnTypeFor(const std::string& sqlType) {
+    std::string upper = toUpperCase(sqlType);
+    if (upper == "INT" || upper == "SMALLINT")
+        return ColumnType::Int;
+    if (upper == "FLOAT" || upper == "REAL" || upper == "NUMERIC" || upper == "DOUBLE PRECISION" || upper == "DOUBLE")
+        return ColumnType::Float;
+    if (upper == "BOOLEAN")
+        return ColumnType::Bool;
+    return ColumnType::String;
+}
+
+Column::Column(ColumnType type) : type(type) {}
+
+bool Column::parseInt(std::string_view text, int64_t& out) {
+    if (!text.empty() && text.front() == '+')
+        text.remove_prefix(1);
+    if (text.empty()) return false;
+    auto res = std::from_chars(text.data(), text.data() + text.size(), out);
+    return res.ec == std::errc() && res.ptr == text.data() + text.size();
+}
+
+bool Column::parseFloat(std::string_view text, double& out) {
+    if (!text.empty() && text.front() == '+')
+        text.remove_prefix(1);
+    if (text.empty()) return false;
+    auto res = std::from_chars(text.data(), text.data() + text.size(), out);
+    return res.ec == std::errc() && res.ptr == text.data() + text.size();
+}
+
+bool Column::parseBool(std::string_view text, bool& out) {
+    std::string upper = toUpperCase(std::string(text));
+    if (upper == "TRUE" || upper == "T" || upper == "1" || upper == "YES") {
+        out = true;
+        return true;
+    }
+    if (upper == "FALSE" || upper == "F" || upper == "0" || upper == "NO") {
+        out = false;
+        return true;
+    }
+    return false;
+}
+
+void Column::formatFloat(double value, std::string& out) {
+    char buf[64];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, res.ptr);
+}
+
+uint64_t Column::encodeFloat(double value) {
+    if (value == 0) value = 0; // fold -0.0 into +0.0
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits & (uint64_t(1) << 63)) ? ~bits : bits | (uint64_t(1) << 63);
+}
+
+uint64_t Column::orderedKey(size_t row) const {
+    switch (type) {
+        case ColumnType::Int: return encodeInt(ints[row]);
+        case ColumnType::Float: return encodeFloat(floats[row]);
+        case ColumnType::Bool: return bools[row];
+        case ColumnType::String: break;
+    }
+    return 0;
+}
+
+void Column::setNullBit(size_t row, bool isNullValue) {
+    uint64_t mask = uint64_t(1) << (row & 63);
+    uint64_t& word = nullBits[row >> 6];
+    bool wasNull = word & mask;
+    if (isNullValue && !wasNull) {
+        word |= mask;
+        nulls++;
+    } else if (!isNullValue && wasNull) {
+        word &= ~mask;
+        nulls--;
+    }
+}
+
+bool Column::isNullValue(const std::string& value) const {
+    return value.empty() || (type != ColumnType::String && equalsIgnoreCase(value, "NULL"));
+}
+
+bool Column::accepts(const std::string& value) const {
+    if (isNullValue(value)) return true;
+    switch (type) {
+        case ColumnType::Int: { int64_t v; return parseInt(value, v); }
+        case ColumnType::Float: { double v; return parseFloat(value, v); }
+        case ColumnType::Bool: { bool v; return parseBool(value, v); }
+        case ColumnType::String: return true;
+    }
+    return false;
+}
+
+bool Column::store(size_t row, const std::string& value, bool appending) {
+    bool isNullValue = this->isNullValue(value);
+    int64_t i = 0;
+    double d = 0;
+    bool b = false;
+    if (!isNullValue) {
+        if (type == ColumnType::Int && !parseInt(value, i)) return false;
+        if (type == ColumnType::Float && !parseFloat(value, d)) return false;
+        if (type == ColumnType::Bool && !parseBool(value, b)) return false;
+    }
+    if (appending) {
+        switch (type) {
+            case ColumnType::Int: ints.push_back(i); break;
+            case ColumnType::Float: floats.push_back(d); break;
+            case ColumnType::Bool: bools.push_back(b); break;
+            case ColumnType::String:
+                strings.push_back({blob.size(), static_cast<uint32_t>(value.size())});
+                blob += value;
+                break;
+        }
+        if ((count & 63) == 0)
+            nullBits.push_back(0);
+        count++;
+    } else {
+        switch (type) {
+            case ColumnType::Int: ints[row] = i; break;
+            case ColumnType::Float: floats[row] = d; break;
+            case ColumnType::Bool: bools[row] = b; break;
+            case ColumnType::String: {
+                // Overwrites append to the blob; the old bytes are reclaimed lazily.
+                deadBytes += strings[row].length;
+                strings[row] = {blob.size(), static_cast<uint32_t>(value.size())};
+                blob += value;
+                if (deadBytes > 4096 && deadBytes * 2 > blob.size())
+                    compactBlob();
+                break;
+            }
+        }
+    }
+    setNullBit(row, isNullValue);
+    return true;
+}
+
+bool Column::append(const std::string& value) {
+    return store(count, value, true);
+}
+
+void Column::appendNull() {
+    store(count, "", true);
+}
+
+void Column::appendFrom(const Column& source, size_t row) {
+    switch (type) {
+        case ColumnType::Int: ints.push_back(source.ints[row]); break;
+        case ColumnType::Float: floats.push_back(source.floats[row]); break;
+        case ColumnType::Bool: bools.push_back(source.bools[row]); break;
+        case ColumnType::String: {
+            // Copying within one column: the text may move when the blob grows.
+            StringRef ref = source.strings[row];
+            uint64_t offset = blob.size();
+            if (&source == this)
+                blob.append(blob, ref.offset, ref.length);
+            else
+                blob.append(source.blob, ref.offset, ref.length);
+            strings.push_back({offset, ref.length});
+            break;
+        }
+    }
+    bool isNullValue = source.isNull(row);
+    if ((count & 63) == 0)
+        nullBits.push_back(0);
+    setNullBit(count, isNullValue);
+    count++;
+}
+
+bool Column::set(size_t row, const std::string& value) {
+    return store(row, value, false);
+}
+
+double Column::getNumeric(size_t row) const {
+    switch (type) {
+        case ColumnType::Int: return static_cast<double>(ints[row]);
+        case ColumnType::Float: return floats[row];
+        case ColumnType::Bool: return bools[row] ? 1.0 : 0.0;
+        case ColumnType::String: break;
+    }
+    return 0;
+}
+
+void Column::appendTo(size_t row, std::string& out) const {
+    if (isNull(row)) return;
+    switch (type) {
+        case ColumnType::Int: {
+            char buf[24];
+            auto res = std::to_chars(buf, buf + sizeof(buf), ints[row]);
+            out.append(buf, res.ptr);
+            break;
+        }
+        case ColumnType::Float:
+            formatFloat(floats[row], out);
+            break;
+        case ColumnType::Bool:
+            out += bools[row] ? "TRUE" : "FALSE";
+            break;
+        case ColumnType::String:
+            out += getString(row);
+            break;
+    }
+}
+
+std::string Column::get(size_t row) const {
+    std::string out;
+    appendTo(row, out);
+    return out;
+}
+
+std::string Column::canonical(const std::string& value) const {
+    std::string out;
+    if (isNullValue(value))
+        return out;
+    switch (type) {
+        case ColumnType::Int: {
+            int64_t v;
+            if (parseInt(value, v)) {
+                char buf[24];
+                auto res = std::to_chars(buf, buf + sizeof(buf), v);
+                out.assign(buf, res.ptr);
+            }
+            break;
+        }
+        case ColumnType::Float: {
+            double v;
+            if (parseFloat(value, v))
+                formatFloat(v, out);
+            break;
+        }
+        case ColumnType::Bool: {
+            bool v;
+            if (parseBool(value, v))
+                out = v ? "TRUE" : "FALSE";
+            break;
+        }
+        case ColumnType::String:
+            out = value;
+            break;
+    }
+    return out;
+}
+
+bool Column::equals(size_t row, const Column& other, size_t otherRow) const {
+    if (isNull(row) || other.isNull(otherRow)) return false;
+    if (type != other.type)
+        return get(row) == other.get(otherRow);
+    switch (type) {
+        case ColumnType::Int: return ints[row] == other.ints[otherRow];
+        case ColumnType::Float: return floats[row] == other.floats[otherRow];
+        case ColumnType::Bool: return bools[row] == other.bools[otherRow];
+        case ColumnType::String: return getString(row) == other.getString(otherRow);
+    }
+    return false;
+}
+
+int Column::compare(size_t a, size_t b) const {
+    bool nullA = isNull(a), nullB = isNull(b);
+    if (nullA || nullB)
+        return nullA == nullB ? 0 : (nullA ? -1 : 1);
+    switch (type) {
+        case ColumnType::Int: return ints[a] < ints[b] ? -1 : (ints[a] > ints[b] ? 1 : 0);
+        case ColumnType::Float: return floats[a] < floats[b] ? -1 : (floats[a] > floats[b] ? 1 : 0);
+        case ColumnType::Bool: return int(bools[a]) - int(bools[b]);
+        case ColumnType::String: {
+            int c = getString(a).compare(getString(b));
+            return c < 0 ? -1 : (c > 0 ? 1 : 0);
+        }
+    }
+    return 0;
+}
+
+// Finalizer from MurmurHash3; spreads integer keys across hash buckets.
+static inline uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+uint64_t Column::hash(size_t row) const {
+    if (isNull(row))
+        return 0;
+    if (type == ColumnType::String)
+        return mix(std::hash<std::string_view>()(getString(row)));
+    return mix(orderedKey(row));
+}
+
+void Column::retain(const std::vector<uint8_t>& keep) {
+    std::vector<uint64_t> newNulls;
+    std::string newBlob;
+    size_t out = 0;
+    nulls = 0;
+    for (size_t row = 0; row < count; ++row) {
+        if (!keep[row]) continue;
+        switch (type) {
+            case ColumnType::Int: ints[out] = ints[row]; break;
+            case ColumnType::Float: floats[out] = floats[row]; break;
+            case ColumnType::Bool: bools[out] = bools[row]; break;
+            case ColumnType::String: {
+                StringRef ref = strings[row];
+                strings[out] = {newBlob.size(), ref.length};
+                newBlob.append(blob, ref.offset, ref.length);
+                break;
+            }
+        }
+        if ((out & 63) == 0)
+            newNulls.push_back(0);
+        if (isNull(row)) {
+            newNulls[out >> 6] |= uint64_t(1) << (out & 63);
+            nulls++;
+        }
+        out++;
+    }
+    count = out;
+    switch (type) {
+        case ColumnType::Int: ints.resize(count); break;
+        case ColumnType::Float: floats.resize(count); break;
+        case ColumnType::Bool: bools.resize(count); break;
+        case ColumnType::String:
+            strings.resize(count);
+            blob = std::move(newBlob);
+            deadBytes = 0;
+            break;
+    }
+    nullBits = std::move(newNulls);
+}
+
+void Column::permute(const std::vector<size_t>& order) {
+    Column sorted(type);
+    for (size_t row : order) {
+        switch (type) {
+            case ColumnType::Int: sorted.ints.push_back(ints[row]); break;
+            case ColumnType::Float: sorted.floats.push_back(floats[row]); break;
+            case ColumnType::Bool: sorted.bools.push_back(bools[row]); break;
+            case ColumnType::String: {
+                StringRef ref = strings[row];
+                sorted.strings.push_back({sorted.blob.size(), ref.length});
+                sorted.blob.append(blob, ref.offset, ref.length);
+                break;
+            }
+        }
+        if ((sorted.count & 63) == 0)
+            sorted.nullBits.push_back(0);
+        sorted.setNullBit(sorted.count, isNull(row));
+        sorted.count++;
+    }
+    *this = std::move(sorted);
+}
+
+void Column::clear() {
+    count = 0;
+    nulls = 0;
+    ints.clear();
+    floats.clear();
+    bools.clear();
+    strings.clear();
+    blob.clear();
+    deadBytes = 0;
+    nullBits.clear();
+}
+
+void Column::compactBlob() {
+    std::string newBlob;
+    newBlob.reserve(blob.size() - deadBytes);
+    for (auto& ref : strings) {
+        uint64_t offset = newBlob.size();
+        newBlob.append(blob, ref.offset, ref.length);
+        ref.offset = offset;
+    }
+    blob = std::move(newBlob);
+    deadBytes = 0;
+}
@@ -0,0 +1,114 @@
+#ifndef COLUMN_H
+#define COLUMN_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Physical storage class of a column, derived from its declared SQL type.
+enum class ColumnType { Int, Float, Bool, String };
+
+// Maps a declared SQL type (INT, FLOAT, BOOLEAN, VARCHAR, ...) to its storage class.
+ColumnType columnTypeFor(const std::string& sqlType);
+
+// A single typed column. Fixed-width types live in contiguous int64/double/bool
+// vectors; VARCHAR/TEXT and friends live in one blob addressed by (offset, length)
+// pairs. NULL (the empty string at the SQL layer) is tracked in a separate bitmap.
+class Column {
+public:
+    explicit Column(ColumnType type = ColumnType::String);
+
+    ColumnType getType() const { return type; }
+    size_t size() const { return count; }
+
+    // Append or overwrite a cell from its textual form. Returns false (and leaves
+    // the column untouched) if the text does not parse as the column's type.
+    bool append(const std::string& value);
+    void appendNull();
+    // Appends a copy of row 'row' of 'source', which must have the same type.
+    void appendFrom(const Column& source, size_t row);
+    bool set(size_t row, const std::string& value);
+
+    // Checks whether 'value' is acceptable for this column without storing it.
+    bool accepts(const std::string& value) const;
+    // NULL is stored from an empty value, or on INT, FLOAT and BOOLEAN
+    // columns from the keyword NULL (in any case).
+    bool isNullValue(const std::string& value) const;
+
+    bool isNull(size_t row) const { return (nullBits[row >> 6] >> (row & 63)) & 1; }
+    size_t nullCount() const { return nulls; }
+    // Bytes of text the cells of a string column hold.
+    size_t stringBytes() const { return blob.size() - deadBytes; }
+
+    int64_t getInt(size_t row) const { return ints[row]; }
+    double getFloat(size_t row) const { return floats[row]; }
+    bool getBool(size_t row) const { return bools[row] != 0; }
+    std::string_view getString(size_t row) const {
+        return std::string_view(blob.data() + strings[row].offset, strings[row].length);
+    }
+    // Numeric view of Int/Float/Bool cells (0 for strings).
+    double getNumeric(size_t row) const;
+
+    // Canonical text of a cell; NULL is the empty string.
+    std::string get(size_t row) const;
+    void appendTo(size_t row, std::string& out) const;
+    // Canonical text 'value' would read back as once stored here (e.g. "007"
+    // in an INT column is "7"). 'value' must be accepted.
+    std::string canonical(const std::string& value) const;
+
+    // Typed equality between two cells, possibly of different columns. Cells of
+    // different storage classes compare by canonical text. NULL never matches.
+    bool equals(size_t row, const Column& other, size_t otherRow) const;
+    // Three-way comparison of two cells of this column; NULL sorts first.
+    int compare(size_t a, size_t b) const;
+    // Hash of a cell consistent with equals() for cells of the same type.
+    uint64_t hash(size_t row) const;
+
+    // Keeps only the rows whose flag in 'keep' is non-zero, preserving order.
+    void retain(const std::vector<uint8_t>& keep);
+    // Reorders the column so that new row i holds old row order[i].
+    void permute(const std::vector<size_t>& order);
+    void clear();
+
+    const int64_t* intData() const { return ints.data(); }
+    const double* floatData() const { return floats.data(); }
+    const uint8_t* boolData() const { return bools.data(); }
+    const uint64_t* nullData() const { return nullBits.data(); }
+
+    static bool parseInt(std::string_view text, int64_t& out);
+    static bool parseFloat(std::string_view text, double& out);
+    static bool parseBool(std::string_view text, bool& out);
+    static void formatFloat(double value, std::string& out);
+
+    // Order-preserving unsigned encodings of fixed-width values: a < b exactly
+    // when encode(a) < encode(b). Used by ordered indexes and sort keys.
+    static uint64_t encodeInt(int64_t value) { return static_cast<uint64_t>(value) ^ (uint64_t(1) << 63); }
+    static uint64_t encodeFloat(double value);
+    // Encoded key of a non-NULL Int/Float/Bool cell.
+    uint64_t orderedKey(size_t row) const;
+
+private:
+    struct StringRef {
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    ColumnType type;
+    size_t count = 0;
+    size_t nulls = 0;
+    std::vector<int64_t> ints;
+    std::vector<double> floats;
+    std::vector<uint8_t> bools;
+    std::vector<StringRef> strings;
+    std::string blob;
+    size_t deadBytes = 0; // blob bytes no longer referenced after overwrites
+    std::vector<uint64_t> nullBits;
+
+    void setNullBit(size_t row, bool isNullValue);
+    bool store(size_t row, const std::string& value, bool appending);
+    void compactBlob();
+};
+
+#endif // COLUMN_H
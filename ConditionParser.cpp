@@ -1,51 +1,343 @@
 #include "ConditionParser.h"
 #include "Utils.h"
+#include "Table.h"
+#include "Aggregation.h"
+#include "SimdKernels.h"
+#include "Optimizer.h"
+#include "Lexer.h"
 #include <sstream>
 #include <cctype>
 #include <stdexcept>
 #include <algorithm>
+#include <functional>
 
 // --- Expression Subclasses ---
+enum class CompareOp { Eq, Ne, Gt, Lt, Ge, Le, Invalid };
+
+static CompareOp toCompareOp(const std::string& op) {
+    if (op == "=") return CompareOp::Eq;
+    if (op == "!=") return CompareOp::Ne;
+    if (op == ">") return CompareOp::Gt;
+    if (op == "<") return CompareOp::Lt;
+    if (op == ">=") return CompareOp::Ge;
+    if (op == "<=") return CompareOp::Le;
+    return CompareOp::Invalid;
+}
+
+template <typename T>
+static inline bool applyCompare(CompareOp op, const T& cell, const T& value) {
+    switch (op) {
+        case CompareOp::Eq: return cell == value;
+        case CompareOp::Ne: return cell != value;
+        case CompareOp::Gt: return cell > value;
+        case CompareOp::Lt: return cell < value;
+        case CompareOp::Ge: return cell >= value;
+        case CompareOp::Le: return cell <= value;
+        case CompareOp::Invalid: break;
+    }
+    return false;
+}
+
+size_t ConditionExpression::filter(const Table& table, size_t* rows, size_t count) const {
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        rows[kept] = rows[i];
+        kept += evaluate(table, rows[i]);
+    }
+    return kept;
+}
+
+// Selection-vector loops: every row is written back and the output cursor
+// only advances for rows that pass, so the loop body has no branches.
+template <typename T, typename Cmp>
+static size_t filterFixed(const T* values, const uint64_t* nullBits, size_t* rows, size_t count,
+                          T literal, Cmp cmp) {
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        size_t row = rows[i];
+        bool isNull = (nullBits[row >> 6] >> (row & 63)) & 1;
+        rows[kept] = row;
+        kept += !isNull & cmp(values[row], literal);
+    }
+    return kept;
+}
+
+template <typename T>
+static size_t filterFixed(CompareOp op, const T* values, const uint64_t* nullBits, size_t* rows,
+                          size_t count, T literal) {
+    switch (op) {
+        case CompareOp::Eq: return filterFixed(values, nullBits, rows, count, literal, std::equal_to<T>());
+        case CompareOp::Ne: return filterFixed(values, nullBits, rows, count, literal, std::not_equal_to<T>());
+        case CompareOp::Gt: return filterFixed(values, nullBits, rows, count, literal, std::greater<T>());
+        case CompareOp::Lt: return filterFixed(values, nullBits, rows, count, literal, std::less<T>());
+        case CompareOp::Ge: return filterFixed(values, nullBits, rows, count, literal, std::greater_equal<T>());
+        case CompareOp::Le: return filterFixed(values, nullBits, rows, count, literal, std::less_equal<T>());
+        case CompareOp::Invalid: break;
+    }
+    return 0;
+}
+
 class ComparisonExpression : public ConditionExpression {
 public:
-    ComparisonExpression(const std::string& column, const std::string& op, const std::string& value)
-        : column(column), op(op), value(value) {}
-
-    bool evaluate(const std::vector<std::string>& row,
-                  const std::vector<std::string>& columns) const override {
-        auto it = std::find(columns.begin(), columns.end(), column);
-        if(it == columns.end()) return false;
-        int idx = std::distance(columns.begin(), it);
-        const std::string& cell = row[idx];
-        // Note: All comparisons are string‐based.
-        if(op == "=")
-            return cell == value;
-        else if(op == "!=")
-            return cell != value;
-        else if(op == ">")
-            return cell > value;
-        else if(op == "<")
-            return cell < value;
-        else if(op == ">=")
-            return cell >= value;
-        else if(op == "<=")
-            return cell <= value;
+    // 'parameter' >= 0 makes the literal a parameter, set by setParameters().
+    ComparisonExpression(const std::string& column, const std::string& op, const std::string& value,
+                         int parameter = -1)
+        : column(column), op(op), value(value), parameter(parameter) {}
+
+    void setParameters(const std::vector<std::string>& values) override {
+        if (parameter >= 0 && static_cast<size_t>(parameter) < values.size())
+            value = values[parameter];
+    }
+
+    void bind(const Table& table) override {
+        columnIndex = table.getColumnIndex(column);
+        compareOp = toCompareOp(op);
+        mode = Mode::Never;
+        if (columnIndex < 0 || compareOp == CompareOp::Invalid)
+            return;
+        // Pre-convert the literal to the column's storage type where possible;
+        // otherwise fall back to comparing canonical text.
+        const Column& data = table.getColumnData(columnIndex);
+        indexKey = value;
+        if (value.empty()) {
+            mode = Mode::Text;
+            return;
+        }
+        switch (data.getType()) {
+            case ColumnType::Int:
+                if (Column::parseInt(value, intValue)) {
+                    mode = Mode::Int;
+                    indexKey = std::to_string(intValue);
+                } else if (Column::parseFloat(value, floatValue))
+                    mode = Mode::Numeric;
+                else
+                    mode = Mode::Text;
+                break;
+            case ColumnType::Float:
+                mode = Column::parseFloat(value, floatValue) ? Mode::Float : Mode::Text;
+                if (mode == Mode::Float) {
+                    indexKey.clear();
+                    Column::formatFloat(floatValue, indexKey);
+                }
+                break;
+            case ColumnType::Bool:
+                mode = Column::parseBool(value, boolValue) ? Mode::Bool : Mode::Text;
+                if (mode == Mode::Bool)
+                    indexKey = boolValue ? "TRUE" : "FALSE";
+                break;
+            case ColumnType::String:
+                mode = Mode::String;
+                break;
+        }
+    }
+
+    bool evaluate(const Table& table, size_t row) const override {
+        if (mode == Mode::Never || columnIndex < 0) return false;
+        const Column& data = table.getColumnData(columnIndex);
+        if (mode == Mode::Text)
+            return applyCompare(compareOp, data.get(row), value);
+        if (data.isNull(row)) return false;
+        switch (mode) {
+            case Mode::Int: return applyCompare(compareOp, data.getInt(row), intValue);
+            case Mode::Float: return applyCompare(compareOp, data.getFloat(row), floatValue);
+            case Mode::Numeric: return applyCompare(compareOp, data.getNumeric(row), floatValue);
+            case Mode::Bool: return applyCompare(compareOp, data.getBool(row), boolValue);
+            case Mode::String: return applyCompare(compareOp, data.getString(row), std::string_view(value));
+            default: break;
+        }
         return false;
     }
+
+    size_t filter(const Table& table, size_t* rows, size_t count) const override {
+        if (mode == Mode::Never || columnIndex < 0)
+            return 0;
+        const Column& data = table.getColumnData(columnIndex);
+        switch (mode) {
+            case Mode::Int:
+                return filterFixed(compareOp, data.intData(), data.nullData(), rows, count, intValue);
+            case Mode::Float:
+                return filterFixed(compareOp, data.floatData(), data.nullData(), rows, count, floatValue);
+            case Mode::Bool:
+                return filterFixed(compareOp, data.boolData(), data.nullData(), rows, count,
+                                   static_cast<uint8_t>(boolValue));
+            case Mode::String: {
+                std::string_view literal(value);
+                size_t kept = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    size_t row = rows[i];
+                    rows[kept] = row;
+                    kept += !data.isNull(row) && applyCompare(compareOp, data.getString(row), literal);
+                }
+                return kept;
+            }
+            default:
+                return ConditionExpression::filter(table, rows, count);
+        }
+    }
+
+    bool filterMask(const Table& table, size_t begin, size_t end, uint64_t* mask) const override {
+        FilterOp kernelOp;
+        switch (compareOp) {
+            case CompareOp::Eq: kernelOp = FilterOp::Eq; break;
+            case CompareOp::Ne: kernelOp = FilterOp::Ne; break;
+            case CompareOp::Lt: kernelOp = FilterOp::Lt; break;
+            case CompareOp::Le: kernelOp = FilterOp::Le; break;
+            case CompareOp::Gt: kernelOp = FilterOp::Gt; break;
+            case CompareOp::Ge: kernelOp = FilterOp::Ge; break;
+            default: return false;
+        }
+        // An unknown column (or a failed bind) has no storage to compare.
+        if (mode == Mode::Never || columnIndex < 0)
+            return false;
+        const Column& data = table.getColumnData(columnIndex);
+        switch (mode) {
+            case Mode::Int:
+                SimdKernels::compareInt64(data.intData(), data.nullData(), begin, end, kernelOp, intValue, mask);
+                return true;
+            case Mode::Float:
+                SimdKernels::compareDouble(data.floatData(), data.nullData(), begin, end, kernelOp, floatValue, mask);
+                return true;
+            case Mode::Bool:
+                SimdKernels::compareBool(data.boolData(), data.nullData(), begin, end, kernelOp,
+                                         static_cast<uint8_t>(boolValue), mask);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool candidateRows(const Table& table, std::vector<size_t>& rows) const override {
+        const Index* index = table.findIndex(columnIndex);
+        if (!index || mode == Mode::Never)
+            return false;
+        if (index->getType() == IndexType::Hash) {
+            // Equality against a hash index is a point lookup on the literal's
+            // canonical form (e.g. '007' on an INT column looks up "7").
+            if (compareOp != CompareOp::Eq || mode == Mode::Numeric)
+                return false;
+            rows = index->lookup(indexKey);
+            return true;
+        }
+        Index::Bound lo, hi;
+        if (!indexRange(table, lo, hi))
+            return false;
+        rows.clear();
+        index->rangeLookup(lo, hi, rows);
+        return true;
+    }
+
+    // Describes this comparison as a key range over a BTREE index on its column.
+    bool indexRange(const Table& table, Index::Bound& lo, Index::Bound& hi) const {
+        const Index* index = table.findIndex(columnIndex);
+        if (!index || index->getType() != IndexType::BTree || compareOp == CompareOp::Ne)
+            return false;
+        Index::Bound key;
+        key.open = false;
+        switch (mode) {
+            case Mode::Int: key.number = Column::encodeInt(intValue); break;
+            case Mode::Float: key.number = Column::encodeFloat(floatValue); break;
+            case Mode::Bool: key.number = boolValue ? 1 : 0; break;
+            case Mode::String: key.text = value; break;
+            default: return false;
+        }
+        lo = hi = Index::Bound();
+        switch (compareOp) {
+            case CompareOp::Eq: lo = hi = key; break;
+            case CompareOp::Gt: lo = key; lo.inclusive = false; break;
+            case CompareOp::Ge: lo = key; break;
+            case CompareOp::Lt: hi = key; hi.inclusive = false; break;
+            case CompareOp::Le: hi = key; break;
+            default: return false;
+        }
+        return true;
+    }
+
+    int boundColumn() const { return columnIndex; }
+    const std::string& literal() const { return value; }
 private:
+    // How the bound literal is compared against the column.
+    enum class Mode { Never, Int, Float, Numeric, Bool, String, Text };
+
     std::string column;
     std::string op;
     std::string value;
+    int parameter;
+
+    int columnIndex = -1;
+    CompareOp compareOp = CompareOp::Invalid;
+    Mode mode = Mode::Never;
+    int64_t intValue = 0;
+    double floatValue = 0;
+    bool boolValue = false;
+    std::string indexKey;
 };
 
+// Compares two range bounds; 'lower' selects which end of a range they are.
+// Returns true when 'a' is the more restrictive of the two.
+static bool tighterBound(const Index::Bound& a, const Index::Bound& b, bool lower, bool textKeys) {
+    if (b.open) return true;
+    if (a.open) return false;
+    int cmp = textKeys ? a.text.compare(b.text) : (a.number < b.number ? -1 : (a.number > b.number ? 1 : 0));
+    if (cmp == 0)
+        return !a.inclusive;
+    return lower ? cmp > 0 : cmp < 0;
+}
+
 class AndExpression : public ConditionExpression {
 public:
     AndExpression(ConditionExprPtr left, ConditionExprPtr right)
         : left(std::move(left)), right(std::move(right)) {}
 
-    bool evaluate(const std::vector<std::string>& row,
-                  const std::vector<std::string>& columns) const override {
-        return left->evaluate(row, columns) && right->evaluate(row, columns);
+    void bind(const Table& table) override {
+        left->bind(table);
+        right->bind(table);
+    }
+
+    void setParameters(const std::vector<std::string>& values) override {
+        left->setParameters(values);
+        right->setParameters(values);
+    }
+
+    bool evaluate(const Table& table, size_t row) const override {
+        return left->evaluate(table, row) && right->evaluate(table, row);
+    }
+
+    size_t filter(const Table& table, size_t* rows, size_t count) const override {
+        count = left->filter(table, rows, count);
+        return count ? right->filter(table, rows, count) : 0;
+    }
+
+    bool filterMask(const Table& table, size_t begin, size_t end, uint64_t* mask) const override {
+        uint64_t other[BatchSize / 64];
+        if (!left->filterMask(table, begin, end, mask) || !right->filterMask(table, begin, end, other))
+            return false;
+        for (size_t w = 0; w < (end - begin + 63) / 64; ++w)
+            mask[w] &= other[w];
+        return true;
+    }
+
+    bool candidateRows(const Table& table, std::vector<size_t>& rows) const override {
+        // Two ranges on the same BTREE column (a > 1 AND a < 9) become one scan.
+        auto* l = dynamic_cast<const ComparisonExpression*>(left.get());
+        auto* r = dynamic_cast<const ComparisonExpression*>(right.get());
+        Index::Bound lo1, hi1, lo2, hi2;
+        if (l && r && l->boundColumn() == r->boundColumn() &&
+            l->indexRange(table, lo1, hi1) && r->indexRange(table, lo2, hi2)) {
+            bool textKeys = table.getColumnData(l->boundColumn()).getType() == ColumnType::String;
+            const Index::Bound& lo = tighterBound(lo1, lo2, true, textKeys) ? lo1 : lo2;
+            const Index::Bound& hi = tighterBound(hi1, hi2, false, textKeys) ? hi1 : hi2;
+            rows.clear();
+            table.findIndex(l->boundColumn())->rangeLookup(lo, hi, rows);
+            return true;
+        }
+        // Either side bounds a conjunction; use the smaller candidate set.
+        std::vector<size_t> other;
+        bool hasLeft = left->candidateRows(table, rows);
+        if (!right->candidateRows(table, other))
+            return hasLeft;
+        if (!hasLeft || other.size() < rows.size())
+            rows.swap(other);
+        return true;
     }
 private:
     ConditionExprPtr left;
@@ -57,15 +349,181 @@ public:
     OrExpression(ConditionExprPtr left, ConditionExprPtr right)
         : left(std::move(left)), right(std::move(right)) {}
 
-    bool evaluate(const std::vector<std::string>& row,
-                  const std::vector<std::string>& columns) const override {
-        return left->evaluate(row, columns) || right->evaluate(row, columns);
+    void bind(const Table& table) override {
+        left->bind(table);
+        right->bind(table);
+    }
+
+    void setParameters(const std::vector<std::string>& values) override {
+        left->setParameters(values);
+        right->setParameters(values);
+    }
+
+    bool evaluate(const Table& table, size_t row) const override {
+        return left->evaluate(table, row) || right->evaluate(table, row);
+    }
+
+    size_t filter(const Table& table, size_t* rows, size_t count) const override {
+        // Rows the left side rejects get a second chance on the right; the two
+        // ascending lists are merged back in place.
+        size_t input[BatchSize], rest[BatchSize];
+        std::copy(rows, rows + count, input);
+        size_t passed = left->filter(table, rows, count);
+        size_t rejected = 0;
+        for (size_t i = 0, j = 0; i < count; ++i) {
+            if (j < passed && rows[j] == input[i])
+                ++j;
+            else
+                rest[rejected++] = input[i];
+        }
+        rejected = right->filter(table, rest, rejected);
+        std::copy(rows, rows + passed, input);
+        std::merge(input, input + passed, rest, rest + rejected, rows);
+        return passed + rejected;
+    }
+
+    bool filterMask(const Table& table, size_t begin, size_t end, uint64_t* mask) const override {
+        uint64_t other[BatchSize / 64];
+        if (!left->filterMask(table, begin, end, mask) || !right->filterMask(table, begin, end, other))
+            return false;
+        for (size_t w = 0; w < (end - begin + 63) / 64; ++w)
+            mask[w] |= other[w];
+        return true;
+    }
+
+    bool candidateRows(const Table& table, std::vector<size_t>& rows) const override {
+        // A disjunction needs both sides indexed; the candidates are the union.
+        std::vector<size_t> other;
+        if (!left->candidateRows(table, rows) || !right->candidateRows(table, other))
+            return false;
+        rows.insert(rows.end(), other.begin(), other.end());
+        std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+        return true;
     }
 private:
     ConditionExprPtr left;
     ConditionExprPtr right;
 };
 
+// TRUE or FALSE, left where the optimizer folded a condition to a constant.
+class ConstantExpression : public ConditionExpression {
+public:
+    explicit ConstantExpression(bool value) : value(value) {}
+
+    void bind(const Table&) override {}
+
+    bool evaluate(const Table&, size_t) const override { return value; }
+
+    size_t filter(const Table&, size_t*, size_t count) const override { return value ? count : 0; }
+
+    bool filterMask(const Table&, size_t begin, size_t end, uint64_t* mask) const override {
+        size_t words = (end - begin + 63) / 64;
+        std::fill(mask, mask + words, value ? ~uint64_t(0) : 0);
+        if (value && (end - begin) % 64)
+            mask[words - 1] = (uint64_t(1) << ((end - begin) % 64)) - 1;
+        return true;
+    }
+private:
+    bool value;
+};
+
+// column IN (v1, v2, ...), which an OR of equalities on one column is
+// rewritten to. Each value compares like the equality it came from; on INT
+// and VARCHAR columns the bound values are kept sorted and each row is
+// checked with one binary search.
+class InExpression : public ConditionExpression {
+public:
+    explicit InExpression(std::vector<std::unique_ptr<ComparisonExpression>> equalities)
+        : equalities(std::move(equalities)) {}
+
+    void setParameters(const std::vector<std::string>& values) override {
+        for (auto& equality : equalities)
+            equality->setParameters(values);
+    }
+
+    void bind(const Table& table) override {
+        for (auto& equality : equalities)
+            equality->bind(table);
+        columnIndex = equalities.front()->boundColumn();
+        mode = Mode::Each;
+        ints.clear();
+        strings.clear();
+        if (columnIndex < 0)
+            return;
+        ColumnType type = table.getColumnData(columnIndex).getType();
+        for (const auto& equality : equalities) {
+            const std::string& value = equality->literal();
+            int64_t number;
+            if (type == ColumnType::Int && Column::parseInt(value, number))
+                ints.push_back(number);
+            else if (type == ColumnType::String && !value.empty())
+                strings.push_back(value);
+            else
+                return;
+        }
+        std::sort(ints.begin(), ints.end());
+        std::sort(strings.begin(), strings.end());
+        mode = type == ColumnType::Int ? Mode::Int : Mode::String;
+    }
+
+    bool evaluate(const Table& table, size_t row) const override {
+        if (mode == Mode::Each) {
+            for (const auto& equality : equalities) {
+                if (equality->evaluate(table, row))
+                    return true;
+            }
+            return false;
+        }
+        const Column& data = table.getColumnData(columnIndex);
+        if (data.isNull(row))
+            return false;
+        if (mode == Mode::Int)
+            return std::binary_search(ints.begin(), ints.end(), data.getInt(row));
+        std::string_view cell = data.getString(row);
+        auto it = std::lower_bound(strings.begin(), strings.end(), cell,
+                                   [](const std::string& a, std::string_view b) { return a < b; });
+        return it != strings.end() && *it == cell;
+    }
+
+    bool filterMask(const Table& table, size_t begin, size_t end, uint64_t* mask) const override {
+        uint64_t other[BatchSize / 64];
+        if (!equalities.front()->filterMask(table, begin, end, mask))
+            return false;
+        for (size_t i = 1; i < equalities.size(); ++i) {
+            if (!equalities[i]->filterMask(table, begin, end, other))
+                return false;
+            for (size_t w = 0; w < (end - begin + 63) / 64; ++w)
+                mask[w] |= other[w];
+        }
+        return true;
+    }
+
+    bool candidateRows(const Table& table, std::vector<size_t>& rows) const override {
+        // Every value must be indexed; the candidates are the union.
+        std::vector<size_t> other;
+        if (!equalities.front()->candidateRows(table, rows))
+            return false;
+        for (size_t i = 1; i < equalities.size(); ++i) {
+            if (!equalities[i]->candidateRows(table, other))
+                return false;
+            rows.insert(rows.end(), other.begin(), other.end());
+        }
+        std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+        return true;
+    }
+private:
+    // Each: no sorted form, so the equalities are evaluated in turn.
+    enum class Mode { Each, Int, String };
+
+    std::vector<std::unique_ptr<ComparisonExpression>> equalities;
+    int columnIndex = -1;
+    Mode mode = Mode::Each;
+    std::vector<int64_t> ints;
+    std::vector<std::string> strings;
+};
+
 // --- ConditionParser Implementation ---
 ConditionParser::ConditionParser(const std::string& condition) : current(0) {
     tokenize(condition);
@@ -80,6 +538,31 @@ void ConditionParser::tokenize(const std::string& condition) {
                 tokens.push_back(buffer);
                 buffer.clear();
             }
+        } else if ((ch == '\'' || ch == '"') && buffer.empty()) {
+            // A quoted literal is one token, quotes kept, spaces, operators
+            // and doubled quotes included.
+            size_t end = i + 1;
+            while (end < condition.size()) {
+                if (condition[end++] != ch)
+                    continue;
+                if (end < condition.size() && condition[end] == ch) {
+                    ++end;
+                    continue;
+                }
+                break;
+            }
+            tokens.push_back(condition.substr(i, end - i));
+            i = end - 1;
+        } else if (ch == '(' && !buffer.empty()) {
+            // A call such as COUNT(*) or SUM(x) is one identifier token, spelled
+            // the same way aggregate output columns are named.
+            size_t close = condition.find(')', i);
+            if (close == std::string::npos)
+                close = condition.size() - 1;
+            buffer += condition.substr(i, close - i + 1);
+            tokens.push_back(Aggregation::canonicalName(buffer));
+            buffer.clear();
+            i = close;
         } else if (ch == '(' || ch == ')') {
             if (!buffer.empty()) {
                 tokens.push_back(buffer);
@@ -125,36 +608,83 @@ bool ConditionParser::matchCondition(const std::string& token) {
     return false;
 }
 
-ConditionExprPtr ConditionParser::parse() {
+Predicate ConditionParser::parsePredicate() {
     return parseExpression();
 }
 
-ConditionExprPtr ConditionParser::parseExpression() {
+ConditionExprPtr ConditionParser::parse() {
+    return build(Optimizer::simplify(parsePredicate()));
+}
+
+ConditionExprPtr ConditionParser::compile(const Table& table) {
+    auto expr = parse();
+    expr->bind(table);
+    return expr;
+}
+
+ConditionExprPtr ConditionParser::build(const Predicate& predicate) {
+    switch (predicate.kind) {
+        case Predicate::Kind::True:
+        case Predicate::Kind::False:
+            return std::make_unique<ConstantExpression>(predicate.kind == Predicate::Kind::True);
+        case Predicate::Kind::Compare:
+            return std::make_unique<ComparisonExpression>(predicate.column, predicate.op, predicate.values[0],
+                                                          predicate.parameters[0]);
+        case Predicate::Kind::In: {
+            std::vector<std::unique_ptr<ComparisonExpression>> equalities;
+            for (size_t i = 0; i < predicate.values.size(); ++i)
+                equalities.push_back(std::make_unique<ComparisonExpression>(
+                    predicate.column, "=", predicate.values[i], predicate.parameters[i]));
+            return std::make_unique<InExpression>(std::move(equalities));
+        }
+        case Predicate::Kind::And:
+        case Predicate::Kind::Or:
+            break;
+    }
+    ConditionExprPtr expr = build(predicate.children[0]);
+    for (size_t i = 1; i < predicate.children.size(); ++i) {
+        if (predicate.kind == Predicate::Kind::And)
+            expr = std::make_unique<AndExpression>(std::move(expr), build(predicate.children[i]));
+        else
+            expr = std::make_unique<OrExpression>(std::move(expr), build(predicate.children[i]));
+    }
+    return expr;
+}
+
+Predicate ConditionParser::parseExpression() {
     // expr -> term { OR term }
-    auto left = parseTerm();
+    Predicate left = parseTerm();
+    if (toUpperCase(peek()) != "OR")
+        return left;
+    Predicate either;
+    either.kind = Predicate::Kind::Or;
+    either.children.push_back(std::move(left));
     while (toUpperCase(peek()) == "OR") {
         getNext(); // consume "OR"
-        auto right = parseTerm();
-        left = std::make_unique<OrExpression>(std::move(left), std::move(right));
+        either.children.push_back(parseTerm());
     }
-    return left;
+    return either;
 }
 
-ConditionExprPtr ConditionParser::parseTerm() {
+Predicate ConditionParser::parseTerm() {
     // term -> factor { AND factor }
-    auto left = parseFactor();
+    Predicate left = parseFactor();
+    if (toUpperCase(peek()) != "AND")
+        return left;
+    Predicate both;
+    both.kind = Predicate::Kind::And;
+    both.children.push_back(std::move(left));
     while (toUpperCase(peek()) == "AND") {
         getNext(); // consume "AND"
-        auto right = parseFactor();
-        left = std::make_unique<AndExpression>(std::move(left), std::move(right));
+        both.children.push_back(parseFactor());
     }
-    return left;
+    return both;
 }
 
-ConditionExprPtr ConditionParser::parseFactor() {
+Predicate ConditionParser::parseFactor() {
     // factor -> '(' expr ')' | comparison
     if (matchCondition("(")) {
-        auto expr = parseExpression();
+        Predicate expr = parseExpression();
         if (!matchCondition(")"))
             throw std::runtime_error("Missing closing parenthesis");
         return expr;
@@ -162,13 +692,24 @@ ConditionExprPtr ConditionParser::parseFactor() {
     return parseComparison();
 }
 
-ConditionExprPtr ConditionParser::parseComparison() {
+Predicate ConditionParser::parseComparison() {
     // comparison -> identifier operator literal
-    std::string identifier = getNext();
-    std::string op = getNext();
+    Predicate comparison;
+    comparison.kind = Predicate::Kind::Compare;
+    comparison.column = getNext();
+    comparison.op = getNext();
     std::string literal = getNext();
+    int parameter = -1;
+    // $1, $2, ... are parameters of a prepared statement.
+    if (literal.size() > 1 && literal[0] == '$' &&
+        literal.find_first_not_of("0123456789", 1) == std::string::npos && literal.size() <= 6) {
+        parameter = std::stoi(literal.substr(1)) - 1;
+        literal.clear();
+    }
     // Remove single quotes if present.
-    if (!literal.empty() && literal.front() == '\'' && literal.back() == '\'')
-        literal = literal.substr(1, literal.size() - 2);
-    return std::make_unique<ComparisonExpression>(identifier, op, literal);
-}
\ No newline at end of file
+    if (literal.size() > 1 && literal.front() == '\'' && literal.back() == '\'')
+        literal = Lexer::unquote(literal);
+    comparison.values.push_back(literal);
+    comparison.parameters.push_back(parameter);
+    return comparison;
+}
@@ -4,22 +4,66 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstdint>
+
+class Table;
+
+// Conditions are evaluated a batch at a time: a selection vector of up to
+// BatchSize row ids goes in and the rows that pass come out.
+constexpr size_t BatchSize = 1024;
 
 // Abstract expression for evaluating conditions against a row.
-// 'row' is the vector of values and 'columns' is the header list.
+// 'row' is a row id into the table's column store. An expression must be bound
+// to the table's schema with bind() before it is evaluated.
 class ConditionExpression {
 public:
     virtual ~ConditionExpression() = default;
-    virtual bool evaluate(const std::vector<std::string>& row,
-                          const std::vector<std::string>& columns) const = 0;
+    // Resolves column names, operators and literals against the table once.
+    virtual void bind(const Table& table) = 0;
+    virtual bool evaluate(const Table& table, size_t row) const = 0;
+    // Compacts rows[0, count) in place to the rows satisfying the expression,
+    // keeping their order, and returns how many remain. Virtual dispatch is
+    // paid once per batch; the comparisons run as typed loops.
+    virtual size_t filter(const Table& table, size_t* rows, size_t count) const;
+    // Dense form for a contiguous batch [begin, end) with 'begin' a multiple
+    // of 64 and at most BatchSize rows: sets bit (row - begin) of 'mask' for
+    // each row satisfying the expression, using the SIMD kernels. Returns
+    // false, leaving 'mask' undefined, if some part of the expression has no
+    // kernel.
+    virtual bool filterMask(const Table&, size_t, size_t, uint64_t*) const { return false; }
+    // If an index can narrow the rows that may satisfy this expression, fills
+    // 'rows' with a superset of the matches and returns true.
+    virtual bool candidateRows(const Table&, std::vector<size_t>&) const { return false; }
+    // Gives the parameters ($1 is values[0]) of a condition parsed once for
+    // a prepared statement their values; bind() must follow.
+    virtual void setParameters(const std::vector<std::string>&) {}
 };
 
 using ConditionExprPtr = std::unique_ptr<ConditionExpression>;
 
+// Logical form of a condition, as parsed and before it becomes expressions.
+// The optimizer (Optimizer.h) rewrites it.
+struct Predicate {
+    enum class Kind { Compare, In, And, Or, True, False };
+    Kind kind = Kind::True;
+    std::string column;               // Compare, In: as written, maybe qualified (t.col)
+    std::string op;                   // Compare
+    std::vector<std::string> values;  // Compare: the literal; In: the list
+    std::vector<int> parameters;      // per value: 0 for $1, or -1 for a literal
+    std::vector<Predicate> children;  // And, Or
+};
+
 class ConditionParser {
 public:
     ConditionParser(const std::string& condition);
+    // The condition as written.
+    Predicate parsePredicate();
+    // The condition after Optimizer::simplify(), as an unbound expression.
     ConditionExprPtr parse();
+    // Parses and binds the condition to 'table' in one step.
+    ConditionExprPtr compile(const Table& table);
+    // Turns a predicate into an expression; And and Or nest to the left.
+    static ConditionExprPtr build(const Predicate& predicate);
 private:
     std::vector<std::string> tokens;
     size_t current;
@@ -28,10 +72,10 @@ private:
     std::string getNext();
     bool matchCondition(const std::string& token);
     // Recursive descent parsing functions
-    ConditionExprPtr parseExpression();
-    ConditionExprPtr parseTerm();
-    ConditionExprPtr parseFactor();
-    ConditionExprPtr parseComparison();
+    Predicate parseExpression();
+    Predicate parseTerm();
+    Predicate parseFactor();
+    Predicate parseComparison();
 };
 
 #endif // CONDITIONPARSER_H
\ No newline at end of file
@@ -1,16 +1,478 @@
 #include "Database.h"
 #include "Utils.h"
+#include "HashJoin.h"
+#include "Optimizer.h"
+#include "Aggregation.h"
+#include "Lexer.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
+#include <set>
+#include <cstring>
+
+namespace {
+
+// Checkpoint once the log has grown past this many bytes.
+const size_t CheckpointLogBytes = 64 << 20;
+
+// Rows are logged as a count followed by the values.
+void appendRows(std::vector<std::string>& fields, const std::vector<std::vector<std::string>>& rows) {
+    for (const auto& row : rows) {
+        fields.push_back(std::to_string(row.size()));
+        fields.insert(fields.end(), row.begin(), row.end());
+    }
+}
+
+std::vector<std::vector<std::string>> readRows(const std::vector<std::string>& fields, size_t from) {
+    std::vector<std::vector<std::string>> rows;
+    while (from < fields.size()) {
+        size_t width = std::stoul(fields[from++]);
+        width = std::min(width, fields.size() - from);
+        rows.emplace_back(fields.begin() + from, fields.begin() + from + width);
+        from += width;
+    }
+    return rows;
+}
+
+// Databases not yet destroyed; an exiting thread closes its sessions only
+// in these.
+std::mutex liveMutex;
+std::unordered_set<Database*> liveDatabases;
+
+// Closes, when its thread exits, the sessions the thread opened.
+struct SessionCloser {
+    std::vector<Database*> databases;
+    ~SessionCloser() {
+        std::lock_guard<std::mutex> lock(liveMutex);
+        for (Database* db : databases) {
+            if (liveDatabases.count(db))
+                db->closeSession();
+        }
+    }
+};
+thread_local SessionCloser sessionCloser;
+
+} // namespace
+
+Database::Database(size_t bufferFrames) : storage(bufferFrames) {
+    {
+        std::lock_guard<std::mutex> lock(liveMutex);
+        liveDatabases.insert(this);
+    }
+    collector = std::thread([this] {
+        std::unique_lock<std::mutex> lock(collectorMutex);
+        while (!stopping) {
+            collectorWake.wait_for(lock, std::chrono::milliseconds(200));
+            if (stopping)
+                break;
+            lock.unlock();
+            collectGarbage();
+            lock.lock();
+        }
+    });
+}
+
+Database::~Database() {
+    {
+        std::lock_guard<std::mutex> lock(liveMutex);
+        liveDatabases.erase(this);
+    }
+    {
+        std::lock_guard<std::mutex> lock(collectorMutex);
+        stopping = true;
+    }
+    collectorWake.notify_all();
+    collector.join();
+    // Uncommitted work is discarded on shutdown; the log has no commit record
+    // for it either.
+    for (auto& entry : sessions) {
+        if (entry.second.inTransaction) {
+            abort(entry.second.txn);
+            entry.second.inTransaction = false;
+        }
+    }
+    checkpoint();
+}
+
+void Database::Access::release() {
+    writers.clear();
+    readers.clear();
+    if (catalogExclusive.owns_lock())
+        catalogExclusive.unlock();
+    if (catalogShared.owns_lock())
+        catalogShared.unlock();
+}
+
+Database::Access Database::lockTables(const std::vector<std::string>& reads,
+                                      const std::vector<std::string>& writes, bool streamLarge) {
+    std::set<std::string> names(reads.begin(), reads.end());
+    names.insert(writes.begin(), writes.end());
+    Access access;
+    access.catalogShared = std::shared_lock<std::shared_mutex>(catalogLock);
+    auto needsLoad = [&](const std::string& name) {
+        return storedTables.count(name) > 0 && !(streamLarge && storage.exceedsBufferPool(name));
+    };
+    bool unloaded = false;
+    for (const auto& name : names)
+        unloaded = unloaded || needsLoad(name);
+    if (unloaded) {
+        // Loading a table changes the catalog, so it needs the lock exclusively.
+        access.catalogShared.unlock();
+        {
+            std::unique_lock<std::shared_mutex> exclusive(catalogLock);
+            for (const auto& name : names) {
+                if (needsLoad(name))
+                    findTable(name);
+            }
+        }
+        access.catalogShared.lock();
+    }
+    // 'names' is sorted, which is the lock order between tables.
+    for (const auto& name : names) {
+        auto it = tableLocks.find(name);
+        if (it == tableLocks.end())
+            continue;
+        if (std::find(writes.begin(), writes.end(), name) != writes.end())
+            access.writers.emplace_back(it->second);
+        else
+            access.readers.emplace_back(it->second);
+    }
+    return access;
+}
+
+Database::Access Database::lockCatalog() {
+    Access access;
+    access.catalogExclusive = std::unique_lock<std::shared_mutex>(catalogLock);
+    return access;
+}
+
+Database::Session& Database::currentSession() {
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    auto inserted = sessions.try_emplace(std::this_thread::get_id());
+    std::vector<Database*>& opened = sessionCloser.databases;
+    if (inserted.second && std::find(opened.begin(), opened.end(), this) == opened.end())
+        opened.push_back(this);
+    return inserted.first->second;
+}
+
+void Database::markDirty(const std::string& lowerName) {
+    std::lock_guard<std::mutex> lock(dirtyMutex);
+    dirtyTables.insert(lowerName);
+    tableVersions[lowerName] = ++versionClock;
+}
+
+void Database::bumpVersion(const std::string& lowerName) {
+    std::lock_guard<std::mutex> lock(dirtyMutex);
+    tableVersions[lowerName] = ++versionClock;
+}
+
+uint64_t Database::tableVersion(const std::string& lowerName) {
+    std::lock_guard<std::mutex> lock(dirtyMutex);
+    auto it = tableVersions.find(lowerName);
+    return it == tableVersions.end() ? 0 : it->second;
+}
+
+bool Database::open(const std::string& directory) {
+    {
+        Access access = lockCatalog();
+        if (!storage.open(directory))
+            return false;
+        persistent = true;
+        for (const auto& name : storage.storedTables())
+            storedTables.insert(name);
+        for (const auto& def : storage.storedIndexes())
+            indexes[def.name] = {def.table, def.column};
+    }
+
+    // Redo everything logged after the last checkpoint.
+    std::vector<WalRecord> records;
+    if (!wal.open(directory + "/wal.log", storage.checkpointLsn(), records))
+        return false;
+    if (!records.empty()) {
+        replay(records);
+        checkpoint();
+    }
+    return true;
+}
+
+// Re-applies logged operations, with logging and console output switched off:
+// statements through the normal entry points, row changes through
+// redoChanges(). Records of a transaction take effect at its Commit record;
+// transactions without one are dropped.
+void Database::replay(const std::vector<WalRecord>& records) {
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+    std::streambuf* err = std::cerr.rdbuf(nullptr);
+    replaying = true;
+    std::unordered_map<uint64_t, std::vector<const WalRecord*>> open;
+    for (const auto& record : records) {
+        switch (record.type) {
+            case WalRecordType::Begin:
+                open[record.lsn];
+                break;
+            case WalRecordType::Commit:
+                for (const WalRecord* pending : open[record.txn])
+                    applyRecord(*pending);
+                open.erase(record.txn);
+                break;
+            case WalRecordType::Rollback:
+                open.erase(record.txn);
+                break;
+            default:
+                if (record.txn == 0)
+                    applyRecord(record);
+                else
+                    open[record.txn].push_back(&record);
+                break;
+        }
+    }
+    replaying = false;
+    std::cout.rdbuf(out);
+    std::cerr.rdbuf(err);
+    std::cout.clear();
+    std::cerr.clear();
+}
+
+void Database::applyRecord(const WalRecord& record) {
+    const std::vector<std::string>& f = record.fields;
+    auto field = [&](size_t i) { return i < f.size() ? f[i] : std::string(); };
+    switch (record.type) {
+        case WalRecordType::CreateTable: {
+            // Name, (column, type) pairs, then the primary key if there is one.
+            std::vector<std::pair<std::string, std::string>> columns;
+            for (size_t i = 1; i + 1 < f.size(); i += 2)
+                columns.emplace_back(f[i], f[i + 1]);
+            createTable(field(0), columns, f.size() % 2 == 0 ? f.back() : "");
+            break;
+        }
+        case WalRecordType::DropTable: dropTable(field(0)); break;
+        case WalRecordType::AddColumn: alterTableAddColumn(field(0), {field(1), field(2)}); break;
+        case WalRecordType::DropColumn: alterTableDropColumn(field(0), field(1)); break;
+        case WalRecordType::RenameTable: renameTable(field(0), field(1)); break;
+        case WalRecordType::Truncate: truncateTable(field(0)); break;
+        case WalRecordType::CreateIndex: createIndex(field(0), field(1), field(2), field(3)); break;
+        case WalRecordType::DropIndex: dropIndex(field(0)); break;
+        case WalRecordType::Insert: insertRecord(field(0), readRows(f, 1)); break;
+        case WalRecordType::Update:
+        case WalRecordType::Delete:
+        case WalRecordType::Merge:
+        case WalRecordType::Replace:
+            redoChanges(field(0), f.size() > 1 ? std::stoul(f[1]) : 0, readRows(f, 2));
+            break;
+        case WalRecordType::Sort: sortPhotos(field(0), field(1), field(2) == "1"); break;
+        case WalRecordType::Begin:
+        case WalRecordType::Commit:
+        case WalRecordType::Rollback:
+            break;
+    }
+}
+
+// Appends the redo record of a mutation that has just been applied. Row
+// changes inside a transaction belong to it; everything else (including DDL,
+// which is not transactional) commits on its own, so wait for the record to be
+// durable before the change is acknowledged or made visible.
+void Database::logOperation(WalRecordType type, const std::vector<std::string>& fields) {
+    if (replaying || !wal.isOpen())
+        return;
+    Session& session = currentSession();
+    bool rowChange = type >= WalRecordType::Insert && type <= WalRecordType::Replace;
+    uint64_t lsn = wal.append(session.inTransaction && rowChange ? session.logTxn : 0, type, fields);
+    if (!session.inTransaction || !rowChange)
+        wal.waitDurable(lsn);
+}
+
+// Row changes other than plain inserts are logged as their effect: the table,
+// the number of versions the statement ended, the ended rows, then the rows it
+// added. Redoing the effect, rather than the statement, applies exactly the
+// rows the statement touched in its snapshot, even when the transaction's
+// Commit record comes after other sessions' changes to the table.
+void Database::logChanges(WalRecordType type, const std::string& tableName, const Transaction& txn,
+                          Table::ChangeMark mark) {
+    if (replaying || !wal.isOpen())
+        return;
+    std::vector<std::vector<std::string>> ended, added;
+    tables[toLowerCase(tableName)].changesSince(txn, mark, ended, added);
+    std::vector<std::string> fields{tableName, std::to_string(ended.size())};
+    appendRows(fields, ended);
+    appendRows(fields, added);
+    logOperation(type, fields);
+}
+
+void Database::redoChanges(const std::string& tableName, size_t endedCount,
+                           std::vector<std::vector<std::string>> rows) {
+    std::string lowerName = toLowerCase(tableName);
+    Access access = lockTables({}, {lowerName});
+    if (!findTable(lowerName))
+        return;
+    endedCount = std::min(endedCount, rows.size());
+    std::vector<std::vector<std::string>> added(rows.begin() + endedCount, rows.end());
+    rows.resize(endedCount);
+    Transaction own;
+    Transaction& txn = beginStatement(own);
+    txn.touch(lowerName);
+    bool ok = tables[lowerName].applyChanges(rows, added, txn);
+    if (ok)
+        markDirty(lowerName);
+    finishStatement(txn, ok, tableName);
+    access.release();
+    endStatement(ok);
+}
+
+void Database::maybeCheckpoint() {
+    if (wal.isOpen() && wal.sizeBytes() > CheckpointLogBytes)
+        checkpoint();
+}
+
+Transaction& Database::beginStatement(Transaction& own) {
+    Session& session = currentSession();
+    if (session.inTransaction)
+        return session.txn;
+    own = transactions.begin();
+    return own;
+}
+
+// Ends a statement's own transaction; an open session transaction is left to
+// endStatement().
+void Database::finishStatement(Transaction& txn, bool ok, const std::string& tableName) {
+    if (!ok)
+        std::cout << "Error: Write conflict on " << tableName
+                  << "; a concurrent transaction changed the same rows." << std::endl;
+    if (&txn == &currentSession().txn)
+        return;
+    if (ok)
+        commit(txn);
+    else
+        abort(txn);
+}
+
+// Takes back a statement refused by a constraint, whose error is already
+// printed. Unlike a write conflict it does not end the session's transaction.
+void Database::discardStatement(Transaction& txn, const std::string& lowerName, Table::ChangeMark mark) {
+    if (&txn == &currentSession().txn)
+        tables[lowerName].undoSince(txn, mark);
+    else
+        abort(txn);
+}
+
+// A failed statement inside an open transaction hit a write conflict;
+// snapshot isolation aborts the whole transaction.
+void Database::endStatement(bool ok) {
+    if (!ok && currentSession().inTransaction)
+        rollbackTransaction();
+    else
+        maybeCheckpoint();
+}
+
+void Database::commit(Transaction& txn) {
+    transactions.commit(txn, [&](uint64_t commitTs) {
+        for (const auto& name : txn.tables) {
+            auto it = tables.find(name);
+            if (it != tables.end())
+                it->second.commitVersions(txn.id, commitTs);
+        }
+    });
+    // The committed rows change what other sessions read.
+    for (const auto& name : txn.tables)
+        bumpVersion(name);
+}
+
+void Database::abort(Transaction& txn) {
+    for (const auto& name : txn.tables) {
+        auto it = tables.find(name);
+        if (it != tables.end())
+            it->second.abortVersions(txn.id);
+    }
+    transactions.abort(txn);
+}
+
+void Database::collectGarbage() {
+    std::shared_lock<std::shared_mutex> catalog(catalogLock);
+    uint64_t horizon = transactions.oldestActiveSnapshot();
+    for (auto& entry : tables) {
+        // Tables in use are left for the next round.
+        std::unique_lock<std::shared_mutex> lock(tableLocks.at(entry.first), std::try_to_lock);
+        if (lock.owns_lock())
+            entry.second.collectGarbage(horizon);
+    }
+}
+
+// Writes every modified table and the catalog to the data directory, deletes
+// the files of tables that no longer exist and empties the log. Skipped while
+// any transaction is running, since the log must keep its records.
+void Database::checkpoint() {
+    Access access = lockCatalog();
+    if (!persistent || transactions.activeCount() > 0)
+        return;
+    uint64_t lsn = wal.isOpen() ? wal.lastLsn() : storage.checkpointLsn();
+    std::lock_guard<std::mutex> dirty(dirtyMutex);
+    for (const auto& name : dirtyTables) {
+        auto it = tables.find(name);
+        if (it != tables.end())
+            storage.saveTableToFile(it->second, name);
+    }
+    dirtyTables.clear();
+    for (const auto& name : storage.storedTables()) {
+        if (tables.find(name) == tables.end() && storedTables.find(name) == storedTables.end())
+            storage.dropTableFile(name);
+    }
+    std::vector<IndexDefinition> definitions;
+    for (const auto& entry : indexes) {
+        IndexDefinition def{entry.first, entry.second.first, entry.second.second, "HASH"};
+        auto it = tables.find(def.table);
+        if (it != tables.end()) {
+            const Index* index = it->second.findIndex(it->second.getColumnIndex(def.column));
+            if (index && index->getType() == IndexType::BTree)
+                def.type = "BTREE";
+        } else {
+            for (const auto& stored : storage.storedIndexes()) {
+                if (stored.name == def.name)
+                    def.type = stored.type;
+            }
+        }
+        definitions.push_back(def);
+    }
+    if (storage.writeCatalog(definitions, lsn) && wal.isOpen())
+        wal.truncate();
+}
+
+// Returns the named table, reading it from the data directory the first time
+// a stored table is used (which needs the catalog lock exclusively); null if
+// there is no such table.
+Table* Database::findTable(const std::string& lowerName) {
+    auto it = tables.find(lowerName);
+    if (it != tables.end())
+        return &it->second;
+    if (storedTables.find(lowerName) == storedTables.end())
+        return nullptr;
+    Table& table = tables[lowerName];
+    table = storage.loadTableFromFile(lowerName);
+    tableLocks[lowerName];
+    storedTables.erase(lowerName);
+    for (const auto& def : storage.storedIndexes()) {
+        auto named = indexes.find(def.name);
+        if (def.table != lowerName || named == indexes.end() || named->second.first != lowerName)
+            continue;
+        table.createIndex(def.column, def.type == "BTREE" ? IndexType::BTree : IndexType::Hash);
+    }
+    return &table;
+}
 
 // Create table
+bool Database::canChangeTable(const std::string& lowerName, const std::string& tableName) {
+    auto it = tables.find(lowerName);
+    if (it == tables.end() || !it->second.hasUncommittedChanges())
+        return true;
+    std::cout << "Error: Table " << tableName
+              << " has uncommitted changes; commit or roll back the transaction first." << std::endl;
+    return false;
+}
+
 void Database::createTable(const std::string& tableName,
-    const std::vector<std::pair<std::string, std::string>>& cols) {
+    const std::vector<std::pair<std::string, std::string>>& cols, const std::string& primaryKey) {
+    Access access = lockCatalog();
     std::string lowerName = toLowerCase(tableName);
-    if (tables.find(lowerName) != tables.end()) {
+    if (tables.find(lowerName) != tables.end() || storedTables.find(lowerName) != storedTables.end()) {
         std::cout << "Error: Table " << tableName << " already exists." << std::endl;
         return;
     }
@@ -18,44 +480,77 @@ void Database::createTable(const std::string& tableName,
     for (const auto& col : cols) {
         table.addColumn(col.first, col.second);
     }
+    if (!primaryKey.empty() && !table.setPrimaryKey(primaryKey))
+        return;
     tables[lowerName] = table;
+    tableLocks[lowerName];
+    markDirty(lowerName);
+    std::vector<std::string> fields{tableName};
+    for (const auto& col : cols) {
+        fields.push_back(col.first);
+        fields.push_back(col.second);
+    }
+    if (!primaryKey.empty())
+        fields.push_back(primaryKey);
+    logOperation(WalRecordType::CreateTable, fields);
     std::cout << "Table " << tableName << " created." << std::endl;
 }
 
 void Database::dropTable(const std::string& tableName) {
+    Access access = lockCatalog();
     std::string lowerName = toLowerCase(tableName);
-    if (tables.erase(lowerName))
+    if (!canChangeTable(lowerName, tableName))
+        return;
+    bool existed = tables.erase(lowerName) > 0;
+    tableLocks.erase(lowerName);
+    existed = storedTables.erase(lowerName) > 0 || existed;
+    if (existed) {
+        bumpVersion(lowerName);
+        forgetIndexes(lowerName);
+        logOperation(WalRecordType::DropTable, {tableName});
         std::cout << "Table " << tableName << " dropped." << std::endl;
-    else
+    } else
         std::cout << "Table " << tableName << " does not exist." << std::endl;
 }
 
 void Database::alterTableAddColumn(const std::string& tableName, const std::pair<std::string, std::string>& column) {
+    Access access = lockCatalog();
     std::string lowerName = toLowerCase(tableName);
-    if (tables.find(lowerName) == tables.end()) {
+    if (!findTable(lowerName)) {
         std::cout << "Table " << tableName << " does not exist." << std::endl;
         return;
     }
+    if (!canChangeTable(lowerName, tableName))
+        return;
     tables[lowerName].addColumn(column.first, column.second);
+    markDirty(lowerName);
+    logOperation(WalRecordType::AddColumn, {tableName, column.first, column.second});
     std::cout << "Column " << column.first << " added to " << tableName << "." << std::endl;
 }
 
 void Database::alterTableDropColumn(const std::string& tableName, const std::string& columnName) {
+    Access access = lockCatalog();
     std::string lowerName = toLowerCase(tableName);
-    if (tables.find(lowerName) == tables.end()) {
+    if (!findTable(lowerName)) {
         std::cout << "Table " << tableName << " does not exist." << std::endl;
         return;
     }
+    if (!canChangeTable(lowerName, tableName))
+        return;
     bool success = tables[lowerName].dropColumn(columnName);
-    if (success)
+    if (success) {
+        markDirty(lowerName);
+        forgetIndexes(lowerName, columnName);
+        logOperation(WalRecordType::DropColumn, {tableName, columnName});
         std::cout << "Column " << columnName << " dropped from " << tableName << "." << std::endl;
-    else
+    } else
         std::cout << "Column " << columnName << " does not exist in " << tableName << "." << std::endl;
 }
 
 void Database::describeTable(const std::string& tableName) {
     std::string lowerName = toLowerCase(tableName);
-    if (tables.find(lowerName) == tables.end()) {
+    Access access = lockTables({lowerName}, {});
+    if (!findTable(lowerName)) {
         std::cout << "Table " << tableName << " does not exist." << std::endl;
         return;
     }
@@ -69,14 +564,50 @@ void Database::describeTable(const std::string& tableName) {
 void Database::insertRecord(const std::string& tableName,
                               const std::vector<std::vector<std::string>>& values) {
     std::string lowerName = toLowerCase(tableName);
-    if (tables.find(lowerName) == tables.end()) {
+    Access access = lockTables({}, {lowerName});
+    if (!findTable(lowerName)) {
         std::cout << "Table " << tableName << " does not exist." << std::endl;
         return;
     }
+    Transaction own;
+    Transaction& txn = beginStatement(own);
+    txn.touch(lowerName);
+    // A row refused by validation or the primary key check (its error is
+    // already printed) takes back the whole statement, rows added before it
+    // included.
+    Table::ChangeMark mark = tables[lowerName].changeMark(txn);
     for (const auto& valueSet : values) {
-        tables[lowerName].addRow(valueSet);
+        if (!tables[lowerName].addRow(valueSet, txn)) {
+            discardStatement(txn, lowerName, mark);
+            return;
+        }
     }
+    markDirty(lowerName);
+    std::vector<std::string> fields{tableName};
+    appendRows(fields, values);
+    logOperation(WalRecordType::Insert, fields);
+    finishStatement(txn, true, tableName);
+    access.release();
     std::cout << "Record(s) inserted into " << tableName << "." << std::endl;
+    endStatement(true);
+}
+
+// Appends a clause to a result cache key with runs of spaces outside quotes
+// collapsed, which no part of a statement tells apart.
+static void appendNormalized(std::string& key, const std::string& clause) {
+    char quote = 0;
+    for (size_t i = 0; i < clause.size(); ++i) {
+        char c = clause[i];
+        if (quote) {
+            quote = c == quote ? 0 : quote;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else if (c == ' ' && i > 0 && clause[i - 1] == ' ') {
+            continue;
+        }
+        key += c;
+    }
+    key += '\0';
 }
 
 void Database::selectRecords(const std::string& tableName,
@@ -87,131 +618,400 @@ void Database::selectRecords(const std::string& tableName,
                              const std::string& havingCondition,
                              bool isJoin,
                              const std::string& joinTable,
-                             const std::string& joinCondition) {
+                             const std::string& joinCondition,
+                             size_t limit,
+                             size_t offset,
+                             ConditionExpression* prepared,
+                             QueryProfile* profile) {
+    // Outside an explicit transaction a SELECT reads the latest committed
+    // rows, so its result can be served from, and saved to, the result
+    // cache. The table versions are read under the statement's table locks,
+    // which every change to those tables excludes. EXPLAIN ANALYZE always
+    // runs the statement and discards its rows.
+    bool cached = resultCache.enabled() && !currentSession().inTransaction && !profile;
+    std::string key;
+    if (cached) {
+        key = toLowerCase(tableName) + '\0' + (isJoin ? toLowerCase(joinTable) : "") + '\0';
+        for (const auto& col : selectColumns)
+            key += col + '\0';
+        for (const std::string* clause : {&condition, &havingCondition, &joinCondition})
+            appendNormalized(key, *clause);
+        for (const auto* list : {&orderByColumns, &groupByColumns}) {
+            for (const auto& item : *list)
+                appendNormalized(key, item);
+            key += '\1';
+        }
+        key += std::to_string(limit) + ' ' + std::to_string(offset);
+    }
+    std::ostringstream buffer;
+    std::ostream discard(nullptr);
+    std::ostream& out = profile ? discard : cached ? static_cast<std::ostream&>(buffer) : std::cout;
+    std::vector<uint64_t> versions;
+    auto fromCache = [&](std::vector<uint64_t> tableVersions) {
+        versions = std::move(tableVersions);
+        std::string result;
+        if (!resultCache.lookup(key, versions, result))
+            return false;
+        std::cout << result << std::flush;
+        return true;
+    };
+    auto toCache = [&]() {
+        std::string result = buffer.str();
+        std::cout << result << std::flush;
+        resultCache.insert(key, versions, result);
+    };
+
     if (!isJoin) {
         std::string lowerName = toLowerCase(tableName);
-        if (tables.find(lowerName) == tables.end()) {
+        bool plainScan = !profile && orderByColumns.empty() && groupByColumns.empty() && havingCondition.empty();
+        for (const auto& col : selectColumns) {
+            std::string argument;
+            if (Aggregation::parseFunction(col, argument) != AggregateFunction::None)
+                plainScan = false;
+        }
+        Access access = lockTables({lowerName}, {}, plainScan);
+        if (plainScan && storedTables.count(lowerName)) {
+            if (cached && fromCache({tableVersion(lowerName)}))
+                return;
+            scanStoredTable(lowerName, selectColumns, condition, limit, offset, prepared, out);
+            if (cached)
+                toCache();
+            return;
+        }
+        if (!findTable(lowerName)) {
             std::cout << "Table " << tableName << " does not exist." << std::endl;
             return;
         }
-        tables[lowerName].selectRows(selectColumns, condition, orderByColumns, groupByColumns, havingCondition);
+        if (cached && fromCache({tableVersion(lowerName)}))
+            return;
+        Transaction own;
+        Transaction& txn = beginStatement(own);
+        if (profile)
+            profile->tableName = lowerName;
+        tables[lowerName].selectRows(selectColumns, condition, txn, orderByColumns, groupByColumns, havingCondition,
+                                     limit, offset, currentSession().parallelism, currentSession().sortMemory,
+                                     prepared, out, profile);
+        if (&txn == &own)
+            transactions.abort(own);
+        if (cached)
+            toCache();
     } else {
-        // JOIN implementation (nested-loop inner join)
+        // JOIN implementation (hash inner join)
         std::string leftName = toLowerCase(tableName);
         std::string rightName = toLowerCase(joinTable);
-        if (tables.find(leftName) == tables.end() || tables.find(rightName) == tables.end()) {
+        Access access = lockTables({leftName, rightName}, {});
+        if (!findTable(leftName) || !findTable(rightName)) {
             std::cout << "One or both tables in JOIN do not exist." << std::endl;
             return;
         }
-        size_t eqPos = joinCondition.find('=');
-        if (eqPos == std::string::npos) {
-            std::cout << "Invalid join condition." << std::endl;
+        if (cached && fromCache({tableVersion(leftName), tableVersion(rightName)}))
             return;
-        }
-        std::string leftJoin = trim(joinCondition.substr(0, eqPos));
-        std::string rightJoin = trim(joinCondition.substr(eqPos + 1));
-        size_t dotPos = leftJoin.find('.');
-        if (dotPos != std::string::npos)
-            leftJoin = leftJoin.substr(dotPos + 1);
-        dotPos = rightJoin.find('.');
-        if (dotPos != std::string::npos)
-            rightJoin = rightJoin.substr(dotPos + 1);
-        
         Table& leftTable = tables[leftName];
         Table& rightTable = tables[rightName];
-        const auto& leftCols = leftTable.getColumns();
-        const auto& rightCols = rightTable.getColumns();
-        auto lit = std::find(leftCols.begin(), leftCols.end(), leftJoin);
-        auto rit = std::find(rightCols.begin(), rightCols.end(), rightJoin);
-        if (lit == leftCols.end() || rit == rightCols.end()) {
-            std::cout << "Join columns not found." << std::endl;
+        JoinPlan plan;
+        if (!Optimizer::planJoin(leftTable, leftName, rightTable, rightName, selectColumns, joinCondition,
+                                 condition, plan))
             return;
+
+        // Matches are written straight from both column stores as they are
+        // found, and probing stops once the LIMIT is reached. Conjuncts of
+        // the WHERE clause pushed below the join narrow each input first.
+        //
+        // ORDER BY, GROUP BY, HAVING and aggregates need every match first:
+        // the columns they and the select list read are copied into a
+        // temporary table, as "table.column" and, where it names the same
+        // column, plain "column", and that table's selectRows() sorts,
+        // groups, limits and projects them.
+        bool materialize = !orderByColumns.empty() || !groupByColumns.empty() || !havingCondition.empty();
+        for (const auto& col : selectColumns) {
+            std::string argument;
+            if (Aggregation::parseFunction(col, argument) != AggregateFunction::None)
+                materialize = true;
         }
-        int leftIdx = std::distance(leftCols.begin(), lit);
-        int rightIdx = std::distance(rightCols.begin(), rit);
-        
-        std::vector<std::vector<std::string>> joinResult;
-        std::vector<std::string> combinedHeader = leftCols;
-        for (const auto& col : rightCols)
-            combinedHeader.push_back(col);
-        
-        const auto& leftRows = leftTable.getRows();
-        const auto& rightRows = rightTable.getRows();
-        for (const auto& lrow : leftRows) {
-            for (const auto& rrow : rightRows) {
-                if (lrow[leftIdx] == rrow[rightIdx]) {
-                    std::vector<std::string> combinedRow = lrow;
-                    combinedRow.insert(combinedRow.end(), rrow.begin(), rrow.end());
-                    joinResult.push_back(combinedRow);
+        bool star = selectColumns.size() == 1 && selectColumns[0] == "*";
+        Table joined;
+        std::vector<std::pair<size_t, bool>> copied;
+        std::vector<std::string> joinedColumns = star ? std::vector<std::string>() : selectColumns;
+        if (materialize) {
+            std::string referenced;
+            for (const auto* list : {&selectColumns, &orderByColumns, &groupByColumns})
+                referenced += join(*list, " ");
+            referenced += " " + havingCondition;
+            for (int side = 0; side < 2; ++side) {
+                const Table& input = side ? rightTable : leftTable;
+                const std::string& name = side ? rightName : leftName;
+                for (size_t i = 0; i < input.getColumns().size(); ++i) {
+                    const std::string& column = input.getColumns()[i];
+                    bool plain = side == 0 || leftTable.getColumnIndex(column) < 0;
+                    if (star)
+                        joinedColumns.push_back(plain ? column : name + "." + column);
+                    else if (referenced.find(column) == std::string::npos)
+                        continue;
+                    joined.addColumn(name + "." + column, input.getColumnTypes()[i]);
+                    copied.emplace_back(i, side == 1);
+                    if (plain) {
+                        joined.addColumn(column, input.getColumnTypes()[i]);
+                        copied.emplace_back(i, side == 1);
+                    }
                 }
             }
         }
-        
-        std::vector<std::string> displayColumns;
-        if (selectColumns.size() == 1 && selectColumns[0] == "*")
-            displayColumns = combinedHeader;
-        else
-            displayColumns = selectColumns;
-        
-        std::vector<std::string> processedDisplayColumns;
-        for (const auto& col : displayColumns) {
-            std::string processed = col;
-            size_t dotPos = processed.find('.');
-            if (dotPos != std::string::npos)
-                processed = processed.substr(dotPos + 1);
-            processedDisplayColumns.push_back(processed);
-        }
-        
-        for (const auto& col : displayColumns)
-            std::cout << col << "\t";
-        std::cout << std::endl;
-        
-        for (const auto& row : joinResult) {
-            for (const auto& procCol : processedDisplayColumns) {
-                auto it = std::find(combinedHeader.begin(), combinedHeader.end(), procCol);
-                if (it != combinedHeader.end()) {
-                    int idx = std::distance(combinedHeader.begin(), it);
-                    std::cout << row[idx] << "\t";
+
+        Transaction own;
+        Transaction& txn = beginStatement(own);
+        bool run = !profile || profile->analyzing();
+        size_t parallelism = currentSession().parallelism;
+        QueryProfile::Stopwatch watch;
+        std::vector<size_t> inputRows[2];
+        size_t scans[2] = {0, 0};
+        for (int side = 0; side < 2; ++side) {
+            const Table& input = side ? rightTable : leftTable;
+            const ConditionExpression* filter = side ? plan.rightFilter.get() : plan.leftFilter.get();
+            if (profile) {
+                scans[side] = input.explainScan(*profile, side ? rightName : leftName, filter,
+                                                side ? plan.rightPredicate : plan.leftPredicate, parallelism);
+                watch = QueryProfile::Stopwatch();
+            }
+            if (filter && run && !plan.empty)
+                inputRows[side] = input.matchingRows(filter, txn, parallelism);
+            if (profile)
+                profile->record(scans[side], watch, profile->at(scans[side]).rowsIn,
+                                filter ? inputRows[side].size() : input.rowCount(),
+                                inputRows[side].capacity() * sizeof(size_t));
+        }
+        const std::vector<size_t>* leftRows = plan.leftFilter ? &inputRows[0] : nullptr;
+        const std::vector<size_t>* rightRows = plan.rightFilter ? &inputRows[1] : nullptr;
+        size_t leftSize = leftRows ? leftRows->size() : leftTable.rowCount();
+        size_t rightSize = rightRows ? rightRows->size() : rightTable.rowCount();
+        size_t joinStep = 0;
+        if (profile) {
+            joinStep = profile->add("Hash Join", {scans[0], scans[1]});
+            QueryProfile::Operator& op = profile->at(joinStep);
+            op.details.push_back("Hash cond: " + joinCondition);
+            if (run)
+                op.details.push_back(std::string("Build side: ") + (leftSize < rightSize ? leftName : rightName));
+            else
+                op.details.push_back("Build side: smaller input after filtering");
+            for (const auto& text : plan.residualText)
+                op.details.push_back("Join filter: " + text);
+            if (plan.empty)
+                op.details.push_back("WHERE is always false: no rows are read");
+            if (!materialize && (limit != Table::NoLimit || offset > 0))
+                op.details.push_back("Limit: " + (limit == Table::NoLimit ? std::string("none") : std::to_string(limit)) +
+                                     ", offset: " + std::to_string(offset));
+            op.details.push_back("Columns: " + join(materialize ? joined.getColumns() : plan.header, ", "));
+            watch = QueryProfile::Stopwatch();
+        }
+        if (run && !materialize) {
+            for (const auto& col : plan.header)
+                out << col << "\t";
+            out << std::endl;
+        }
+
+        std::string line;
+        std::vector<std::string> values(copied.size());
+        size_t skip = materialize ? 0 : offset;
+        size_t remaining = plan.empty || !run ? 0 : materialize ? Table::NoLimit : limit;
+        size_t written = 0;
+        size_t hashBytes = 0;
+        if (remaining > 0)
+            hashBytes = hashJoin(leftTable.getColumnData(plan.leftKey), rightTable.getColumnData(plan.rightKey),
+                                 [&](size_t lrow, size_t rrow) {
+                if (!leftTable.isVisible(lrow, txn) || !rightTable.isVisible(rrow, txn) ||
+                    !plan.residualHolds(leftTable, lrow, rightTable, rrow))
+                    return true;
+                if (skip > 0) {
+                    --skip;
+                    return true;
+                }
+                --remaining;
+                ++written;
+                if (materialize) {
+                    for (size_t i = 0; i < copied.size(); ++i) {
+                        const Table& side = copied[i].second ? rightTable : leftTable;
+                        values[i] = side.getValue(copied[i].second ? rrow : lrow, copied[i].first);
+                    }
+                    joined.addRow(values);
+                    return true;
                 }
+                line.clear();
+                for (const auto& column : plan.output) {
+                    const Table& side = column.second ? rightTable : leftTable;
+                    side.getColumnData(column.first).appendTo(column.second ? rrow : lrow, line);
+                    line += '\t';
+                }
+                out << line << '\n';
+                return remaining > 0;
+            }, leftRows, rightRows);
+        if (profile)
+            profile->record(joinStep, watch, plan.empty ? 0 : leftSize + rightSize, written, hashBytes);
+        if (materialize) {
+            if (profile)
+                profile->tableName = "join result";
+            joined.selectRows(joinedColumns, "", txn, orderByColumns, groupByColumns, havingCondition, limit, offset,
+                              parallelism, currentSession().sortMemory, nullptr, out, profile);
+            // The temporary table's scan, added right after the join, reads
+            // the join's output.
+            if (profile) {
+                QueryProfile::Operator& op = profile->at(joinStep + 1);
+                op.name = "Materialize";
+                op.inputs = {joinStep};
+            }
+        }
+        out << std::flush;
+        if (&txn == &own)
+            transactions.abort(own);
+        if (cached)
+            toCache();
+    }
+}
+
+void Database::scanStoredTable(const std::string& lowerName, const std::vector<std::string>& selectColumns,
+                               const std::string& condition, size_t limit, size_t offset,
+                               ConditionExpression* prepared, std::ostream& out) {
+    Table chunk = storage.tableSchema(lowerName);
+    ConditionExprPtr parsed;
+    ConditionExpression* where = prepared;
+    if (!where && !condition.empty()) {
+        parsed = ConditionParser(condition).parse();
+        where = parsed.get();
+    }
+    std::vector<std::string> displayColumns = selectColumns;
+    if (selectColumns.size() == 1 && selectColumns[0] == "*")
+        displayColumns = chunk.getColumns();
+    std::vector<int> projection;
+    for (const auto& col : displayColumns) {
+        int idx = chunk.getColumnIndex(col);
+        if (idx >= 0)
+            projection.push_back(idx);
+    }
+    for (const auto& col : displayColumns)
+        out << col << "\t";
+    out << std::endl;
+
+    // An unloaded table has not changed since it was stored, so every
+    // snapshot sees exactly the stored rows.
+    size_t parallelism = currentSession().parallelism;
+    std::string text;
+    auto writeChunk = [&]() {
+        if (where)
+            where->bind(chunk);
+        size_t wanted = limit > Table::NoLimit - offset ? Table::NoLimit : offset + limit;
+        text.clear();
+        for (size_t row : chunk.matchingRows(where, Transaction::latestCommitted(), parallelism, wanted)) {
+            if (limit == 0)
+                break;
+            if (offset > 0) {
+                --offset;
+                continue;
+            }
+            --limit;
+            for (int idx : projection) {
+                chunk.getColumnData(idx).appendTo(row, text);
+                text += '\t';
             }
-            std::cout << std::endl;
+            text += '\n';
         }
+        out << text;
+        chunk.clearRows();
+        return limit > 0;
+    };
+    bool more = limit > 0;
+    if (more) {
+        storage.scanTable(lowerName, [&](const std::vector<std::string>& values, uint64_t) {
+            chunk.addRow(values);
+            more = chunk.rowCount() < Table::MorselRows || writeChunk();
+            return more;
+        });
     }
+    if (more && chunk.rowCount() > 0)
+        writeChunk();
+    out << std::flush;
 }
 
-void Database::deleteRecords(const std::string& tableName, const std::string& condition) {
+void Database::explainSelect(const Query& query) {
+    QueryProfile profile(query.explainAnalyze);
+    QueryProfile::Stopwatch watch;
+    selectRecords(query.tableName, query.selectColumns, query.condition, query.orderByColumns, query.groupByColumns,
+                  query.havingCondition, query.isJoin, query.joinTable, query.joinCondition, query.limit,
+                  query.offset, nullptr, &profile);
+    profile.print(std::cout, watch.milliseconds());
+}
+
+void Database::deleteRecords(const std::string& tableName, const std::string& condition,
+                             ConditionExpression* prepared) {
     std::string lowerName = toLowerCase(tableName);
-    if (tables.find(lowerName) == tables.end()) {
+    Access access = lockTables({}, {lowerName});
+    if (!findTable(lowerName)) {
         std::cout << "Table " << tableName << " does not exist." << std::endl;
         return;
     }
-    tables[lowerName].deleteRows(condition);
-    std::cout << "Records deleted from " << tableName << "." << std::endl;
+    Transaction own;
+    Transaction& txn = beginStatement(own);
+    txn.touch(lowerName);
+    Table::ChangeMark mark = tables[lowerName].changeMark(txn);
+    bool ok = tables[lowerName].deleteRows(condition, txn, currentSession().parallelism, prepared);
+    if (ok) {
+        markDirty(lowerName);
+        logChanges(WalRecordType::Delete, tableName, txn, mark);
+    }
+    finishStatement(txn, ok, tableName);
+    access.release();
+    if (ok)
+        std::cout << "Records deleted from " << tableName << "." << std::endl;
+    endStatement(ok);
 }
 
 void Database::updateRecords(const std::string& tableName,
                              const std::vector<std::pair<std::string, std::string>>& updates,
-                             const std::string& condition) {
+                             const std::string& condition,
+                             ConditionExpression* prepared) {
     std::string lowerName = toLowerCase(tableName);
-    if (tables.find(lowerName) == tables.end()) {
+    Access access = lockTables({}, {lowerName});
+    if (!findTable(lowerName)) {
         std::cout << "Table " << tableName << " does not exist." << std::endl;
         return;
     }
-    tables[lowerName].updateRows(updates, condition);
-    std::cout << "Records updated in " << tableName << "." << std::endl;
+    Transaction own;
+    Transaction& txn = beginStatement(own);
+    txn.touch(lowerName);
+    Table::ChangeMark mark = tables[lowerName].changeMark(txn);
+    WriteResult result = tables[lowerName].updateRows(updates, condition, txn, currentSession().parallelism,
+                                                      prepared);
+    if (result == WriteResult::Violation) {
+        discardStatement(txn, lowerName, mark);
+        return;
+    }
+    bool ok = result == WriteResult::Ok;
+    if (ok) {
+        markDirty(lowerName);
+        logChanges(WalRecordType::Update, tableName, txn, mark);
+    }
+    finishStatement(txn, ok, tableName);
+    access.release();
+    if (ok)
+        std::cout << "Records updated in " << tableName << "." << std::endl;
+    endStatement(ok);
 }
 
 void Database::showTables() {
+    Access access = lockTables({}, {});
     std::cout << "Available Tables:" << std::endl;
     for (const auto& pair : tables)
         std::cout << pair.first << std::endl;
+    for (const auto& name : storedTables)
+        std::cout << name << std::endl;
 }
 
-// Transaction functions
+// Transaction functions. BEGIN only takes a snapshot; the cost of a
+// transaction is the versions it writes.
 void Database::beginTransaction() {
-    if (!inTransaction) {
-        backupTables = tables;
-        inTransaction = true;
+    Session& session = currentSession();
+    if (!session.inTransaction) {
+        session.txn = transactions.begin();
+        if (wal.isOpen() && !replaying)
+            session.logTxn = wal.append(0, WalRecordType::Begin, {});
+        session.inTransaction = true;
         std::cout << "Transaction started." << std::endl;
     } else {
         std::cout << "Transaction already in progress." << std::endl;
@@ -219,66 +1019,317 @@ void Database::beginTransaction() {
 }
 
 void Database::commitTransaction() {
-    if (!inTransaction) {
+    Session& session = currentSession();
+    if (!session.inTransaction) {
        std::cout << "No active transaction to commit." << std::endl;
        return;
     }
-    inTransaction = false;
-    backupTables.clear();
+    if (wal.isOpen() && !replaying)
+        wal.waitDurable(wal.append(session.logTxn, WalRecordType::Commit, {}));
+    {
+        Access access = lockTables({}, session.txn.tables);
+        commit(session.txn);
+    }
+    session.inTransaction = false;
+    maybeCheckpoint();
     std::cout << "Transaction committed." << std::endl;
 }
 
 void Database::rollbackTransaction() {
-    if (!inTransaction) {
+    Session& session = currentSession();
+    if (!session.inTransaction) {
        std::cout << "No active transaction to rollback." << std::endl;
        return;
     }
-    tables = backupTables;
-    backupTables.clear();
-    inTransaction = false;
+    abortSession(session);
     std::cout << "Transaction rolled back." << std::endl;
 }
 
+void Database::abortSession(Session& session) {
+    {
+        Access access = lockTables({}, session.txn.tables);
+        abort(session.txn);
+    }
+    session.inTransaction = false;
+    if (wal.isOpen() && !replaying)
+        wal.append(session.logTxn, WalRecordType::Rollback, {});
+}
+
+void Database::closeSession() {
+    std::thread::id self = std::this_thread::get_id();
+    Session* session;
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex);
+        auto it = sessions.find(self);
+        if (it == sessions.end())
+            return;
+        session = &it->second;
+    }
+    if (session->inTransaction)
+        abortSession(*session);
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    sessions.erase(self);
+}
+
+// Reads "n", "nKB", "nMB" or "nGB" as a number of bytes.
+static bool parseByteSize(const std::string& value, int64_t& bytes) {
+    std::string upperValue = toUpperCase(value);
+    int64_t unit = 1;
+    for (const auto& suffix : {std::make_pair("KB", 1 << 10), std::make_pair("MB", 1 << 20),
+                               std::make_pair("GB", 1 << 30)}) {
+        size_t length = std::strlen(suffix.first);
+        if (upperValue.size() > length && upperValue.compare(upperValue.size() - length, length, suffix.first) == 0) {
+            upperValue = trim(upperValue.substr(0, upperValue.size() - length));
+            unit = suffix.second;
+        }
+    }
+    int64_t amount = 0;
+    if (!Column::parseInt(upperValue, amount) || amount < 0 || amount > (INT64_MAX / unit))
+        return false;
+    bytes = amount * unit;
+    return true;
+}
+
+void Database::setVariable(const std::string& name, const std::string& value) {
+    std::string upperName = toUpperCase(name);
+    int64_t bytes = 0;
+    if (upperName == "SORT_MEMORY") {
+        if (!parseByteSize(value, bytes) || bytes < (int64_t(1) << 20)) {
+            std::cout << "Error: SORT_MEMORY must be at least 1MB." << std::endl;
+            return;
+        }
+        currentSession().sortMemory = static_cast<size_t>(bytes);
+        std::cout << "Sort memory set to " << bytes << " bytes." << std::endl;
+        return;
+    }
+    if (upperName == "RESULT_CACHE") {
+        if (!parseByteSize(value, bytes)) {
+            std::cout << "Error: RESULT_CACHE takes a size such as 0, 65536 or 64MB." << std::endl;
+            return;
+        }
+        resultCache.setCapacity(static_cast<size_t>(bytes));
+        if (bytes == 0)
+            std::cout << "Result cache disabled." << std::endl;
+        else
+            std::cout << "Result cache set to " << bytes << " bytes." << std::endl;
+        return;
+    }
+    if (upperName != "PARALLELISM") {
+        std::cout << "Unknown setting " << name << "." << std::endl;
+        return;
+    }
+    int64_t threads = 0;
+    if (!Column::parseInt(value, threads) || threads < 1) {
+        std::cout << "Error: PARALLELISM must be a positive integer." << std::endl;
+        return;
+    }
+    currentSession().parallelism = static_cast<size_t>(threads);
+    std::cout << "Parallelism set to " << threads << "." << std::endl;
+}
+
+void Database::showResultCache() {
+    ResultCache::Stats stats = resultCache.stats();
+    std::cout << "Result cache: " << stats.entries << " entries, " << stats.bytes << " of " << stats.capacity
+              << " bytes, " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions
+              << " evictions." << std::endl;
+}
+
+ResultCache::Stats Database::resultCacheStats() const {
+    return resultCache.stats();
+}
+
+bool Database::prepare(const std::string& name, const std::string& statement) {
+    Parser parser;
+    Query query = parser.parsePrepared(statement);
+    if (query.type != "SELECT" && query.type != "INSERT" && query.type != "REPLACE" &&
+        query.type != "UPDATE" && query.type != "DELETE") {
+        std::cout << "Error: Only SELECT, INSERT, REPLACE, UPDATE and DELETE can be prepared." << std::endl;
+        return false;
+    }
+    PreparedStatement prepared;
+    if (!query.condition.empty())
+        prepared.condition = ConditionParser(query.condition).parse();
+    prepared.query = std::move(query);
+    currentSession().prepared[toLowerCase(name)] = std::move(prepared);
+    std::cout << "Statement " << name << " prepared." << std::endl;
+    return true;
+}
+
+// The condition of a prepared statement with its parameters spelled out as
+// literals, as the result cache keys it.
+static std::string conditionText(const Query& query, const std::vector<std::string>& arguments) {
+    std::string text;
+    size_t copied = 0;
+    for (const auto& slot : query.parameterSlots) {
+        if (slot.kind != ParameterSlot::Kind::Condition)
+            continue;
+        text.append(query.condition, copied, slot.position - copied);
+        text += '\'';
+        for (char c : arguments[slot.parameter])
+            text += c == '\'' ? "''" : std::string(1, c);
+        text += '\'';
+        copied = slot.position + slot.length;
+    }
+    text.append(query.condition, copied, std::string::npos);
+    return text;
+}
+
+void Database::execute(const std::string& name, const std::vector<std::string>& arguments) {
+    Session& session = currentSession();
+    auto it = session.prepared.find(toLowerCase(name));
+    if (it == session.prepared.end()) {
+        std::cout << "Prepared statement " << name << " does not exist." << std::endl;
+        return;
+    }
+    Query& q = it->second.query;
+    ConditionExpression* condition = it->second.condition.get();
+    if (arguments.size() != q.parameterCount) {
+        std::cout << "Error: " << name << " takes " << q.parameterCount << " parameter(s), got "
+                  << arguments.size() << "." << std::endl;
+        return;
+    }
+    for (const auto& slot : q.parameterSlots) {
+        if (slot.kind == ParameterSlot::Kind::Value)
+            q.values[slot.row][slot.position] = arguments[slot.parameter];
+        else if (slot.kind == ParameterSlot::Kind::Update)
+            q.updates[slot.position].second = arguments[slot.parameter];
+    }
+    if (condition)
+        condition->setParameters(arguments);
+
+    if (q.type == "SELECT") {
+        selectRecords(q.tableName, q.selectColumns, conditionText(q, arguments), q.orderByColumns, q.groupByColumns,
+                      q.havingCondition, q.isJoin, q.joinTable, q.joinCondition, q.limit, q.offset, condition);
+    } else if (q.type == "INSERT") {
+        insertRecord(q.tableName, q.values);
+    } else if (q.type == "REPLACE") {
+        replaceInto(q.tableName, q.values);
+    } else if (q.type == "UPDATE") {
+        updateRecords(q.tableName, q.updates, conditionText(q, arguments), condition);
+    } else if (q.type == "DELETE") {
+        deleteRecords(q.tableName, conditionText(q, arguments), condition);
+    }
+}
+
+void Database::deallocate(const std::string& name) {
+    if (currentSession().prepared.erase(toLowerCase(name)) == 0) {
+        std::cout << "Prepared statement " << name << " does not exist." << std::endl;
+        return;
+    }
+    std::cout << "Statement " << name << " deallocated." << std::endl;
+}
+
 // New functionalities
 
 void Database::truncateTable(const std::string& tableName) {
+    Access access = lockCatalog();
     std::string lowerName = toLowerCase(tableName);
-    if (tables.find(lowerName) == tables.end()) {
+    if (!findTable(lowerName)) {
         std::cout << "Table " << tableName << " does not exist." << std::endl;
         return;
     }
+    if (!canChangeTable(lowerName, tableName))
+        return;
     tables[lowerName].clearRows();
+    markDirty(lowerName);
+    logOperation(WalRecordType::Truncate, {tableName});
     std::cout << "Table " << tableName << " truncated." << std::endl;
 }
 
 void Database::renameTable(const std::string& oldName, const std::string& newName) {
+    Access access = lockCatalog();
     std::string lowerOld = toLowerCase(oldName);
     std::string lowerNew = toLowerCase(newName);
-    if (tables.find(lowerOld) == tables.end()) {
+    if (!findTable(lowerOld)) {
         std::cout << "Table " << oldName << " does not exist." << std::endl;
         return;
     }
+    if (!canChangeTable(lowerOld, oldName))
+        return;
     tables[lowerNew] = tables[lowerOld];
+    // Saved under the new name, so its rows no longer match a stored file.
+    tables[lowerNew].setStoredLayoutCurrent(false);
     tables.erase(lowerOld);
+    tableLocks.erase(lowerOld);
+    tableLocks[lowerNew];
+    storedTables.erase(lowerNew);
+    markDirty(lowerNew);
+    bumpVersion(lowerOld);
+    for (auto& entry : indexes) {
+        if (entry.second.first == lowerOld)
+            entry.second.first = lowerNew;
+    }
+    logOperation(WalRecordType::RenameTable, {oldName, newName});
     std::cout << "Table " << oldName << " renamed to " << newName << "." << std::endl;
 }
 
-void Database::createIndex(const std::string& indexName, const std::string& tableName, const std::string& columnName) {
+void Database::createIndex(const std::string& indexName, const std::string& tableName, const std::string& columnName,
+                           const std::string& indexType) {
+    Access access = lockCatalog();
     std::string lowerTable = toLowerCase(tableName);
-    if (tables.find(lowerTable) == tables.end()) {
+    if (!findTable(lowerTable)) {
         std::cout << "Table " << tableName << " does not exist." << std::endl;
         return;
     }
-    indexes[toLowerCase(indexName)] = {lowerTable, columnName};
-    std::cout << "Index " << indexName << " created on " << tableName << "(" << columnName << ")." << std::endl;
+    std::string lowerIndex = toLowerCase(indexName);
+    if (indexes.find(lowerIndex) != indexes.end()) {
+        std::cout << "Index " << indexName << " already exists." << std::endl;
+        return;
+    }
+    IndexType type;
+    std::string upperType = toUpperCase(indexType);
+    if (upperType == "HASH") {
+        type = IndexType::Hash;
+    } else if (upperType == "BTREE") {
+        type = IndexType::BTree;
+    } else {
+        std::cout << "Unknown index type " << indexType << "." << std::endl;
+        return;
+    }
+    if (!tables[lowerTable].createIndex(columnName, type)) {
+        std::cout << "Column " << columnName << " does not exist in " << tableName << "." << std::endl;
+        return;
+    }
+    indexes[lowerIndex] = {lowerTable, columnName};
+    bumpVersion(lowerTable);
+    logOperation(WalRecordType::CreateIndex, {indexName, tableName, columnName, upperType});
+    std::cout << "Index " << indexName << " created on " << tableName << "(" << columnName << ") using "
+              << upperType << "." << std::endl;
 }
 
 void Database::dropIndex(const std::string& indexName) {
+    Access access = lockCatalog();
     std::string lowerIndex = toLowerCase(indexName);
-    if (indexes.erase(lowerIndex))
-        std::cout << "Index " << indexName << " dropped." << std::endl;
-    else
+    auto it = indexes.find(lowerIndex);
+    if (it == indexes.end()) {
         std::cout << "Index " << indexName << " does not exist." << std::endl;
+        return;
+    }
+    auto target = it->second;
+    indexes.erase(it);
+    // Several index names may share one physical index on the same column.
+    bool stillReferenced = false;
+    for (const auto& entry : indexes) {
+        if (entry.second == target)
+            stillReferenced = true;
+    }
+    auto tableIt = tables.find(target.first);
+    if (!stillReferenced && tableIt != tables.end()) {
+        tableIt->second.dropIndex(target.second);
+        bumpVersion(target.first);
+    }
+    logOperation(WalRecordType::DropIndex, {indexName});
+    std::cout << "Index " << indexName << " dropped." << std::endl;
+}
+
+// Removes index names that refer to 'tableName' (and 'columnName', if given).
+void Database::forgetIndexes(const std::string& tableName, const std::string& columnName) {
+    for (auto it = indexes.begin(); it != indexes.end();) {
+        if (it->second.first == tableName && (columnName.empty() || it->second.second == columnName))
+            it = indexes.erase(it);
+        else
+            ++it;
+    }
 }
 
 void Database::mergeRecords(const std::string& tableName, const std::string& mergeCommand) {
@@ -328,7 +1379,7 @@ void Database::mergeRecords(const std::string& tableName, const std::string& mer
         std::string alias = trim(trimmedExpr.substr(asPos + 2));
         // Remove quotes if the literal is quoted.
         if (!literal.empty() && literal.front() == '\'' && literal.back() == '\'' && literal.size() > 1)
-            literal = literal.substr(1, literal.size() - 2);
+            literal = Lexer::unquote(literal);
         srcRecord[toLowerCase(alias)] = literal;
     }
     
@@ -371,7 +1422,7 @@ void Database::mergeRecords(const std::string& tableName, const std::string& mer
                     val = srcRecord[refCol];
                 }
             } else if (!val.empty() && val.front() == '\'' && val.back() == '\'' && val.size() > 1) {
-                val = val.substr(1, val.size() - 2);
+                val = Lexer::unquote(val);
             }
             updateAssignments[col] = val;
         }
@@ -395,13 +1446,14 @@ void Database::mergeRecords(const std::string& tableName, const std::string& mer
             if (srcRecord.find(refCol) != srcRecord.end())
                 val = srcRecord[refCol];
         } else if (!val.empty() && val.front() == '\'' && val.back() == '\'' && val.size() > 1) {
-            val = val.substr(1, val.size() - 2);
+            val = Lexer::unquote(val);
         }
     }
     
     // --- Step 6: Apply the MERGE to the target table ---
     std::string lowerTable = toLowerCase(tableName);
-    if (tables.find(lowerTable) == tables.end()) {
+    Access access = lockTables({}, {lowerTable});
+    if (!findTable(lowerTable)) {
         std::cout << "MERGE: Table " << tableName << " does not exist." << std::endl;
         return;
     }
@@ -420,19 +1472,44 @@ void Database::mergeRecords(const std::string& tableName, const std::string& mer
     }
     
     bool matched = false;
-    // Check each row for a match on the ON condition.
-    for (auto &row : tables[lowerTable].getRowsNonConst()) {
-        if (row.size() > targetIndex && toLowerCase(row[targetIndex]) == toLowerCase(srcRecord[srcColumn])) {
+    WriteResult result = WriteResult::Ok;
+    Table& target = tables[lowerTable];
+    Transaction own;
+    Transaction& txn = beginStatement(own);
+    txn.touch(lowerTable);
+    Table::ChangeMark mark = target.changeMark(txn);
+    std::vector<std::pair<int, std::string>> assignments;
+    for (size_t j = 0; j < targetCols.size(); j++) {
+        auto it = updateAssignments.find(toLowerCase(targetCols[j]));
+        if (it != updateAssignments.end())
+            assignments.emplace_back(static_cast<int>(j), it->second);
+    }
+    // Matching on the primary key is a hash lookup. Otherwise check each
+    // visible row for a match on the ON condition; updated rows are appended
+    // as new versions, so stop at the rows that existed before.
+    if (targetIndex == target.primaryKeyColumn()) {
+        size_t row = target.findByPrimaryKey(srcRecord[srcColumn], txn);
+        if (row != Table::NoRow) {
+            result = target.updateRow(row, assignments, txn);
+            matched = true;
+        }
+    }
+    size_t rowCount = matched || targetIndex == target.primaryKeyColumn() ? 0 : target.rowCount();
+    for (size_t row = 0; row < rowCount && result == WriteResult::Ok; row++) {
+        if (!target.isVisible(row, txn))
+            continue;
+        if (toLowerCase(target.getValue(row, targetIndex)) == toLowerCase(srcRecord[srcColumn])) {
             // When matched, update the row using the UPDATE assignments.
-            for (size_t j = 0; j < targetCols.size(); j++) {
-                std::string colName = toLowerCase(targetCols[j]);
-                if (updateAssignments.find(colName) != updateAssignments.end()) {
-                    row[j] = updateAssignments[colName];
-                }
-            }
+            result = target.updateRow(row, assignments, txn);
             matched = true;
         }
     }
+    if (result == WriteResult::Conflict) {
+        finishStatement(txn, false, tableName);
+        access.release();
+        endStatement(false);
+        return;
+    }
     
     if (!matched) {
         // No matching row found; build a new row using the INSERT values.
@@ -444,51 +1521,99 @@ void Database::mergeRecords(const std::string& tableName, const std::string& mer
             else
                 newRow.push_back("");
         }
-        tables[lowerTable].addRow(newRow);
+        if (!tables[lowerTable].addRow(newRow, txn))
+            result = WriteResult::Violation;
+    }
+    if (result == WriteResult::Violation) {
+        discardStatement(txn, lowerTable, mark);
+        return;
     }
+    markDirty(lowerTable);
+    logChanges(WalRecordType::Merge, tableName, txn, mark);
+    finishStatement(txn, true, tableName);
+    access.release();
     
     std::cout << "MERGE command executed on " << tableName << "." << std::endl;
+    endStatement(true);
 }
 
 
 void Database::replaceInto(const std::string& tableName, const std::vector<std::vector<std::string>>& values) {
     std::string lowerName = toLowerCase(tableName);
-    if (tables.find(lowerName) == tables.end()) {
+    Access access = lockTables({}, {lowerName});
+    if (!findTable(lowerName)) {
         std::cout << "Table " << tableName << " does not exist." << std::endl;
         return;
     }
+    Table& table = tables[lowerName];
+    Transaction own;
+    Transaction& txn = beginStatement(own);
+    txn.touch(lowerName);
+    Table::ChangeMark mark = table.changeMark(txn);
+    WriteResult result = WriteResult::Ok;
+    int primaryKey = table.primaryKeyColumn();
     for (const auto& row : values) {
-        bool replaced = false;
-        for (auto& existingRow : tables[lowerName].getRowsNonConst()) {
-            if (!existingRow.empty() && !row.empty() && existingRow[0] == row[0]) {
-                existingRow = row;
-                replaced = true;
-                break;
+        // With a primary key the row to replace is one hash lookup away;
+        // otherwise it is the first row whose first column matches.
+        size_t existingRow = Table::NoRow;
+        if (primaryKey >= 0) {
+            if (static_cast<size_t>(primaryKey) < row.size())
+                existingRow = table.findByPrimaryKey(row[primaryKey], txn);
+        } else {
+            size_t rowCount = table.rowCount();
+            for (size_t candidate = 0; candidate < rowCount && !row.empty(); candidate++) {
+                if (table.isVisible(candidate, txn) && table.getValue(candidate, 0) == row[0]) {
+                    existingRow = candidate;
+                    break;
+                }
             }
         }
-        if (!replaced) {
-            tables[lowerName].addRow(row);
-        }
+        if (existingRow != Table::NoRow)
+            result = table.replaceRow(existingRow, row, txn);
+        else if (!table.addRow(row, txn))
+            result = WriteResult::Violation;
+        if (result != WriteResult::Ok)
+            break;
+    }
+    if (result == WriteResult::Violation) {
+        discardStatement(txn, lowerName, mark);
+        return;
+    }
+    if (result == WriteResult::Conflict) {
+        finishStatement(txn, false, tableName);
+        access.release();
+        endStatement(false);
+        return;
     }
+    markDirty(lowerName);
+    logChanges(WalRecordType::Replace, tableName, txn, mark);
+    finishStatement(txn, true, tableName);
+    access.release();
     std::cout << "REPLACE INTO executed on " << tableName << "." << std::endl;
+    endStatement(true);
 }
 
 void Database::sortPhotos(const std::string& tableName, const std::string& column, bool ascending) {
+    Access access = lockCatalog();
     std::string lowerName = toLowerCase(tableName);
-    if (tables.find(lowerName) == tables.end()) {
+    if (!findTable(lowerName)) {
         std::cout << "Table " << tableName << " does not exist." << std::endl;
         return;
     }
-    tables[lowerName].sortRows(column, ascending);
+    tables[lowerName].sortRows(column, ascending, currentSession().sortMemory, currentSession().parallelism);
+    markDirty(lowerName);
+    logOperation(WalRecordType::Sort, {tableName, column, ascending ? "1" : "0"});
     std::cout << "Photos sorted in " << tableName << "." << std::endl;
 }
 
 void Database::trackRecentPhoto(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(photoMutex);
     recentPhotos.push(filename);
     std::cout << "Photo " << filename << " tracked as recent." << std::endl;
 }
 
 void Database::showRecentPhotos() {
+    std::lock_guard<std::mutex> lock(photoMutex);
     std::cout << "Recent Photos:" << std::endl;
     while (!recentPhotos.empty()) {
         std::cout << recentPhotos.top() << std::endl;
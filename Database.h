@@ -6,19 +6,45 @@
 #include <unordered_map>
 #include "Table.h"
 #include "Storage.h"
+#include "WriteAheadLog.h"
+#include "Transaction.h"
+#include "ThreadPool.h"
+#include "Parser.h"
+#include "ResultCache.h"
 #include <queue>
+#include <unordered_set>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <condition_variable>
 
 class Database {
 public:
+    // Safe to share between threads. Each thread is a separate session with
+    // its own transaction; statements on different tables, and SELECTs on
+    // the same table, run concurrently. 'bufferFrames' sizes the page cache
+    // of the data directory: stored tables larger than it are scanned a page
+    // at a time rather than loaded.
+    explicit Database(size_t bufferFrames = 1024);
+    ~Database();
+
+    // Persistence: tables live in 'directory' and are read on first use.
+    // Every mutation is redo-logged before it is acknowledged; checkpoint()
+    // writes modified tables back and empties the log. open() replays the log.
+    bool open(const std::string& directory);
+    void checkpoint();
+
     // DDL
     void createTable(const std::string& tableName,
-                     const std::vector<std::pair<std::string, std::string>>& columns);
+                     const std::vector<std::pair<std::string, std::string>>& columns,
+                     const std::string& primaryKey = "");
     void dropTable(const std::string& tableName);
     void alterTableAddColumn(const std::string& tableName, const std::pair<std::string, std::string>& column);
     void alterTableDropColumn(const std::string& tableName, const std::string& columnName);
     void describeTable(const std::string& tableName);
 
-    // DML
+    // DML. A condition already parsed by a prepared statement is passed as
+    // 'prepared'; 'condition' is then its text with the arguments filled in.
     void insertRecord(const std::string& tableName,
                       const std::vector<std::vector<std::string>>& values);
     void selectRecords(const std::string& tableName,
@@ -29,22 +55,62 @@ public:
                        const std::string& havingCondition = "",
                        bool isJoin = false,
                        const std::string& joinTable = "",
-                       const std::string& joinCondition = "");
-    void deleteRecords(const std::string& tableName, const std::string& condition);
+                       const std::string& joinCondition = "",
+                       size_t limit = Table::NoLimit,
+                       size_t offset = 0,
+                       ConditionExpression* prepared = nullptr,
+                       QueryProfile* profile = nullptr);
+    // EXPLAIN [ANALYZE] SELECT ...: prints the plan of the SELECT in 'query':
+    // its scans and the indexes they use, the join algorithm, the sort
+    // strategy. With ANALYZE the statement also runs, with its rows
+    // discarded, and every operator reports wall time, rows in and out, peak
+    // memory and bytes spilled to disk.
+    void explainSelect(const Query& query);
+    void deleteRecords(const std::string& tableName, const std::string& condition,
+                       ConditionExpression* prepared = nullptr);
     void updateRecords(const std::string& tableName,
                        const std::vector<std::pair<std::string, std::string>>& updates,
-                       const std::string& condition);
+                       const std::string& condition,
+                       ConditionExpression* prepared = nullptr);
     void showTables();
 
-    // Transaction commands (simulated)
+    // Transactions: snapshot isolation over versioned rows. DDL is not
+    // transactional and takes effect immediately.
     void beginTransaction();
     void commitTransaction();
     void rollbackTransaction();
+    // Ends the calling thread's session: rolls back its open transaction and
+    // forgets its settings and prepared statements. A thread's sessions are
+    // closed when it exits; closing one earlier frees it sooner.
+    void closeSession();
+
+    // Session settings: SET PARALLELISM n (threads one scan may use) and
+    // SET SORT_MEMORY n[KB|MB|GB] (bytes a sort holds before spilling).
+    // SET RESULT_CACHE n[KB|MB|GB] sizes the result cache shared by all
+    // sessions; 0, the default, turns it off.
+    void setVariable(const std::string& name, const std::string& value);
+
+    // SELECT results are cached (see ResultCache.h) per table versions: every
+    // change to a table, and every commit touching it, gives it a new
+    // version. Statements inside an explicit transaction bypass the cache.
+    void showResultCache();
+    ResultCache::Stats resultCacheStats() const;
+
+    // Prepared statements, private to the session: PREPARE name AS statement
+    // and EXECUTE name(arg, ...). SELECT, INSERT, REPLACE, UPDATE and DELETE
+    // can be prepared, with $1, $2, ... standing for values and WHERE
+    // literals. The statement is parsed, and its condition compiled, once;
+    // each execution fills in the arguments and binds the condition to the
+    // table's current schema.
+    bool prepare(const std::string& name, const std::string& statement);
+    void execute(const std::string& name, const std::vector<std::string>& arguments);
+    void deallocate(const std::string& name);
 
     // New functionalities
     void truncateTable(const std::string& tableName);
     void renameTable(const std::string& oldName, const std::string& newName);
-    void createIndex(const std::string& indexName, const std::string& tableName, const std::string& columnName);
+    void createIndex(const std::string& indexName, const std::string& tableName, const std::string& columnName,
+                     const std::string& indexType = "HASH");
     void dropIndex(const std::string& indexName);
     void mergeRecords(const std::string& tableName, const std::string& mergeCommand);
     void replaceInto(const std::string& tableName, const std::vector<std::vector<std::string>>& values);
@@ -55,14 +121,123 @@ public:
     void showRecentPhotos();
 
 private:
+    // Locking. The catalog lock guards the set of tables and everything
+    // describing it (tables, tableLocks, storedTables, indexes): statements
+    // hold it shared, DDL and checkpoints exclusively. Each loaded table has
+    // its own reader-writer lock for its rows; SELECT takes it shared, DML
+    // exclusive. Lock order is the catalog first, then tables by name.
+    std::shared_mutex catalogLock;
     std::unordered_map<std::string, Table> tables;
-    bool inTransaction = false;
-    std::unordered_map<std::string, Table> backupTables;
+    std::unordered_map<std::string, std::shared_mutex> tableLocks;
+
+    // The locks one statement holds; released in reverse order.
+    class Access {
+    public:
+        Access() = default;
+        Access(Access&&) = default;
+        ~Access() { release(); }
+        void release();
 
-    // Simple index storage: indexName -> pair<tableName, columnName>
+    private:
+        friend class Database;
+        std::shared_lock<std::shared_mutex> catalogShared;
+        std::unique_lock<std::shared_mutex> catalogExclusive;
+        std::vector<std::shared_lock<std::shared_mutex>> readers;
+        std::vector<std::unique_lock<std::shared_mutex>> writers;
+    };
+    // Catalog shared plus the named tables, loading stored ones first. With
+    // 'streamLarge', stored tables larger than the buffer pool stay unloaded
+    // for scanStoredTable().
+    Access lockTables(const std::vector<std::string>& reads, const std::vector<std::string>& writes,
+                      bool streamLarge = false);
+    Access lockCatalog();
+
+    struct PreparedStatement {
+        Query query;                // arguments are written into its parameter slots
+        ConditionExprPtr condition; // the WHERE condition, parsed; null without one
+    };
+
+    // Transaction state belongs to the calling thread: each thread sharing
+    // the Database is its own session.
+    struct Session {
+        bool inTransaction = false;
+        Transaction txn;      // the open transaction, if inTransaction
+        uint64_t logTxn = 0;  // LSN of the open transaction's Begin record
+        size_t parallelism = ThreadPool::shared().size();
+        size_t sortMemory = RowSorter::DefaultMemoryBudget;
+        std::unordered_map<std::string, PreparedStatement> prepared; // by lower-case name
+    };
+    std::mutex sessionMutex;
+    std::unordered_map<std::thread::id, Session> sessions;
+    Session& currentSession();
+
+    TransactionManager transactions;
+
+    Storage storage;
+    bool persistent = false;
+    std::unordered_set<std::string> storedTables; // on disk, not loaded yet
+    std::mutex dirtyMutex;
+    std::unordered_set<std::string> dirtyTables;  // loaded and modified since the last checkpoint
+    std::unordered_map<std::string, uint64_t> tableVersions; // stamp of each table's last change
+    uint64_t versionClock = 0;
+    ResultCache resultCache;
+    WriteAheadLog wal;
+    bool replaying = false;
+
+    // Background removal of row versions no snapshot can see.
+    std::thread collector;
+    std::mutex collectorMutex;
+    std::condition_variable collectorWake;
+    bool stopping = false;
+
+    // Index names: indexName -> pair<tableName, columnName>. The index data
+    // itself lives in the Table so every row mutation keeps it current.
     std::unordered_map<std::string, std::pair<std::string, std::string>> indexes;
 
+    std::mutex photoMutex;
     std::priority_queue<std::string> recentPhotos;
+
+    Table* findTable(const std::string& lowerName);
+    // A plain SELECT (no ORDER BY, grouping or aggregates) on a stored table
+    // that is not loaded: its pages pass through the buffer pool into one
+    // chunk of Table::MorselRows rows at a time, which is filtered and
+    // projected, so memory stays bounded whatever the table's size.
+    void scanStoredTable(const std::string& lowerName, const std::vector<std::string>& selectColumns,
+                         const std::string& condition, size_t limit, size_t offset,
+                         ConditionExpression* prepared, std::ostream& out);
+    // False (with an error) if an open transaction has written to the table.
+    // Commit and abort find a transaction's versions by table name, and the
+    // log holds them as rows of the table's current columns, so the table
+    // cannot be dropped, renamed, truncated or altered under them.
+    bool canChangeTable(const std::string& lowerName, const std::string& tableName);
+    // Records a change to a table: it must be checkpointed, and cached
+    // results that read it are stale. Called with the table locked.
+    void markDirty(const std::string& lowerName);
+    void bumpVersion(const std::string& lowerName);
+    uint64_t tableVersion(const std::string& lowerName);
+    // A statement runs in the session's open transaction, or in one of its
+    // own that finishStatement() commits (or aborts, if the statement failed).
+    // Both are called with the statement's table locks held; endStatement()
+    // runs after they are released.
+    Transaction& beginStatement(Transaction& own);
+    void finishStatement(Transaction& txn, bool ok, const std::string& tableName);
+    void endStatement(bool ok);
+    void discardStatement(Transaction& txn, const std::string& lowerName, Table::ChangeMark mark);
+    void commit(Transaction& txn);
+    void abort(Transaction& txn);
+    // Aborts the session's open transaction and logs its rollback.
+    void abortSession(Session& session);
+    void collectGarbage();
+    void maybeCheckpoint();
+    void logOperation(WalRecordType type, const std::vector<std::string>& fields);
+    // Logs the rows a statement changed in 'tableName' since 'mark', and
+    // redoes them from the log.
+    void logChanges(WalRecordType type, const std::string& tableName, const Transaction& txn,
+                    Table::ChangeMark mark);
+    void redoChanges(const std::string& tableName, size_t endedCount, std::vector<std::vector<std::string>> rows);
+    void replay(const std::vector<WalRecord>& records);
+    void applyRecord(const WalRecord& record);
+    void forgetIndexes(const std::string& tableName, const std::string& columnName = "");
 };
 
 #endif // DATABASE_H
\ No newline at end of file
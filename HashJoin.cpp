@@ -0,0 +1,42 @@
+#include "HashJoin.h"
+#include <functional>
+
+uint64_t JoinHashTable::hashKey(const Column& column, size_t row, bool textKeys) {
+    if (textKeys)
+        return std::hash<std::string>()(column.get(row));
+    return column.hash(row);
+}
+
+JoinHashTable::JoinHashTable(const Column& keys, bool textKeys, const std::vector<size_t>* rows)
+    : keys(keys), textKeys(textKeys) {
+    size_t count = rows ? rows->size() : keys.size() - keys.nullCount();
+    if (count == 0)
+        return;
+    // Keep the load factor at or below one half.
+    size_t capacity = 1;
+    while (capacity < count * 2)
+        capacity <<= 1;
+    slots.assign(capacity, Slot{0, Empty});
+    mask = capacity - 1;
+    next.assign(keys.size(), Empty);
+    // Insert in reverse so that each chain ends up in ascending row order.
+    for (size_t i = rows ? rows->size() : keys.size(); i-- > 0;) {
+        size_t row = rows ? (*rows)[i] : i;
+        if (keys.isNull(row))
+            continue;
+        uint64_t h = hashKey(keys, row, textKeys);
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if (slot.head == Empty) {
+                slot.hash = h;
+                slot.head = row;
+                break;
+            }
+            if (slot.hash == h && keys.equals(slot.head, keys, row)) {
+                next[row] = slot.head;
+                slot.head = row;
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef HASHJOIN_H
+#define HASHJOIN_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "Column.h"
+
+// Flat open-addressing hash table from a join column's values to the row ids
+// holding them. Each slot stores a key hash and the first row of its key; rows
+// with equal keys are chained through 'next', in ascending row order. NULL
+// keys are never inserted, so they never join.
+class JoinHashTable {
+public:
+    // 'textKeys' hashes and compares canonical text, for joins between columns
+    // of different storage classes (e.g. INT = VARCHAR). Only 'rows' (in
+    // ascending order) are inserted if given.
+    JoinHashTable(const Column& keys, bool textKeys, const std::vector<size_t>* rows = nullptr);
+
+    // Calls fn(buildRow) for every build row whose key equals probe's 'row'.
+    template <typename Fn>
+    void forEachMatch(const Column& probe, size_t row, Fn fn) const {
+        if (probe.isNull(row) || slots.empty())
+            return;
+        uint64_t h = hashKey(probe, row, textKeys);
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if (slot.head == Empty)
+                return;
+            if (slot.hash == h && keys.equals(slot.head, probe, row)) {
+                for (size_t r = slot.head; r != Empty; r = next[r])
+                    fn(r);
+                return;
+            }
+        }
+    }
+
+    static uint64_t hashKey(const Column& column, size_t row, bool textKeys);
+    size_t memoryUsage() const { return slots.size() * sizeof(Slot) + next.size() * sizeof(size_t); }
+
+private:
+    static constexpr size_t Empty = SIZE_MAX;
+    struct Slot {
+        uint64_t hash;
+        size_t head;
+    };
+
+    const Column& keys;
+    bool textKeys;
+    std::vector<Slot> slots;
+    std::vector<size_t> next;
+    size_t mask = 0;
+};
+
+// Inner equi-join of left.leftCol = right.rightCol. Builds the hash table on
+// the smaller input and probes with the larger one, calling
+// emit(leftRow, rightRow) for each match without materializing joined rows.
+// Probing stops at the next probe row once emit returns false. 'leftRows'
+// and 'rightRows', if given, restrict the inputs to those rows (ascending),
+// e.g. the ones passing a filter pushed below the join. Returns the bytes
+// the hash table took.
+template <typename Emit>
+size_t hashJoin(const Column& leftKeys, const Column& rightKeys, Emit emit,
+              const std::vector<size_t>* leftRows = nullptr, const std::vector<size_t>* rightRows = nullptr) {
+    bool textKeys = leftKeys.getType() != rightKeys.getType();
+    size_t leftSize = leftRows ? leftRows->size() : leftKeys.size();
+    size_t rightSize = rightRows ? rightRows->size() : rightKeys.size();
+    bool buildLeft = leftSize < rightSize;
+    const Column& build = buildLeft ? leftKeys : rightKeys;
+    const Column& probe = buildLeft ? rightKeys : leftKeys;
+    const std::vector<size_t>* probeRows = buildLeft ? rightRows : leftRows;
+    JoinHashTable table(build, textKeys, buildLeft ? leftRows : rightRows);
+    bool more = true;
+    size_t probeSize = buildLeft ? rightSize : leftSize;
+    for (size_t i = 0; i < probeSize && more; ++i) {
+        size_t row = probeRows ? (*probeRows)[i] : i;
+        table.forEachMatch(probe, row, [&](size_t match) {
+            if (more)
+                more = buildLeft ? emit(match, row) : emit(row, match);
+        });
+    }
+    return table.memoryUsage();
+}
+
+#endif // HASHJOIN_H
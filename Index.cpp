@@ -1,19 +1,117 @@
 #include "Index.h"
+#include <algorithm>
 
-Index::Index(const std::string& columnName) : column(columnName) {}
+Index::Index(const std::string& columnName, IndexType type) : column(columnName), type(type) {}
 
-void Index::build(const std::vector<std::vector<std::string>>& rows, int colIndex) {
-    indexMap.clear();
-    for (int i = 0; i < rows.size(); i++) {
-        if (colIndex < rows[i].size()) {
-            indexMap[rows[i][colIndex]].push_back(i);
+void Index::build(const Column& data) {
+    clear();
+    if (type == IndexType::Hash) {
+        for (size_t i = 0; i < data.size(); i++) {
+            indexMap[data.get(i)].push_back(i);
+        }
+        return;
+    }
+    textKeys = data.getType() == ColumnType::String;
+    if (textKeys) {
+        std::vector<std::pair<std::string, size_t>> entries;
+        for (size_t i = 0; i < data.size(); i++) {
+            if (data.isNull(i))
+                nullRows.push_back(i);
+            else
+                entries.emplace_back(std::string(data.getString(i)), i);
         }
+        std::sort(entries.begin(), entries.end());
+        textTree.bulkLoad(entries);
+    } else {
+        std::vector<std::pair<uint64_t, size_t>> entries;
+        for (size_t i = 0; i < data.size(); i++) {
+            if (data.isNull(i))
+                nullRows.push_back(i);
+            else
+                entries.emplace_back(data.orderedKey(i), i);
+        }
+        std::sort(entries.begin(), entries.end());
+        numericTree.bulkLoad(entries);
+    }
+}
+
+void Index::insert(const Column& data, size_t row) {
+    if (type == IndexType::Hash) {
+        indexMap[data.get(row)].push_back(row);
+    } else if (data.isNull(row)) {
+        nullRows.insert(std::lower_bound(nullRows.begin(), nullRows.end(), row), row);
+    } else if (textKeys) {
+        textTree.insert(std::string(data.getString(row)), row);
+    } else {
+        numericTree.insert(data.orderedKey(row), row);
+    }
+}
+
+void Index::erase(const Column& data, size_t row) {
+    if (type == IndexType::Hash) {
+        auto it = indexMap.find(data.get(row));
+        if (it == indexMap.end())
+            return;
+        auto& rows = it->second;
+        rows.erase(std::remove(rows.begin(), rows.end(), row), rows.end());
+        if (rows.empty())
+            indexMap.erase(it);
+    } else if (data.isNull(row)) {
+        auto it = std::lower_bound(nullRows.begin(), nullRows.end(), row);
+        if (it != nullRows.end() && *it == row)
+            nullRows.erase(it);
+    } else if (textKeys) {
+        textTree.erase(std::string(data.getString(row)), row);
+    } else {
+        numericTree.erase(data.orderedKey(row), row);
+    }
+}
+
+void Index::clear() {
+    indexMap.clear();
+    numericTree.clear();
+    textTree.clear();
+    nullRows.clear();
+}
+
+void Index::renumber(const std::vector<size_t>& newIds) {
+    for (auto& entry : indexMap) {
+        for (size_t& row : entry.second)
+            row = newIds[row];
     }
+    for (size_t& row : nullRows)
+        row = newIds[row];
+    numericTree.renumber(newIds);
+    textTree.renumber(newIds);
 }
 
-std::vector<int> Index::lookup(const std::string& value) const {
+const std::vector<size_t>& Index::lookup(const std::string& value) const {
+    static const std::vector<size_t> none;
     auto it = indexMap.find(value);
     if (it != indexMap.end())
         return it->second;
-    return {};
-}
\ No newline at end of file
+    return none;
+}
+
+void Index::rangeLookup(const Bound& lo, const Bound& hi, std::vector<size_t>& rows) const {
+    auto collect = [&rows](size_t row) { rows.push_back(row); };
+    if (textKeys) {
+        textTree.scan(lo.open ? nullptr : &lo.text, lo.inclusive,
+                      hi.open ? nullptr : &hi.text, hi.inclusive, collect);
+    } else {
+        numericTree.scan(lo.open ? nullptr : &lo.number, lo.inclusive,
+                         hi.open ? nullptr : &hi.number, hi.inclusive, collect);
+    }
+}
+
+void Index::orderedRows(bool ascending, std::vector<size_t>& rows) const {
+    auto collect = [&rows](size_t row) { rows.push_back(row); };
+    if (ascending)
+        rows.insert(rows.end(), nullRows.begin(), nullRows.end());
+    if (textKeys)
+        textTree.scanAll(ascending, collect);
+    else
+        numericTree.scanAll(ascending, collect);
+    if (!ascending)
+        rows.insert(rows.end(), nullRows.rbegin(), nullRows.rend());
+}
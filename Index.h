@@ -4,17 +4,55 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include <cstdint>
+#include "Column.h"
+#include "BPlusTree.h"
 
+enum class IndexType { Hash, BTree };
+
+// Index over one column.
+// HASH keys are the canonical text of a cell (see Column::get), so NULL cells
+// are indexed under the empty string; it only answers equality.
+// BTREE keys compare by the column's type (Column::orderedKey for fixed-width
+// columns, raw bytes for text); NULL cells are kept aside and ordered first.
 class Index {
 public:
-    Index(const std::string& columnName);
-    // Build the index given table rows and the column index.
-    void build(const std::vector<std::vector<std::string>>& rows, int colIndex);
-    // Retrieve row indices for a given column value.
-    std::vector<int> lookup(const std::string& value) const;
+    // One end of a BTREE range. 'number' is an ordered key for fixed-width
+    // columns and 'text' the key for text columns.
+    struct Bound {
+        bool open = true;
+        bool inclusive = true;
+        uint64_t number = 0;
+        std::string text;
+    };
+
+    Index(const std::string& columnName = "", IndexType type = IndexType::Hash);
+    const std::string& getColumn() const { return column; }
+    IndexType getType() const { return type; }
+    // Build the index from the column's current contents.
+    void build(const Column& data);
+    // Keep the index in step with single-row changes. erase() must be called
+    // before the cell is overwritten.
+    void insert(const Column& data, size_t row);
+    void erase(const Column& data, size_t row);
+    void clear();
+    // Follows a compaction of the rows: row r becomes newIds[r], which must
+    // not decrease with r. Rows that were removed must be erased first.
+    void renumber(const std::vector<size_t>& newIds);
+    // Retrieve row indices for a given column value (HASH).
+    const std::vector<size_t>& lookup(const std::string& value) const;
+    // Append the rows whose key lies between 'lo' and 'hi' in key order (BTREE).
+    void rangeLookup(const Bound& lo, const Bound& hi, std::vector<size_t>& rows) const;
+    // Append every row in key order, NULLs first when ascending (BTREE).
+    void orderedRows(bool ascending, std::vector<size_t>& rows) const;
 private:
     std::string column;
-    std::unordered_map<std::string, std::vector<int>> indexMap;
+    IndexType type;
+    bool textKeys = false;
+    std::unordered_map<std::string, std::vector<size_t>> indexMap;
+    BPlusTree<uint64_t> numericTree;
+    BPlusTree<std::string> textTree;
+    std::vector<size_t> nullRows;
 };
 
-#endif // INDEX_H
\ No newline at end of file
+#endif // INDEX_H
@@ -0,0 +1,68 @@
+#include "Lexer.h"
+#include <cctype>
+#include <cstring>
+
+static bool isSymbolChar(char c) {
+    return c != '\0' && std::strchr("(),;=<>!*+-/%", c) != nullptr;
+}
+
+static bool isWordChar(char c) {
+    return !std::isspace(static_cast<unsigned char>(c)) && !isSymbolChar(c) && c != '\'' && c != '"';
+}
+
+void Lexer::tokenize(std::string_view source, std::vector<Token>& tokens) {
+    tokens.clear();
+    size_t pos = 0;
+    const size_t size = source.size();
+    while (true) {
+        while (pos < size && std::isspace(static_cast<unsigned char>(source[pos])))
+            ++pos;
+        if (pos == size)
+            break;
+        size_t start = pos;
+        char c = source[pos++];
+        TokenType type;
+        if (c == '\'' || c == '"') {
+            // An unterminated literal runs to the end of the statement.
+            type = TokenType::String;
+            while (pos < size) {
+                if (source[pos++] != c)
+                    continue;
+                if (pos < size && source[pos] == c) {
+                    ++pos;
+                    continue;
+                }
+                break;
+            }
+        } else if (isSymbolChar(c)) {
+            type = TokenType::Symbol;
+            if (pos < size && ((c == '<' && (source[pos] == '=' || source[pos] == '>')) ||
+                               ((c == '>' || c == '!') && source[pos] == '=')))
+                ++pos;
+        } else {
+            type = TokenType::Word;
+            while (pos < size && isWordChar(source[pos]))
+                ++pos;
+            if (c == '$' && pos - start > 1 &&
+                source.find_first_not_of("0123456789", start + 1) >= pos)
+                type = TokenType::Parameter;
+        }
+        tokens.push_back({type, source.substr(start, pos - start)});
+    }
+    tokens.push_back({TokenType::End, source.substr(size)});
+}
+
+std::string Lexer::unquote(std::string_view literal) {
+    std::string value;
+    if (literal.empty())
+        return value;
+    char quote = literal.front();
+    size_t end = literal.size() > 1 && literal.back() == quote ? literal.size() - 1 : literal.size();
+    value.reserve(end);
+    for (size_t i = 1; i < end; ++i) {
+        value += literal[i];
+        if (literal[i] == quote && i + 1 < end && literal[i + 1] == quote)
+            ++i;
+    }
+    return value;
+}
@@ -0,0 +1,31 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class TokenType { Word, String, Symbol, Parameter, End };
+
+// A token is a view into the statement it was read from, which must outlive it.
+//  Word:   keywords, names (including qualified ones such as t.col) and numbers.
+//  String: a quoted literal, quotes included; a doubled quote stands for itself.
+//  Symbol: punctuation and operators: ( ) , ; = < > <= >= <> != ! * + - / %
+//  Parameter: $1, $2, ... in a prepared statement.
+//  End:    closes every token list, with empty text at the end of the statement.
+struct Token {
+    TokenType type;
+    std::string_view text;
+};
+
+class Lexer {
+public:
+    // Splits 'source' into 'tokens' in one pass. 'tokens' is cleared first, so
+    // a caller can reuse one vector across statements.
+    static void tokenize(std::string_view source, std::vector<Token>& tokens);
+    // The value of a String token: its quotes dropped and each doubled quote
+    // collapsed, so 'it''s' is it's.
+    static std::string unquote(std::string_view literal);
+};
+
+#endif // LEXER_H
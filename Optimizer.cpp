@@ -0,0 +1,348 @@
+#include "Optimizer.h"
+#include "Table.h"
+#include "Utils.h"
+#include "Lexer.h"
+#include <iostream>
+#include <cctype>
+
+// --- Predicate rewrites ---
+
+static Predicate constant(bool value) {
+    Predicate predicate;
+    predicate.kind = value ? Predicate::Kind::True : Predicate::Kind::False;
+    return predicate;
+}
+
+static bool isQuoted(const std::string& text) {
+    return text.size() >= 2 && (text.front() == '\'' || text.front() == '"') && text.back() == text.front();
+}
+
+// A number or a quoted string where a column name is expected.
+static bool isConstantOperand(const std::string& text) {
+    double number;
+    if (isQuoted(text))
+        return true;
+    return !text.empty() && (std::isdigit(static_cast<unsigned char>(text[0])) || text[0] == '-' ||
+                             text[0] == '+' || text[0] == '.') &&
+           Column::parseFloat(text, number);
+}
+
+// Evaluates a comparison between two constants into 'result'. Numbers
+// compare as numbers and anything else as text.
+static bool foldComparison(const Predicate& comparison, bool& result) {
+    if (comparison.parameters[0] >= 0 || !isConstantOperand(comparison.column))
+        return false;
+    std::string left = comparison.column;
+    if (isQuoted(left))
+        left = Lexer::unquote(left);
+    const std::string& right = comparison.values[0];
+    double a, b;
+    int cmp;
+    if (!isQuoted(comparison.column) && Column::parseFloat(left, a) && Column::parseFloat(right, b))
+        cmp = a < b ? -1 : (a > b ? 1 : 0);
+    else
+        cmp = left.compare(right);
+    const std::string& op = comparison.op;
+    if (op == "=") result = cmp == 0;
+    else if (op == "!=") result = cmp != 0;
+    else if (op == "<") result = cmp < 0;
+    else if (op == "<=") result = cmp <= 0;
+    else if (op == ">") result = cmp > 0;
+    else if (op == ">=") result = cmp >= 0;
+    else return false;
+    return true;
+}
+
+static bool isEquality(const Predicate& predicate) {
+    return predicate.kind == Predicate::Kind::In ||
+           (predicate.kind == Predicate::Kind::Compare && predicate.op == "=");
+}
+
+// Merges the equalities on each column among the operands of an OR into one
+// IN list, kept where the first of them was.
+static void mergeEqualities(std::vector<Predicate>& operands) {
+    for (size_t i = 0; i < operands.size(); ++i) {
+        if (!isEquality(operands[i]))
+            continue;
+        for (size_t j = i + 1; j < operands.size();) {
+            if (!isEquality(operands[j]) || operands[j].column != operands[i].column) {
+                ++j;
+                continue;
+            }
+            Predicate& list = operands[i];
+            list.kind = Predicate::Kind::In;
+            list.op.clear();
+            list.values.insert(list.values.end(), operands[j].values.begin(), operands[j].values.end());
+            list.parameters.insert(list.parameters.end(), operands[j].parameters.begin(),
+                                   operands[j].parameters.end());
+            operands.erase(operands.begin() + j);
+        }
+    }
+}
+
+Predicate Optimizer::simplify(Predicate predicate) {
+    bool value;
+    switch (predicate.kind) {
+        case Predicate::Kind::Compare:
+            return foldComparison(predicate, value) ? constant(value) : predicate;
+        case Predicate::Kind::And:
+        case Predicate::Kind::Or:
+            break;
+        default:
+            return predicate;
+    }
+    // TRUE is the identity of AND and absorbs OR; FALSE the other way round.
+    bool isAnd = predicate.kind == Predicate::Kind::And;
+    Predicate::Kind identity = isAnd ? Predicate::Kind::True : Predicate::Kind::False;
+    std::vector<Predicate> operands;
+    for (auto& child : predicate.children) {
+        Predicate operand = simplify(std::move(child));
+        if (operand.kind == predicate.kind) {
+            for (auto& nested : operand.children)
+                operands.push_back(std::move(nested));
+        } else if (operand.kind == Predicate::Kind::True || operand.kind == Predicate::Kind::False) {
+            if (operand.kind != identity)
+                return operand;
+        } else {
+            operands.push_back(std::move(operand));
+        }
+    }
+    if (!isAnd)
+        mergeEqualities(operands);
+    if (operands.empty())
+        return constant(isAnd);
+    if (operands.size() == 1)
+        return std::move(operands[0]);
+    predicate.children = std::move(operands);
+    return predicate;
+}
+
+// Quotes literals that are not numbers, doubling quotes inside them.
+static std::string literalText(const std::string& value, int parameter) {
+    double number;
+    if (parameter >= 0)
+        return "$" + std::to_string(parameter + 1);
+    if (Column::parseFloat(value, number))
+        return value;
+    std::string text = "'";
+    for (char c : value)
+        text += c == '\'' ? "''" : std::string(1, c);
+    return text + "'";
+}
+
+std::string Optimizer::describe(const Predicate& predicate) {
+    switch (predicate.kind) {
+        case Predicate::Kind::True: return "TRUE";
+        case Predicate::Kind::False: return "FALSE";
+        case Predicate::Kind::Compare:
+            return predicate.column + " " + predicate.op + " " +
+                   literalText(predicate.values[0], predicate.parameters[0]);
+        case Predicate::Kind::In: {
+            std::string text = predicate.column + " IN (";
+            for (size_t i = 0; i < predicate.values.size(); ++i)
+                text += (i ? ", " : "") + literalText(predicate.values[i], predicate.parameters[i]);
+            return text + ")";
+        }
+        case Predicate::Kind::And:
+        case Predicate::Kind::Or:
+            break;
+    }
+    std::string text;
+    for (const auto& child : predicate.children) {
+        if (!text.empty())
+            text += predicate.kind == Predicate::Kind::And ? " AND " : " OR ";
+        bool nested = child.kind == Predicate::Kind::And || child.kind == Predicate::Kind::Or;
+        text += nested ? "(" + describe(child) + ")" : describe(child);
+    }
+    return text;
+}
+
+// --- Join planning ---
+
+namespace {
+struct JoinInputs {
+    const Table* tables[2];
+    std::string names[2];
+};
+}
+
+// Finds 'name' among the columns of the join's inputs. A qualifier naming
+// either table picks it; otherwise the preferred table is searched first.
+static bool resolve(const std::string& name, const JoinInputs& inputs, bool preferRight,
+                    size_t& column, bool& right) {
+    std::string bare = name;
+    size_t dot = name.find('.');
+    if (dot != std::string::npos) {
+        bare = name.substr(dot + 1);
+        std::string qualifier = name.substr(0, dot);
+        for (int side = 0; side < 2; ++side) {
+            if (equalsIgnoreCase(qualifier, inputs.names[side])) {
+                int index = inputs.tables[side]->getColumnIndex(bare);
+                if (index < 0)
+                    return false;
+                column = index;
+                right = side == 1;
+                return true;
+            }
+        }
+    }
+    for (int side : {preferRight ? 1 : 0, preferRight ? 0 : 1}) {
+        int index = inputs.tables[side]->getColumnIndex(bare);
+        if (index >= 0) {
+            column = index;
+            right = side == 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Rewrites the columns of 'predicate' to their unqualified names and returns
+// the inputs it reads: bit 0 for the left, bit 1 for the right. A column
+// neither input has makes its comparison FALSE.
+static int unqualify(Predicate& predicate, const JoinInputs& inputs) {
+    if (predicate.kind == Predicate::Kind::And || predicate.kind == Predicate::Kind::Or) {
+        int sides = 0;
+        for (auto& child : predicate.children)
+            sides |= unqualify(child, inputs);
+        return sides;
+    }
+    if (predicate.kind != Predicate::Kind::Compare && predicate.kind != Predicate::Kind::In)
+        return 0;
+    size_t column;
+    bool right;
+    if (!resolve(predicate.column, inputs, false, column, right)) {
+        predicate = constant(false);
+        return 0;
+    }
+    int side = right ? 1 : 0;
+    predicate.column = inputs.tables[side]->getColumns()[column];
+    return 1 << side;
+}
+
+// Builds the per-pair form of a conjunct reading both inputs, resolving each
+// (possibly qualified) column to its side.
+static JoinPredicate toJoinPredicate(const Predicate& predicate, const JoinInputs& inputs) {
+    JoinPredicate result;
+    result.kind = predicate.kind;
+    if (predicate.kind == Predicate::Kind::And || predicate.kind == Predicate::Kind::Or) {
+        for (const auto& child : predicate.children)
+            result.children.push_back(toJoinPredicate(child, inputs));
+        return result;
+    }
+    Predicate leaf = predicate;
+    int sides = unqualify(leaf, inputs);
+    result.right = sides == 2;
+    result.leaf = ConditionParser::build(leaf);
+    result.leaf->bind(*inputs.tables[result.right ? 1 : 0]);
+    return result;
+}
+
+bool JoinPredicate::evaluate(const Table& left, size_t leftRow, const Table& right, size_t rightRow) const {
+    switch (kind) {
+        case Predicate::Kind::And:
+            for (const auto& child : children) {
+                if (!child.evaluate(left, leftRow, right, rightRow))
+                    return false;
+            }
+            return true;
+        case Predicate::Kind::Or:
+            for (const auto& child : children) {
+                if (child.evaluate(left, leftRow, right, rightRow))
+                    return true;
+            }
+            return false;
+        default:
+            return this->right ? leaf->evaluate(right, rightRow) : leaf->evaluate(left, leftRow);
+    }
+}
+
+bool JoinPlan::residualHolds(const Table& left, size_t leftRow, const Table& right, size_t rightRow) const {
+    for (const auto& conjunct : residual) {
+        if (!conjunct.evaluate(left, leftRow, right, rightRow))
+            return false;
+    }
+    return true;
+}
+
+// Combines pushed-down conjuncts into one filter bound to 'table'.
+static ConditionExprPtr buildFilter(std::vector<Predicate>& conjuncts, const Table& table, Predicate& predicate) {
+    if (conjuncts.empty())
+        return nullptr;
+    predicate.kind = Predicate::Kind::And;
+    predicate.children = std::move(conjuncts);
+    predicate = Optimizer::simplify(std::move(predicate));
+    ConditionExprPtr filter = ConditionParser::build(predicate);
+    filter->bind(table);
+    return filter;
+}
+
+bool Optimizer::planJoin(const Table& left, const std::string& leftName,
+                         const Table& right, const std::string& rightName,
+                         const std::vector<std::string>& selectColumns,
+                         const std::string& joinCondition, const std::string& condition,
+                         JoinPlan& plan) {
+    JoinInputs inputs{{&left, &right}, {leftName, rightName}};
+    size_t eqPos = joinCondition.find('=');
+    if (eqPos == std::string::npos) {
+        std::cout << "Invalid join condition." << std::endl;
+        return false;
+    }
+    bool firstRight, secondRight;
+    if (!resolve(trim(joinCondition.substr(0, eqPos)), inputs, false, plan.leftKey, firstRight) ||
+        !resolve(trim(joinCondition.substr(eqPos + 1)), inputs, true, plan.rightKey, secondRight) ||
+        firstRight == secondRight) {
+        std::cout << "Join columns not found." << std::endl;
+        return false;
+    }
+    if (firstRight)
+        std::swap(plan.leftKey, plan.rightKey);
+
+    // Output columns; unknown ones keep their header but print nothing.
+    if (selectColumns.size() == 1 && selectColumns[0] == "*") {
+        for (int side = 0; side < 2; ++side) {
+            const auto& columns = inputs.tables[side]->getColumns();
+            for (size_t i = 0; i < columns.size(); ++i) {
+                plan.header.push_back(columns[i]);
+                plan.output.emplace_back(i, side == 1);
+            }
+        }
+    } else {
+        plan.header = selectColumns;
+        for (const auto& name : selectColumns) {
+            size_t column;
+            bool isRight;
+            if (resolve(name, inputs, false, column, isRight))
+                plan.output.emplace_back(column, isRight);
+        }
+    }
+
+    if (trim(condition).empty())
+        return true;
+    Predicate where = simplify(ConditionParser(condition).parsePredicate());
+    std::vector<Predicate> conjuncts;
+    if (where.kind == Predicate::Kind::And)
+        conjuncts = std::move(where.children);
+    else
+        conjuncts.push_back(std::move(where));
+    std::vector<Predicate> pushed[2];
+    for (auto& conjunct : conjuncts) {
+        Predicate bare = conjunct;
+        int sides = unqualify(bare, inputs);
+        bare = simplify(std::move(bare));
+        if (bare.kind == Predicate::Kind::True)
+            continue;
+        if (bare.kind == Predicate::Kind::False) {
+            plan.empty = true;
+            return true;
+        }
+        if (sides == 3) {
+            plan.residual.push_back(toJoinPredicate(conjunct, inputs));
+            plan.residualText.push_back(describe(conjunct));
+        } else
+            pushed[sides == 2 ? 1 : 0].push_back(std::move(bare));
+    }
+    plan.leftFilter = buildFilter(pushed[0], left, plan.leftPredicate);
+    plan.rightFilter = buildFilter(pushed[1], right, plan.rightPredicate);
+    return true;
+}
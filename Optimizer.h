@@ -0,0 +1,64 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "ConditionParser.h"
+
+class Table;
+
+// A WHERE conjunct reading both inputs of a join, checked on each joined
+// pair. Its leaves (comparisons and IN lists) are bound to their side's table.
+struct JoinPredicate {
+    Predicate::Kind kind = Predicate::Kind::True; // And, Or, or a leaf
+    bool right = false;                           // leaf: reads the right input
+    ConditionExprPtr leaf;
+    std::vector<JoinPredicate> children;
+
+    bool evaluate(const Table& left, size_t leftRow, const Table& right, size_t rightRow) const;
+};
+
+// How a two-table equi-join runs. WHERE conjuncts reading one input are
+// pushed below the join as that input's filter, so only matching rows are
+// hashed and probed; the others are checked per joined pair. Only the join
+// keys and the output columns are resolved, never a combined row.
+struct JoinPlan {
+    size_t leftKey = 0;
+    size_t rightKey = 0;
+    ConditionExprPtr leftFilter;  // bound to the left table; null keeps every row
+    ConditionExprPtr rightFilter; // bound to the right table
+    Predicate leftPredicate;      // the filters' logical form, for EXPLAIN
+    Predicate rightPredicate;
+    std::vector<JoinPredicate> residual;
+    std::vector<std::string> residualText;
+    bool empty = false;           // the WHERE clause can never hold
+    std::vector<std::string> header;
+    std::vector<std::pair<size_t, bool>> output; // column, true for the right input
+
+    bool residualHolds(const Table& left, size_t leftRow, const Table& right, size_t rightRow) const;
+};
+
+// Rule-based rewrites applied between the parser and execution.
+class Optimizer {
+public:
+    // Folds comparisons between constants ('1 = 1'), flattens nested AND and
+    // OR, drops the TRUE and FALSE operands that leaves redundant, and merges
+    // equalities on one column under an OR (a = 1 OR a = 2) into an IN list.
+    static Predicate simplify(Predicate predicate);
+    // Condition text for a predicate, as EXPLAIN prints it.
+    static std::string describe(const Predicate& predicate);
+
+    // Plans 'left JOIN right ON joinCondition WHERE condition'. A column may
+    // be qualified by its table's name; an unqualified one is looked up in
+    // the left table first (the right one for the right side of the ON
+    // equality). Prints an error and returns false if the ON clause is not
+    // an equality between a column of each table.
+    static bool planJoin(const Table& left, const std::string& leftName,
+                         const Table& right, const std::string& rightName,
+                         const std::vector<std::string>& selectColumns,
+                         const std::string& joinCondition, const std::string& condition,
+                         JoinPlan& plan);
+};
+
+#endif // OPTIMIZER_H
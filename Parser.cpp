@@ -1,280 +1,506 @@
 #include "Parser.h"
 #include "Utils.h"
-#include <sstream>
-#include <algorithm>
 #include <unordered_set>
 #include <iostream>
 
-Query Parser::parseQuery(const std::string& queryStr) {
-    Query q;
-    std::istringstream iss(queryStr);
-    std::string word;
-    iss >> word;
-    std::string command = toUpperCase(word);
-
-    if (command == "CREATE") {
-        iss >> word;
-        if (toUpperCase(word) == "TABLE") {
-            q.type = "CREATE";
-            iss >> q.tableName;
-            q.columns = extractColumns(queryStr);
-    
-            // Validate duplicate column names and data types.
-            std::unordered_set<std::string> seen;
-            for (const auto &colPair : q.columns) {
-                if (seen.find(colPair.first) != seen.end()) {
-                    std::cerr << "Error: Duplicate column name '" << colPair.first 
-                              << "' in CREATE TABLE statement." << std::endl;
-                    q.columns.clear();
-                    return q;
-                }
-                seen.insert(colPair.first);
-                if (!isValidDataType(colPair.second)) {
-                    std::cerr << "Error: Invalid data type '" << colPair.second 
-                              << "' for column '" << colPair.first << "'." << std::endl;
-                    q.columns.clear();
-                    return q;
-                }
-            }
-        } else if (toUpperCase(word) == "INDEX") {
-            q.type = "CREATEINDEX";
-            iss >> q.indexName;
-            iss >> word; // Expect "ON"
-            iss >> q.tableName;
-            size_t parenStart = queryStr.find('(', queryStr.find(q.tableName));
-            size_t parenEnd = queryStr.find(')', parenStart);
-            if (parenStart != std::string::npos && parenEnd != std::string::npos) {
-                std::string col = queryStr.substr(parenStart + 1, parenEnd - parenStart - 1);
-                q.columnName = trim(col);
-            }
-        }
-    } else if (command == "INSERT") {
-        q.type = "INSERT";
-        iss >> word; // Expect "INTO"
-        iss >> q.tableName;
-        q.values = extractValues(queryStr);
-    } else if (command == "SELECT") {
-        q.type = "SELECT";
-        q.selectColumns = extractSelectColumns(queryStr);
-        size_t fromPos = toUpperCase(queryStr).find("FROM");
-        if (fromPos != std::string::npos) {
-            std::istringstream issFrom(queryStr.substr(fromPos + 4));
-            issFrom >> q.tableName;
-        }
-        q.condition = extractCondition(queryStr);
-        size_t orderPos = toUpperCase(queryStr).find("ORDER BY");
-        if (orderPos != std::string::npos) {
-            size_t endPos = queryStr.find_first_of("\n;", orderPos);
-            std::string orderStr = queryStr.substr(orderPos + 8, endPos - orderPos - 8);
-            std::istringstream issOrder(orderStr);
-            std::string token;
-            while (std::getline(issOrder, token, ',')) {
-                q.orderByColumns.push_back(trim(token));
-            }
+const Token& Parser::peek(size_t ahead) const {
+    return tokens[std::min(current + ahead, tokens.size() - 1)];
+}
+
+bool Parser::isWord(const char* keyword, size_t ahead) const {
+    const Token& token = peek(ahead);
+    return token.type == TokenType::Word && equalsIgnoreCase(token.text, keyword);
+}
+
+bool Parser::acceptWord(const char* keyword) {
+    if (failed || !isWord(keyword))
+        return false;
+    ++current;
+    return true;
+}
+
+bool Parser::accept(const char* symbol) {
+    if (failed || peek().type != TokenType::Symbol || peek().text != symbol)
+        return false;
+    ++current;
+    return true;
+}
+
+void Parser::expectWord(const char* keyword) {
+    if (!acceptWord(keyword))
+        fail();
+}
+
+void Parser::expect(const char* symbol) {
+    if (!accept(symbol))
+        fail();
+}
+
+std::string Parser::readName() {
+    if (failed || peek().type != TokenType::Word) {
+        fail();
+        return "";
+    }
+    return std::string(tokens[current++].text);
+}
+
+void Parser::fail() {
+    if (failed)
+        return;
+    failed = true;
+    if (peek().type == TokenType::End)
+        std::cerr << "Error: Syntax error at end of statement." << std::endl;
+    else
+        std::cerr << "Error: Syntax error near '" << peek().text << "'." << std::endl;
+}
+
+bool Parser::isClauseKeyword(size_t index) const {
+    static const char* const keywords[] = {"FROM", "JOIN", "INNER", "ON", "WHERE", "HAVING", "LIMIT", "OFFSET"};
+    const Token& token = tokens[index];
+    if (token.type != TokenType::Word)
+        return false;
+    for (const char* keyword : keywords) {
+        if (equalsIgnoreCase(token.text, keyword))
+            return true;
+    }
+    return (equalsIgnoreCase(token.text, "GROUP") || equalsIgnoreCase(token.text, "ORDER")) &&
+           tokens[index + 1].type == TokenType::Word && equalsIgnoreCase(tokens[index + 1].text, "BY");
+}
+
+size_t Parser::skipExpression(bool commas, bool clauses) {
+    size_t start = current;
+    size_t depth = 0;
+    for (; tokens[current].type != TokenType::End; ++current) {
+        const Token& token = tokens[current];
+        if (token.type == TokenType::Parameter && !conditionParameters) {
+            fail();
+            break;
         }
-        size_t groupPos = toUpperCase(queryStr).find("GROUP BY");
-        if (groupPos != std::string::npos) {
-            size_t endPos = queryStr.find_first_of("\n;", groupPos);
-            std::string groupStr = queryStr.substr(groupPos + 8, endPos - groupPos - 8);
-            std::istringstream issGroup(groupStr);
-            std::string token;
-            while (std::getline(issGroup, token, ',')) {
-                q.groupByColumns.push_back(trim(token));
+        if (token.type == TokenType::Symbol) {
+            if (token.text == "(") {
+                ++depth;
+            } else if (token.text == ")") {
+                if (depth == 0)
+                    break;
+                --depth;
+            } else if (commas && depth == 0 && token.text == ",") {
+                break;
             }
+        } else if (clauses && depth == 0 && isClauseKeyword(current)) {
+            break;
         }
-        size_t havingPos = toUpperCase(queryStr).find("HAVING");
-        if (havingPos != std::string::npos) {
-            q.havingCondition = trim(queryStr.substr(havingPos + 6));
+    }
+    return start;
+}
+
+// Statement text covered by tokens [from, to), as written.
+std::string Parser::text(size_t from, size_t to) const {
+    if (from >= to)
+        return "";
+    const char* begin = tokens[from].text.data();
+    const char* end = tokens[to - 1].text.data() + tokens[to - 1].text.size();
+    return std::string(begin, end - begin);
+}
+
+// Reads a condition up to the next clause.
+std::string Parser::readClause() {
+    size_t start = skipExpression(false, true);
+    if (start == current)
+        fail();
+    return text(start, current);
+}
+
+// Reads a comma-separated list (select columns, GROUP BY, ORDER BY).
+std::vector<std::string> Parser::readList() {
+    std::vector<std::string> items;
+    do {
+        size_t start = skipExpression(true, true);
+        if (start == current) {
+            fail();
+            break;
         }
-        size_t joinPos = toUpperCase(queryStr).find("JOIN");
-        if (joinPos != std::string::npos) {
-            q.isJoin = true;
-            std::istringstream issJoin(queryStr.substr(joinPos + 4));
-            issJoin >> q.joinTable;
-            size_t onPos = toUpperCase(queryStr).find("ON", joinPos);
-            if (onPos != std::string::npos) {
-                std::string joinCond = queryStr.substr(onPos + 2);
-                joinCond = trim(joinCond);
-                if (!joinCond.empty() && joinCond.back() == ';') {
-                    joinCond.pop_back();
-                    joinCond = trim(joinCond);
-                }
-                q.joinCondition = joinCond;
-            }
+        items.push_back(text(start, current));
+    } while (accept(","));
+    return items;
+}
+
+static std::string unquote(std::string value) {
+    if (value.size() > 1 && value.front() == '\'' && value.back() == '\'')
+        return Lexer::unquote(value);
+    return value;
+}
+
+bool Parser::atValueParameter() const {
+    if (!preparing || peek().type != TokenType::Parameter)
+        return false;
+    const Token& after = peek(1);
+    if (after.type == TokenType::Symbol)
+        return after.text == "," || after.text == ")";
+    return after.type == TokenType::End || isClauseKeyword(current + 1);
+}
+
+void Parser::addParameter(Query& q, const Token& token, ParameterSlot slot) {
+    // "$n" with n from 1 to 65535
+    if (token.text.size() > 6 || token.text[1] == '0') {
+        fail();
+        return;
+    }
+    size_t number = 0;
+    for (char digit : token.text.substr(1))
+        number = number * 10 + static_cast<size_t>(digit - '0');
+    if (number > 65535) {
+        fail();
+        return;
+    }
+    slot.parameter = number - 1;
+    q.parameterCount = std::max(q.parameterCount, number);
+    q.parameterSlots.push_back(slot);
+}
+
+// Reads "(v1, v2, ...)" as the next row of q.values; an empty value is NULL.
+std::vector<std::string> Parser::readRow(Query& q) {
+    std::vector<std::string> row;
+    expect("(");
+    if (failed)
+        return row;
+    do {
+        if (atValueParameter()) {
+            addParameter(q, peek(), {ParameterSlot::Kind::Value, 0, q.values.size(), row.size(), 0});
+            row.emplace_back(tokens[current++].text);
+            continue;
         }
-    } else if (command == "DELETE") {
+        size_t start = skipExpression(true, false);
+        row.push_back(unquote(text(start, current)));
+    } while (accept(","));
+    expect(")");
+    return row;
+}
+
+// Reads a WHERE condition into q.condition, with the offsets of its parameters.
+void Parser::readWhere(Query& q) {
+    size_t start = current;
+    conditionParameters = preparing;
+    q.condition = readClause();
+    conditionParameters = false;
+    for (size_t i = start; i < current && !failed; ++i) {
+        if (tokens[i].type != TokenType::Parameter)
+            continue;
+        size_t offset = tokens[i].text.data() - tokens[start].text.data();
+        addParameter(q, tokens[i], {ParameterSlot::Kind::Condition, 0, 0, offset, tokens[i].text.size()});
+    }
+}
+
+// Skips the size arguments of a type such as VARCHAR(20) or NUMERIC(10, 2).
+void Parser::skipTypeArguments() {
+    if (accept("(")) {
+        skipExpression(false, false);
+        expect(")");
+    }
+}
+
+Query Parser::parseQuery(const std::string& query) {
+    return parse(query, false);
+}
+
+Query Parser::parsePrepared(const std::string& query) {
+    return parse(query, true);
+}
+
+Query Parser::parse(const std::string& queryStr, bool prepared) {
+    Lexer::tokenize(queryStr, tokens);
+    current = 0;
+    failed = false;
+    preparing = prepared;
+    Query q;
+
+    if (acceptWord("CREATE")) {
+        if (acceptWord("TABLE"))
+            parseCreateTable(q);
+        else if (acceptWord("INDEX"))
+            parseCreateIndex(q);
+        else
+            return q;
+    } else if (acceptWord("INSERT")) {
+        q.type = "INSERT";
+        parseInsert(q);
+    } else if (acceptWord("SELECT")) {
+        parseSelect(q);
+    } else if (acceptWord("DELETE")) {
         q.type = "DELETE";
-        iss >> word; // Expect "FROM"
-        iss >> q.tableName;
-        q.condition = extractCondition(queryStr);
-    } else if (command == "UPDATE") {
-        q.type = "UPDATE";
-        iss >> q.tableName;
-        q.updates = extractUpdates(queryStr);
-        q.condition = extractCondition(queryStr);
-    } else if (command == "DROP") {
-        iss >> word;
-        if (toUpperCase(word) == "TABLE") {
+        expectWord("FROM");
+        q.tableName = readName();
+        if (acceptWord("WHERE"))
+            readWhere(q);
+    } else if (acceptWord("UPDATE")) {
+        parseUpdate(q);
+    } else if (acceptWord("DROP")) {
+        if (acceptWord("TABLE")) {
             q.type = "DROP";
-            iss >> q.tableName;
-        } else if (toUpperCase(word) == "INDEX") {
+            q.tableName = readName();
+        } else if (acceptWord("INDEX")) {
             q.type = "DROPINDEX";
-            iss >> q.indexName;
+            q.indexName = readName();
+        } else {
+            return q;
         }
-    } else if (command == "ALTER") {
-        q.type = "ALTER";
-        iss >> word; // Expect "TABLE"
-        iss >> q.tableName;
-        iss >> word; // Expect action: ADD, DROP, or RENAME
-        q.alterAction = toUpperCase(word);
-        if (q.alterAction == "ADD") {
-            std::string nextToken;
-            if (iss >> nextToken) {
-                if (toUpperCase(nextToken) == "COLUMN") {
-                    std::string colName, colType;
-                    iss >> colName >> colType;
-                    q.alterColumn = { colName, colType };
-                } else {
-                    std::string colName = nextToken;
-                    std::string colType;
-                    iss >> colType;
-                    q.alterColumn = { colName, colType };
-                }
-            }
-        } else if (q.alterAction == "DROP") {
-            iss >> word;
-            if (toUpperCase(word) == "COLUMN")
-                iss >> q.alterColumn.first;
-            else
-                q.alterColumn.first = word;
-        } else if (q.alterAction == "RENAME") {
-            iss >> word; // Expect "TO"
-            iss >> q.newTableName;
-        }
-    } else if (command == "DESCRIBE") {
+    } else if (acceptWord("ALTER")) {
+        parseAlter(q);
+    } else if (acceptWord("DESCRIBE")) {
         q.type = "DESCRIBE";
-        iss >> q.tableName;
-    } else if (command == "SHOW") {
-        q.type = "SHOW";
-    } else if (command == "BEGIN") {
-        q.type = "BEGIN";
-    } else if (command == "COMMIT") {
-        q.type = "COMMIT";
-    } else if (command == "ROLLBACK") {
-        q.type = "ROLLBACK";
-    } else if (command == "TRUNCATE") {
+        q.tableName = readName();
+    } else if (isWord("SHOW") && isWord("CACHE", 1)) {
+        q.type = "SHOWCACHE";
+        current += 2;
+    } else if (isWord("SHOW") || isWord("BEGIN") || isWord("COMMIT") || isWord("ROLLBACK")) {
+        // Anything after the keyword (SHOW TABLES, BEGIN TRANSACTION) is ignored.
+        q.type = toUpperCase(std::string(peek().text));
+        current = tokens.size() - 1;
+    } else if (acceptWord("SET")) {
+        // SET name value, or SET name = value
+        q.type = "SET";
+        q.settingName = readName();
+        accept("=");
+        size_t start = skipExpression(false, false);
+        if (start == current)
+            fail();
+        q.settingValue = text(start, current);
+    } else if (acceptWord("TRUNCATE")) {
         q.type = "TRUNCATE";
-        iss >> word; // Expect "TABLE"
-        iss >> q.tableName;
-    } else if (command == "MERGE") {
+        acceptWord("TABLE");
+        q.tableName = readName();
+    } else if (acceptWord("MERGE")) {
+        // The rest of the statement is interpreted by Database::mergeRecords.
         q.type = "MERGE";
-        iss >> word; // Expect "INTO"
-        iss >> q.tableName;
-        size_t pos = queryStr.find(q.tableName);
-        q.mergeCommand = trim(queryStr.substr(pos + q.tableName.size()));
-    } else if (command == "REPLACE") {
+        expectWord("INTO");
+        q.tableName = readName();
+        q.mergeCommand = text(current, tokens.size() - 1);
+        current = tokens.size() - 1;
+    } else if (acceptWord("REPLACE")) {
         q.type = "REPLACE";
-        iss >> word; // Expect "INTO"
-        iss >> q.tableName;
-        q.values = extractValues(queryStr);
+        parseInsert(q);
+    } else if (acceptWord("PREPARE")) {
+        // PREPARE name AS statement; the statement is parsed by parsePrepared().
+        q.type = "PREPARE";
+        q.statementName = readName();
+        expectWord("AS");
+        if (!failed && peek().type == TokenType::End)
+            fail();
+        q.statementText = text(current, tokens.size() - 1);
+        current = tokens.size() - 1;
+    } else if (acceptWord("EXECUTE")) {
+        parseExecute(q);
+    } else if (acceptWord("EXPLAIN")) {
+        bool analyze = acceptWord("ANALYZE");
+        if (!isWord("SELECT")) {
+            std::cerr << "Error: EXPLAIN supports SELECT statements only." << std::endl;
+            return Query();
+        }
+        ++current;
+        parseSelect(q);
+        q.type = "EXPLAIN";
+        q.explainAnalyze = analyze;
+    } else if (acceptWord("DEALLOCATE")) {
+        q.type = "DEALLOCATE";
+        acceptWord("PREPARE");
+        q.statementName = readName();
+    } else {
+        return q;
     }
+
+    if (!failed && peek().type != TokenType::End)
+        fail();
+    if (failed)
+        return Query();
     return q;
 }
 
-std::vector<std::vector<std::string>> Parser::extractValues(const std::string& query) {
-    std::vector<std::vector<std::string>> values;
-    size_t start = 0;
-    while ((start = query.find('(', start)) != std::string::npos) {
-        ++start;
-        size_t end = query.find(')', start);
-        if (end == std::string::npos) break;
-        std::string valuesStr = query.substr(start, end - start);
-        std::istringstream iss(valuesStr);
-        std::string value;
-        std::vector<std::string> valueSet;
-        while (std::getline(iss, value, ',')) {
-            value = trim(value);
-            if (!value.empty() && value.front() == '\'' && value.back() == '\'' && value.size() > 1)
-                value = value.substr(1, value.size() - 2);
-            valueSet.push_back(value);
+// CREATE TABLE name (col type [PRIMARY KEY], ... [, PRIMARY KEY (col)])
+void Parser::parseCreateTable(Query& q) {
+    q.type = "CREATE";
+    q.tableName = readName();
+    expect("(");
+    std::vector<std::string> primaryKeys;
+    do {
+        if (isWord("PRIMARY") && isWord("KEY", 1)) {
+            // Table constraint: PRIMARY KEY (col)
+            current += 2;
+            expect("(");
+            primaryKeys.push_back(readName());
+            expect(")");
+            continue;
+        }
+        std::string name = readName();
+        std::string type = readName();
+        skipTypeArguments();
+        // Column constraints; only PRIMARY KEY has an effect.
+        while (!failed && peek().type == TokenType::Word) {
+            if (isWord("PRIMARY") && isWord("KEY", 1)) {
+                current += 2;
+                primaryKeys.push_back(name);
+            } else {
+                ++current;
+            }
+        }
+        q.columns.emplace_back(std::move(name), std::move(type));
+    } while (accept(","));
+    expect(")");
+    if (failed)
+        return;
+
+    if (primaryKeys.size() > 1) {
+        std::cerr << "Error: A table can have only one PRIMARY KEY column." << std::endl;
+        q.columns.clear();
+        return;
+    }
+    if (!primaryKeys.empty())
+        q.primaryKey = primaryKeys[0];
+
+    // Validate duplicate column names and data types.
+    std::unordered_set<std::string> seen;
+    for (const auto &colPair : q.columns) {
+        if (seen.find(colPair.first) != seen.end()) {
+            std::cerr << "Error: Duplicate column name '" << colPair.first
+                      << "' in CREATE TABLE statement." << std::endl;
+            q.columns.clear();
+            return;
+        }
+        seen.insert(colPair.first);
+        if (!isValidDataType(colPair.second)) {
+            std::cerr << "Error: Invalid data type '" << colPair.second
+                      << "' for column '" << colPair.first << "'." << std::endl;
+            q.columns.clear();
+            return;
         }
-        values.push_back(valueSet);
-        start = end + 1;
     }
-    return values;
 }
 
-std::vector<std::pair<std::string, std::string>> Parser::extractColumns(const std::string& query) {
-    std::vector<std::pair<std::string, std::string>> cols;
-    size_t start = query.find('(');
-    size_t end = query.find(')', start);
-    if (start == std::string::npos || end == std::string::npos)
-        return cols;
-    std::string colsStr = query.substr(start + 1, end - start - 1);
-    std::istringstream iss(colsStr);
-    std::string col;
-    while (std::getline(iss, col, ',')) {
-        std::istringstream colStream(col);
-        std::string colName, colType;
-        colStream >> colName >> colType;
-        cols.emplace_back(trim(colName), trim(colType));
+// CREATE INDEX name ON table (col) [USING HASH | BTREE]
+void Parser::parseCreateIndex(Query& q) {
+    q.type = "CREATEINDEX";
+    q.indexName = readName();
+    expectWord("ON");
+    q.tableName = readName();
+    if (acceptWord("USING"))
+        q.indexType = toUpperCase(readName());
+    expect("(");
+    q.columnName = readName();
+    expect(")");
+    if (acceptWord("USING"))
+        q.indexType = toUpperCase(readName());
+}
+
+// INSERT | REPLACE INTO table [VALUES] (row), (row), ...
+void Parser::parseInsert(Query& q) {
+    expectWord("INTO");
+    q.tableName = readName();
+    acceptWord("VALUES");
+    do {
+        q.values.push_back(readRow(q));
+    } while (accept(","));
+}
+
+// SELECT list FROM table [[INNER] JOIN table ON cond] [WHERE cond]
+//     [GROUP BY list] [HAVING cond] [ORDER BY list] [LIMIT n [OFFSET m]]
+void Parser::parseSelect(Query& q) {
+    q.type = "SELECT";
+    q.selectColumns = readList();
+    expectWord("FROM");
+    q.tableName = readName();
+    if (isWord("JOIN") || (isWord("INNER") && isWord("JOIN", 1))) {
+        current += isWord("INNER") ? 2 : 1;
+        q.isJoin = true;
+        q.joinTable = readName();
+        expectWord("ON");
+        q.joinCondition = readClause();
+    }
+    while (!failed && peek().type != TokenType::End) {
+        if (acceptWord("WHERE")) {
+            readWhere(q);
+        } else if (isWord("GROUP") && isWord("BY", 1)) {
+            current += 2;
+            q.groupByColumns = readList();
+        } else if (acceptWord("HAVING")) {
+            q.havingCondition = readClause();
+        } else if (isWord("ORDER") && isWord("BY", 1)) {
+            current += 2;
+            q.orderByColumns = readList();
+        } else if (acceptWord("LIMIT")) {
+            parseLimit(q);
+        } else {
+            fail();
+        }
     }
-    return cols;
 }
 
-std::vector<std::pair<std::string, std::string>> Parser::extractUpdates(const std::string& query) {
-    std::vector<std::pair<std::string, std::string>> updates;
-    size_t pos = toUpperCase(query).find("SET");
-    if (pos == std::string::npos)
-        return updates;
-    pos += 3;
-    size_t endPos = toUpperCase(query).find("WHERE", pos);
-    std::string updatesStr = (endPos == std::string::npos) ? query.substr(pos) : query.substr(pos, endPos - pos);
-    std::istringstream iss(updatesStr);
-    std::string update;
-    while (std::getline(iss, update, ',')) {
-        size_t eq = update.find('=');
-        if (eq == std::string::npos) continue;
-        std::string col = trim(update.substr(0, eq));
-        std::string val = trim(update.substr(eq + 1));
-        if (!val.empty() && val.front() == '\'' && val.back() == '\'' && val.size() > 1)
-            val = val.substr(1, val.size() - 2);
-        updates.emplace_back(col, val);
+// Reads "n [OFFSET m]" into q.limit and q.offset.
+void Parser::parseLimit(Query& q) {
+    auto readCount = [&](size_t& out) {
+        const Token& token = peek();
+        if (token.type != TokenType::Word || token.text.size() > 18 ||
+            token.text.find_first_not_of("0123456789") != std::string_view::npos)
+            return false;
+        out = 0;
+        for (char digit : token.text)
+            out = out * 10 + static_cast<size_t>(digit - '0');
+        ++current;
+        return true;
+    };
+    if (!readCount(q.limit) || (acceptWord("OFFSET") && !readCount(q.offset))) {
+        std::cerr << "Error: LIMIT and OFFSET take non-negative integers." << std::endl;
+        failed = true;
     }
-    return updates;
 }
 
-std::vector<std::string> Parser::extractSelectColumns(const std::string& query) {
-    std::vector<std::string> cols;
-    size_t start = toUpperCase(query).find("SELECT");
-    if (start == std::string::npos) return cols;
-    start += 6;
-    size_t end = toUpperCase(query).find("FROM", start);
-    if (end == std::string::npos) return cols;
-    std::string colsStr = query.substr(start, end - start);
-    std::istringstream iss(colsStr);
-    std::string col;
-    while (std::getline(iss, col, ',')) {
-        cols.push_back(trim(col));
+// UPDATE table SET col = value, ... [WHERE cond]
+void Parser::parseUpdate(Query& q) {
+    q.type = "UPDATE";
+    q.tableName = readName();
+    expectWord("SET");
+    do {
+        std::string column = readName();
+        expect("=");
+        if (atValueParameter()) {
+            addParameter(q, peek(), {ParameterSlot::Kind::Update, 0, 0, q.updates.size(), 0});
+            q.updates.emplace_back(std::move(column), std::string(tokens[current++].text));
+            continue;
+        }
+        size_t start = skipExpression(true, true);
+        q.updates.emplace_back(std::move(column), unquote(text(start, current)));
+    } while (accept(","));
+    if (acceptWord("WHERE"))
+        readWhere(q);
+}
+
+// ALTER TABLE table ADD [COLUMN] col type | DROP [COLUMN] col | RENAME TO name
+void Parser::parseAlter(Query& q) {
+    q.type = "ALTER";
+    expectWord("TABLE");
+    q.tableName = readName();
+    if (acceptWord("ADD")) {
+        q.alterAction = "ADD";
+        acceptWord("COLUMN");
+        q.alterColumn.first = readName();
+        q.alterColumn.second = readName();
+        skipTypeArguments();
+    } else if (acceptWord("DROP")) {
+        q.alterAction = "DROP";
+        acceptWord("COLUMN");
+        q.alterColumn.first = readName();
+    } else if (acceptWord("RENAME")) {
+        q.alterAction = "RENAME";
+        expectWord("TO");
+        q.newTableName = readName();
+    } else {
+        fail();
     }
-    return cols;
 }
 
-std::string Parser::extractCondition(const std::string& query) {
-    size_t pos = toUpperCase(query).find("WHERE");
-    if (pos == std::string::npos)
-        return "";
-    size_t endPos = std::string::npos;
-    size_t orderPos = toUpperCase(query).find("ORDER BY", pos);
-    size_t groupPos = toUpperCase(query).find("GROUP BY", pos);
-    size_t havingPos = toUpperCase(query).find("HAVING", pos);
-    if (orderPos != std::string::npos)
-        endPos = orderPos;
-    if (groupPos != std::string::npos && (endPos == std::string::npos || groupPos < endPos))
-        endPos = groupPos;
-    if (havingPos != std::string::npos && (endPos == std::string::npos || havingPos < endPos))
-        endPos = havingPos;
-    if (endPos == std::string::npos)
-        return trim(query.substr(pos + 5));
-    return trim(query.substr(pos + 5, endPos - pos - 5));
+// EXECUTE name [(arg, ...)]
+void Parser::parseExecute(Query& q) {
+    q.type = "EXECUTE";
+    q.statementName = readName();
+    if (peek().type == TokenType::Symbol && peek().text == "(" && peek(1).text == ")")
+        current += 2;
+    else if (peek().type == TokenType::Symbol && peek().text == "(")
+        q.arguments = readRow(q);
 }
@@ -2,13 +2,29 @@
 #define PARSER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include "Lexer.h"
 
+// Where a parameter ($1, $2, ...) of a prepared statement appears.
+struct ParameterSlot {
+    enum class Kind { Value, Update, Condition };
+    Kind kind;
+    size_t parameter; // 0 for $1
+    size_t row;       // Value: the row of 'values'
+    size_t position;  // Value: column in the row; Update: index in 'updates';
+                      // Condition: offset of the "$n" text in 'condition'
+    size_t length;    // Condition: length of the "$n" text
+};
+
+// A parsed statement. Clause texts (conditions, list items, values) are
+// copied out of the statement once, with their original spelling.
 struct Query {
-    std::string type;  // e.g. CREATE, INSERT, SELECT, UPDATE, DELETE, DROP, ALTER, DESCRIBE, BEGIN, COMMIT, ROLLBACK, TRUNCATE, RENAME, CREATEINDEX, DROPINDEX, MERGE, REPLACE
+    std::string type;  // e.g. CREATE, INSERT, SELECT, UPDATE, DELETE, DROP, ALTER, DESCRIBE, BEGIN, COMMIT, ROLLBACK, TRUNCATE, RENAME, CREATEINDEX, DROPINDEX, MERGE, REPLACE, SET, SHOWCACHE, PREPARE, EXECUTE, DEALLOCATE, EXPLAIN
     std::string tableName;
     // For CREATE TABLE: list of (column name, type)
     std::vector<std::pair<std::string, std::string>> columns;
+    std::string primaryKey; // PRIMARY KEY column, if declared
     // For INSERT and REPLACE: list of rows (each row is a list of values)
     std::vector<std::vector<std::string>> values;
     // For UPDATE: list of (column, new value)
@@ -21,6 +37,9 @@ struct Query {
     // ORDER BY and GROUP BY
     std::vector<std::string> orderByColumns;
     std::vector<std::string> groupByColumns;
+    // LIMIT n OFFSET m; 'limit' stays at its maximum when there is no LIMIT.
+    size_t limit = static_cast<size_t>(-1);
+    size_t offset = 0;
     // For ALTER TABLE: action and column info
     std::string alterAction; // "ADD" or "DROP" or "RENAME"
     std::pair<std::string, std::string> alterColumn; // column name and type (for ADD)
@@ -35,18 +54,78 @@ struct Query {
     // For INDEX operations
     std::string indexName;
     std::string columnName; // used in CREATE INDEX
+    std::string indexType = "HASH"; // CREATE INDEX ... USING HASH | BTREE
     // For MERGE
     std::string mergeCommand;
+    // For SET
+    std::string settingName;
+    std::string settingValue;
+    // For PREPARE, EXECUTE and DEALLOCATE
+    std::string statementName;
+    std::string statementText;           // PREPARE: the statement after AS
+    std::vector<std::string> arguments;  // EXECUTE
+    // EXPLAIN [ANALYZE] SELECT ...: the SELECT's fields are filled in as usual.
+    bool explainAnalyze = false;
+    // Parameters of a statement parsed with Parser::parsePrepared().
+    size_t parameterCount = 0;
+    std::vector<ParameterSlot> parameterSlots;
 };
 
+// Recursive-descent parser over the tokens of one statement. The statement
+// is lexed once and every clause is read in a single left-to-right pass.
 class Parser {
 public:
+    // Returns a Query with an empty type for an unknown command, and prints
+    // an error and returns an empty Query for a malformed one.
     Query parseQuery(const std::string& query);
-    std::vector<std::vector<std::string>> extractValues(const std::string& query);
-    std::vector<std::pair<std::string, std::string>> extractColumns(const std::string& query);
-    std::vector<std::pair<std::string, std::string>> extractUpdates(const std::string& query);
-    std::vector<std::string> extractSelectColumns(const std::string& query);
-    std::string extractCondition(const std::string& query);
+    // Parses a statement for PREPARE: $1, $2, ... may stand for a whole value
+    // of a VALUES row or a SET assignment, or for the literal of a WHERE
+    // comparison. Query::parameterSlots records where each one is.
+    Query parsePrepared(const std::string& query);
+
+private:
+    std::vector<Token> tokens; // reused across statements
+    size_t current = 0;
+    bool failed = false;
+    bool preparing = false;
+    bool conditionParameters = false; // parameters allowed in the expression being read
+
+    Query parse(const std::string& query, bool prepared);
+
+    const Token& peek(size_t ahead = 0) const;
+    bool isWord(const char* keyword, size_t ahead = 0) const;
+    bool acceptWord(const char* keyword);
+    bool accept(const char* symbol);
+    void expectWord(const char* keyword);
+    void expect(const char* symbol);
+    std::string readName();
+    // Prints a syntax error at the current token; only the first one counts.
+    void fail();
+
+    bool isClauseKeyword(size_t index) const;
+    // Skips one expression and returns the index of its first token. It ends
+    // at the end of the statement, at a ')' closing a '(' opened before it,
+    // at a top-level ',' if 'commas', and at a top-level clause keyword
+    // (FROM, JOIN, ON, WHERE, GROUP BY, ...) if 'clauses'.
+    size_t skipExpression(bool commas, bool clauses);
+    std::string text(size_t from, size_t to) const;
+    std::string readClause();
+    std::vector<std::string> readList();
+    std::vector<std::string> readRow(Query& q);
+    void readWhere(Query& q);
+    // True if the next token is a parameter making up a whole value.
+    bool atValueParameter() const;
+    void addParameter(Query& q, const Token& token, ParameterSlot slot);
+    void skipTypeArguments();
+
+    void parseCreateTable(Query& q);
+    void parseCreateIndex(Query& q);
+    void parseInsert(Query& q);
+    void parseSelect(Query& q);
+    void parseLimit(Query& q);
+    void parseUpdate(Query& q);
+    void parseAlter(Query& q);
+    void parseExecute(Query& q);
 };
 
 #endif // PARSER_H
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "QueryProfile.h"
+#include <iomanip>
+#include <sstream>
+
+size_t QueryProfile::add(const std::string& name, std::vector<size_t> inputs) {
+    Operator op;
+    op.name = name;
+    op.inputs = std::move(inputs);
+    operators.push_back(std::move(op));
+    return operators.size() - 1;
+}
+
+void QueryProfile::record(size_t id, const Stopwatch& watch, size_t rowsIn, size_t rowsOut,
+                          size_t memoryPeak, size_t spillBytes) {
+    Operator& op = operators[id];
+    op.milliseconds = watch.milliseconds();
+    op.rowsIn = rowsIn;
+    op.rowsOut = rowsOut;
+    op.memoryPeak = memoryPeak;
+    op.spillBytes = spillBytes;
+}
+
+std::string QueryProfile::formatBytes(size_t bytes) {
+    static const char* units[] = {"B", "KB", "MB", "GB"};
+    double value = static_cast<double>(bytes);
+    size_t unit = 0;
+    while (value >= 1024 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        value /= 1024;
+        ++unit;
+    }
+    std::ostringstream text;
+    if (unit == 0)
+        text << bytes << " B";
+    else
+        text << std::fixed << std::setprecision(1) << value << ' ' << units[unit];
+    return text.str();
+}
+
+void QueryProfile::print(std::ostream& out, double totalMilliseconds) const {
+    if (operators.empty())
+        return;
+    print(out, operators.size() - 1, 0);
+    if (analyze)
+        out << "Execution time: " << std::fixed << std::setprecision(3) << totalMilliseconds << " ms"
+            << std::defaultfloat << std::endl;
+}
+
+void QueryProfile::print(std::ostream& out, size_t id, size_t depth) const {
+    const Operator& op = operators[id];
+    std::string indent(depth * 4, ' ');
+    out << indent << "-> " << op.name << std::endl;
+    for (const auto& detail : op.details)
+        out << indent << "     " << detail << std::endl;
+    if (analyze)
+        out << indent << "     Actual: time=" << std::fixed << std::setprecision(3) << op.milliseconds
+            << std::defaultfloat << " ms, rows in=" << op.rowsIn << ", rows out=" << op.rowsOut
+            << ", memory peak=" << formatBytes(op.memoryPeak) << ", spill=" << formatBytes(op.spillBytes)
+            << std::endl;
+    for (size_t input : op.inputs)
+        print(out, input, depth + 1);
+}
@@ -0,0 +1,66 @@
+#ifndef QUERYPROFILE_H
+#define QUERYPROFILE_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <cstddef>
+
+// The operators of one SELECT, as EXPLAIN prints them. Plain EXPLAIN only
+// records the plan; EXPLAIN ANALYZE runs the statement and also records, per
+// operator, its wall time, rows in and out, peak memory and bytes spilled to
+// disk. Operators form a tree: each is added after its inputs, and the last
+// one added is the root.
+class QueryProfile {
+public:
+    struct Operator {
+        std::string name;                 // e.g. "Hash Join"
+        std::vector<std::string> details; // e.g. "Filter: v > 1"
+        std::vector<size_t> inputs;
+        double milliseconds = 0;
+        size_t rowsIn = 0;
+        size_t rowsOut = 0;
+        size_t memoryPeak = 0;
+        size_t spillBytes = 0;
+    };
+
+    class Stopwatch {
+    public:
+        Stopwatch() : start(std::chrono::steady_clock::now()) {}
+        double milliseconds() const {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    private:
+        std::chrono::steady_clock::time_point start;
+    };
+
+    explicit QueryProfile(bool analyze) : analyze(analyze) {}
+    bool analyzing() const { return analyze; }
+
+    // The table a single-table statement reads, for naming its scan.
+    std::string tableName;
+
+    // Adds an operator reading from the operators 'inputs'; returns its id.
+    size_t add(const std::string& name, std::vector<size_t> inputs = {});
+    Operator& at(size_t id) { return operators[id]; }
+    bool empty() const { return operators.empty(); }
+    // Records what operator 'id' did since 'watch' started.
+    void record(size_t id, const Stopwatch& watch, size_t rowsIn, size_t rowsOut,
+                size_t memoryPeak = 0, size_t spillBytes = 0);
+
+    // Prints the tree from the root, each operator indented under the one
+    // reading it, then the total time when analyzing.
+    void print(std::ostream& out, double totalMilliseconds = 0) const;
+
+    // 1536 -> "1.5 KB".
+    static std::string formatBytes(size_t bytes);
+
+private:
+    bool analyze;
+    std::vector<Operator> operators;
+
+    void print(std::ostream& out, size_t id, size_t depth) const;
+};
+
+#endif // QUERYPROFILE_H
@@ -0,0 +1,74 @@
+#include "ResultCache.h"
+
+void ResultCache::setCapacity(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = bytes;
+    evictTo(capacity);
+}
+
+bool ResultCache::enabled() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return capacity > 0;
+}
+
+bool ResultCache::lookup(const std::string& key, const std::vector<uint64_t>& versions, std::string& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = byKey.find(key);
+    if (it == byKey.end() || it->second->versions != versions) {
+        if (it != byKey.end())
+            erase(it->second);
+        ++misses;
+        return false;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    result = it->second->result;
+    ++hits;
+    return true;
+}
+
+void ResultCache::insert(const std::string& key, const std::vector<uint64_t>& versions, const std::string& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = byKey.find(key);
+    if (it != byKey.end())
+        erase(it->second);
+    Entry entry{key, versions, result};
+    size_t bytes = entry.bytes();
+    if (bytes > capacity)
+        return;
+    evictTo(capacity - bytes);
+    entries.push_front(std::move(entry));
+    byKey[key] = entries.begin();
+    used += bytes;
+}
+
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    byKey.clear();
+    used = 0;
+}
+
+ResultCache::Stats ResultCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+    stats.entries = entries.size();
+    stats.bytes = used;
+    stats.capacity = capacity;
+    return stats;
+}
+
+void ResultCache::erase(std::list<Entry>::iterator it) {
+    used -= it->bytes();
+    byKey.erase(it->key);
+    entries.erase(it);
+}
+
+void ResultCache::evictTo(size_t bytes) {
+    while (used > bytes) {
+        erase(std::prev(entries.end()));
+        ++evictions;
+    }
+}
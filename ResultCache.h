@@ -0,0 +1,61 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+// Printed results of SELECT statements, keyed by normalized statement text.
+// An entry records the version of every table it read and is only served
+// while all of them are unchanged; a stale entry is dropped when it is next
+// looked up, or evicted. Entries are evicted least recently used first to
+// stay within the capacity. A capacity of 0 (the default) disables caching.
+class ResultCache {
+public:
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t capacity = 0;
+    };
+
+    // Changing the capacity evicts entries as needed.
+    void setCapacity(size_t bytes);
+    bool enabled() const;
+
+    // Copies the result cached for 'key' into 'result' if there is one and
+    // it was computed at 'versions'.
+    bool lookup(const std::string& key, const std::vector<uint64_t>& versions, std::string& result);
+    // Results larger than the capacity are not kept.
+    void insert(const std::string& key, const std::vector<uint64_t>& versions, const std::string& result);
+    void clear();
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::vector<uint64_t> versions;
+        std::string result;
+        size_t bytes() const { return key.size() + result.size() + versions.size() * sizeof(uint64_t) + sizeof(Entry); }
+    };
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> byKey;
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+
+    void erase(std::list<Entry>::iterator it);
+    void evictTo(size_t bytes);
+};
+
+#endif // RESULTCACHE_H
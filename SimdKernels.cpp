@@ -0,0 +1,509 @@
+#include "SimdKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LITESQL_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Number of set bits of 'bits' in positions [begin, end).
+inline size_t countBits(const uint64_t* bits, size_t begin, size_t end) {
+    size_t total = 0;
+    while (begin < end) {
+        size_t blockEnd = std::min(end, (begin | 63) + 1);
+        uint64_t word = bits[begin >> 6] >> (begin & 63);
+        size_t width = blockEnd - begin;
+        if (width < 64)
+            word &= (uint64_t(1) << width) - 1;
+        total += __builtin_popcountll(word);
+        begin = blockEnd;
+    }
+    return total;
+}
+
+// Integer sums are kept as the sums of the values' high (signed) and low
+// (unsigned) 32-bit halves, which cannot overflow for fewer than 2^31 rows.
+// Adds hi * 2^32 + lo, a sum of such a run, to 'out'.
+inline void addSplitSum(int64_t hi, uint64_t lo, NumericSummary& out) {
+    __int128 total = static_cast<__int128>(hi) * (int64_t(1) << 32) + lo;
+    out.sum += static_cast<double>(total);
+    if (total < INT64_MIN || total > INT64_MAX ||
+        __builtin_add_overflow(out.intSum, static_cast<int64_t>(total), &out.intSum))
+        out.exact = false;
+}
+
+// --- Scalar kernels --------------------------------------------------------
+// Blocks are 64 rows, one null-bitmap word each. The fast inner loops use
+// several independent accumulators so the compiler can keep them in registers.
+
+void summarizeInt64Scalar(const int64_t* values, const uint64_t* nullBits,
+                          size_t begin, size_t end, NumericSummary& out) {
+    int64_t hi = 0;
+    uint64_t lo = 0;
+    int64_t mn = INT64_MAX, mx = INT64_MIN;
+    size_t count = 0;
+    size_t row = begin;
+    while (row < end) {
+        size_t blockEnd = std::min(end, (row | 63) + 1);
+        uint64_t word = nullBits[row >> 6];
+        if (word == 0) {
+            for (size_t i = row; i < blockEnd; ++i) {
+                int64_t v = values[i];
+                hi += v >> 32;
+                lo += static_cast<uint32_t>(v);
+                mn = v < mn ? v : mn;
+                mx = v > mx ? v : mx;
+            }
+            count += blockEnd - row;
+        } else {
+            for (size_t i = row; i < blockEnd; ++i) {
+                if ((word >> (i & 63)) & 1) continue;
+                int64_t v = values[i];
+                hi += v >> 32;
+                lo += static_cast<uint32_t>(v);
+                mn = v < mn ? v : mn;
+                mx = v > mx ? v : mx;
+                count++;
+            }
+        }
+        row = blockEnd;
+    }
+    if (count == 0) return;
+    addSplitSum(hi, lo, out);
+    out.min = out.count ? std::min(out.min, double(mn)) : double(mn);
+    out.max = out.count ? std::max(out.max, double(mx)) : double(mx);
+    out.count += count;
+}
+
+void summarizeDoubleScalar(const double* values, const uint64_t* nullBits,
+                           size_t begin, size_t end, NumericSummary& out) {
+    double sum[4] = {0, 0, 0, 0};
+    double mn = INFINITY, mx = -INFINITY;
+    size_t count = 0;
+    size_t row = begin;
+    while (row < end) {
+        size_t blockEnd = std::min(end, (row | 63) + 1);
+        uint64_t word = nullBits[row >> 6];
+        if (word == 0) {
+            size_t i = row;
+            for (; i + 4 <= blockEnd; i += 4) {
+                for (int k = 0; k < 4; ++k) {
+                    double v = values[i + k];
+                    sum[k] += v;
+                    mn = v < mn ? v : mn;
+                    mx = v > mx ? v : mx;
+                }
+            }
+            for (; i < blockEnd; ++i) {
+                sum[0] += values[i];
+                mn = values[i] < mn ? values[i] : mn;
+                mx = values[i] > mx ? values[i] : mx;
+            }
+            count += blockEnd - row;
+        } else {
+            for (size_t i = row; i < blockEnd; ++i) {
+                if ((word >> (i & 63)) & 1) continue;
+                double v = values[i];
+                sum[0] += v;
+                mn = v < mn ? v : mn;
+                mx = v > mx ? v : mx;
+                count++;
+            }
+        }
+        row = blockEnd;
+    }
+    if (count == 0) return;
+    out.sum += (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    out.min = out.count ? std::min(out.min, mn) : mn;
+    out.max = out.count ? std::max(out.max, mx) : mx;
+    out.count += count;
+}
+
+// Comparison filters produce one mask word per 64 rows. The scalar form
+// builds each word with shifts the compiler can vectorize.
+template <typename T, typename Cmp>
+void compareScalar(const T* values, const uint64_t* nullBits, size_t begin, size_t end,
+                   T literal, Cmp cmp, uint64_t* mask) {
+    for (size_t base = begin, w = 0; base < end; base += 64, ++w) {
+        size_t width = std::min<size_t>(64, end - base);
+        uint64_t bits = 0;
+        for (size_t i = 0; i < width; ++i)
+            bits |= uint64_t(cmp(values[base + i], literal)) << i;
+        mask[w] = bits & ~nullBits[base >> 6];
+    }
+}
+
+template <typename T>
+void compareScalar(const T* values, const uint64_t* nullBits, size_t begin, size_t end,
+                   FilterOp op, T literal, uint64_t* mask) {
+    switch (op) {
+        case FilterOp::Eq: compareScalar(values, nullBits, begin, end, literal, std::equal_to<T>(), mask); break;
+        case FilterOp::Ne: compareScalar(values, nullBits, begin, end, literal, std::not_equal_to<T>(), mask); break;
+        case FilterOp::Lt: compareScalar(values, nullBits, begin, end, literal, std::less<T>(), mask); break;
+        case FilterOp::Le: compareScalar(values, nullBits, begin, end, literal, std::less_equal<T>(), mask); break;
+        case FilterOp::Gt: compareScalar(values, nullBits, begin, end, literal, std::greater<T>(), mask); break;
+        case FilterOp::Ge: compareScalar(values, nullBits, begin, end, literal, std::greater_equal<T>(), mask); break;
+    }
+}
+
+void compareInt64Scalar(const int64_t* values, const uint64_t* nullBits, size_t begin, size_t end,
+                        FilterOp op, int64_t literal, uint64_t* mask) {
+    compareScalar(values, nullBits, begin, end, op, literal, mask);
+}
+
+void compareDoubleScalar(const double* values, const uint64_t* nullBits, size_t begin, size_t end,
+                         FilterOp op, double literal, uint64_t* mask) {
+    compareScalar(values, nullBits, begin, end, op, literal, mask);
+}
+
+#ifdef LITESQL_X86_DISPATCH
+// --- Integer comparison building blocks -------------------------------------
+// x86 only has equality and signed greater-than for 64-bit lanes, so every
+// integer operator is one of Eq, Gt or Lt (operands swapped), optionally
+// negated: Ne = !Eq, Le = !Gt, Ge = !Lt. Integers have no NaN, so negation
+// is exact.
+enum class IntBase { Eq, Gt, Lt };
+
+template <IntBase Base>
+inline bool intCompare(int64_t value, int64_t literal) {
+    return Base == IntBase::Eq ? value == literal : Base == IntBase::Gt ? value > literal : value < literal;
+}
+
+// Finishes the mask word of rows [base, base + width): the tail of a
+// partial word is compared one row at a time, then negation and NULLs apply.
+template <IntBase Base, bool Negate>
+inline uint64_t finishInt64Word(uint64_t bits, const int64_t* values, const uint64_t* nullBits,
+                                size_t base, size_t width, int64_t literal) {
+    for (size_t i = width & ~size_t(3); i < width; ++i)
+        bits |= uint64_t(intCompare<Base>(values[base + i], literal)) << i;
+    if (Negate)
+        bits = ~bits;
+    if (width < 64)
+        bits &= (uint64_t(1) << width) - 1;
+    return bits & ~nullBits[base >> 6];
+}
+
+// --- SSE4.2 kernels --------------------------------------------------------
+
+template <IntBase Base, bool Negate>
+__attribute__((target("sse4.2")))
+void compareInt64Sse42(const int64_t* values, const uint64_t* nullBits, size_t begin, size_t end,
+                       int64_t literal, uint64_t* mask) {
+    __m128i lit = _mm_set1_epi64x(literal);
+    for (size_t base = begin, w = 0; base < end; base += 64, ++w) {
+        size_t width = std::min<size_t>(64, end - base);
+        uint64_t bits = 0;
+        for (size_t k = 0; k + 4 <= width; k += 4) {
+            __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + base + k));
+            __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + base + k + 2));
+            __m128i m0 = Base == IntBase::Eq ? _mm_cmpeq_epi64(x0, lit)
+                       : Base == IntBase::Gt ? _mm_cmpgt_epi64(x0, lit) : _mm_cmpgt_epi64(lit, x0);
+            __m128i m1 = Base == IntBase::Eq ? _mm_cmpeq_epi64(x1, lit)
+                       : Base == IntBase::Gt ? _mm_cmpgt_epi64(x1, lit) : _mm_cmpgt_epi64(lit, x1);
+            uint64_t lanes = _mm_movemask_pd(_mm_castsi128_pd(m0)) | (_mm_movemask_pd(_mm_castsi128_pd(m1)) << 2);
+            bits |= lanes << k;
+        }
+        mask[w] = finishInt64Word<Base, Negate>(bits, values, nullBits, base, width, literal);
+    }
+}
+
+__attribute__((target("sse4.2")))
+void compareInt64Sse42(const int64_t* values, const uint64_t* nullBits, size_t begin, size_t end,
+                       FilterOp op, int64_t literal, uint64_t* mask) {
+    switch (op) {
+        case FilterOp::Eq: compareInt64Sse42<IntBase::Eq, false>(values, nullBits, begin, end, literal, mask); break;
+        case FilterOp::Ne: compareInt64Sse42<IntBase::Eq, true>(values, nullBits, begin, end, literal, mask); break;
+        case FilterOp::Gt: compareInt64Sse42<IntBase::Gt, false>(values, nullBits, begin, end, literal, mask); break;
+        case FilterOp::Le: compareInt64Sse42<IntBase::Gt, true>(values, nullBits, begin, end, literal, mask); break;
+        case FilterOp::Lt: compareInt64Sse42<IntBase::Lt, false>(values, nullBits, begin, end, literal, mask); break;
+        case FilterOp::Ge: compareInt64Sse42<IntBase::Lt, true>(values, nullBits, begin, end, literal, mask); break;
+    }
+}
+
+// --- AVX2 kernels ----------------------------------------------------------
+// Only NULL-free 64-row blocks take the vector path; blocks with NULLs fall
+// back to the scalar loop for that block.
+
+__attribute__((target("avx2")))
+void summarizeInt64Avx2(const int64_t* values, const uint64_t* nullBits,
+                        size_t begin, size_t end, NumericSummary& out) {
+    // AVX2 has no 64-bit arithmetic shift: the high halves are summed
+    // unsigned and 2^32 is taken back once per negative value.
+    const __m256i lowMask = _mm256_set1_epi64x(0xffffffff);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i vhigh = _mm256_setzero_si256();
+    __m256i vlow = _mm256_setzero_si256();
+    __m256i vnegative = _mm256_setzero_si256();
+    __m256i vmin = _mm256_set1_epi64x(INT64_MAX);
+    __m256i vmax = _mm256_set1_epi64x(INT64_MIN);
+    int64_t hi = 0;
+    uint64_t lo = 0;
+    int64_t mn = INT64_MAX, mx = INT64_MIN;
+    size_t count = 0;
+    size_t row = begin;
+    while (row < end) {
+        size_t blockEnd = std::min(end, (row | 63) + 1);
+        uint64_t word = nullBits[row >> 6];
+        size_t i = row;
+        if (word == 0) {
+            for (; i + 4 <= blockEnd; i += 4) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+                vhigh = _mm256_add_epi64(vhigh, _mm256_srli_epi64(v, 32));
+                vlow = _mm256_add_epi64(vlow, _mm256_and_si256(v, lowMask));
+                vnegative = _mm256_sub_epi64(vnegative, _mm256_cmpgt_epi64(zero, v));
+                vmin = _mm256_blendv_epi8(vmin, v, _mm256_cmpgt_epi64(vmin, v));
+                vmax = _mm256_blendv_epi8(vmax, v, _mm256_cmpgt_epi64(v, vmax));
+            }
+            count += i - row;
+        }
+        for (; i < blockEnd; ++i) {
+            if ((word >> (i & 63)) & 1) continue;
+            int64_t v = values[i];
+            hi += v >> 32;
+            lo += static_cast<uint32_t>(v);
+            mn = v < mn ? v : mn;
+            mx = v > mx ? v : mx;
+            count++;
+        }
+        row = blockEnd;
+    }
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), vhigh);
+    hi += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), vnegative);
+    hi -= (lanes[0] + lanes[1] + lanes[2] + lanes[3]) << 32;
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), vlow);
+    lo += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), vmin);
+    for (int64_t v : lanes) mn = v < mn ? v : mn;
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), vmax);
+    for (int64_t v : lanes) mx = v > mx ? v : mx;
+    if (count == 0) return;
+    addSplitSum(hi, lo, out);
+    out.min = out.count ? std::min(out.min, double(mn)) : double(mn);
+    out.max = out.count ? std::max(out.max, double(mx)) : double(mx);
+    out.count += count;
+}
+
+__attribute__((target("avx2")))
+void summarizeDoubleAvx2(const double* values, const uint64_t* nullBits,
+                         size_t begin, size_t end, NumericSummary& out) {
+    __m256d vsum0 = _mm256_setzero_pd(), vsum1 = _mm256_setzero_pd();
+    __m256d vmin = _mm256_set1_pd(INFINITY);
+    __m256d vmax = _mm256_set1_pd(-INFINITY);
+    double sum = 0;
+    double mn = INFINITY, mx = -INFINITY;
+    size_t count = 0;
+    size_t row = begin;
+    while (row < end) {
+        size_t blockEnd = std::min(end, (row | 63) + 1);
+        uint64_t word = nullBits[row >> 6];
+        size_t i = row;
+        if (word == 0) {
+            for (; i + 8 <= blockEnd; i += 8) {
+                __m256d a = _mm256_loadu_pd(values + i);
+                __m256d b = _mm256_loadu_pd(values + i + 4);
+                vsum0 = _mm256_add_pd(vsum0, a);
+                vsum1 = _mm256_add_pd(vsum1, b);
+                vmin = _mm256_min_pd(vmin, _mm256_min_pd(a, b));
+                vmax = _mm256_max_pd(vmax, _mm256_max_pd(a, b));
+            }
+            count += i - row;
+        }
+        for (; i < blockEnd; ++i) {
+            if ((word >> (i & 63)) & 1) continue;
+            double v = values[i];
+            sum += v;
+            mn = v < mn ? v : mn;
+            mx = v > mx ? v : mx;
+            count++;
+        }
+        row = blockEnd;
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, _mm256_add_pd(vsum0, vsum1));
+    sum += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm256_store_pd(lanes, vmin);
+    for (double v : lanes) mn = v < mn ? v : mn;
+    _mm256_store_pd(lanes, vmax);
+    for (double v : lanes) mx = v > mx ? v : mx;
+    if (count == 0) return;
+    out.sum += sum;
+    out.min = out.count ? std::min(out.min, mn) : mn;
+    out.max = out.count ? std::max(out.max, mx) : mx;
+    out.count += count;
+}
+
+template <IntBase Base, bool Negate>
+__attribute__((target("avx2")))
+void compareInt64Avx2(const int64_t* values, const uint64_t* nullBits, size_t begin, size_t end,
+                      int64_t literal, uint64_t* mask) {
+    __m256i lit = _mm256_set1_epi64x(literal);
+    for (size_t base = begin, w = 0; base < end; base += 64, ++w) {
+        size_t width = std::min<size_t>(64, end - base);
+        uint64_t bits = 0;
+        for (size_t k = 0; k + 4 <= width; k += 4) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + base + k));
+            __m256i m = Base == IntBase::Eq ? _mm256_cmpeq_epi64(x, lit)
+                      : Base == IntBase::Gt ? _mm256_cmpgt_epi64(x, lit) : _mm256_cmpgt_epi64(lit, x);
+            bits |= uint64_t(_mm256_movemask_pd(_mm256_castsi256_pd(m))) << k;
+        }
+        mask[w] = finishInt64Word<Base, Negate>(bits, values, nullBits, base, width, literal);
+    }
+}
+
+__attribute__((target("avx2")))
+void compareInt64Avx2(const int64_t* values, const uint64_t* nullBits, size_t begin, size_t end,
+                      FilterOp op, int64_t literal, uint64_t* mask) {
+    switch (op) {
+        case FilterOp::Eq: compareInt64Avx2<IntBase::Eq, false>(values, nullBits, begin, end, literal, mask); break;
+        case FilterOp::Ne: compareInt64Avx2<IntBase::Eq, true>(values, nullBits, begin, end, literal, mask); break;
+        case FilterOp::Gt: compareInt64Avx2<IntBase::Gt, false>(values, nullBits, begin, end, literal, mask); break;
+        case FilterOp::Le: compareInt64Avx2<IntBase::Gt, true>(values, nullBits, begin, end, literal, mask); break;
+        case FilterOp::Lt: compareInt64Avx2<IntBase::Lt, false>(values, nullBits, begin, end, literal, mask); break;
+        case FilterOp::Ge: compareInt64Avx2<IntBase::Lt, true>(values, nullBits, begin, end, literal, mask); break;
+    }
+}
+
+// Doubles use ordered predicates (unordered for !=), matching the scalar
+// operators when NaN is involved.
+template <int Predicate, typename Cmp>
+__attribute__((target("avx2")))
+void compareDoubleAvx2(const double* values, const uint64_t* nullBits, size_t begin, size_t end,
+                       double literal, Cmp cmp, uint64_t* mask) {
+    __m256d lit = _mm256_set1_pd(literal);
+    for (size_t base = begin, w = 0; base < end; base += 64, ++w) {
+        size_t width = std::min<size_t>(64, end - base);
+        uint64_t bits = 0;
+        size_t k = 0;
+        for (; k + 4 <= width; k += 4) {
+            __m256d x = _mm256_loadu_pd(values + base + k);
+            bits |= uint64_t(_mm256_movemask_pd(_mm256_cmp_pd(x, lit, Predicate))) << k;
+        }
+        for (; k < width; ++k)
+            bits |= uint64_t(cmp(values[base + k], literal)) << k;
+        mask[w] = bits & ~nullBits[base >> 6];
+    }
+}
+
+__attribute__((target("avx2")))
+void compareDoubleAvx2(const double* values, const uint64_t* nullBits, size_t begin, size_t end,
+                       FilterOp op, double literal, uint64_t* mask) {
+    switch (op) {
+        case FilterOp::Eq:
+            compareDoubleAvx2<_CMP_EQ_OQ>(values, nullBits, begin, end, literal, std::equal_to<double>(), mask);
+            break;
+        case FilterOp::Ne:
+            compareDoubleAvx2<_CMP_NEQ_UQ>(values, nullBits, begin, end, literal, std::not_equal_to<double>(), mask);
+            break;
+        case FilterOp::Lt:
+            compareDoubleAvx2<_CMP_LT_OQ>(values, nullBits, begin, end, literal, std::less<double>(), mask);
+            break;
+        case FilterOp::Le:
+            compareDoubleAvx2<_CMP_LE_OQ>(values, nullBits, begin, end, literal, std::less_equal<double>(), mask);
+            break;
+        case FilterOp::Gt:
+            compareDoubleAvx2<_CMP_GT_OQ>(values, nullBits, begin, end, literal, std::greater<double>(), mask);
+            break;
+        case FilterOp::Ge:
+            compareDoubleAvx2<_CMP_GE_OQ>(values, nullBits, begin, end, literal, std::greater_equal<double>(), mask);
+            break;
+    }
+}
+#endif
+
+using Int64Kernel = void (*)(const int64_t*, const uint64_t*, size_t, size_t, NumericSummary&);
+using DoubleKernel = void (*)(const double*, const uint64_t*, size_t, size_t, NumericSummary&);
+using Int64Filter = void (*)(const int64_t*, const uint64_t*, size_t, size_t, FilterOp, int64_t, uint64_t*);
+using DoubleFilter = void (*)(const double*, const uint64_t*, size_t, size_t, FilterOp, double, uint64_t*);
+
+struct Dispatch {
+    Int64Kernel summarizeInt64 = summarizeInt64Scalar;
+    DoubleKernel summarizeDouble = summarizeDoubleScalar;
+    Int64Filter compareInt64 = compareInt64Scalar;
+    DoubleFilter compareDouble = compareDoubleScalar;
+    const char* isa = "scalar";
+
+    Dispatch() {
+#ifdef LITESQL_X86_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            summarizeInt64 = summarizeInt64Avx2;
+            summarizeDouble = summarizeDoubleAvx2;
+            compareInt64 = compareInt64Avx2;
+            compareDouble = compareDoubleAvx2;
+            isa = "avx2";
+        } else if (__builtin_cpu_supports("sse4.2")) {
+            compareInt64 = compareInt64Sse42;
+            isa = "sse4.2";
+        }
+#endif
+    }
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch table;
+    return table;
+}
+
+} // namespace
+
+void SimdKernels::summarizeInt64(const int64_t* values, const uint64_t* nullBits,
+                                 size_t begin, size_t end, NumericSummary& out) {
+    dispatch().summarizeInt64(values, nullBits, begin, end, out);
+}
+
+void SimdKernels::summarizeDouble(const double* values, const uint64_t* nullBits,
+                                  size_t begin, size_t end, NumericSummary& out) {
+    dispatch().summarizeDouble(values, nullBits, begin, end, out);
+}
+
+void SimdKernels::summarizeBool(const uint8_t* values, const uint64_t* nullBits,
+                                size_t begin, size_t end, NumericSummary& out) {
+    // Bytes are 0/1 and NULLs are stored as 0, so the true-count is a plain
+    // byte sum that compilers vectorize on their own.
+    size_t trues = 0;
+    for (size_t i = begin; i < end; ++i)
+        trues += values[i];
+    size_t count = (end - begin) - countBits(nullBits, begin, end);
+    if (count == 0) return;
+    double mn = trues == count ? 1 : 0;
+    double mx = trues > 0 ? 1 : 0;
+    addSplitSum(0, trues, out);
+    out.min = out.count ? std::min(out.min, mn) : mn;
+    out.max = out.count ? std::max(out.max, mx) : mx;
+    out.count += count;
+}
+
+void SimdKernels::compareInt64(const int64_t* values, const uint64_t* nullBits, size_t begin, size_t end,
+                               FilterOp op, int64_t literal, uint64_t* mask) {
+    dispatch().compareInt64(values, nullBits, begin, end, op, literal, mask);
+}
+
+void SimdKernels::compareDouble(const double* values, const uint64_t* nullBits, size_t begin, size_t end,
+                                FilterOp op, double literal, uint64_t* mask) {
+    dispatch().compareDouble(values, nullBits, begin, end, op, literal, mask);
+}
+
+void SimdKernels::compareBool(const uint8_t* values, const uint64_t* nullBits, size_t begin, size_t end,
+                              FilterOp op, uint8_t literal, uint64_t* mask) {
+    // Byte compares vectorize well without hand-written intrinsics.
+    compareScalar(values, nullBits, begin, end, op, literal, mask);
+}
+
+size_t SimdKernels::maskToRows(const uint64_t* mask, size_t begin, size_t end, size_t* rows) {
+    size_t count = 0;
+    for (size_t base = begin, w = 0; base < end; base += 64, ++w) {
+        for (uint64_t bits = mask[w]; bits; bits &= bits - 1)
+            rows[count++] = base + __builtin_ctzll(bits);
+    }
+    return count;
+}
+
+const char* SimdKernels::activeIsa() {
+    return dispatch().isa;
+}
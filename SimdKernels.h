@@ -0,0 +1,55 @@
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// COUNT/SUM/MIN/MAX of the non-NULL values in a range of a fixed-width column.
+struct NumericSummary {
+    size_t count = 0;
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+    // Integer kernels also keep the exact sum; 'exact' is cleared once it
+    // leaves the int64 range.
+    int64_t intSum = 0;
+    bool exact = true;
+};
+
+// Comparison of a filter kernel: 'value op literal'.
+enum class FilterOp { Eq, Ne, Lt, Le, Gt, Ge };
+
+// Tight loops over column storage. Each kernel has a portable scalar version
+// and, on x86-64, AVX2 versions selected once at runtime from the CPU's
+// feature flags. 'nullBits' is the column's NULL bitmap (bit i = row i).
+class SimdKernels {
+public:
+    // Summaries over rows [begin, end). NULL cells hold 0 in storage, so
+    // whole 64-row words without NULLs are reduced without looking at bits.
+    static void summarizeInt64(const int64_t* values, const uint64_t* nullBits,
+                               size_t begin, size_t end, NumericSummary& out);
+    static void summarizeDouble(const double* values, const uint64_t* nullBits,
+                                size_t begin, size_t end, NumericSummary& out);
+    static void summarizeBool(const uint8_t* values, const uint64_t* nullBits,
+                              size_t begin, size_t end, NumericSummary& out);
+
+    // Filters over rows [begin, end), where 'begin' is a multiple of 64: bit
+    // (row - begin) of 'mask' is set when the row is not NULL and
+    // 'value op literal' holds. 'mask' receives (end - begin + 63) / 64 words,
+    // so conditions combine with plain word-wise AND/OR.
+    static void compareInt64(const int64_t* values, const uint64_t* nullBits, size_t begin, size_t end,
+                             FilterOp op, int64_t literal, uint64_t* mask);
+    static void compareDouble(const double* values, const uint64_t* nullBits, size_t begin, size_t end,
+                              FilterOp op, double literal, uint64_t* mask);
+    static void compareBool(const uint8_t* values, const uint64_t* nullBits, size_t begin, size_t end,
+                            FilterOp op, uint8_t literal, uint64_t* mask);
+    // Writes the row ids of the set bits of a mask over [begin, end) to
+    // 'rows' in ascending order and returns how many there are.
+    static size_t maskToRows(const uint64_t* mask, size_t begin, size_t end, size_t* rows);
+
+    // Name of the instruction set the dispatcher picked ("avx2", "sse4.2"
+    // or "scalar").
+    static const char* activeIsa();
+};
+
+#endif // SIMDKERNELS_H
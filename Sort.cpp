@@ -0,0 +1,512 @@
+#include "Sort.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+// Below this many rows a bucket is finished with a comparison sort.
+constexpr size_t RadixCutoff = 32;
+// In-memory bytes per row besides its key: key offset, two prefix entries
+// and a position.
+constexpr size_t RowOverhead = sizeof(size_t) + 2 * 16 + sizeof(size_t);
+// Runs merged into one at a time while spilling.
+constexpr size_t MaxMergeWidth = 64;
+constexpr size_t RunBufferBytes = 64 << 10;
+// Smallest input sorted on several threads, and sample keys per bucket.
+constexpr size_t ParallelSortRows = 1 << 16;
+constexpr size_t SampleRate = 32;
+
+void appendBigEndian(std::string& out, uint64_t value) {
+    char buffer[8];
+    for (int i = 7; i >= 0; --i) {
+        buffer[i] = static_cast<char>(value & 0xff);
+        value >>= 8;
+    }
+    out.append(buffer, 8);
+}
+
+// memcmp order of two keys, from byte 'depth' on.
+int compareKeys(std::string_view a, std::string_view b, size_t depth) {
+    size_t length = std::min(a.size(), b.size());
+    int c = length > depth ? std::memcmp(a.data() + depth, b.data() + depth, length - depth) : 0;
+    if (c != 0)
+        return c;
+    return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+}
+
+// MSD radix sort of the positions pos[0, n) by key bytes from 'depth' on,
+// one byte per level with a bucket for keys that have already ended.
+// Buckets are filled stably, and positions start out ascending, so equal
+// keys keep their input order.
+void radixSort(const NormalizedKeys& keys, size_t* pos, size_t* scratch, size_t n, size_t depth) {
+    while (n >= RadixCutoff) {
+        size_t counts[257] = {};
+        for (size_t i = 0; i < n; ++i) {
+            std::string_view key = keys[pos[i]];
+            ++counts[depth < key.size() ? static_cast<uint8_t>(key[depth]) + 1 : 0];
+        }
+        // Every key ended: they are all equal. One shared byte: move on to
+        // the next one without moving anything.
+        if (counts[0] == n)
+            return;
+        if (counts[0] == 0 && std::find(counts + 1, counts + 257, n) != counts + 257) {
+            ++depth;
+            continue;
+        }
+        size_t starts[257];
+        size_t start = 0;
+        for (size_t b = 0; b < 257; ++b) {
+            starts[b] = start;
+            start += counts[b];
+        }
+        for (size_t i = 0; i < n; ++i) {
+            std::string_view key = keys[pos[i]];
+            scratch[starts[depth < key.size() ? static_cast<uint8_t>(key[depth]) + 1 : 0]++] = pos[i];
+        }
+        std::copy(scratch, scratch + n, pos);
+        start = counts[0];
+        for (size_t b = 1; b < 257; ++b) {
+            if (counts[b] > 1)
+                radixSort(keys, pos + start, scratch + start, counts[b], depth + 1);
+            start += counts[b];
+        }
+        return;
+    }
+    std::sort(pos, pos + n, [&](size_t a, size_t b) {
+        int c = compareKeys(keys[a], keys[b], depth);
+        return c < 0 || (c == 0 && a < b);
+    });
+}
+
+// First 8 bytes of a key as a big-endian integer, zero-padded.
+uint64_t keyPrefix(std::string_view key) {
+    uint64_t prefix = 0;
+    size_t length = std::min<size_t>(8, key.size());
+    for (size_t i = 0; i < length; ++i)
+        prefix |= uint64_t(static_cast<uint8_t>(key[i])) << (56 - 8 * i);
+    return prefix;
+}
+
+struct PrefixEntry {
+    uint64_t prefix;
+    size_t pos;
+};
+
+// Sorts the ascending positions order[0, n) by key. LSD radix passes over (8-byte prefix,
+// position) pairs order most rows, skipping bytes every prefix shares; runs
+// of equal prefixes are then finished by MSD radix from byte 8. No key is a
+// prefix of another, so equal zero-padded prefixes mean either identical
+// short keys or long keys that agree on their first 8 bytes.
+void sortPositions(const NormalizedKeys& keys, size_t* order, size_t n) {
+    std::vector<PrefixEntry> entries(n), scratch(n);
+    std::vector<size_t> counts(8 * 256, 0);
+    for (size_t i = 0; i < n; ++i) {
+        entries[i] = {keyPrefix(keys[order[i]]), order[i]};
+        for (size_t b = 0; b < 8; ++b)
+            ++counts[b * 256 + ((entries[i].prefix >> (8 * b)) & 0xff)];
+    }
+    for (size_t b = 0; b < 8; ++b) {
+        size_t* count = &counts[b * 256];
+        if (std::find(count, count + 256, n) != count + 256)
+            continue;
+        size_t start = 0;
+        for (size_t v = 0; v < 256; ++v) {
+            size_t c = count[v];
+            count[v] = start;
+            start += c;
+        }
+        for (const PrefixEntry& entry : entries)
+            scratch[count[(entry.prefix >> (8 * b)) & 0xff]++] = entry;
+        entries.swap(scratch);
+    }
+    for (size_t i = 0; i < n; ++i)
+        order[i] = entries[i].pos;
+    std::vector<size_t> positions;
+    for (size_t first = 0; first < n;) {
+        size_t last = first + 1;
+        while (last < n && entries[last].prefix == entries[first].prefix)
+            ++last;
+        if (last - first > 1 && keys[order[first]].size() > 8) {
+            positions.resize(last - first);
+            radixSort(keys, &order[first], positions.data(), last - first, 8);
+        }
+        first = last;
+    }
+}
+
+// Parallel sample sort of the positions 0..n-1 into 'order'. Splitters
+// drawn from a sorted sample cut the keys into a few buckets per thread.
+// Each thread counts its contiguous slice of positions into buckets; the
+// counts give every (slice, bucket) pair its place in the output, so the
+// scatter needs no locks and leaves each bucket's positions ascending. The
+// buckets are then radix sorted independently.
+void parallelSortPositions(const NormalizedKeys& keys, std::vector<size_t>& order, size_t parallelism) {
+    size_t n = keys.size();
+    auto less = [&](size_t a, size_t b) {
+        int c = compareKeys(keys[a], keys[b], 0);
+        return c < 0 || (c == 0 && a < b);
+    };
+    size_t bucketCount = parallelism * 4;
+    std::vector<size_t> splitters;
+    for (size_t i = 0; i < bucketCount * SampleRate; ++i)
+        splitters.push_back(i * n / (bucketCount * SampleRate));
+    std::sort(splitters.begin(), splitters.end(), less);
+    for (size_t b = 1; b < bucketCount; ++b)
+        splitters[b - 1] = splitters[b * SampleRate];
+    splitters.resize(bucketCount - 1);
+
+    std::vector<uint32_t> bucketOf(n);
+    std::vector<size_t> counts(parallelism * bucketCount, 0);
+    ThreadPool::shared().run(parallelism, parallelism, [&](size_t slice, size_t) {
+        size_t* count = &counts[slice * bucketCount];
+        for (size_t pos = slice * n / parallelism; pos < (slice + 1) * n / parallelism; ++pos) {
+            size_t bucket = std::upper_bound(splitters.begin(), splitters.end(), pos, less) - splitters.begin();
+            bucketOf[pos] = static_cast<uint32_t>(bucket);
+            ++count[bucket];
+        }
+    });
+    std::vector<size_t> bucketStart(bucketCount + 1);
+    size_t start = 0;
+    for (size_t b = 0; b < bucketCount; ++b) {
+        bucketStart[b] = start;
+        for (size_t slice = 0; slice < parallelism; ++slice) {
+            size_t c = counts[slice * bucketCount + b];
+            counts[slice * bucketCount + b] = start;
+            start += c;
+        }
+    }
+    bucketStart[bucketCount] = n;
+    ThreadPool::shared().run(parallelism, parallelism, [&](size_t slice, size_t) {
+        size_t* next = &counts[slice * bucketCount];
+        for (size_t pos = slice * n / parallelism; pos < (slice + 1) * n / parallelism; ++pos)
+            order[next[bucketOf[pos]]++] = pos;
+    });
+    ThreadPool::shared().run(bucketCount, parallelism, [&](size_t b, size_t) {
+        sortPositions(keys, &order[bucketStart[b]], bucketStart[b + 1] - bucketStart[b]);
+    });
+}
+
+// Positions 0..n-1 of 'keys' in sorted order, cut to 'limit'.
+// Large sorts run in parallel unless a small LIMIT makes a partial sort
+// cheaper.
+bool sortsInParallel(size_t count, size_t limit, size_t parallelism) {
+    return parallelism > 1 && count >= ParallelSortRows && limit >= count / 16;
+}
+
+std::vector<size_t> sortedPositions(const NormalizedKeys& keys, size_t limit, size_t parallelism) {
+    size_t count = keys.size();
+    std::vector<size_t> order(count);
+    if (sortsInParallel(count, limit, parallelism)) {
+        parallelSortPositions(keys, order, parallelism);
+        if (count > limit)
+            order.resize(limit);
+        return order;
+    }
+    std::iota(order.begin(), order.end(), size_t(0));
+    if (limit < count / 16) {
+        std::partial_sort(order.begin(), order.begin() + limit, order.end(), [&](size_t a, size_t b) {
+            int c = compareKeys(keys[a], keys[b], 0);
+            return c < 0 || (c == 0 && a < b);
+        });
+        order.resize(limit);
+    } else {
+        sortPositions(keys, order.data(), count);
+        if (count > limit)
+            order.resize(limit);
+    }
+    return order;
+}
+
+// A sorted run in a temporary file, read back one record at a time. Records
+// are [keyLength:4][key][row:8]; the file is removed when it is closed.
+class SpillRun {
+public:
+    SpillRun() : file(std::tmpfile()) {
+        if (file)
+            std::setvbuf(file, nullptr, _IOFBF, RunBufferBytes);
+    }
+    ~SpillRun() {
+        if (file)
+            std::fclose(file);
+    }
+    SpillRun(const SpillRun&) = delete;
+    SpillRun& operator=(const SpillRun&) = delete;
+
+    bool isOpen() const { return file != nullptr; }
+
+    bool write(std::string_view key, uint64_t row) {
+        uint32_t length = static_cast<uint32_t>(key.size());
+        bytesWritten += sizeof(length) + key.size() + sizeof(row);
+        return std::fwrite(&length, sizeof(length), 1, file) == 1 &&
+               std::fwrite(key.data(), 1, key.size(), file) == key.size() &&
+               std::fwrite(&row, sizeof(row), 1, file) == 1;
+    }
+    bool rewind() { return std::fflush(file) == 0 && std::fseek(file, 0, SEEK_SET) == 0; }
+
+    // Loads the next record into key()/row(); false at the end of the run.
+    bool next() {
+        uint32_t length;
+        if (std::fread(&length, sizeof(length), 1, file) != 1)
+            return false;
+        current.resize(length);
+        return std::fread(&current[0], 1, length, file) == length &&
+               std::fread(&currentRow, sizeof(currentRow), 1, file) == 1;
+    }
+    std::string_view key() const { return current; }
+    uint64_t row() const { return currentRow; }
+    size_t bytes() const { return bytesWritten; }
+
+private:
+    FILE* file;
+    std::string current;
+    uint64_t currentRow = 0;
+    size_t bytesWritten = 0;
+};
+
+// K-way merge of sorted runs with a loser tree: internal node i (1 <= i < k)
+// holds the loser of the match played there, tree[0] the overall winner, and
+// run r is the leaf at k + r. Replacing the winner replays only its path to
+// the root, about log2(k) key comparisons per record. Ties go to the earlier
+// run, which keeps equal keys in input order.
+class LoserTree {
+public:
+    explicit LoserTree(std::vector<SpillRun*> runs) : runs(std::move(runs)), tree(this->runs.size()) {
+        live.resize(this->runs.size());
+        for (size_t r = 0; r < this->runs.size(); ++r)
+            live[r] = this->runs[r]->rewind() && this->runs[r]->next();
+        tree[0] = build(1);
+    }
+
+    bool empty() const { return !live[tree[0]]; }
+    SpillRun& top() const { return *runs[tree[0]]; }
+
+    void pop() {
+        size_t winner = tree[0];
+        live[winner] = runs[winner]->next();
+        for (size_t node = (winner + runs.size()) / 2; node >= 1; node /= 2) {
+            if (beats(tree[node], winner))
+                std::swap(tree[node], winner);
+        }
+        tree[0] = winner;
+    }
+
+private:
+    std::vector<SpillRun*> runs;
+    std::vector<uint8_t> live;
+    std::vector<size_t> tree;
+
+    // An exhausted run loses to every live one.
+    bool beats(size_t a, size_t b) const {
+        if (live[a] != live[b])
+            return live[a];
+        if (!live[a])
+            return a < b;
+        int c = compareKeys(runs[a]->key(), runs[b]->key(), 0);
+        return c < 0 || (c == 0 && a < b);
+    }
+
+    // Plays the matches below 'node' and returns their winner.
+    size_t build(size_t node) {
+        size_t k = runs.size();
+        if (node >= k)
+            return node - k;
+        size_t left = build(2 * node);
+        size_t right = build(2 * node + 1);
+        if (beats(left, right)) {
+            tree[node] = right;
+            return left;
+        }
+        tree[node] = left;
+        return right;
+    }
+};
+
+} // namespace
+
+NormalizedKeys::NormalizedKeys(const std::vector<SortKey>& keys) : keys(keys), nullable(keys.size()) {
+    for (size_t k = 0; k < keys.size(); ++k)
+        nullable[k] = keys[k].column->nullCount() > 0;
+    offsets.push_back(0);
+}
+
+void NormalizedKeys::add(size_t row) {
+    for (size_t k = 0; k < keys.size(); ++k) {
+        const Column& column = *keys[k].column;
+        size_t start = bytes.size();
+        bool isNull = column.isNull(row);
+        if (nullable[k])
+            bytes += isNull ? '\0' : '\1';
+        if (!isNull) {
+            switch (column.getType()) {
+                case ColumnType::Int:
+                case ColumnType::Float:
+                    appendBigEndian(bytes, column.orderedKey(row));
+                    break;
+                case ColumnType::Bool:
+                    bytes += column.getBool(row) ? '\1' : '\0';
+                    break;
+                case ColumnType::String:
+                    for (char c : column.getString(row)) {
+                        bytes += c;
+                        if (c == '\0')
+                            bytes += '\xff';
+                    }
+                    bytes.append(2, '\0');
+                    break;
+            }
+        }
+        if (keys[k].descending) {
+            for (size_t b = start; b < bytes.size(); ++b)
+                bytes[b] = static_cast<char>(~bytes[b]);
+        }
+    }
+    offsets.push_back(bytes.size());
+}
+
+void NormalizedKeys::clear() {
+    bytes.clear();
+    offsets.resize(1);
+}
+
+std::string RowSorter::strategy(size_t rows, size_t limit, size_t parallelism) {
+    if (sortsInParallel(rows, limit, parallelism))
+        return "parallel sample sort";
+    return limit < rows / 16 ? "top-N partial sort" : "radix sort";
+}
+
+std::string RowSorter::plannedStrategy(size_t rows, const std::vector<SortKey>& keys, size_t limit,
+                                      size_t memoryBudget, size_t parallelism, size_t& memory) {
+    // Per row: the key as NormalizedKeys::add() encodes it, its offset, and
+    // the same overhead sort() counts against the budget.
+    size_t perRow = sizeof(size_t) + RowOverhead;
+    for (const auto& key : keys) {
+        const Column& column = *key.column;
+        perRow += column.nullCount() > 0;
+        switch (column.getType()) {
+            case ColumnType::Int:
+            case ColumnType::Float:
+                perRow += 8;
+                break;
+            case ColumnType::Bool:
+                perRow += 1;
+                break;
+            case ColumnType::String:
+                perRow += (column.size() ? column.stringBytes() / column.size() : 0) + 2;
+                break;
+        }
+    }
+    memory = rows * perRow;
+    if (rows < 2 || keys.empty())
+        return "none";
+    if (memory < memoryBudget)
+        return strategy(rows, limit, parallelism);
+    size_t chunk = std::max<size_t>(memoryBudget / perRow, 1);
+    return "external merge sort, " + strategy(chunk, limit, parallelism) + " per run (about " +
+           std::to_string((rows + chunk - 1) / chunk) + " runs)";
+}
+
+void RowSorter::sort(std::vector<size_t>& rows, const std::vector<SortKey>& keys, size_t limit,
+                     size_t memoryBudget, size_t parallelism, Stats* stats) {
+    size_t count = rows.size();
+    Stats ignored;
+    if (!stats)
+        stats = &ignored;
+    *stats = Stats();
+    if (count < 2 || keys.empty()) {
+        if (count > limit)
+            rows.resize(limit);
+        return;
+    }
+    NormalizedKeys normalized(keys);
+    size_t next = 0;
+    auto noteMemory = [&]() {
+        stats->memoryPeak = std::max(stats->memoryPeak, normalized.memoryUsage() + normalized.size() * RowOverhead);
+    };
+    auto fill = [&]() {
+        normalized.clear();
+        while (next < count &&
+               (normalized.size() == 0 || normalized.memoryUsage() + normalized.size() * RowOverhead < memoryBudget))
+            normalized.add(rows[next++]);
+        noteMemory();
+    };
+    auto sortInMemory = [&]() {
+        while (next < count)
+            normalized.add(rows[next++]);
+        noteMemory();
+        stats->strategy = strategy(count, limit, parallelism);
+        std::vector<size_t> order = sortedPositions(normalized, limit, parallelism);
+        std::vector<size_t> sorted(order.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            sorted[i] = rows[order[i]];
+        rows.swap(sorted);
+    };
+    fill();
+    if (next == count) {
+        sortInMemory();
+        return;
+    }
+
+    // The input does not fit: each budget-sized chunk becomes a sorted run on
+    // disk. A run only needs its first 'limit' rows. Whenever MaxMergeWidth
+    // runs of one level pile up at the end of the list they are merged into
+    // one run of the next level, which bounds the open files and keeps runs
+    // in input order.
+    struct Run {
+        std::unique_ptr<SpillRun> file;
+        size_t level;
+    };
+    std::vector<Run> runs;
+    stats->strategy = "external merge sort, " + strategy(normalized.size(), limit, parallelism) + " per run";
+    auto spillFailed = [&]() {
+        std::cerr << "Warning: cannot write a sort spill file; sorting in memory." << std::endl;
+        runs.clear();
+        next = 0;
+        normalized.clear();
+        sortInMemory();
+    };
+    while (normalized.size() > 0) {
+        auto file = std::make_unique<SpillRun>();
+        size_t chunkStart = next - normalized.size();
+        bool ok = file->isOpen();
+        if (ok) {
+            for (size_t pos : sortedPositions(normalized, limit, parallelism))
+                ok = ok && file->write(normalized[pos], rows[chunkStart + pos]);
+        }
+        if (!ok)
+            return spillFailed();
+        stats->spillBytes += file->bytes();
+        ++stats->runs;
+        runs.push_back({std::move(file), 0});
+        while (runs.size() >= MaxMergeWidth && runs[runs.size() - MaxMergeWidth].level == runs.back().level) {
+            size_t first = runs.size() - MaxMergeWidth;
+            std::vector<SpillRun*> group;
+            for (size_t r = first; r < runs.size(); ++r)
+                group.push_back(runs[r].file.get());
+            auto merged = std::make_unique<SpillRun>();
+            ok = merged->isOpen();
+            size_t written = 0;
+            for (LoserTree tree(group); ok && !tree.empty() && written < limit; tree.pop(), ++written)
+                ok = merged->write(tree.top().key(), tree.top().row());
+            if (!ok)
+                return spillFailed();
+            stats->spillBytes += merged->bytes();
+            size_t level = runs.back().level + 1;
+            runs.resize(first);
+            runs.push_back({std::move(merged), level});
+        }
+        fill();
+    }
+    normalized.clear();
+
+    std::vector<SpillRun*> sources;
+    for (auto& run : runs)
+        sources.push_back(run.file.get());
+    rows.clear();
+    for (LoserTree tree(sources); !tree.empty() && rows.size() < limit; tree.pop())
+        rows.push_back(tree.top().row());
+}
@@ -0,0 +1,82 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Column.h"
+
+// One ORDER BY term, resolved to its column once per query.
+struct SortKey {
+    const Column* column;
+    bool descending;
+};
+
+// Normalized (binary) sort keys: one byte string per row such that memcmp
+// order of two keys is the order of their rows under the ORDER BY terms.
+// Each term contributes a NULL marker (only if its column holds NULLs; NULL
+// sorts first), then the value: the order-preserving 8-byte encoding of an
+// Int/Float in big-endian order, one byte for a Bool, or the bytes of a
+// string with 0x00 escaped as 0x00 0xFF and a 0x00 0x00 terminator.
+// Descending terms invert all of their bytes.
+class NormalizedKeys {
+public:
+    explicit NormalizedKeys(const std::vector<SortKey>& keys);
+
+    // Appends the key of 'row'.
+    void add(size_t row);
+    void clear();
+
+    size_t size() const { return offsets.size() - 1; }
+    size_t memoryUsage() const { return bytes.size() + offsets.size() * sizeof(size_t); }
+    // Key of the i-th added row.
+    std::string_view operator[](size_t i) const {
+        return std::string_view(bytes.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+
+private:
+    std::vector<SortKey> keys;
+    std::vector<uint8_t> nullable;
+    std::string bytes;
+    std::vector<size_t> offsets; // key i is bytes[offsets[i], offsets[i + 1])
+};
+
+class RowSorter {
+public:
+    static constexpr size_t DefaultMemoryBudget = size_t(256) << 20;
+
+    // What one sort did, for EXPLAIN ANALYZE.
+    struct Stats {
+        std::string strategy;
+        size_t runs = 0;       // sorted runs spilled to disk
+        size_t memoryPeak = 0; // bytes of sort keys and scratch space
+        size_t spillBytes = 0; // bytes written to spill files
+    };
+
+    // Reorders 'rows' by 'keys'; rows with equal keys keep their input order.
+    // When 'limit' is below rows.size() only the first 'limit' rows are kept,
+    // and they are found with a bounded heap instead of a full sort.
+    //
+    // Sort keys and scratch space are held to about 'memoryBudget' bytes.
+    // Larger inputs are sorted a budget-sized chunk at a time, each chunk is
+    // spilled to a temporary file as a sorted run, and the runs are merged
+    // with a loser tree. Large sorts run on up to 'parallelism' threads of
+    // the shared pool. 'stats', if given, receives what was done.
+    static void sort(std::vector<size_t>& rows, const std::vector<SortKey>& keys,
+                     size_t limit = static_cast<size_t>(-1),
+                     size_t memoryBudget = DefaultMemoryBudget,
+                     size_t parallelism = 1,
+                     Stats* stats = nullptr);
+    // How sort() orders 'rows' keys held in memory: "radix sort", "top-N
+    // partial sort" or "parallel sample sort".
+    static std::string strategy(size_t rows, size_t limit, size_t parallelism);
+    // The strategy sort() is expected to use for 'rows' rows, without sorting:
+    // whether their keys fit 'memoryBudget' is judged from the average key
+    // size of the key columns, which is returned in 'memory' (for all rows).
+    static std::string plannedStrategy(size_t rows, const std::vector<SortKey>& keys, size_t limit,
+                                       size_t memoryBudget, size_t parallelism, size_t& memory);
+};
+
+#endif // SORT_H
@@ -1,16 +1,639 @@
 #include "Storage.h"
 #include <fstream>
+#include <iostream>
+#include <cstring>
+#include <charconv>
+#include <memory>
+#include <filesystem>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
 
-void Storage::saveTableToFile(const Table& table, const std::string& tableName) {
-    std::ofstream file(tableName + ".txt");
-    // Serialization code would go here.
-    file.close();
+namespace fs = std::filesystem;
+
+namespace {
+
+const char CatalogMagic[8] = {'L', 'S', 'Q', 'L', 'C', 'A', 'T', '3'};
+// The previous format, without page and record counts; still readable.
+const char CatalogMagicV2[8] = {'L', 'S', 'Q', 'L', 'C', 'A', 'T', '2'};
+
+enum PageKind : uint8_t { DataPage = 1, OverflowPage = 2 };
+// Per-column flag bits in the catalog.
+enum ColumnFlag : char { ColumnNotNull = 1, ColumnPrimaryKey = 2 };
+
+constexpr size_t HeaderSize = 12;
+constexpr size_t SlotSize = 4;
+constexpr uint16_t OverflowSlot = 0xFFFF;
+// Largest record stored inline in an otherwise empty data page.
+constexpr size_t MaxInline = BufferPool::PageSize - HeaderSize - SlotSize;
+constexpr size_t OverflowCapacity = BufferPool::PageSize - HeaderSize;
+
+template <typename T>
+T readAt(const char* page, size_t offset) {
+    T value;
+    std::memcpy(&value, page + offset, sizeof(T));
+    return value;
 }
 
-Table Storage::loadTableFromFile(const std::string& tableName) {
+template <typename T>
+void writeAt(char* page, size_t offset, T value) {
+    std::memcpy(page + offset, &value, sizeof(T));
+}
+
+template <typename T>
+void appendRaw(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Row record: a NULL bitmap followed by the non-NULL cells in column order
+// (8-byte ints and doubles, 1-byte bools, length-prefixed strings).
+void encodeRow(const Table& table, size_t row, std::string& out) {
+    out.clear();
+    size_t columns = table.getColumns().size();
+    out.resize((columns + 7) / 8, '\0');
+    for (size_t c = 0; c < columns; ++c) {
+        const Column& column = table.getColumnData(c);
+        if (column.isNull(row)) {
+            out[c / 8] = static_cast<char>(out[c / 8] | (1 << (c % 8)));
+            continue;
+        }
+        switch (column.getType()) {
+            case ColumnType::Int: appendRaw(out, column.getInt(row)); break;
+            case ColumnType::Float: appendRaw(out, column.getFloat(row)); break;
+            case ColumnType::Bool: appendRaw(out, static_cast<uint8_t>(column.getBool(row))); break;
+            case ColumnType::String: {
+                std::string_view text = column.getString(row);
+                appendRaw(out, static_cast<uint32_t>(text.size()));
+                out.append(text.data(), text.size());
+                break;
+            }
+        }
+    }
+}
+
+bool decodeRow(const std::vector<ColumnType>& types, const char* data, size_t size,
+               std::vector<std::string>& values) {
+    size_t columns = types.size();
+    size_t pos = (columns + 7) / 8;
+    if (pos > size)
+        return false;
+    values.assign(columns, "");
+    for (size_t c = 0; c < columns; ++c) {
+        if ((data[c / 8] >> (c % 8)) & 1)
+            continue;
+        std::string& value = values[c];
+        switch (types[c]) {
+            case ColumnType::Int: {
+                if (pos + 8 > size) return false;
+                char buf[24];
+                auto res = std::to_chars(buf, buf + sizeof(buf), readAt<int64_t>(data, pos));
+                value.assign(buf, res.ptr);
+                pos += 8;
+                break;
+            }
+            case ColumnType::Float:
+                if (pos + 8 > size) return false;
+                Column::formatFloat(readAt<double>(data, pos), value);
+                pos += 8;
+                break;
+            case ColumnType::Bool:
+                if (pos + 1 > size) return false;
+                value = data[pos] ? "TRUE" : "FALSE";
+                pos += 1;
+                break;
+            case ColumnType::String: {
+                if (pos + 4 > size) return false;
+                uint32_t length = readAt<uint32_t>(data, pos);
+                pos += 4;
+                if (pos + length > size) return false;
+                value.assign(data + pos, length);
+                pos += length;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void writeString(std::ostream& out, const std::string& text) {
+    uint32_t length = static_cast<uint32_t>(text.size());
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(text.data(), length);
+}
+
+// Forces a written file to stable storage before the catalog refers to it.
+bool syncFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+bool readString(std::istream& in, std::string& text) {
+    uint32_t length = 0;
+    if (!in.read(reinterpret_cast<char*>(&length), sizeof(length)))
+        return false;
+    text.resize(length);
+    return static_cast<bool>(in.read(&text[0], length));
+}
+
+} // namespace
+
+Storage::Storage(size_t bufferFrames) : pool(bufferFrames) {}
+
+std::string Storage::filePath(const std::string& file) const {
+    return (fs::path(dir) / file).string();
+}
+
+bool Storage::open(const std::string& directory) {
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if (ec) {
+        std::cerr << "Error: Cannot create data directory " << directory << "." << std::endl;
+        return false;
+    }
+    for (const auto& file : openFiles)
+        pool.closeFile(file.second);
+    openFiles.clear();
+    dir = directory;
+    catalog.clear();
+    catalogIndexes.clear();
+    obsoleteFiles.clear();
+    generation = 0;
+    lastCheckpointLsn = 0;
+    if (!readCatalog())
+        return false;
+    removeUnreferencedFiles();
+    return true;
+}
+
+int Storage::fileId(const std::string& file) {
+    auto it = openFiles.find(file);
+    if (it != openFiles.end())
+        return it->second;
+    int id = pool.openFile(filePath(file));
+    if (id >= 0)
+        openFiles[file] = id;
+    return id;
+}
+
+// Files left behind by a checkpoint that never reached its catalog, and the
+// tails that saves appended to current files before such a crash.
+void Storage::removeUnreferencedFiles() {
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (entry.path().extension() != ".tbl" && entry.path().extension() != ".del")
+            continue;
+        std::string file = entry.path().filename().string();
+        bool referenced = false;
+        for (const auto& table : catalog) {
+            uint64_t size = 0;
+            if (table.second.file == file)
+                size = static_cast<uint64_t>(table.second.pages) * BufferPool::PageSize;
+            else if (table.second.deletions == file)
+                size = table.second.deleted.size() * sizeof(uint64_t);
+            else
+                continue;
+            referenced = true;
+            if (fs::file_size(entry.path(), ec) > size)
+                fs::resize_file(entry.path(), size, ec);
+        }
+        if (!referenced)
+            fs::remove(entry.path(), ec);
+    }
+}
+
+bool Storage::readCatalog() {
+    std::ifstream in(fs::path(dir) / "catalog.dat", std::ios::binary);
+    if (!in)
+        return true; // a new database
+    char magic[sizeof(CatalogMagic)];
+    uint32_t tableCount = 0;
+    bool counted = in.read(magic, sizeof(magic)) && std::memcmp(magic, CatalogMagic, sizeof(magic)) == 0;
+    if ((!counted && (!in || std::memcmp(magic, CatalogMagicV2, sizeof(magic)) != 0)) ||
+        !in.read(reinterpret_cast<char*>(&generation), sizeof(generation)) ||
+        !in.read(reinterpret_cast<char*>(&lastCheckpointLsn), sizeof(lastCheckpointLsn)) ||
+        !in.read(reinterpret_cast<char*>(&tableCount), sizeof(tableCount))) {
+        std::cerr << "Error: Catalog in " << dir << " is corrupt." << std::endl;
+        return false;
+    }
+    for (uint32_t t = 0; t < tableCount; ++t) {
+        std::string name;
+        uint32_t columnCount = 0;
+        std::string file;
+        if (!readString(in, name) || !readString(in, file))
+            return false;
+        TableSchema& schema = catalog[name];
+        schema.file = file;
+        uint64_t deletedCount = 0;
+        if (counted) {
+            if (!in.read(reinterpret_cast<char*>(&schema.pages), sizeof(schema.pages)) ||
+                !in.read(reinterpret_cast<char*>(&schema.records), sizeof(schema.records)) ||
+                !readString(in, schema.deletions) ||
+                !in.read(reinterpret_cast<char*>(&deletedCount), sizeof(deletedCount)))
+                return false;
+        } else {
+            std::error_code ec;
+            uint64_t size = fs::file_size(filePath(file), ec);
+            schema.pages = ec ? 0 : static_cast<uint32_t>(size / BufferPool::PageSize);
+        }
+        if (deletedCount > 0) {
+            std::ifstream deletions(filePath(schema.deletions), std::ios::binary);
+            schema.deleted.resize(deletedCount);
+            if (!deletions.read(reinterpret_cast<char*>(schema.deleted.data()), deletedCount * sizeof(uint64_t))) {
+                std::cerr << "Error: Deletions file for " << name << " is corrupt." << std::endl;
+                return false;
+            }
+            std::sort(schema.deleted.begin(), schema.deleted.end());
+        }
+        if (!in.read(reinterpret_cast<char*>(&columnCount), sizeof(columnCount)))
+            return false;
+        for (uint32_t c = 0; c < columnCount; ++c) {
+            std::string column, type;
+            char flags = 0;
+            if (!readString(in, column) || !readString(in, type) || !in.read(&flags, 1))
+                return false;
+            schema.columns.push_back(column);
+            schema.types.push_back(type);
+            schema.notNull.push_back(flags & ColumnNotNull);
+            if (flags & ColumnPrimaryKey)
+                schema.primaryKey = static_cast<int>(c);
+        }
+    }
+    uint32_t indexCount = 0;
+    if (!in.read(reinterpret_cast<char*>(&indexCount), sizeof(indexCount)))
+        return false;
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        IndexDefinition def;
+        if (!readString(in, def.name) || !readString(in, def.table) ||
+            !readString(in, def.column) || !readString(in, def.type))
+            return false;
+        catalogIndexes.push_back(def);
+    }
+    return true;
+}
+
+bool Storage::writeCatalog(const std::vector<IndexDefinition>& indexes, uint64_t lsn) {
+    if (!isOpen())
+        return false;
+    fs::path path = fs::path(dir) / "catalog.dat";
+    fs::path temp = fs::path(dir) / "catalog.dat.tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        uint64_t nextGeneration = generation + 1;
+        out.write(CatalogMagic, sizeof(CatalogMagic));
+        out.write(reinterpret_cast<const char*>(&nextGeneration), sizeof(nextGeneration));
+        out.write(reinterpret_cast<const char*>(&lsn), sizeof(lsn));
+        uint32_t tableCount = static_cast<uint32_t>(catalog.size());
+        out.write(reinterpret_cast<const char*>(&tableCount), sizeof(tableCount));
+        for (const auto& entry : catalog) {
+            writeString(out, entry.first);
+            writeString(out, entry.second.file);
+            uint64_t deletedCount = entry.second.deleted.size();
+            out.write(reinterpret_cast<const char*>(&entry.second.pages), sizeof(entry.second.pages));
+            out.write(reinterpret_cast<const char*>(&entry.second.records), sizeof(entry.second.records));
+            writeString(out, entry.second.deletions);
+            out.write(reinterpret_cast<const char*>(&deletedCount), sizeof(deletedCount));
+            uint32_t columnCount = static_cast<uint32_t>(entry.second.columns.size());
+            out.write(reinterpret_cast<const char*>(&columnCount), sizeof(columnCount));
+            for (size_t c = 0; c < columnCount; ++c) {
+                writeString(out, entry.second.columns[c]);
+                writeString(out, entry.second.types[c]);
+                char flags = entry.second.notNull[c] ? ColumnNotNull : 0;
+                if (static_cast<int>(c) == entry.second.primaryKey)
+                    flags |= ColumnPrimaryKey;
+                out.write(&flags, 1);
+            }
+        }
+        uint32_t indexCount = static_cast<uint32_t>(indexes.size());
+        out.write(reinterpret_cast<const char*>(&indexCount), sizeof(indexCount));
+        for (const auto& def : indexes) {
+            writeString(out, def.name);
+            writeString(out, def.table);
+            writeString(out, def.column);
+            writeString(out, def.type);
+        }
+        if (!out.flush()) {
+            std::cerr << "Error: Cannot write catalog in " << dir << "." << std::endl;
+            return false;
+        }
+    }
+    if (!syncFile(temp.string())) {
+        std::cerr << "Error: Cannot sync catalog in " << dir << "." << std::endl;
+        return false;
+    }
+    std::error_code ec;
+    fs::rename(temp, path, ec);
+    if (ec) {
+        std::cerr << "Error: Cannot replace catalog in " << dir << "." << std::endl;
+        return false;
+    }
+    generation++;
+    lastCheckpointLsn = lsn;
+    catalogIndexes = indexes;
+    for (const auto& file : obsoleteFiles) {
+        auto open = openFiles.find(file);
+        if (open != openFiles.end()) {
+            pool.closeFile(open->second);
+            openFiles.erase(open);
+        }
+        fs::remove(filePath(file), ec);
+    }
+    obsoleteFiles.clear();
+    return true;
+}
+
+std::vector<std::string> Storage::storedTables() const {
+    std::vector<std::string> names;
+    for (const auto& entry : catalog)
+        names.push_back(entry.first);
+    return names;
+}
+
+bool Storage::appendRecords(const Table& table, const std::vector<size_t>& rows, int file) {
+    // Records go on fresh pages, so no page already written changes.
+    std::unique_ptr<PageHandle> page;
+    std::string record;
+    for (size_t row : rows) {
+        encodeRow(table, row, record);
+        bool overflow = record.size() > MaxInline;
+        size_t inlineSize = overflow ? 8 : record.size();
+        if (page) {
+            char* data = page->data();
+            size_t slotEnd = HeaderSize + (readAt<uint16_t>(data, 2) + 1) * SlotSize;
+            if (slotEnd + inlineSize > readAt<uint16_t>(data, 4))
+                page.reset();
+        }
+        if (!page) {
+            page = std::make_unique<PageHandle>(pool, file);
+            if (!page->data())
+                return false;
+            writeAt<uint8_t>(page->data(), 0, DataPage);
+            writeAt<uint16_t>(page->data(), 4, static_cast<uint16_t>(BufferPool::PageSize));
+        }
+
+        std::string payload;
+        if (overflow) {
+            // Spill the record into a chain of overflow pages.
+            std::unique_ptr<PageHandle> previous;
+            uint32_t first = 0;
+            for (size_t pos = 0; pos < record.size(); pos += OverflowCapacity) {
+                auto chunk = std::make_unique<PageHandle>(pool, file);
+                size_t length = std::min(OverflowCapacity, record.size() - pos);
+                writeAt<uint8_t>(chunk->data(), 0, OverflowPage);
+                writeAt<uint16_t>(chunk->data(), 4, static_cast<uint16_t>(length));
+                std::memcpy(chunk->data() + HeaderSize, record.data() + pos, length);
+                if (previous)
+                    writeAt<uint32_t>(previous->data(), 8, chunk->number());
+                else
+                    first = chunk->number();
+                previous = std::move(chunk);
+            }
+            appendRaw(payload, first);
+            appendRaw(payload, static_cast<uint32_t>(record.size()));
+        }
+        const std::string& bytes = overflow ? payload : record;
+
+        char* data = page->data();
+        uint16_t slots = readAt<uint16_t>(data, 2);
+        uint16_t freeEnd = static_cast<uint16_t>(readAt<uint16_t>(data, 4) - bytes.size());
+        std::memcpy(data + freeEnd, bytes.data(), bytes.size());
+        writeAt<uint16_t>(data, HeaderSize + slots * SlotSize, freeEnd);
+        writeAt<uint16_t>(data, HeaderSize + slots * SlotSize + 2,
+                          overflow ? OverflowSlot : static_cast<uint16_t>(bytes.size()));
+        writeAt<uint16_t>(data, 2, static_cast<uint16_t>(slots + 1));
+        writeAt<uint16_t>(data, 4, freeEnd);
+    }
+    page.reset();
+    pool.flushFile(file);
+    return true;
+}
+
+bool Storage::appendDeletions(TableSchema& schema, const std::string& tableName,
+                              const std::vector<uint64_t>& records) {
+    if (records.empty())
+        return true;
+    if (schema.deletions.empty())
+        schema.deletions = tableName + "." + std::to_string(generation + 1) + ".del";
+    {
+        std::ofstream out(filePath(schema.deletions), std::ios::binary | std::ios::app);
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(uint64_t));
+        if (!out.flush())
+            return false;
+    }
+    if (!syncFile(filePath(schema.deletions)))
+        return false;
+    schema.deleted.insert(schema.deleted.end(), records.begin(), records.end());
+    std::sort(schema.deleted.begin(), schema.deleted.end());
+    return true;
+}
+
+void Storage::saveTableToFile(Table& table, const std::string& tableName) {
+    if (!isOpen())
+        return;
+    // Only the committed state is stored. Rows saved before that are no
+    // longer visible (ended or removed since) become deletions.
+    const Transaction& committed = Transaction::latestCommitted();
+    std::vector<size_t> added;
+    std::vector<uint64_t> ended = table.takeRemovedRecords();
+    for (size_t row = 0; row < table.rowCount(); ++row) {
+        bool visible = table.isVisible(row, committed);
+        if (visible && table.storedRecord(row) == Table::NotStored)
+            added.push_back(row);
+        else if (!visible && table.storedRecord(row) != Table::NotStored)
+            ended.push_back(table.storedRecord(row));
+    }
+
+    auto it = catalog.find(tableName);
+    bool append = it != catalog.end() && table.storedLayoutCurrent() && it->second.records != UnknownRecords &&
+                  it->second.columns == table.getColumns() && it->second.types == table.getColumnTypes();
+    // Compact once most of the file is deleted records.
+    if (append && (it->second.deleted.size() + ended.size()) * 2 > it->second.records + added.size())
+        append = false;
+
+    if (append) {
+        TableSchema& schema = it->second;
+        int file = fileId(schema.file);
+        if (file < 0 || pool.pageCount(file) != schema.pages || !appendRecords(table, added, file) ||
+            !syncFile(filePath(schema.file)) || !appendDeletions(schema, tableName, ended)) {
+            std::cerr << "Error: Cannot write table file " << schema.file << "." << std::endl;
+            return;
+        }
+        for (size_t i = 0; i < added.size(); ++i)
+            table.setStoredRecord(added[i], schema.records + i);
+        for (size_t row = 0; row < table.rowCount(); ++row) {
+            if (!table.isVisible(row, committed))
+                table.setStoredRecord(row, Table::NotStored);
+        }
+        schema.pages = pool.pageCount(file);
+        schema.records += added.size();
+        schema.notNull.clear();
+        for (size_t c = 0; c < schema.columns.size(); ++c)
+            schema.notNull.push_back(table.isNotNull(c));
+        schema.primaryKey = table.primaryKeyColumn();
+        return;
+    }
+
+    // Write a fresh file next to the old one; the catalog switches to it.
+    std::string file = tableName + "." + std::to_string(generation + 1) + ".tbl";
+    auto open = openFiles.find(file);
+    if (open != openFiles.end()) {
+        pool.closeFile(open->second);
+        openFiles.erase(open);
+    }
+    int id = pool.openFile(filePath(file), true);
+    if (id < 0)
+        return;
+    openFiles[file] = id;
+    std::vector<size_t> rows;
+    for (size_t row = 0; row < table.rowCount(); ++row) {
+        if (table.isVisible(row, committed))
+            rows.push_back(row);
+    }
+    if (!appendRecords(table, rows, id) || !syncFile(filePath(file))) {
+        std::cerr << "Error: Cannot write table file " << file << "." << std::endl;
+        return;
+    }
+    for (size_t row = 0; row < table.rowCount(); ++row)
+        table.setStoredRecord(row, Table::NotStored);
+    for (size_t i = 0; i < rows.size(); ++i)
+        table.setStoredRecord(rows[i], i);
+    table.setStoredLayoutCurrent(true);
+
+    TableSchema& schema = catalog[tableName];
+    if (!schema.file.empty() && schema.file != file)
+        obsoleteFiles.push_back(schema.file);
+    if (!schema.deletions.empty())
+        obsoleteFiles.push_back(schema.deletions);
+    schema.file = file;
+    schema.pages = pool.pageCount(id);
+    schema.records = rows.size();
+    schema.deletions.clear();
+    schema.deleted.clear();
+    schema.columns = table.getColumns();
+    schema.types = table.getColumnTypes();
+    schema.notNull.clear();
+    for (size_t c = 0; c < schema.columns.size(); ++c)
+        schema.notNull.push_back(table.isNotNull(c));
+    schema.primaryKey = table.primaryKeyColumn();
+}
+
+bool Storage::scanTable(const std::string& tableName,
+                        const std::function<bool(const std::vector<std::string>&, uint64_t)>& fn) {
+    auto it = catalog.find(tableName);
+    if (it == catalog.end())
+        return false;
+    const TableSchema& schema = it->second;
+    std::vector<ColumnType> types;
+    for (const auto& type : schema.types)
+        types.push_back(columnTypeFor(type));
+    if (schema.file.empty())
+        return true;
+
+    // The pool is shared by concurrent scans, so it is only used under
+    // poolMutex: each page's records are decoded there, then handed to 'fn'
+    // without the lock.
+    bool ok = true;
+    bool more = true;
+    uint64_t record = 0;
+    auto deleted = schema.deleted.begin();
+    std::vector<std::vector<std::string>> rows;
+    std::vector<uint64_t> records;
+    std::string bytes;
+    for (uint32_t pageNo = 0; pageNo < schema.pages && ok && more; ++pageNo) {
+        rows.clear();
+        records.clear();
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            int file = fileId(schema.file);
+            if (file < 0)
+                return false;
+            PageHandle page(pool, file, pageNo);
+            const char* data = page.data();
+            ok = data != nullptr;
+            if (!ok || readAt<uint8_t>(data, 0) != DataPage)
+                continue;
+            uint16_t slots = readAt<uint16_t>(data, 2);
+            for (uint16_t s = 0; s < slots && ok; ++s, ++record) {
+                while (deleted != schema.deleted.end() && *deleted < record)
+                    ++deleted;
+                if (deleted != schema.deleted.end() && *deleted == record)
+                    continue;
+                rows.emplace_back();
+                records.push_back(record);
+                uint16_t offset = readAt<uint16_t>(data, HeaderSize + s * SlotSize);
+                uint16_t length = readAt<uint16_t>(data, HeaderSize + s * SlotSize + 2);
+                if (length != OverflowSlot) {
+                    ok = offset + length <= BufferPool::PageSize &&
+                         decodeRow(types, data + offset, length, rows.back());
+                    continue;
+                }
+                uint32_t next = readAt<uint32_t>(data, offset);
+                uint32_t total = readAt<uint32_t>(data, offset + 4);
+                bytes.clear();
+                while (bytes.size() < total && ok) {
+                    PageHandle chunk(pool, file, next);
+                    ok = chunk.data() && readAt<uint8_t>(chunk.data(), 0) == OverflowPage;
+                    if (!ok)
+                        break;
+                    bytes.append(chunk.data() + HeaderSize, readAt<uint16_t>(chunk.data(), 4));
+                    next = readAt<uint32_t>(chunk.data(), 8);
+                }
+                ok = ok && decodeRow(types, bytes.data(), bytes.size(), rows.back());
+            }
+        }
+        for (size_t i = 0; i < rows.size() && ok && more; ++i)
+            more = fn(rows[i], records[i]);
+    }
+    if (!ok)
+        std::cerr << "Error: Table file for " << tableName << " is corrupt." << std::endl;
+    return ok;
+}
+
+Table Storage::tableSchema(const std::string& tableName) const {
     Table table;
-    std::ifstream file(tableName + ".txt");
-    // Deserialization code would go here.
-    file.close();
+    auto it = catalog.find(tableName);
+    if (it == catalog.end())
+        return table;
+    const TableSchema& schema = it->second;
+    for (size_t c = 0; c < schema.columns.size(); ++c)
+        table.addColumn(schema.columns[c], schema.types[c], schema.notNull[c]);
     return table;
-}
\ No newline at end of file
+}
+
+bool Storage::exceedsBufferPool(const std::string& tableName) const {
+    auto it = catalog.find(tableName);
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return it != catalog.end() && it->second.pages > pool.frameCount();
+}
+
+Table Storage::loadTableFromFile(const std::string& tableName) {
+    Table table = tableSchema(tableName);
+    auto it = catalog.find(tableName);
+    if (it == catalog.end())
+        return table;
+    scanTable(tableName, [&](const std::vector<std::string>& values, uint64_t record) {
+        if (table.addRow(values))
+            table.setStoredRecord(table.rowCount() - 1, record);
+        return true;
+    });
+    if (it->second.primaryKey >= 0)
+        table.setPrimaryKey(it->second.columns[it->second.primaryKey]);
+    table.setStoredLayoutCurrent(true);
+    return table;
+}
+
+void Storage::dropTableFile(const std::string& tableName) {
+    if (!isOpen())
+        return;
+    auto it = catalog.find(tableName);
+    if (it == catalog.end())
+        return;
+    if (!it->second.file.empty())
+        obsoleteFiles.push_back(it->second.file);
+    if (!it->second.deletions.empty())
+        obsoleteFiles.push_back(it->second.deletions);
+    catalog.erase(it);
+}
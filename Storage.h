@@ -2,12 +2,114 @@
 #define STORAGE_H
 
 #include "Table.h"
+#include "BufferPool.h"
 #include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
 
+// An index as recorded in the catalog.
+struct IndexDefinition {
+    std::string name;
+    std::string table;
+    std::string column;
+    std::string type; // HASH or BTREE
+};
+
+// On-disk database: a directory holding one catalog file (schemas and index
+// definitions) and, per table, one file of fixed-size slotted pages plus an
+// optional file of deleted record numbers. Table files are read and written a
+// page at a time through the buffer pool. A table larger than the pool is
+// never loaded for a plain scan: scanTable() streams its pages through the
+// pool, so only a bounded number of them are resident at once.
+//
+// Records are numbered in file order. A save appends the rows added since
+// the last one on fresh pages at the end of the file, and the numbers of the
+// records that went away to the deletions file; pages and numbers already
+// written are never changed. The catalog records how many pages and deletions
+// are valid, so anything a crash leaves past them is ignored and cut off on
+// open. Replacing the catalog is therefore the single atomic step of a
+// checkpoint. When more than half the records are deleted, or the table's
+// layout changed, the table is rewritten whole into a new file named after
+// the next catalog generation, and files the catalog no longer names are
+// deleted afterwards.
+//
+// Data page layout (BufferPool::PageSize bytes):
+//   [kind:1][pad:1][slotCount:2][freeEnd:2][pad:2][next:4][slots...  ...records]
+// Slots are (offset:2, length:2) pairs growing up from the header; records grow
+// down from the end of the page. A record too large for one page is written to
+// a chain of overflow pages and its slot holds (firstPage:4, length:4) with the
+// length field set to OverflowSlot.
 class Storage {
 public:
-    void saveTableToFile(const Table& table, const std::string& tableName);
+    explicit Storage(size_t bufferFrames = 1024);
+
+    // Opens (creating if needed) the database directory and reads its catalog.
+    bool open(const std::string& directory);
+    bool isOpen() const { return !dir.empty(); }
+
+    std::vector<std::string> storedTables() const;
+    const std::vector<IndexDefinition>& storedIndexes() const { return catalogIndexes; }
+
+    // Log position covered by the last checkpoint written to the catalog.
+    uint64_t checkpointLsn() const { return lastCheckpointLsn; }
+
+    // Saves the table's changes since it was loaded or last saved (see
+    // above) and notes in it which rows are now stored; the result becomes
+    // current with the next writeCatalog().
+    void saveTableToFile(Table& table, const std::string& tableName);
+    // Rebuilds a stored table (schema and rows); empty if it is not stored.
     Table loadTableFromFile(const std::string& tableName);
+    // A stored table's schema, without rows.
+    Table tableSchema(const std::string& tableName) const;
+    // True if the table's pages outnumber the buffer pool's frames.
+    bool exceedsBufferPool(const std::string& tableName) const;
+    // Streams the live rows of a stored table page by page, as text values
+    // with their record numbers, until 'fn' returns false. Safe to call from
+    // several threads at once, though not during a save.
+    bool scanTable(const std::string& tableName,
+                   const std::function<bool(const std::vector<std::string>&, uint64_t)>& fn);
+    // Forgets a stored table; its file is deleted by the next writeCatalog().
+    void dropTableFile(const std::string& tableName);
+    // Atomically replaces the catalog file with the current schemas, 'indexes'
+    // and the log position the saved tables reflect.
+    bool writeCatalog(const std::vector<IndexDefinition>& indexes, uint64_t lsn);
+
+private:
+    static constexpr uint64_t UnknownRecords = ~uint64_t(0);
+
+    struct TableSchema {
+        std::vector<std::string> columns;
+        std::vector<std::string> types;
+        std::vector<bool> notNull;
+        int primaryKey = -1;
+        std::string file;
+        uint32_t pages = 0;                // valid pages of 'file'
+        uint64_t records = UnknownRecords; // records in them, deleted ones included
+        std::string deletions;             // file of deleted record numbers, or empty
+        std::vector<uint64_t> deleted;     // its valid contents, sorted
+    };
+
+    std::string dir;
+    BufferPool pool;
+    mutable std::mutex poolMutex; // scans run concurrently under the catalog's shared lock
+    std::unordered_map<std::string, int> openFiles; // file name -> pool file id
+    std::map<std::string, TableSchema> catalog;
+    std::vector<IndexDefinition> catalogIndexes;
+    uint64_t generation = 0;
+    uint64_t lastCheckpointLsn = 0;
+    std::vector<std::string> obsoleteFiles;
+
+    std::string filePath(const std::string& file) const;
+    int fileId(const std::string& file);
+    bool readCatalog();
+    void removeUnreferencedFiles();
+    // Writes 'rows' of 'table' to new pages at the end of the file; returns
+    // false if the file cannot be written.
+    bool appendRecords(const Table& table, const std::vector<size_t>& rows, int file);
+    bool appendDeletions(TableSchema& schema, const std::string& tableName, const std::vector<uint64_t>& records);
 };
 
-#endif // STORAGE_H
\ No newline at end of file
+#endif // STORAGE_H
@@ -2,19 +2,27 @@
 #include "Utils.h"
 #include "ConditionParser.h"
 #include "Aggregation.h"
+#include "ThreadPool.h"
+#include "SimdKernels.h"
+#include "Sort.h"
+#include "Optimizer.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <numeric>
 #include <unordered_map>
+#include <unordered_set>
 #include <stdexcept>
 
 void Table::addColumn(const std::string& columnName, const std::string& type, bool isNotNull) {
     columns.push_back(columnName);
     columnTypes.push_back(type);
     notNullConstraints.push_back(isNotNull);
-    for (auto& row : rows) {
-        row.push_back(isNotNull ? "" : "");
-    }
+    layoutCurrent = false;
+    Column column(columnTypeFor(type));
+    for (size_t i = 0; i < numRows; ++i)
+        column.appendNull();
+    data.push_back(std::move(column));
 }
 
 bool Table::dropColumn(const std::string& columnName) {
@@ -27,25 +35,445 @@ bool Table::dropColumn(const std::string& columnName) {
     columns.erase(it);
     columnTypes.erase(columnTypes.begin() + index);
     notNullConstraints.erase(notNullConstraints.begin() + index);
-    for (auto& row : rows) {
-        if (index < row.size())
-            row.erase(row.begin() + index);
+    data.erase(data.begin() + index);
+    layoutCurrent = false;
+    indexes.erase(columnName);
+    if (index == primaryKey) {
+        primaryKey = -1;
+        primaryIndex.clear();
+    } else if (index < primaryKey) {
+        primaryKey--;
     }
     return true;
 }
 
-void Table::addRow(const std::vector<std::string>& values) {
+int Table::getColumnIndex(const std::string& columnName) const {
+    auto it = std::find(columns.begin(), columns.end(), columnName);
+    if (it == columns.end())
+        return -1;
+    return std::distance(columns.begin(), it);
+}
+
+bool Table::validateRow(const std::vector<std::string>& values) const {
     if (values.size() != columns.size()) {
         std::cerr << "Error: Incorrect number of values for row." << std::endl;
-        return;
+        return false;
     }
     for (size_t i = 0; i < values.size(); ++i) {
-        if (notNullConstraints[i] && values[i].empty()) {
+        if (notNullConstraints[i] && data[i].isNullValue(values[i])) {
             std::cerr << "Error: NOT NULL constraint violated for column " << columns[i] << "." << std::endl;
-            return;
+            return false;
+        }
+        if (!data[i].accepts(values[i])) {
+            std::cerr << "Error: Invalid value '" << values[i] << "' for " << columnTypes[i]
+                      << " column " << columns[i] << "." << std::endl;
+            return false;
         }
     }
-    rows.push_back(values);
+    return true;
+}
+
+void Table::appendRow(const std::vector<std::string>& values, uint64_t begin) {
+    for (size_t i = 0; i < values.size(); ++i)
+        data[i].append(values[i]);
+    indexRow(numRows);
+    versionBegin.push_back(begin);
+    versionEnd.push_back(InfiniteTs);
+    storedRecords.push_back(NotStored);
+    numRows++;
+}
+
+void Table::indexRow(size_t row) {
+    for (auto& entry : indexes)
+        entry.second.insert(data[getColumnIndex(entry.first)], row);
+    if (primaryKey >= 0)
+        primaryIndex.insert(data[primaryKey], row);
+}
+
+bool Table::primaryKeyFree(const std::string& value, uint64_t writer, size_t ignoreRow) const {
+    if (primaryKey < 0)
+        return true;
+    for (size_t row : primaryIndex.lookup(data[primaryKey].canonical(value))) {
+        uint64_t end = versionEnd[row];
+        if (row != ignoreRow && (end == InfiniteTs || ((end & TxnIdBit) && end != writer))) {
+            std::cerr << "Error: Duplicate primary key value '" << value << "' for column "
+                      << columns[primaryKey] << "." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Adds a row that every transaction sees (loading, internal result tables).
+bool Table::addRow(const std::vector<std::string>& values) {
+    if (!validateRow(values) || !primaryKeyFree(primaryKey >= 0 ? values[primaryKey] : "", 0))
+        return false;
+    appendRow(values, 0);
+    return true;
+}
+
+bool Table::addRow(const std::vector<std::string>& values, Transaction& txn) {
+    if (!validateRow(values) || !primaryKeyFree(primaryKey >= 0 ? values[primaryKey] : "", txn.id))
+        return false;
+    appendRow(values, txn.id);
+    pending[txn.id].inserted.push_back(numRows - 1);
+    return true;
+}
+
+void Table::endVersion(size_t row, Transaction& txn) {
+    versionEnd[row] = txn.id;
+    endedVersions++;
+    pending[txn.id].deleted.push_back(row);
+}
+
+// Appends a copy of 'row' with 'assignments' applied as a version owned by 'txn'.
+void Table::appendVersion(size_t row, const std::vector<std::pair<int, std::string>>& assignments,
+                          Transaction& txn) {
+    for (auto& column : data)
+        column.appendFrom(column, row);
+    for (const auto& assignment : assignments)
+        data[assignment.first].set(numRows, assignment.second);
+    indexRow(numRows);
+    versionBegin.push_back(txn.id);
+    versionEnd.push_back(InfiniteTs);
+    storedRecords.push_back(NotStored);
+    pending[txn.id].inserted.push_back(numRows);
+    numRows++;
+}
+
+bool Table::setValue(size_t row, size_t col, const std::string& value) {
+    if (notNullConstraints[col] && data[col].isNullValue(value)) {
+        std::cerr << "Error: NOT NULL constraint violated for column " << columns[col] << "." << std::endl;
+        return false;
+    }
+    if (!data[col].accepts(value)) {
+        std::cerr << "Error: Invalid value '" << value << "' for " << columnTypes[col]
+                  << " column " << columns[col] << "." << std::endl;
+        return false;
+    }
+    if (static_cast<int>(col) == primaryKey) {
+        if (!primaryKeyFree(value, 0, row))
+            return false;
+        primaryIndex.erase(data[col], row);
+    }
+    auto idx = indexes.find(columns[col]);
+    if (idx != indexes.end())
+        idx->second.erase(data[col], row);
+    data[col].set(row, value);
+    if (idx != indexes.end())
+        idx->second.insert(data[col], row);
+    if (static_cast<int>(col) == primaryKey)
+        primaryIndex.insert(data[col], row);
+    // The stored record is out of date: replace it at the next save.
+    if (storedRecords[row] != NotStored) {
+        removedRecords.push_back(storedRecords[row]);
+        storedRecords[row] = NotStored;
+    }
+    return true;
+}
+
+WriteResult Table::replaceRow(size_t row, const std::vector<std::string>& values, Transaction& txn) {
+    if (!writable(row))
+        return WriteResult::Conflict;
+    if (!validateRow(values) || (primaryKey >= 0 && !primaryKeyFree(values[primaryKey], txn.id, row)))
+        return WriteResult::Violation;
+    endVersion(row, txn);
+    appendRow(values, txn.id);
+    pending[txn.id].inserted.push_back(numRows - 1);
+    return WriteResult::Ok;
+}
+
+WriteResult Table::updateRow(size_t row, const std::vector<std::pair<int, std::string>>& assignments,
+                             Transaction& txn) {
+    if (!writable(row))
+        return WriteResult::Conflict;
+    for (const auto& assignment : assignments) {
+        if (assignment.first == primaryKey && !primaryKeyFree(assignment.second, txn.id, row))
+            return WriteResult::Violation;
+    }
+    endVersion(row, txn);
+    appendVersion(row, assignments, txn);
+    return WriteResult::Ok;
+}
+
+void Table::commitVersions(uint64_t txnId, uint64_t commitTs) {
+    auto it = pending.find(txnId);
+    if (it == pending.end())
+        return;
+    for (size_t row : it->second.inserted)
+        versionBegin[row] = commitTs;
+    for (size_t row : it->second.deleted)
+        versionEnd[row] = commitTs;
+    endedRows.insert(endedRows.end(), it->second.deleted.begin(), it->second.deleted.end());
+    if (!it->second.inserted.empty())
+        newestBegin = std::max(newestBegin, commitTs);
+    pending.erase(it);
+}
+
+void Table::abortVersions(uint64_t txnId) {
+    auto it = pending.find(txnId);
+    if (it == pending.end())
+        return;
+    for (size_t row : it->second.deleted) {
+        versionEnd[row] = InfiniteTs;
+        endedVersions--;
+    }
+    // Discarded inserts end at time 0: invisible to all, reclaimed by GC.
+    for (size_t row : it->second.inserted) {
+        versionEnd[row] = 0;
+        endedVersions++;
+    }
+    endedRows.insert(endedRows.end(), it->second.inserted.begin(), it->second.inserted.end());
+    pending.erase(it);
+}
+
+std::vector<std::string> Table::rowValues(size_t row) const {
+    std::vector<std::string> values;
+    values.reserve(data.size());
+    for (const auto& column : data)
+        values.push_back(column.get(row));
+    return values;
+}
+
+Table::ChangeMark Table::changeMark(const Transaction& txn) const {
+    ChangeMark mark;
+    auto it = pending.find(txn.id);
+    if (it != pending.end()) {
+        mark.inserted = it->second.inserted.size();
+        mark.deleted = it->second.deleted.size();
+    }
+    return mark;
+}
+
+void Table::changesSince(const Transaction& txn, ChangeMark mark,
+                         std::vector<std::vector<std::string>>& ended,
+                         std::vector<std::vector<std::string>>& added) const {
+    auto it = pending.find(txn.id);
+    if (it == pending.end())
+        return;
+    const std::vector<size_t>& inserted = it->second.inserted;
+    const std::vector<size_t>& deleted = it->second.deleted;
+    std::unordered_set<size_t> created(inserted.begin() + mark.inserted, inserted.end());
+    for (size_t i = mark.deleted; i < deleted.size(); ++i) {
+        if (created.erase(deleted[i]) == 0)
+            ended.push_back(rowValues(deleted[i]));
+    }
+    for (size_t i = mark.inserted; i < inserted.size(); ++i) {
+        if (created.count(inserted[i]))
+            added.push_back(rowValues(inserted[i]));
+    }
+}
+
+// Values joined with their lengths, so that distinct rows never collide.
+static std::string rowKey(const std::vector<std::string>& values) {
+    std::string key;
+    for (const auto& value : values)
+        key += std::to_string(value.size()) + ':' + value;
+    return key;
+}
+
+bool Table::applyChanges(const std::vector<std::vector<std::string>>& ended,
+                         const std::vector<std::vector<std::string>>& added, Transaction& txn) {
+    std::vector<size_t> rows;
+    if (primaryKey >= 0) {
+        for (const auto& values : ended) {
+            size_t row = static_cast<size_t>(primaryKey) < values.size()
+                             ? findByPrimaryKey(values[primaryKey], txn) : NoRow;
+            if (row == NoRow || !writable(row))
+                return false;
+            rows.push_back(row);
+        }
+    } else if (!ended.empty()) {
+        // Without a key, one pass matches whole rows; equal rows are
+        // interchangeable, so any visible one of them will do.
+        std::unordered_map<std::string, size_t> wanted;
+        for (const auto& values : ended)
+            wanted[rowKey(values)]++;
+        for (size_t row = 0; row < numRows && rows.size() < ended.size(); ++row) {
+            if (!isVisible(row, txn) || !writable(row))
+                continue;
+            auto it = wanted.find(rowKey(rowValues(row)));
+            if (it == wanted.end() || it->second == 0)
+                continue;
+            it->second--;
+            rows.push_back(row);
+        }
+        if (rows.size() < ended.size())
+            return false;
+    }
+    for (size_t row : rows)
+        endVersion(row, txn);
+    for (const auto& values : added) {
+        if (!addRow(values, txn))
+            return false;
+    }
+    return true;
+}
+
+void Table::undoSince(Transaction& txn, ChangeMark mark) {
+    auto it = pending.find(txn.id);
+    if (it == pending.end())
+        return;
+    std::vector<size_t>& inserted = it->second.inserted;
+    std::vector<size_t>& deleted = it->second.deleted;
+    for (size_t i = mark.deleted; i < deleted.size(); ++i) {
+        versionEnd[deleted[i]] = InfiniteTs;
+        endedVersions--;
+    }
+    // As in abortVersions(), the statement's inserts end at time 0.
+    for (size_t i = mark.inserted; i < inserted.size(); ++i) {
+        versionEnd[inserted[i]] = 0;
+        endedVersions++;
+        endedRows.push_back(inserted[i]);
+    }
+    inserted.resize(mark.inserted);
+    deleted.resize(mark.deleted);
+}
+
+size_t Table::collectGarbage(uint64_t horizon) {
+    size_t kept = 0;
+    size_t reclaimed = 0;
+    for (size_t row : endedRows) {
+        if (versionEnd[row] > horizon) {
+            endedRows[kept++] = row;
+            continue;
+        }
+        unindexRow(row);
+        reclaimedRows.push_back(row);
+        reclaimed++;
+    }
+    endedRows.resize(kept);
+    // Compaction renumbers every row, so it waits until it frees a good part
+    // of the table.
+    if (!reclaimedRows.empty() && reclaimedRows.size() * CompactionFraction >= numRows)
+        compactRows();
+    return reclaimed;
+}
+
+void Table::unindexRow(size_t row) {
+    for (auto& entry : indexes)
+        entry.second.erase(data[getColumnIndex(entry.first)], row);
+    if (primaryKey >= 0)
+        primaryIndex.erase(data[primaryKey], row);
+}
+
+void Table::compactRows() {
+    std::vector<uint8_t> keep(numRows, 1);
+    for (size_t row : reclaimedRows)
+        keep[row] = 0;
+    // Rows keep their order, so the new ids never decrease (as
+    // Index::renumber() needs); a removed row maps to its successor's id.
+    std::vector<size_t> newIds(numRows);
+    size_t out = 0;
+    for (size_t row = 0; row < numRows; ++row) {
+        newIds[row] = out;
+        if (!keep[row]) {
+            if (storedRecords[row] != NotStored)
+                removedRecords.push_back(storedRecords[row]);
+            continue;
+        }
+        versionBegin[out] = versionBegin[row];
+        versionEnd[out] = versionEnd[row];
+        storedRecords[out] = storedRecords[row];
+        out++;
+    }
+    for (auto& column : data)
+        column.retain(keep);
+    versionBegin.resize(out);
+    versionEnd.resize(out);
+    storedRecords.resize(out);
+    endedVersions -= numRows - out;
+    numRows = out;
+    for (auto& entry : indexes)
+        entry.second.renumber(newIds);
+    primaryIndex.renumber(newIds);
+    // Writers still running hold row ids of their versions, none reclaimed.
+    for (auto& entry : pending) {
+        for (size_t& row : entry.second.inserted)
+            row = newIds[row];
+        for (size_t& row : entry.second.deleted)
+            row = newIds[row];
+    }
+    for (size_t& row : endedRows)
+        row = newIds[row];
+    reclaimedRows.clear();
+}
+
+bool Table::createIndex(const std::string& columnName, IndexType type) {
+    int col = getColumnIndex(columnName);
+    if (col < 0)
+        return false;
+    Index index(columnName, type);
+    buildIndex(index, col);
+    indexes[columnName] = std::move(index);
+    return true;
+}
+
+void Table::dropIndex(const std::string& columnName) {
+    indexes.erase(columnName);
+}
+
+// A column's own index, or else the primary key index when it is the key.
+const Index* Table::findIndex(int col) const {
+    if (col < 0)
+        return nullptr;
+    auto it = indexes.find(columns[col]);
+    if (it != indexes.end())
+        return &it->second;
+    return col == primaryKey ? &primaryIndex : nullptr;
+}
+
+void Table::rebuildIndexes() {
+    for (auto& entry : indexes)
+        buildIndex(entry.second, getColumnIndex(entry.first));
+    if (primaryKey >= 0)
+        buildIndex(primaryIndex, primaryKey);
+}
+
+void Table::buildIndex(Index& index, size_t col) const {
+    index.build(data[col]);
+    for (size_t row : reclaimedRows)
+        index.erase(data[col], row);
+}
+
+bool Table::setPrimaryKey(const std::string& columnName) {
+    int col = getColumnIndex(columnName);
+    if (col < 0) {
+        std::cerr << "Error: Column " << columnName << " does not exist." << std::endl;
+        return false;
+    }
+    Index index(columnName, IndexType::Hash);
+    buildIndex(index, col);
+    // Versions not ended, or ended by a writer still running, are live.
+    auto live = [&](size_t row) { return versionEnd[row] == InfiniteTs || (versionEnd[row] & TxnIdBit); };
+    for (size_t row = 0; row < numRows; ++row) {
+        if (!live(row))
+            continue;
+        if (data[col].isNull(row)) {
+            std::cerr << "Error: PRIMARY KEY column " << columnName << " holds NULL values." << std::endl;
+            return false;
+        }
+        for (size_t other : index.lookup(data[col].get(row))) {
+            if (other != row && live(other)) {
+                std::cerr << "Error: PRIMARY KEY column " << columnName << " holds duplicate values." << std::endl;
+                return false;
+            }
+        }
+    }
+    primaryKey = col;
+    notNullConstraints[col] = true;
+    primaryIndex = std::move(index);
+    return true;
+}
+
+size_t Table::findByPrimaryKey(const std::string& value, const Transaction& txn) const {
+    if (primaryKey < 0)
+        return NoRow;
+    for (size_t row : primaryIndex.lookup(data[primaryKey].canonical(value))) {
+        if (isVisible(row, txn))
+            return row;
+    }
+    return NoRow;
 }
 
 void Table::printTable() {
@@ -53,218 +481,812 @@ void Table::printTable() {
         std::cout << col << "\t";
     }
     std::cout << std::endl;
-    for (const auto& row : rows) {
-        for (const auto& value : row) {
-            std::cout << value << "\t";
+    for (size_t row = 0; row < numRows; ++row) {
+        if (!isVisible(row, Transaction::latestCommitted()))
+            continue;
+        for (const auto& column : data) {
+            std::cout << column.get(row) << "\t";
         }
         std::cout << std::endl;
     }
 }
 
-void Table::deleteRows(const std::string& condition) {
-    if (condition.empty()) {
-        rows.clear();
-        return;
+const ConditionExpression* Table::bindCondition(const std::string& condition, ConditionExpression* prepared,
+                                                ConditionExprPtr& parsed) const {
+    if (prepared) {
+        prepared->bind(*this);
+        return prepared;
     }
+    if (condition.empty())
+        return nullptr;
     ConditionParser cp(condition);
-    auto expr = cp.parse();
-    rows.erase(std::remove_if(rows.begin(), rows.end(), [&](const std::vector<std::string>& row) {
-        return expr->evaluate(row, columns);
-    }), rows.end());
-}
-
-void Table::updateRows(const std::vector<std::pair<std::string, std::string>>& updates,
-                       const std::string& condition) {
-    ConditionExprPtr expr = nullptr;
-    if (!condition.empty()) {
-        ConditionParser cp(condition);
-        expr = cp.parse();
-    }
-    for (auto& row : rows) {
-        if (!expr || expr->evaluate(row, columns)) {
-            for (const auto& update : updates) {
-                auto it = std::find(columns.begin(), columns.end(), update.first);
-                if (it != columns.end()) {
-                    int index = std::distance(columns.begin(), it);
-                    row[index] = update.second;
+    parsed = cp.compile(*this);
+    return parsed.get();
+}
+
+// Row ids (in storage order) of the rows visible to 'txn' that satisfy 'expr'.
+std::vector<size_t> Table::matchingRows(const ConditionExpression* expr, const Transaction& txn,
+                                        size_t parallelism, size_t limit) const {
+    std::vector<size_t> result;
+    bool everyVersion = allVisible(txn);
+    if (expr) {
+        std::vector<size_t> candidates;
+        if (expr->candidateRows(*this, candidates)) {
+            // An index narrowed the search; re-check the full condition on the
+            // hits, a batch at a time.
+            std::sort(candidates.begin(), candidates.end());
+            size_t batch[BatchSize];
+            for (size_t begin = 0; begin < candidates.size() && result.size() < limit; begin += BatchSize) {
+                size_t count = 0;
+                for (size_t i = begin; i < std::min(candidates.size(), begin + BatchSize); ++i) {
+                    batch[count] = candidates[i];
+                    count += everyVersion || isVisible(candidates[i], txn);
                 }
+                count = expr->filter(*this, batch, count);
+                result.insert(result.end(), batch, batch + count);
             }
+            return result;
         }
     }
+    // Scans evaluate the condition over each batch as a bitmask with the SIMD
+    // kernels where it has them, and otherwise fill a selection vector with
+    // the visible rows and let the condition narrow it. Batches start at
+    // multiples of BatchSize, as the kernels require.
+    auto scan = [&](size_t begin, size_t end, std::vector<size_t>& out) {
+        size_t batch[BatchSize];
+        uint64_t mask[BatchSize / 64];
+        for (size_t first = begin; first < end && out.size() < limit; first += BatchSize) {
+            size_t last = std::min(end, first + BatchSize);
+            size_t count = 0;
+            if (expr && expr->filterMask(*this, first, last, mask)) {
+                for (size_t row = first; !everyVersion && row < last; ++row) {
+                    if (!isVisible(row, txn))
+                        mask[(row - first) >> 6] &= ~(uint64_t(1) << ((row - first) & 63));
+                }
+                count = SimdKernels::maskToRows(mask, first, last, batch);
+                out.insert(out.end(), batch, batch + count);
+                continue;
+            }
+            for (size_t row = first; row < last; ++row) {
+                batch[count] = row;
+                count += everyVersion || isVisible(row, txn);
+            }
+            if (expr)
+                count = expr->filter(*this, batch, count);
+            out.insert(out.end(), batch, batch + count);
+        }
+    };
+    size_t morsels = (numRows + MorselRows - 1) / MorselRows;
+    if (parallelism <= 1 || morsels <= 1) {
+        scan(0, numRows, result);
+        return result;
+    }
+    // Each morsel keeps its own matches; concatenating them in morsel order
+    // keeps the row ids ascending. With a limit, morsels are scanned one wave
+    // per thread at a time, until the waves so far hold enough matches.
+    size_t wave = limit == NoLimit ? morsels : parallelism;
+    std::vector<std::vector<size_t>> parts(std::min(wave, morsels));
+    for (size_t first = 0; first < morsels && result.size() < limit; first += wave) {
+        size_t count = std::min(wave, morsels - first);
+        ThreadPool::shared().run(count, parallelism, [&](size_t task, size_t) {
+            size_t morsel = first + task;
+            parts[task].clear();
+            scan(morsel * MorselRows, std::min(numRows, (morsel + 1) * MorselRows), parts[task]);
+        });
+        size_t total = result.size();
+        for (size_t task = 0; task < count; ++task)
+            total += parts[task].size();
+        result.reserve(total);
+        for (size_t task = 0; task < count; ++task)
+            result.insert(result.end(), parts[task].begin(), parts[task].end());
+    }
+    return result;
+}
+
+// Columns a predicate compares, each once, in order of appearance.
+static void comparedColumns(const Predicate& predicate, std::vector<std::string>& columns) {
+    if (predicate.kind == Predicate::Kind::Compare || predicate.kind == Predicate::Kind::In) {
+        if (std::find(columns.begin(), columns.end(), predicate.column) == columns.end())
+            columns.push_back(predicate.column);
+    }
+    for (const auto& child : predicate.children)
+        comparedColumns(child, columns);
+}
+
+size_t Table::explainScan(QueryProfile& profile, const std::string& name, const ConditionExpression* expr,
+                          const Predicate& predicate, size_t parallelism, size_t limit) const {
+    // The same choice matchingRows() makes: an index if the condition can
+    // use one, else a scan, filtered in parallel when there is more than one
+    // morsel.
+    std::vector<size_t> candidates;
+    bool indexed = expr && expr->candidateRows(*this, candidates);
+    size_t morsels = (numRows + MorselRows - 1) / MorselRows;
+    bool parallel = expr && !indexed && parallelism > 1 && morsels > 1;
+    size_t id = profile.add(std::string(indexed ? "Index Scan" : (parallel ? "Parallel Seq Scan" : "Seq Scan")) +
+                            " on " + name);
+    QueryProfile::Operator& op = profile.at(id);
+    if (indexed) {
+        std::vector<std::string> compared;
+        comparedColumns(predicate, compared);
+        std::string used;
+        for (const auto& column : compared) {
+            int col = getColumnIndex(column);
+            const Index* index = findIndex(col);
+            if (!index)
+                continue;
+            used += (used.empty() ? "" : ", ") + std::string(index->getType() == IndexType::Hash ? "HASH" : "BTREE") +
+                    " on " + column + (col == primaryKey && index == &primaryIndex ? " (PRIMARY KEY)" : "");
+        }
+        op.details.push_back("Index: " + used);
+        op.details.push_back("Index candidates: " + std::to_string(candidates.size()));
+    }
+    if (expr) {
+        op.details.push_back("Filter: " + Optimizer::describe(predicate));
+        uint64_t mask[BatchSize / 64];
+        if (!indexed)
+            op.details.push_back(std::string("Filter evaluation: ") +
+                                 (numRows > 0 && expr->filterMask(*this, 0, std::min(numRows, BatchSize), mask)
+                                      ? "SIMD bitmask" : "selection vector"));
+    }
+    if (parallel)
+        op.details.push_back("Workers: " + std::to_string(parallelism) + ", morsels: " + std::to_string(morsels));
+    if (limit != NoLimit)
+        op.details.push_back("Stops after: " + std::to_string(limit) + " rows");
+    op.rowsIn = indexed ? candidates.size() : numRows;
+    return id;
+}
+
+// Deleting ends the matching versions; they are removed by garbage collection
+// once no snapshot can see them.
+bool Table::deleteRows(const std::string& condition, Transaction& txn, size_t parallelism,
+                       ConditionExpression* prepared) {
+    ConditionExprPtr parsed;
+    std::vector<size_t> matches = matchingRows(bindCondition(condition, prepared, parsed), txn, parallelism);
+    for (size_t row : matches) {
+        if (!writable(row))
+            return false;
+    }
+    for (size_t row : matches)
+        endVersion(row, txn);
+    return true;
+}
+
+// Updating ends each matching version and appends its successor.
+WriteResult Table::updateRows(const std::vector<std::pair<std::string, std::string>>& updates,
+                              const std::string& condition, Transaction& txn, size_t parallelism,
+                              ConditionExpression* prepared) {
+    std::vector<std::pair<int, std::string>> resolved;
+    for (const auto& update : updates) {
+        // One bad assignment rejects the whole statement.
+        int index = getColumnIndex(update.first);
+        if (index < 0) {
+            std::cerr << "Error: Column " << update.first << " does not exist." << std::endl;
+            return WriteResult::Violation;
+        }
+        if (notNullConstraints[index] && data[index].isNullValue(update.second)) {
+            std::cerr << "Error: NOT NULL constraint violated for column " << columns[index] << "." << std::endl;
+            return WriteResult::Violation;
+        }
+        if (!data[index].accepts(update.second)) {
+            std::cerr << "Error: Invalid value '" << update.second << "' for " << columnTypes[index]
+                      << " column " << columns[index] << "." << std::endl;
+            return WriteResult::Violation;
+        }
+        resolved.emplace_back(index, update.second);
+    }
+    ConditionExprPtr parsed;
+    std::vector<size_t> matches = matchingRows(bindCondition(condition, prepared, parsed), txn, parallelism);
+    for (size_t row : matches) {
+        if (!writable(row))
+            return WriteResult::Conflict;
+    }
+    if (resolved.empty())
+        return WriteResult::Ok;
+    // A new primary key value can go to one row at most.
+    for (const auto& assignment : resolved) {
+        if (assignment.first != primaryKey || matches.empty())
+            continue;
+        if (matches.size() > 1) {
+            std::cerr << "Error: Duplicate primary key value '" << assignment.second << "' for column "
+                      << columns[primaryKey] << "." << std::endl;
+            return WriteResult::Violation;
+        }
+        if (!primaryKeyFree(assignment.second, txn.id, matches[0]))
+            return WriteResult::Violation;
+    }
+    for (size_t row : matches) {
+        endVersion(row, txn);
+        appendVersion(row, resolved, txn);
+    }
+    return WriteResult::Ok;
 }
 
+// TRUNCATE is not versioned: every version goes at once.
 void Table::clearRows() {
-    rows.clear();
+    for (auto& column : data)
+        column.clear();
+    numRows = 0;
+    for (auto& entry : indexes)
+        entry.second.clear();
+    primaryIndex.clear();
+    versionBegin.clear();
+    versionEnd.clear();
+    storedRecords.clear();
+    removedRecords.clear();
+    layoutCurrent = false;
+    endedRows.clear();
+    reclaimedRows.clear();
+    pending.clear();
+    newestBegin = 0;
+    endedVersions = 0;
 }
 
-void Table::sortRows(const std::string& columnName, bool ascending) {
-    auto it = std::find(columns.begin(), columns.end(), columnName);
-    if (it == columns.end()) {
+void Table::sortRows(const std::string& columnName, bool ascending, size_t memoryBudget, size_t parallelism) {
+    int columnIndex = getColumnIndex(columnName);
+    if (columnIndex < 0) {
         std::cerr << "Error: Column " << columnName << " does not exist." << std::endl;
         return;
     }
-    int columnIndex = std::distance(columns.begin(), it);
-
-    std::sort(rows.begin(), rows.end(), [columnIndex, ascending](const std::vector<std::string>& a, const std::vector<std::string>& b) {
-        return ascending ? (a[columnIndex] < b[columnIndex]) : (a[columnIndex] > b[columnIndex]);
+    if (!pending.empty()) {
+        std::cerr << "Error: Cannot reorder a table with uncommitted changes." << std::endl;
+        return;
+    }
+    // Reclaimed versions go first, as a rebuilt index would hold them again.
+    if (!reclaimedRows.empty())
+        compactRows();
+    std::vector<size_t> order(numRows);
+    std::iota(order.begin(), order.end(), size_t(0));
+    RowSorter::sort(order, {{&data[columnIndex], !ascending}}, order.size(), memoryBudget, parallelism);
+    // One permutation, applied to the columns in parallel.
+    ThreadPool::shared().run(data.size(), parallelism, [&](size_t column, size_t) {
+        data[column].permute(order);
     });
+    std::vector<uint64_t> begins(numRows), ends(numRows);
+    for (size_t i = 0; i < numRows; ++i) {
+        begins[i] = versionBegin[order[i]];
+        ends[i] = versionEnd[order[i]];
+    }
+    versionBegin.swap(begins);
+    versionEnd.swap(ends);
+    std::vector<size_t> position(numRows);
+    for (size_t i = 0; i < numRows; ++i)
+        position[order[i]] = i;
+    for (size_t& row : endedRows)
+        row = position[row];
+    storedRecords.assign(numRows, NotStored);
+    removedRecords.clear();
+    layoutCurrent = false;
+    rebuildIndexes();
 }
 
-static bool parseAggregate(const std::string& colExpr, std::string& func, std::string& colName) {
-    size_t pos1 = colExpr.find('(');
-    size_t pos2 = colExpr.find(')');
-    if (pos1 == std::string::npos || pos2 == std::string::npos) return false;
-    func = toUpperCase(trim(colExpr.substr(0, pos1)));
-    colName = trim(colExpr.substr(pos1 + 1, pos2 - pos1 - 1));
-    return true;
+namespace {
+
+// Hashes and compares rows by their GROUP BY columns, reading the column store
+// directly. Unlike join keys, NULLs group together.
+struct GroupKeyHash {
+    const std::vector<const Column*>* keys;
+    size_t operator()(size_t row) const {
+        uint64_t h = 0;
+        for (const Column* column : *keys)
+            h = (h ^ column->hash(row)) * 0x100000001b3ULL;
+        return h;
+    }
+};
+
+struct GroupKeyEqual {
+    const std::vector<const Column*>* keys;
+    bool operator()(size_t a, size_t b) const {
+        for (const Column* column : *keys) {
+            bool nullA = column->isNull(a), nullB = column->isNull(b);
+            if (nullA != nullB || (!nullA && !column->equals(a, *column, b)))
+                return false;
+        }
+        return true;
+    }
+};
+
+// One output column of an aggregate query.
+struct OutputColumn {
+    std::string name;
+    AggregateFunction func;
+    const Column* column; // source column; null for COUNT(*) and unknown names
+    std::string type;     // declared type of the column in the result
+    bool integers;        // the source column is INT or BOOLEAN
+};
+
+// Aggregation state of one slice of the input: its groups in order of first
+// appearance and one accumulator per output column and group.
+struct PartialAggregate {
+    std::unordered_map<size_t, size_t, GroupKeyHash, GroupKeyEqual> groupIds;
+    std::vector<size_t> representatives;
+    std::vector<AggregateState> states;
+
+    explicit PartialAggregate(const std::vector<const Column*>* keys)
+        : groupIds(16, GroupKeyHash{keys}, GroupKeyEqual{keys}) {}
+
+    size_t group(size_t row, size_t width) {
+        auto inserted = groupIds.emplace(row, representatives.size());
+        if (inserted.second) {
+            representatives.push_back(row);
+            states.resize(states.size() + width);
+        }
+        return inserted.first->second;
+    }
+
+    // Folds in the groups of a slice that follows this one.
+    void merge(const PartialAggregate& next, size_t width) {
+        for (size_t g = 0; g < next.representatives.size(); ++g) {
+            size_t into = group(next.representatives[g], width);
+            for (size_t i = 0; i < width; ++i)
+                Aggregation::merge(states[into * width + i], next.states[g * width + i]);
+        }
+    }
+};
+
+// Aggregates input positions [begin, end): rows[n], or row n when 'rows' is
+// null. With no GROUP BY keys every row falls into one group, and numeric
+// aggregates reduce straight over the column storage.
+void aggregateSlice(const std::vector<OutputColumn>& outputs, const std::vector<const Column*>& groupKeys,
+                    const size_t* rows, size_t begin, size_t end, size_t tableRows, PartialAggregate& partial) {
+    size_t width = outputs.size();
+    if (begin == end)
+        return;
+    if (groupKeys.empty()) {
+        AggregateState* states = &partial.states[partial.group(rows ? rows[begin] : begin, width) * width];
+        for (size_t i = 0; i < width; ++i) {
+            const OutputColumn& out = outputs[i];
+            switch (out.func) {
+                case AggregateFunction::CountAll:
+                    states[i].count += end - begin;
+                    break;
+                case AggregateFunction::Count:
+                    if (out.column && !rows && begin == 0 && end == tableRows) {
+                        states[i].count += tableRows - out.column->nullCount();
+                        break;
+                    }
+                    for (size_t n = begin; out.column && n < end; ++n)
+                        Aggregation::accumulate(states[i], out.func, out.column, rows ? rows[n] : n);
+                    break;
+                case AggregateFunction::Min:
+                case AggregateFunction::Max:
+                    if (out.column && out.column->getType() == ColumnType::String) {
+                        for (size_t n = begin; n < end; ++n)
+                            Aggregation::accumulate(states[i], out.func, out.column, rows ? rows[n] : n);
+                        break;
+                    }
+                    // fall through
+                case AggregateFunction::Sum:
+                case AggregateFunction::Avg:
+                    if (out.column)
+                        Aggregation::summarize(*out.column, rows, begin, end, states[i]);
+                    break;
+                case AggregateFunction::Median:
+                case AggregateFunction::Mode:
+                    for (size_t n = begin; out.column && n < end; ++n)
+                        Aggregation::accumulate(states[i], out.func, out.column, rows ? rows[n] : n);
+                    break;
+                case AggregateFunction::None:
+                    break;
+            }
+        }
+        return;
+    }
+    // Grouped: look up the groups of a batch of rows, then fold the batch
+    // into each aggregate column in turn.
+    size_t batchRows[BatchSize], groups[BatchSize];
+    for (size_t first = begin; first < end; first += BatchSize) {
+        size_t count = std::min(BatchSize, end - first);
+        for (size_t j = 0; j < count; ++j) {
+            batchRows[j] = rows ? rows[first + j] : first + j;
+            groups[j] = partial.group(batchRows[j], width);
+        }
+        for (size_t i = 0; i < width; ++i) {
+            const OutputColumn& out = outputs[i];
+            if (out.func != AggregateFunction::None && (out.column || out.func == AggregateFunction::CountAll))
+                Aggregation::accumulateBatch(partial.states.data() + i, width, groups, out.func, out.column,
+                                             batchRows, count);
+        }
+    }
+}
+
+// Splits an ORDER BY term such as "x DESC" into its column and direction.
+std::string orderTerm(const std::string& token, bool& descending) {
+    std::string upper = toUpperCase(token);
+    descending = false;
+    size_t pos = upper.find(" DESC");
+    if (pos != std::string::npos) {
+        descending = true;
+        return trim(token.substr(0, pos));
+    }
+    if ((pos = upper.find(" ASC")) != std::string::npos)
+        return trim(token.substr(0, pos));
+    return token;
+}
+
+} // namespace
+
+void Table::aggregateRows(const std::vector<std::string>& displayColumns,
+                          const std::vector<size_t>* filteredRows,
+                          const std::vector<std::string>& groupByColumns,
+                          const std::string& havingCondition,
+                          const std::vector<std::string>& orderByColumns,
+                          size_t limit, size_t offset,
+                          size_t parallelism, size_t sortMemory,
+                          std::ostream& output,
+                          QueryProfile* profile,
+                          size_t input) const {
+    std::vector<const Column*> groupKeys;
+    for (const auto& grpCol : groupByColumns) {
+        int idx = getColumnIndex(grpCol);
+        if (idx >= 0)
+            groupKeys.push_back(&data[idx]);
+    }
+
+    // Output columns are the select list, then anything HAVING or ORDER BY
+    // needs that the select list lacks (hidden from the printed result).
+    std::vector<OutputColumn> outputs;
+    auto addOutput = [&](const std::string& expr) {
+        std::string argument;
+        AggregateFunction func = Aggregation::parseFunction(expr, argument);
+        OutputColumn out{func == AggregateFunction::None ? expr : Aggregation::canonicalName(expr),
+                         func, nullptr, "VARCHAR", false};
+        int idx = getColumnIndex(func == AggregateFunction::None ? expr : argument);
+        if (idx >= 0) {
+            out.column = &data[idx];
+            out.type = columnTypes[idx];
+            out.integers = data[idx].getType() == ColumnType::Int || data[idx].getType() == ColumnType::Bool;
+        }
+        bool textExtreme = (func == AggregateFunction::Min || func == AggregateFunction::Max) &&
+                           out.column && out.column->getType() == ColumnType::String;
+        if (func == AggregateFunction::CountAll || func == AggregateFunction::Count ||
+            (func == AggregateFunction::Sum && out.integers))
+            out.type = "INT";
+        else if (func != AggregateFunction::None && func != AggregateFunction::Mode && !textExtreme)
+            out.type = "FLOAT";
+        outputs.push_back(out);
+    };
+    for (const auto& col : displayColumns)
+        addOutput(col);
+    size_t visibleColumns = outputs.size();
+    std::vector<std::string> needed;
+    if (!havingCondition.empty()) {
+        needed = Aggregation::findAggregates(havingCondition);
+        needed.insert(needed.end(), groupByColumns.begin(), groupByColumns.end());
+    }
+    std::vector<std::pair<std::string, bool>> order;
+    for (const auto& token : orderByColumns) {
+        bool descending;
+        std::string name = Aggregation::canonicalName(orderTerm(token, descending));
+        order.emplace_back(name, descending);
+        needed.push_back(name);
+    }
+    for (const auto& name : needed) {
+        bool present = false;
+        for (const auto& out : outputs)
+            present = present || out.name == name;
+        if (!present)
+            addOutput(name);
+    }
+
+    // Hash aggregation: each group keeps its first row (for group columns) and
+    // one small accumulator per aggregate, never the input rows themselves.
+    // A null 'filteredRows' means every row of the table. Morsels of the input
+    // are aggregated separately and merged in order, so groups come out in
+    // order of first appearance either way.
+    size_t inputRows = filteredRows ? filteredRows->size() : numRows;
+    const size_t* rows = filteredRows ? filteredRows->data() : nullptr;
+    size_t aggregate = 0;
+    if (profile) {
+        aggregate = profile->add(groupKeys.empty() ? "Aggregate" : "Hash Aggregate", {input});
+        QueryProfile::Operator& op = profile->at(aggregate);
+        if (!groupByColumns.empty())
+            op.details.push_back("Group by: " + join(groupByColumns, ", "));
+        if (!havingCondition.empty())
+            op.details.push_back("Having: " + havingCondition);
+        if (!orderByColumns.empty())
+            op.details.push_back("Order by: " + join(orderByColumns, ", "));
+        if (parallelism > 1 && inputRows > MorselRows)
+            op.details.push_back("Workers: " + std::to_string(parallelism) + ", morsels: " +
+                                 std::to_string((inputRows + MorselRows - 1) / MorselRows));
+        if (limit != NoLimit || offset > 0)
+            op.details.push_back("Limit: " + (limit == NoLimit ? std::string("none") : std::to_string(limit)) +
+                                 ", offset: " + std::to_string(offset));
+        if (!profile->analyzing())
+            return;
+    }
+    QueryProfile::Stopwatch watch;
+    auto slice = [&](size_t begin, size_t end) {
+        PartialAggregate partial(&groupKeys);
+        aggregateSlice(outputs, groupKeys, rows, begin, end, numRows, partial);
+        return partial;
+    };
+    size_t morsels = (inputRows + MorselRows - 1) / MorselRows;
+    PartialAggregate total(&groupKeys);
+    if (parallelism <= 1 || morsels <= 1) {
+        total = slice(0, inputRows);
+    } else {
+        std::vector<PartialAggregate> parts(morsels, PartialAggregate(&groupKeys));
+        ThreadPool::shared().run(morsels, parallelism, [&](size_t morsel, size_t) {
+            parts[morsel] = slice(morsel * MorselRows, std::min(inputRows, (morsel + 1) * MorselRows));
+        });
+        for (const auto& part : parts)
+            total.merge(part, outputs.size());
+    }
+    // Without GROUP BY the whole input is one group, even when it is empty.
+    if (groupKeys.empty() && total.representatives.empty()) {
+        total.representatives.push_back(0);
+        total.states.resize(outputs.size());
+    }
+    const std::vector<size_t>& representatives = total.representatives;
+    const std::vector<AggregateState>& states = total.states;
+
+    // An integer SUM that left the int64 range in some group is a FLOAT.
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        for (size_t group = 0; outputs[i].func == AggregateFunction::Sum && group < representatives.size(); ++group) {
+            if (!states[group * outputs.size() + i].exact)
+                outputs[i].type = "FLOAT";
+        }
+    }
+    Table result;
+    for (const auto& out : outputs)
+        result.addColumn(out.name, out.type);
+    for (size_t group = 0; group < representatives.size(); ++group) {
+        std::vector<std::string> values;
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            const OutputColumn& out = outputs[i];
+            if (out.func != AggregateFunction::None)
+                values.push_back(Aggregation::finalize(states[group * outputs.size() + i], out.func, out.integers));
+            else if (out.column && inputRows > 0)
+                values.push_back(out.column->get(representatives[group]));
+            else
+                values.push_back("");
+        }
+        result.addRow(values);
+    }
+
+    // HAVING filters the aggregated output, not the input rows.
+    ConditionExprPtr having;
+    std::vector<size_t> kept = result.matchingRows(result.bindCondition(havingCondition, nullptr, having),
+                                                   Transaction::latestCommitted());
+    std::vector<SortKey> sortKeys;
+    for (const auto& term : order) {
+        int idx = result.getColumnIndex(term.first);
+        if (idx >= 0)
+            sortKeys.push_back({&result.data[idx], term.second});
+    }
+    if (!sortKeys.empty()) {
+        size_t wanted = limit > NoLimit - offset ? NoLimit : offset + limit;
+        RowSorter::sort(kept, sortKeys, wanted, sortMemory, parallelism);
+    }
+    kept.erase(kept.begin(), kept.begin() + std::min(offset, kept.size()));
+    if (kept.size() > limit)
+        kept.resize(limit);
+    if (profile)
+        profile->record(aggregate, watch, inputRows, kept.size(),
+                        states.size() * sizeof(AggregateState) + representatives.size() * sizeof(size_t));
+    if (!groupKeys.empty()) {
+        for (const auto& col : displayColumns)
+            output << col << "\t";
+        output << std::endl;
+    }
+    for (size_t row : kept) {
+        for (size_t i = 0; i < visibleColumns; ++i)
+            output << result.getValue(row, i) << "\t";
+        output << std::endl;
+    }
 }
 
 void Table::selectRows(const std::vector<std::string>& selectColumns,
                        const std::string& condition,
+                       const Transaction& txn,
                        const std::vector<std::string>& orderByColumns,
                        const std::vector<std::string>& groupByColumns,
-                       const std::string& havingCondition) {
+                       const std::string& havingCondition,
+                       size_t limit,
+                       size_t offset,
+                       size_t parallelism,
+                       size_t sortMemory,
+                       ConditionExpression* prepared,
+                       std::ostream& output,
+                       QueryProfile* profile) const {
     std::vector<std::string> displayColumns;
     if (selectColumns.size() == 1 && selectColumns[0] == "*")
         displayColumns = columns;
     else
         displayColumns = selectColumns;
 
-    std::vector<std::vector<std::string>> filteredRows;
-    if (!condition.empty()) {
-        ConditionParser cp(condition);
-        auto expr = cp.parse();
-        for (const auto& row : rows) {
-            if (expr->evaluate(row, columns))
-                filteredRows.push_back(row);
-        }
-    } else {
-        filteredRows = rows;
-    }
-
-    // Check for aggregate functions (AVG, MIN, MAX, SUM, COUNT)
-    bool hasAggregate = false;
-    std::vector<std::string> aggregateResults;
+    // Aggregate queries (COUNT, SUM, AVG, MIN, MAX, MEDIAN, MODE) and GROUP BY.
+    bool hasAggregate = !groupByColumns.empty();
     for (const auto& colExpr : displayColumns) {
-        std::string func, colName;
-        if (parseAggregate(colExpr, func, colName)) {
+        std::string argument;
+        if (Aggregation::parseFunction(colExpr, argument) != AggregateFunction::None)
             hasAggregate = true;
-            auto it = std::find(columns.begin(), columns.end(), colName);
-            if (it == columns.end()) {
-                aggregateResults.push_back("");
-                continue;
-            }
-            int idx = std::distance(columns.begin(), it);
-            std::vector<std::string> colValues;
-            for (const auto& row : filteredRows) {
-                if (idx < row.size())
-                    colValues.push_back(row[idx]);
-            }
-            if (func == "COUNT" && colExpr.find("*") != std::string::npos) {
-                aggregateResults.push_back(std::to_string(filteredRows.size()));
-            } else if (func == "AVG") {
-                double avg = Aggregation::computeMean(colValues);
-                aggregateResults.push_back(std::to_string(avg));
-            } else if (func == "MIN") {
-                double min = Aggregation::computeMin(colValues);
-                aggregateResults.push_back(std::to_string(min));
-            } else if (func == "MAX") {
-                double max = Aggregation::computeMax(colValues);
-                aggregateResults.push_back(std::to_string(max));
-            } else if (func == "SUM") {
-                double sum = Aggregation::computeSum(colValues);
-                aggregateResults.push_back(std::to_string(sum));
-            } else {
-                aggregateResults.push_back(filteredRows.empty() ? "" : filteredRows[0][idx]);
-            }
-        } else {
-            aggregateResults.push_back("");
-        }
     }
+    ConditionExprPtr parsed;
+    const ConditionExpression* where = bindCondition(condition, prepared, parsed);
+    // EXPLAIN adds each step below to 'profile'; plain EXPLAIN runs none.
+    bool run = !profile || profile->analyzing();
+    Predicate predicate;
+    if (profile && where)
+        predicate = Optimizer::simplify(ConditionParser(condition).parsePredicate());
+    QueryProfile::Stopwatch watch;
+    size_t step = 0;
     if (hasAggregate) {
-        for (const auto& res : aggregateResults)
-            std::cout << res << "\t";
-        std::cout << std::endl;
+        // Without WHERE, and with no versions hidden from this snapshot,
+        // aggregates read every row and need no row-id list.
+        bool allRows = !where && allVisible(txn);
+        if (profile)
+            step = explainScan(*profile, profile->tableName, where, predicate, parallelism);
+        std::vector<size_t> filteredRows;
+        if (!allRows && run)
+            filteredRows = matchingRows(where, txn, parallelism);
+        if (profile)
+            profile->record(step, watch, profile->at(step).rowsIn, allRows ? numRows : filteredRows.size(),
+                            filteredRows.capacity() * sizeof(size_t));
+        aggregateRows(displayColumns, allRows ? nullptr : &filteredRows, groupByColumns, havingCondition,
+                      orderByColumns, limit, offset, parallelism, sortMemory, output, profile, step);
         return;
     }
 
-    if (!groupByColumns.empty()) {
-        std::unordered_map<std::string, std::vector<std::vector<std::string>>> groups;
-        for (const auto& row : filteredRows) {
-            std::string key;
-            for (const auto& grpCol : groupByColumns) {
-                auto it = std::find(columns.begin(), columns.end(), grpCol);
-                if (it != columns.end()) {
-                    int idx = std::distance(columns.begin(), it);
-                    key += row[idx] + "|";
-                }
+    // Rows travel through filter and sort as ids into the column store; only
+    // the projected columns are read, when the result is written. Without
+    // WHERE, ORDER BY or hidden versions no id list is built at all.
+    // Without ORDER BY the scan stops once it has the first offset + limit
+    // matches.
+    size_t wanted = limit > NoLimit - offset ? NoLimit : offset + limit;
+    bool allRows = !where && allVisible(txn);
+    size_t scanLimit = orderByColumns.empty() ? wanted : NoLimit;
+    // Plain EXPLAIN does not filter; the rows the scan reads bound its output.
+    size_t scannedRows = numRows;
+    if (profile) {
+        step = explainScan(*profile, profile->tableName, where, predicate, parallelism, scanLimit);
+        scannedRows = profile->at(step).rowsIn;
+    }
+    std::vector<size_t> filteredRows;
+    if (!allRows && run)
+        filteredRows = matchingRows(where, txn, parallelism, scanLimit);
+    if (profile)
+        profile->record(step, watch, profile->at(step).rowsIn, allRows ? numRows : filteredRows.size(),
+                        filteredRows.capacity() * sizeof(size_t));
+
+    // ORDER BY terms are resolved to columns once, not per comparison.
+    std::vector<SortKey> sortKeys;
+    int firstSortColumn = -1;
+    for (const auto& token : orderByColumns) {
+        bool desc;
+        int idx = getColumnIndex(orderTerm(token, desc));
+        if (idx < 0)
+            continue;
+        if (sortKeys.empty())
+            firstSortColumn = idx;
+        sortKeys.push_back({&data[idx], desc});
+    }
+
+    // A single ORDER BY column with a BTREE index is read in index order
+    // instead of being sorted.
+    bool orderedByIndex = false;
+    if (orderByColumns.size() == 1 && sortKeys.size() == 1) {
+        const Index* index = findIndex(firstSortColumn);
+        if (index && index->getType() == IndexType::BTree) {
+            orderedByIndex = true;
+            size_t rowsIn = allRows ? numRows : filteredRows.size();
+            if (profile) {
+                step = profile->add("Index Order", {step});
+                profile->at(step).details.push_back("Index: BTREE on " + columns[firstSortColumn] +
+                                                    (sortKeys[0].descending ? ", descending" : ""));
+                watch = QueryProfile::Stopwatch();
             }
-            groups[key].push_back(row);
-        }
-        for (const auto& col : displayColumns)
-            std::cout << col << "\t";
-        std::cout << std::endl;
-        for (const auto& kv : groups) {
-            const auto& groupRows = kv.second;
-            std::vector<std::string> resultRow;
-            for (const auto& col : displayColumns) {
-                if (toUpperCase(col) == "COUNT(*)") {
-                    resultRow.push_back(std::to_string(groupRows.size()));
-                } else {
-                    auto it = std::find(columns.begin(), columns.end(), col);
-                    if (it != columns.end()) {
-                        int idx = std::distance(columns.begin(), it);
-                        resultRow.push_back(groupRows[0][idx]);
-                    } else {
-                        resultRow.push_back("");
-                    }
+            if (run) {
+                std::vector<size_t> ordered;
+                index->orderedRows(!sortKeys[0].descending, ordered);
+                if (!allRows) {
+                    std::vector<uint8_t> selected(numRows, 0);
+                    for (size_t row : filteredRows)
+                        selected[row] = 1;
+                    ordered.erase(std::remove_if(ordered.begin(), ordered.end(),
+                                                 [&](size_t row) { return !selected[row]; }),
+                                  ordered.end());
                 }
+                filteredRows.swap(ordered);
             }
-            for (const auto& cell : resultRow)
-                std::cout << cell << "\t";
-            std::cout << std::endl;
+            allRows = false;
+            if (profile)
+                profile->record(step, watch, rowsIn, filteredRows.size(), filteredRows.capacity() * sizeof(size_t));
         }
-        return;
     }
 
-    if (!orderByColumns.empty()) {
-        std::sort(filteredRows.begin(), filteredRows.end(), [&](const auto& a, const auto& b) {
-            for (const auto& token : orderByColumns) {
-                std::string colName = token;
-                bool desc = false;
-                size_t pos = toUpperCase(token).find(" DESC");
-                if (pos != std::string::npos) {
-                    desc = true;
-                    colName = trim(token.substr(0, pos));
-                } else {
-                    pos = toUpperCase(token).find(" ASC");
-                    if (pos != std::string::npos) {
-                        colName = trim(token.substr(0, pos));
-                    }
-                }
-                auto it = std::find(columns.begin(), columns.end(), colName);
-                if (it != columns.end()) {
-                    int idx = std::distance(columns.begin(), it);
-                    if (a[idx] == b[idx])
-                        continue;
-                    return desc ? (a[idx] > b[idx]) : (a[idx] < b[idx]);
-                }
+    if (!orderByColumns.empty() && !orderedByIndex) {
+        size_t rowsIn = allRows ? numRows : filteredRows.size();
+        if (profile) {
+            step = profile->add("Sort", {step});
+            QueryProfile::Operator& op = profile->at(step);
+            op.details.push_back("Sort key: " + join(orderByColumns, ", "));
+            if (wanted != NoLimit)
+                op.details.push_back("Keeps: first " + std::to_string(wanted) + " rows");
+            if (!run) {
+                size_t memory;
+                std::string strategy = RowSorter::plannedStrategy(allRows ? numRows : scannedRows, sortKeys,
+                                                                  wanted, sortMemory, parallelism, memory);
+                op.details.push_back("Strategy: " + strategy + ", estimated " + QueryProfile::formatBytes(memory) +
+                                     " of sort keys (budget " + QueryProfile::formatBytes(sortMemory) + ")");
             }
-            return false;
-        });
+            watch = QueryProfile::Stopwatch();
+        }
+        RowSorter::Stats sortStats;
+        if (run) {
+            if (allRows) {
+                filteredRows.resize(numRows);
+                std::iota(filteredRows.begin(), filteredRows.end(), size_t(0));
+            }
+            // Sorted on normalized keys; with LIMIT only the first offset +
+            // limit rows are put in order.
+            RowSorter::sort(filteredRows, sortKeys, wanted, sortMemory, parallelism, &sortStats);
+        }
+        allRows = false;
+        if (profile && run) {
+            profile->record(step, watch, rowsIn, filteredRows.size(), sortStats.memoryPeak, sortStats.spillBytes);
+            profile->at(step).details.push_back(
+                "Strategy: " + (sortStats.strategy.empty() ? std::string("none") : sortStats.strategy) +
+                (sortStats.runs ? " (" + std::to_string(sortStats.runs) + " runs)" : ""));
+        }
     }
+    size_t resultRows = std::min(wanted, allRows ? numRows : filteredRows.size());
+    size_t firstRow = std::min(offset, resultRows);
 
+    std::vector<int> projection;
+    for (const auto& col : displayColumns) {
+        int idx = getColumnIndex(col);
+        if (idx >= 0)
+            projection.push_back(idx);
+    }
+    if (profile) {
+        if (limit != NoLimit || offset > 0) {
+            step = profile->add("Limit", {step});
+            profile->at(step).details.push_back(
+                "Limit: " + (limit == NoLimit ? std::string("none") : std::to_string(limit)) +
+                ", offset: " + std::to_string(offset));
+            profile->record(step, QueryProfile::Stopwatch(), allRows ? numRows : filteredRows.size(),
+                            resultRows - firstRow);
+        }
+        step = profile->add("Project", {step});
+        profile->at(step).details.push_back("Columns: " + join(displayColumns, ", "));
+        if (!run)
+            return;
+        watch = QueryProfile::Stopwatch();
+    }
     for (const auto& col : displayColumns)
-        std::cout << col << "\t";
-    std::cout << std::endl;
-    for (const auto& row : filteredRows) {
-        for (const auto& col : displayColumns) {
-            auto it = std::find(columns.begin(), columns.end(), col);
-            if (it != columns.end()) {
-                int idx = std::distance(columns.begin(), it);
-                std::cout << row[idx] << "\t";
+        output << col << "\t";
+    output << std::endl;
+    // Morsels of the result are formatted in parallel, a bounded batch at a
+    // time, and written in order.
+    size_t morsels = (resultRows - firstRow + MorselRows - 1) / MorselRows;
+    size_t batch = std::max<size_t>(1, parallelism) * 4;
+    std::vector<std::string> text(std::min(morsels, batch));
+    size_t textBytes = 0;
+    for (size_t first = 0; first < morsels; first += batch) {
+        size_t count = std::min(batch, morsels - first);
+        ThreadPool::shared().run(count, parallelism, [&](size_t task, size_t) {
+            std::string& out = text[task];
+            out.clear();
+            size_t begin = firstRow + (first + task) * MorselRows;
+            size_t end = std::min(resultRows, begin + MorselRows);
+            for (size_t n = begin; n < end; ++n) {
+                size_t row = allRows ? n : filteredRows[n];
+                for (int idx : projection) {
+                    data[idx].appendTo(row, out);
+                    out += '\t';
+                }
+                out += '\n';
             }
+        });
+        size_t bytes = 0;
+        for (size_t task = 0; task < count; ++task) {
+            output << text[task];
+            bytes += text[task].capacity();
         }
-        std::cout << std::endl;
+        textBytes = std::max(textBytes, bytes);
     }
+    output << std::flush;
+    if (profile)
+        profile->record(step, watch, resultRows - firstRow, resultRows - firstRow, textBytes);
 }
\ No newline at end of file
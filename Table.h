@@ -3,7 +3,20 @@
 
 #include <string>
 #include <vector>
+#include <iostream>
 #include <functional> // For std::function
+#include <unordered_map>
+#include "Column.h"
+#include "Index.h"
+#include "Transaction.h"
+#include "Sort.h"
+#include "ConditionParser.h"
+#include "QueryProfile.h"
+
+// Outcome of a row change: applied, refused because a concurrent transaction
+// changed the row (a write conflict), or refused by a constraint, with the
+// error already printed. A refused change leaves the table as it was.
+enum class WriteResult { Ok, Conflict, Violation };
 
 class Table {
 public:
@@ -11,31 +24,209 @@ public:
     void addColumn(const std::string& columnName, const std::string& type, bool isNotNull = false);
     bool dropColumn(const std::string& columnName);
 
-    // DML: Row operations
-    void addRow(const std::vector<std::string>& values);
+    // DML: Row operations. Rows are versioned (see Transaction.h): writes made
+    // under a transaction create or end versions that stay private to it until
+    // commitVersions(). Delete returns false, changing nothing, when a target
+    // row was already changed by a concurrent transaction.
+    bool addRow(const std::vector<std::string>& values);
+    bool addRow(const std::vector<std::string>& values, Transaction& txn);
+    // Scans run morsel by morsel (MorselRows rows each) on up to
+    // 'parallelism' threads of the shared pool: filtering, projection and
+    // partial aggregation per morsel, merged in morsel order so results are
+    // the same as a serial scan. Only rows [offset, offset + limit) of the
+    // result are written; an unordered scan stops once it has found them.
+    // ORDER BY spills to disk beyond 'sortMemory' bytes. The result is
+    // written to 'output'.
+    //
+    // Statements take their WHERE condition as text, or already parsed (by a
+    // prepared statement) as 'prepared', which is then bound to this table
+    // and used instead.
+    //
+    // With a 'profile' (EXPLAIN) each step adds an operator to it. Unless the
+    // profile is analyzing, nothing runs and nothing is written.
     void selectRows(const std::vector<std::string>& selectColumns,
                     const std::string& condition,
+                    const Transaction& txn,
                     const std::vector<std::string>& orderByColumns = {},
                     const std::vector<std::string>& groupByColumns = {},
-                    const std::string& havingCondition = "");
+                    const std::string& havingCondition = "",
+                    size_t limit = NoLimit,
+                    size_t offset = 0,
+                    size_t parallelism = 1,
+                    size_t sortMemory = RowSorter::DefaultMemoryBudget,
+                    ConditionExpression* prepared = nullptr,
+                    std::ostream& output = std::cout,
+                    QueryProfile* profile = nullptr) const;
     void printTable();
-    void deleteRows(const std::string& condition);
-    void updateRows(const std::vector<std::pair<std::string, std::string>>& updates,
-                    const std::string& condition);
+    bool deleteRows(const std::string& condition, Transaction& txn, size_t parallelism = 1,
+                    ConditionExpression* prepared = nullptr);
+    WriteResult updateRows(const std::vector<std::pair<std::string, std::string>>& updates,
+                           const std::string& condition, Transaction& txn, size_t parallelism = 1,
+                           ConditionExpression* prepared = nullptr);
+    // Replaces a visible row with a new version holding 'values'.
+    WriteResult replaceRow(size_t row, const std::vector<std::string>& values, Transaction& txn);
+    WriteResult updateRow(size_t row, const std::vector<std::pair<int, std::string>>& assignments,
+                          Transaction& txn);
+
+    // Redo logging. A statement's effect is the versions its transaction
+    // ended and created between changeMark() and changesSince(), as row
+    // images; a version created and ended again in between is left out.
+    // applyChanges() redoes such an effect: it ends one visible version equal
+    // to each 'ended' row, then adds the 'added' rows. False if an ended row
+    // is not there.
+    struct ChangeMark {
+        size_t inserted = 0;
+        size_t deleted = 0;
+    };
+    ChangeMark changeMark(const Transaction& txn) const;
+    void changesSince(const Transaction& txn, ChangeMark mark,
+                      std::vector<std::vector<std::string>>& ended,
+                      std::vector<std::vector<std::string>>& added) const;
+    bool applyChanges(const std::vector<std::vector<std::string>>& ended,
+                      const std::vector<std::vector<std::string>>& added, Transaction& txn);
+    // Takes back the versions 'txn' ended and created since 'mark', for a
+    // statement that failed part way; the transaction stays open.
+    void undoSince(Transaction& txn, ChangeMark mark);
     void clearRows(); // New: remove all rows
 
     // New: Sort rows based on a column
-    void sortRows(const std::string& columnName, bool ascending);
+    void sortRows(const std::string& columnName, bool ascending,
+                  size_t memoryBudget = RowSorter::DefaultMemoryBudget, size_t parallelism = 1);
+
+    // Version bookkeeping driven by the transaction manager.
+    void commitVersions(uint64_t txnId, uint64_t commitTs);
+    void abortVersions(uint64_t txnId);
+    // Reclaims the versions no transaction can see any more (their end stamp
+    // is at or below 'horizon'): they leave the indexes at once, and the
+    // column store is compacted once they make up 1/CompactionFraction of
+    // it. Only versions ended since the last call are examined. Returns the
+    // number reclaimed.
+    size_t collectGarbage(uint64_t horizon);
+    // True while some transaction holds versions it has not yet committed.
+    bool hasUncommittedChanges() const { return !pending.empty(); }
+
+    // Persistence (see Storage.h): the record of the table's file each row
+    // was read from or last saved as, or NotStored for rows added since.
+    // Stored records whose rows garbage collection removed are kept until
+    // the next save takes them. The layout stops being current when the
+    // rows no longer map onto the file's records one to one (a schema
+    // change, TRUNCATE, a reorder); the next save then rewrites the file.
+    uint64_t storedRecord(size_t row) const { return storedRecords[row]; }
+    void setStoredRecord(size_t row, uint64_t record) { storedRecords[row] = record; }
+    std::vector<uint64_t> takeRemovedRecords() { return std::move(removedRecords); }
+    bool storedLayoutCurrent() const { return layoutCurrent; }
+    void setStoredLayoutCurrent(bool current) { layoutCurrent = current; }
+    static constexpr uint64_t NotStored = static_cast<uint64_t>(-1);
 
     const std::vector<std::string>& getColumns() const { return columns; }
-    const std::vector<std::vector<std::string>>& getRows() const { return rows; }
-    std::vector<std::vector<std::string>>& getRowsNonConst() { return rows; }
+    const std::vector<std::string>& getColumnTypes() const { return columnTypes; }
+    bool isNotNull(size_t col) const { return notNullConstraints[col]; }
+    // Position of a column in the schema, or -1 if it does not exist.
+    int getColumnIndex(const std::string& columnName) const;
+
+    // Columnar row access. Row ids address versions; check isVisible().
+    size_t rowCount() const { return numRows; }
+    bool isVisible(size_t row, const Transaction& txn) const {
+        return txn.canSee(versionBegin[row], versionEnd[row]);
+    }
+    const Column& getColumnData(size_t col) const { return data[col]; }
+    std::string getValue(size_t row, size_t col) const { return data[col].get(row); }
+    bool setValue(size_t row, size_t col, const std::string& value);
+
+    // Indexes: at most one per column, maintained by every row mutation.
+    // They cover every version; lookups are filtered by visibility.
+    bool createIndex(const std::string& columnName, IndexType type = IndexType::Hash);
+    void dropIndex(const std::string& columnName);
+    const Index* findIndex(int col) const;
+
+    // Visible rows satisfying 'expr', in row order, found through an index
+    // where one applies. 'expr' is bound to this table; null matches every
+    // row. Stops scanning once at least 'limit' matches are found.
+    std::vector<size_t> matchingRows(const ConditionExpression* expr, const Transaction& txn,
+                                     size_t parallelism = 1, size_t limit = NoLimit) const;
+    // EXPLAIN: adds the scan of this table ('name') that matchingRows() makes
+    // for 'expr', whose logical form is 'predicate', to 'profile'. Returns its
+    // id, with the rows the scan reads as rowsIn.
+    size_t explainScan(QueryProfile& profile, const std::string& name, const ConditionExpression* expr,
+                       const Predicate& predicate, size_t parallelism, size_t limit = NoLimit) const;
+
+    // PRIMARY KEY: a NOT NULL column whose live versions hold distinct
+    // values, kept in a hash index of its own. Fails (changing nothing) if
+    // the current rows already break the constraint.
+    bool setPrimaryKey(const std::string& columnName);
+    int primaryKeyColumn() const { return primaryKey; }
+    // The version with primary key 'value' that 'txn' sees, or NoRow.
+    size_t findByPrimaryKey(const std::string& value, const Transaction& txn) const;
+
+    static constexpr size_t MorselRows = 16384;
+    static constexpr size_t CompactionFraction = 4;
+    static constexpr size_t NoLimit = static_cast<size_t>(-1);
+    static constexpr size_t NoRow = static_cast<size_t>(-1);
 
 private:
+    // Rows a transaction created and ended, per running writer.
+    struct PendingVersions {
+        std::vector<size_t> inserted;
+        std::vector<size_t> deleted;
+    };
+
     std::vector<std::string> columns;
     std::vector<std::string> columnTypes;
     std::vector<bool> notNullConstraints;
-    std::vector<std::vector<std::string>> rows;
+    std::vector<Column> data;
+    size_t numRows = 0;
+    std::unordered_map<std::string, Index> indexes; // column name -> index
+    int primaryKey = -1;
+    Index primaryIndex;
+    std::vector<uint64_t> versionBegin;
+    std::vector<uint64_t> versionEnd;
+    std::unordered_map<uint64_t, PendingVersions> pending; // txn id -> its versions
+    uint64_t newestBegin = 0;  // largest committed begin stamp
+    size_t endedVersions = 0;  // versions whose end stamp is set
+    std::vector<size_t> endedRows;     // ended for good (committed or aborted), not yet reclaimed
+    std::vector<size_t> reclaimedRows; // out of the indexes, awaiting compaction
+    std::vector<uint64_t> storedRecords;  // per row, see storedRecord()
+    std::vector<uint64_t> removedRecords;
+    bool layoutCurrent = false;
+
+    bool validateRow(const std::vector<std::string>& values) const;
+    void appendRow(const std::vector<std::string>& values, uint64_t begin);
+    void indexRow(size_t row);
+    // False (with an error) if a live version other than 'ignoreRow' already
+    // holds primary key 'value'. Versions ended by 'writer' do not count;
+    // ones ended by another, still running, writer do.
+    bool primaryKeyFree(const std::string& value, uint64_t writer, size_t ignoreRow = NoRow) const;
+    void appendVersion(size_t row, const std::vector<std::pair<int, std::string>>& assignments, Transaction& txn);
+    std::vector<std::string> rowValues(size_t row) const;
+    void endVersion(size_t row, Transaction& txn);
+    bool writable(size_t row) const { return versionEnd[row] == InfiniteTs; }
+    // True when every version is visible to 'txn' (nothing deleted or pending).
+    bool allVisible(const Transaction& txn) const {
+        return endedVersions == 0 && pending.empty() && newestBegin <= txn.readTs;
+    }
+    void rebuildIndexes();
+    // Builds 'index' over column 'col', leaving out reclaimed versions.
+    void buildIndex(Index& index, size_t col) const;
+    void unindexRow(size_t row);
+    // Removes the reclaimed versions from the column store, renumbering the
+    // remaining rows everywhere row ids are held.
+    void compactRows();
+    // The statement's condition bound to this table: 'prepared' if set, or
+    // else 'condition' compiled into 'parsed'. Null without a condition.
+    const ConditionExpression* bindCondition(const std::string& condition, ConditionExpression* prepared,
+                                             ConditionExprPtr& parsed) const;
+    // ORDER BY applies to the aggregated rows, after HAVING.
+    void aggregateRows(const std::vector<std::string>& displayColumns,
+                       const std::vector<size_t>* filteredRows,
+                       const std::vector<std::string>& groupByColumns,
+                       const std::string& havingCondition,
+                       const std::vector<std::string>& orderByColumns,
+                       size_t limit, size_t offset,
+                       size_t parallelism, size_t sortMemory,
+                       std::ostream& output,
+                       QueryProfile* profile = nullptr,
+                       size_t input = 0) const;
+
 };
 
-#endif // TABLE_H
\ No newline at end of file
+#endif // TABLE_H
@@ -0,0 +1,119 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+
+struct ThreadPool::Job {
+    // A slot's remaining tasks are [next, end): the owner takes from the
+    // front, thieves from the back.
+    struct Share {
+        std::mutex mutex;
+        size_t next = 0;
+        size_t end = 0;
+    };
+
+    const std::function<void(size_t, size_t)>* fn = nullptr;
+    size_t parallelism = 0;
+    std::unique_ptr<Share[]> shares;
+    std::atomic<size_t> nextSlot{1}; // slot 0 is the caller
+
+    std::mutex doneMutex;
+    std::condition_variable doneWake;
+    size_t tasks = 0;
+    size_t done = 0;
+
+    bool take(size_t slot, size_t& task) {
+        Share& own = shares[slot];
+        {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (own.next < own.end) {
+                task = own.next++;
+                return true;
+            }
+        }
+        for (size_t i = 1; i < parallelism; ++i) {
+            Share& victim = shares[(slot + i) % parallelism];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.next < victim.end) {
+                task = --victim.end;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+    for (size_t i = 0; i < threads; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || !queue.empty(); });
+        if (stopping)
+            return;
+        std::shared_ptr<Job> job = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        // A helper that arrives after the others drained the job finds no
+        // tasks and leaves without touching fn.
+        size_t slot = job->nextSlot++;
+        if (slot < job->parallelism)
+            participate(*job, slot);
+        job.reset();
+        lock.lock();
+    }
+}
+
+void ThreadPool::participate(Job& job, size_t slot) {
+    size_t task;
+    while (job.take(slot, task)) {
+        (*job.fn)(task, slot);
+        std::lock_guard<std::mutex> lock(job.doneMutex);
+        if (++job.done == job.tasks)
+            job.doneWake.notify_all();
+    }
+}
+
+void ThreadPool::run(size_t tasks, size_t parallelism, const std::function<void(size_t, size_t)>& fn) {
+    parallelism = std::min({parallelism, tasks, workers.size() + 1});
+    if (parallelism <= 1) {
+        for (size_t task = 0; task < tasks; ++task)
+            fn(task, 0);
+        return;
+    }
+    auto job = std::make_shared<Job>();
+    job->fn = &fn;
+    job->parallelism = parallelism;
+    job->tasks = tasks;
+    job->shares.reset(new Job::Share[parallelism]);
+    for (size_t i = 0; i < parallelism; ++i) {
+        job->shares[i].next = tasks * i / parallelism;
+        job->shares[i].end = tasks * (i + 1) / parallelism;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 1; i < parallelism; ++i)
+            queue.push_back(job);
+    }
+    wake.notify_all();
+    participate(*job, 0);
+    std::unique_lock<std::mutex> lock(job->doneMutex);
+    job->doneWake.wait(lock, [&] { return job->done == job->tasks; });
+}
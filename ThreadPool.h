@@ -0,0 +1,45 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <deque>
+
+// Work-stealing pool for morsel-driven execution. A parallel job is a range of
+// task numbers (typically the morsels of a table). Each participating thread
+// starts on its own contiguous share of the range and, once that is done,
+// steals from the far end of the other shares. The calling thread always takes
+// part, so a job finishes even while every worker is busy with other jobs.
+class ThreadPool {
+public:
+    // The process-wide pool, one worker per hardware thread.
+    static ThreadPool& shared();
+
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+    size_t size() const { return workers.size(); }
+
+    // Calls fn(task, slot) once for every task in [0, tasks) on at most
+    // 'parallelism' threads and returns when all of them have finished.
+    // 'slot' (< parallelism) tells the threads of one job apart, for
+    // per-thread scratch state.
+    void run(size_t tasks, size_t parallelism, const std::function<void(size_t, size_t)>& fn);
+
+private:
+    struct Job;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::shared_ptr<Job>> queue; // one entry per helper a job asks for
+    bool stopping = false;
+
+    void workerLoop();
+    static void participate(Job& job, size_t slot);
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,42 @@
+#include "Transaction.h"
+
+const Transaction& Transaction::latestCommitted() {
+    static const Transaction snapshot = [] {
+        Transaction txn;
+        txn.readTs = InfiniteTs - 1;
+        return txn;
+    }();
+    return snapshot;
+}
+
+Transaction TransactionManager::begin() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Transaction txn;
+    txn.id = TxnIdBit | nextId++;
+    txn.readTs = clock;
+    activeSnapshots.insert(clock);
+    return txn;
+}
+
+void TransactionManager::abort(Transaction& txn) {
+    std::lock_guard<std::mutex> lock(mutex);
+    release(txn);
+}
+
+void TransactionManager::release(Transaction& txn) {
+    auto it = activeSnapshots.find(txn.readTs);
+    if (txn.id != 0 && it != activeSnapshots.end())
+        activeSnapshots.erase(it);
+    txn.id = 0;
+    txn.tables.clear();
+}
+
+uint64_t TransactionManager::oldestActiveSnapshot() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return activeSnapshots.empty() ? clock : *activeSnapshots.begin();
+}
+
+size_t TransactionManager::activeCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return activeSnapshots.size();
+}
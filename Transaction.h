@@ -0,0 +1,75 @@
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <cstdint>
+#include <algorithm>
+
+// Row versions carry two stamps: 'begin' (the writer that created the version)
+// and 'end' (the writer that deleted it). A stamp is a commit timestamp once
+// the writer has committed, and the writer's transaction id while it is still
+// running. Ids have the top bit set so the two never collide.
+constexpr uint64_t TxnIdBit = uint64_t(1) << 63;
+constexpr uint64_t InfiniteTs = UINT64_MAX; // 'end' of a live version
+
+// A snapshot plus the writes made under it.
+struct Transaction {
+    uint64_t id = 0;                 // TxnIdBit | sequence; 0 for a read-only snapshot
+    uint64_t readTs = 0;             // sees versions committed at or before this
+    std::vector<std::string> tables; // tables holding versions written by this transaction
+
+    // Snapshot isolation: committed before the snapshot (or our own write),
+    // and not deleted by a commit before the snapshot (or by ourselves).
+    bool canSee(uint64_t begin, uint64_t end) const {
+        if ((begin & TxnIdBit) ? begin != id : begin > readTs)
+            return false;
+        if (end == InfiniteTs)
+            return true;
+        return (end & TxnIdBit) ? end != id : end > readTs;
+    }
+
+    void touch(const std::string& table) {
+        if (std::find(tables.begin(), tables.end(), table) == tables.end())
+            tables.push_back(table);
+    }
+
+    // Sees every committed version; used where no session snapshot applies.
+    static const Transaction& latestCommitted();
+};
+
+// Hands out snapshots and commit timestamps. Commits are serialized, and a
+// commit's versions are stamped before its timestamp becomes readable, so a
+// transaction sees either all of another's writes or none of them.
+class TransactionManager {
+public:
+    Transaction begin();
+
+    // stamp(commitTs) must rewrite the transaction's versions.
+    template <typename Fn>
+    void commit(Transaction& txn, Fn stamp) {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t commitTs = clock + 1;
+        stamp(commitTs);
+        clock = commitTs;
+        release(txn);
+    }
+    void abort(Transaction& txn);
+
+    // Versions whose end stamp is at or below this are invisible to every
+    // running and future transaction.
+    uint64_t oldestActiveSnapshot();
+    size_t activeCount();
+
+private:
+    std::mutex mutex;
+    uint64_t clock = 0;
+    uint64_t nextId = 1;
+    std::multiset<uint64_t> activeSnapshots;
+
+    void release(Transaction& txn);
+};
+
+#endif // TRANSACTION_H
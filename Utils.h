@@ -2,6 +2,7 @@
 #define UTILS_H
 
 #include <string>
+#include <string_view>
 #include <sstream>   // Added for std::istringstream.
 #include <vector>    // Added for std::vector.
 #include <algorithm>
@@ -23,6 +24,13 @@ inline std::string toLowerCase(const std::string& str) {
     return lowerStr;
 }
 
+// Compares two strings ignoring ASCII case, without copying either.
+inline bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::toupper(static_cast<unsigned char>(x)) == std::toupper(static_cast<unsigned char>(y));
+    });
+}
+
 // Trims whitespace from both ends of a string.
 inline std::string trim(const std::string& str) {
     std::string result = str;
@@ -46,6 +54,16 @@ static std::vector<std::string> split(const std::string &s, char delimiter) {
     return tokens;
 }
 
+// Joins strings with the given separator.
+inline std::string join(const std::vector<std::string>& items, const std::string& separator) {
+    std::string result;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (i > 0)
+            result += separator;
+        result += items[i];
+    }
+    return result;
+}
 
 // Validates the data type.
 // Supported types: INT, VARCHAR, TEXT, FLOAT, BOOLEAN
@@ -0,0 +1,211 @@
+#include "WriteAheadLog.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+uint32_t crc32(const char* data, size_t size) {
+    static uint32_t table[256];
+    static bool ready = false;
+    if (!ready) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        ready = true;
+    }
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+void appendRaw(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readRaw(const std::string& in, size_t& pos, T& value) {
+    if (pos + sizeof(T) > in.size())
+        return false;
+    std::memcpy(&value, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0)
+            return false;
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+bool WriteAheadLog::open(const std::string& path, uint64_t checkpointLsn, std::vector<WalRecord>& recovered) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Cannot open log " << path << "." << std::endl;
+        return false;
+    }
+    std::string contents;
+    char buffer[65536];
+    ssize_t got;
+    while ((got = ::read(fd, buffer, sizeof(buffer))) > 0)
+        contents.append(buffer, static_cast<size_t>(got));
+
+    // Decode records until the end or the first torn/corrupt one.
+    size_t pos = 0;
+    uint64_t lastSeen = checkpointLsn;
+    while (true) {
+        size_t start = pos;
+        uint32_t length = 0, crc = 0;
+        if (!readRaw(contents, pos, length) || !readRaw(contents, pos, crc) ||
+            pos + length > contents.size() || crc32(contents.data() + pos, length) != crc) {
+            pos = start;
+            break;
+        }
+        std::string body = contents.substr(pos, length);
+        pos += length;
+        WalRecord record;
+        size_t at = 0;
+        uint8_t type = 0;
+        uint32_t fieldCount = 0;
+        bool ok = readRaw(body, at, record.lsn) && readRaw(body, at, record.txn) &&
+                  readRaw(body, at, type) && readRaw(body, at, fieldCount);
+        for (uint32_t i = 0; ok && i < fieldCount; ++i) {
+            uint32_t fieldLength = 0;
+            ok = readRaw(body, at, fieldLength) && at + fieldLength <= body.size();
+            if (ok) {
+                record.fields.emplace_back(body, at, fieldLength);
+                at += fieldLength;
+            }
+        }
+        if (!ok) {
+            pos = start;
+            break;
+        }
+        record.type = static_cast<WalRecordType>(type);
+        lastSeen = std::max(lastSeen, record.lsn);
+        if (record.lsn > checkpointLsn)
+            recovered.push_back(std::move(record));
+    }
+    if (pos < contents.size()) {
+        std::cerr << "Warning: Discarding " << contents.size() - pos
+                  << " bytes of incomplete log records." << std::endl;
+        if (::ftruncate(fd, static_cast<off_t>(pos)) != 0)
+            std::cerr << "Error: Cannot truncate log " << path << "." << std::endl;
+    }
+    ::lseek(fd, static_cast<off_t>(pos), SEEK_SET);
+    fileBytes = pos;
+    nextLsn = lastSeen + 1;
+    pendingLsn = durableLsn = lastSeen;
+    stopping = false;
+    flusher = std::thread(&WriteAheadLog::flushLoop, this);
+    return true;
+}
+
+void WriteAheadLog::close() {
+    if (fd < 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work.notify_all();
+    if (flusher.joinable())
+        flusher.join();
+    ::close(fd);
+    fd = -1;
+}
+
+uint64_t WriteAheadLog::append(uint64_t txn, WalRecordType type, const std::vector<std::string>& fields) {
+    std::string body;
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t lsn = nextLsn++;
+    appendRaw(body, lsn);
+    appendRaw(body, txn);
+    appendRaw(body, static_cast<uint8_t>(type));
+    appendRaw(body, static_cast<uint32_t>(fields.size()));
+    for (const auto& field : fields) {
+        appendRaw(body, static_cast<uint32_t>(field.size()));
+        body += field;
+    }
+    appendRaw(pending, static_cast<uint32_t>(body.size()));
+    appendRaw(pending, crc32(body.data(), body.size()));
+    pending += body;
+    pendingLsn = lsn;
+    return lsn;
+}
+
+void WriteAheadLog::waitDurable(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (durableLsn >= lsn)
+        return;
+    work.notify_one();
+    durable.wait(lock, [&] { return durableLsn >= lsn || syncFailed || fd < 0; });
+}
+
+// Group commit: take everything appended so far, write and fsync it without
+// holding the lock, then release every waiter the batch covered.
+void WriteAheadLog::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work.wait(lock, [&] { return stopping || !pending.empty(); });
+        if (pending.empty() && stopping)
+            break;
+        std::string batch;
+        batch.swap(pending);
+        uint64_t batchLsn = pendingLsn;
+        lock.unlock();
+        bool ok = writeAll(fd, batch.data(), batch.size()) && ::fsync(fd) == 0;
+        lock.lock();
+        if (ok) {
+            fileBytes += batch.size();
+            durableLsn = batchLsn;
+        } else {
+            std::cerr << "Error: Log write failed; commits are no longer durable." << std::endl;
+            syncFailed = true;
+        }
+        durable.notify_all();
+    }
+}
+
+uint64_t WriteAheadLog::truncate() {
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t last = nextLsn - 1;
+    if (fd < 0)
+        return last;
+    // Let the flusher drain what is buffered first.
+    work.notify_one();
+    durable.wait(lock, [&] { return (pending.empty() && durableLsn >= last) || syncFailed; });
+    if (::ftruncate(fd, 0) == 0 && ::lseek(fd, 0, SEEK_SET) == 0) {
+        ::fsync(fd);
+        fileBytes = 0;
+    }
+    return last;
+}
+
+uint64_t WriteAheadLog::lastLsn() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return nextLsn - 1;
+}
+
+size_t WriteAheadLog::sizeBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fileBytes + pending.size();
+}
@@ -0,0 +1,77 @@
+#ifndef WRITEAHEADLOG_H
+#define WRITEAHEADLOG_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+// Redo operations; one per Database mutation entry point. DDL and INSERT are
+// logged as statements, the other row changes as the rows they ended and added.
+enum class WalRecordType : uint8_t {
+    Begin = 1, Commit, Rollback,
+    CreateTable, DropTable, AddColumn, DropColumn, RenameTable, Truncate,
+    CreateIndex, DropIndex,
+    Insert, Update, Delete, Merge, Replace, Sort
+};
+
+// One log record. 'txn' is 0 for autocommit statements; otherwise the record
+// only takes effect if a Commit record for the same txn follows it.
+struct WalRecord {
+    uint64_t lsn = 0;
+    uint64_t txn = 0;
+    WalRecordType type = WalRecordType::Begin;
+    std::vector<std::string> fields;
+};
+
+// Append-only redo log with group commit. append() only buffers a record;
+// a background flusher writes everything buffered with one write and one
+// fsync, so sessions waiting in waitDurable() at the same time share a sync.
+//
+// On disk each record is [length:4][crc32:4][lsn:8][txn:8][type:1]
+// [fieldCount:4] followed by (length:4, bytes) per field. Recovery stops at the
+// first torn or corrupt record and cuts the file there.
+class WriteAheadLog {
+public:
+    WriteAheadLog() = default;
+    ~WriteAheadLog();
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Opens the log and returns (in 'recovered') the records after
+    // 'checkpointLsn', which the caller replays before appending new ones.
+    bool open(const std::string& path, uint64_t checkpointLsn, std::vector<WalRecord>& recovered);
+    bool isOpen() const { return fd >= 0; }
+    void close();
+
+    uint64_t append(uint64_t txn, WalRecordType type, const std::vector<std::string>& fields);
+    // Blocks until every record up to 'lsn' is on stable storage.
+    void waitDurable(uint64_t lsn);
+    // Empties the log once a checkpoint covers all of it. Returns the last
+    // LSN handed out, which the checkpoint records.
+    uint64_t truncate();
+
+    uint64_t lastLsn();
+    size_t sizeBytes();
+
+private:
+    int fd = -1;
+    std::mutex mutex;
+    std::condition_variable work;     // flusher: there is something to write
+    std::condition_variable durable;  // waiters: durableLsn moved forward
+    std::string pending;              // encoded records not yet written
+    uint64_t nextLsn = 1;
+    uint64_t pendingLsn = 0;          // last LSN in 'pending'
+    uint64_t durableLsn = 0;
+    size_t fileBytes = 0;
+    bool stopping = false;
+    bool syncFailed = false;
+    std::thread flusher;
+
+    void flushLoop();
+};
+
+#endif // WRITEAHEADLOG_H
@@ -6,8 +6,10 @@
 #include "Parser.h"
 #include "Utils.h"
 
-int main() {
+int main(int argc, char* argv[]) {
     Database db;
+    // Tables persist in the data directory (first argument, or ./litesql_data).
+    db.open(argc > 1 ? argv[1] : "litesql_data");
     Parser parser;
     std::string commandBuffer;
     std::string line;
@@ -41,8 +43,7 @@ int main() {
                 continue;
             
             // Check for exit commands.
-            std::string upperCmd = toUpperCase(trimmedCmd);
-            if (upperCmd == "EXIT" || upperCmd == "QUIT")
+            if (equalsIgnoreCase(trimmedCmd, "EXIT") || equalsIgnoreCase(trimmedCmd, "QUIT"))
                 return 0;
 
             // Process the complete command.
@@ -50,13 +51,15 @@ int main() {
             std::string qType = toUpperCase(query.type);
 
             if (qType == "CREATE") {
-                db.createTable(query.tableName, query.columns);
+                db.createTable(query.tableName, query.columns, query.primaryKey);
             } else if (qType == "INSERT") {
                 db.insertRecord(query.tableName, query.values);
             } else if (qType == "SELECT") {
                 db.selectRecords(query.tableName, query.selectColumns, query.condition,
                                  query.orderByColumns, query.groupByColumns, query.havingCondition,
-                                 query.isJoin, query.joinTable, query.joinCondition);
+                                 query.isJoin, query.joinTable, query.joinCondition, query.limit, query.offset);
+            } else if (qType == "EXPLAIN") {
+                db.explainSelect(query);
             } else if (qType == "DELETE") {
                 db.deleteRecords(query.tableName, query.condition);
             } else if (qType == "UPDATE") {
@@ -75,22 +78,32 @@ int main() {
                 db.describeTable(query.tableName);
             } else if (qType == "SHOW") {
                 db.showTables();
+            } else if (qType == "SHOWCACHE") {
+                db.showResultCache();
             } else if (qType == "BEGIN") {
                 db.beginTransaction();
             } else if (qType == "COMMIT") {
                 db.commitTransaction();
             } else if (qType == "ROLLBACK") {
                 db.rollbackTransaction();
+            } else if (qType == "SET") {
+                db.setVariable(query.settingName, query.settingValue);
             } else if (qType == "TRUNCATE") {
                 db.truncateTable(query.tableName);
             } else if (qType == "CREATEINDEX") {
-                db.createIndex(query.indexName, query.tableName, query.columnName);
+                db.createIndex(query.indexName, query.tableName, query.columnName, query.indexType);
             } else if (qType == "DROPINDEX") {
                 db.dropIndex(query.indexName);
             } else if (qType == "MERGE") {
                 db.mergeRecords(query.tableName, query.mergeCommand);
             } else if (qType == "REPLACE") {
                 db.replaceInto(query.tableName, query.values);
+            } else if (qType == "PREPARE") {
+                db.prepare(query.statementName, query.statementText);
+            } else if (qType == "EXECUTE") {
+                db.execute(query.statementName, query.arguments);
+            } else if (qType == "DEALLOCATE") {
+                db.deallocate(query.statementName);
             } else {
                 std::cout << "Invalid command." << std::endl;
             }
@@ -0,0 +1,96 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+// Helpers shared by the tests in this directory. Each test is one program:
+//
+//   g++ -std=c++17 -I. tests/<name>_test.cpp $(ls *.cpp | grep -v main.cpp) -o <name>_test -lpthread
+//   ./<name>_test
+//
+// It prints PASS or FAIL per case and exits non-zero if any case failed.
+
+#include "Database.h"
+#include "Parser.h"
+#include "Utils.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+
+static int failures = 0;
+
+static void expect(const std::string& name, const std::string& actual, const std::string& expected) {
+    if (actual == expected) {
+        std::cout << "PASS " << name << std::endl;
+        return;
+    }
+    std::cout << "FAIL " << name << "\n--- expected\n" << expected << "--- got\n" << actual;
+    failures++;
+}
+
+static void expectTrue(const std::string& name, bool holds) {
+    expect(name, holds ? "true\n" : "false\n", "true\n");
+}
+
+// Runs the ';'-separated statements as the command line does and returns
+// everything they print, errors included.
+static std::string run(Database& db, const std::string& statements) {
+    std::ostringstream out;
+    std::streambuf* savedOut = std::cout.rdbuf(out.rdbuf());
+    std::streambuf* savedErr = std::cerr.rdbuf(out.rdbuf());
+    Parser parser;
+    for (const auto& text : split(statements, ';')) {
+        if (trim(text).empty())
+            continue;
+        Query q = parser.parseQuery(trim(text));
+        std::string type = toUpperCase(q.type);
+        if (type == "CREATE")
+            db.createTable(q.tableName, q.columns, q.primaryKey);
+        else if (type == "INSERT")
+            db.insertRecord(q.tableName, q.values);
+        else if (type == "SELECT")
+            db.selectRecords(q.tableName, q.selectColumns, q.condition, q.orderByColumns, q.groupByColumns,
+                             q.havingCondition, q.isJoin, q.joinTable, q.joinCondition, q.limit, q.offset);
+        else if (type == "EXPLAIN")
+            db.explainSelect(q);
+        else if (type == "DELETE")
+            db.deleteRecords(q.tableName, q.condition);
+        else if (type == "UPDATE")
+            db.updateRecords(q.tableName, q.updates, q.condition);
+        else if (type == "DROP")
+            db.dropTable(q.tableName);
+        else if (type == "ALTER" && q.alterAction == "ADD")
+            db.alterTableAddColumn(q.tableName, q.alterColumn);
+        else if (type == "ALTER" && q.alterAction == "DROP")
+            db.alterTableDropColumn(q.tableName, q.alterColumn.first);
+        else if (type == "ALTER" && q.alterAction == "RENAME")
+            db.renameTable(q.tableName, q.newTableName);
+        else if (type == "BEGIN")
+            db.beginTransaction();
+        else if (type == "COMMIT")
+            db.commitTransaction();
+        else if (type == "ROLLBACK")
+            db.rollbackTransaction();
+        else if (type == "SET")
+            db.setVariable(q.settingName, q.settingValue);
+        else if (type == "TRUNCATE")
+            db.truncateTable(q.tableName);
+        else if (type == "CREATEINDEX")
+            db.createIndex(q.indexName, q.tableName, q.columnName, q.indexType);
+        else if (type == "DROPINDEX")
+            db.dropIndex(q.indexName);
+        else if (type == "MERGE")
+            db.mergeRecords(q.tableName, q.mergeCommand);
+        else if (type == "REPLACE")
+            db.replaceInto(q.tableName, q.values);
+        else if (type == "PREPARE")
+            db.prepare(q.statementName, q.statementText);
+        else if (type == "EXECUTE")
+            db.execute(q.statementName, q.arguments);
+        else if (type == "DEALLOCATE")
+            db.deallocate(q.statementName);
+    }
+    std::cout.rdbuf(savedOut);
+    std::cerr.rdbuf(savedErr);
+    return out.str();
+}
+
+#endif // TEST_UTIL_H
@@ -0,0 +1,46 @@
+// GROUP BY runs as a hash aggregation; HAVING and ORDER BY apply to the
+// aggregated rows.
+
+#include "TestUtil.h"
+
+int main() {
+    Database db;
+    run(db, "CREATE TABLE t (id INT, g TEXT, v INT, f FLOAT);"
+            "INSERT INTO t VALUES (1, 'a', 5, 1.5), (2, 'b', 7, NULL), (3, 'a', NULL, 2.5), (4, 'c', 1, 0.5),"
+            " (5, 'b', 3, 4)");
+
+    expect("every aggregate function",
+           run(db, "SELECT g, COUNT(*), COUNT(v), SUM(v), AVG(v), MIN(v), MAX(v), MEDIAN(v) FROM t GROUP BY g"),
+           "g\tCOUNT(*)\tCOUNT(v)\tSUM(v)\tAVG(v)\tMIN(v)\tMAX(v)\tMEDIAN(v)\t\n"
+           "a\t2\t1\t5\t5\t5\t5\t5\t\nb\t2\t2\t10\t5\t3\t7\t5\t\nc\t1\t1\t1\t1\t1\t1\t1\t\n");
+    expect("float column", run(db, "SELECT g, MIN(f), MAX(f), AVG(f) FROM t GROUP BY g"),
+           "g\tMIN(f)\tMAX(f)\tAVG(f)\t\na\t1.5\t2.5\t2\t\nb\t4\t4\t4\t\nc\t0.5\t0.5\t0.5\t\n");
+    expect("MIN and MAX of text", run(db, "SELECT COUNT(*), MIN(g), MAX(g) FROM t"), "5\ta\tc\t\n");
+    expect("groups of the filtered rows", run(db, "SELECT g, MIN(id) FROM t WHERE id > 1 GROUP BY g"),
+           "g\tMIN(id)\t\nb\t2\t\na\t3\t\nc\t4\t\n");
+
+    expect("HAVING on an aggregate in the select list",
+           run(db, "SELECT g, COUNT(*) FROM t GROUP BY g HAVING COUNT(*) > 1"), "g\tCOUNT(*)\t\na\t2\t\nb\t2\t\n");
+    expect("HAVING on an aggregate missing from the select list",
+           run(db, "SELECT g FROM t GROUP BY g HAVING SUM(v) >= 6"), "g\t\nb\t\n");
+    expect("HAVING on a group column", run(db, "SELECT COUNT(*) FROM t GROUP BY g HAVING g = 'c'"),
+           "COUNT(*)\t\n1\t\n");
+
+    expect("ORDER BY a group column", run(db, "SELECT g, MIN(id) FROM t WHERE id > 1 GROUP BY g ORDER BY g"),
+           "g\tMIN(id)\t\na\t3\t\nb\t2\t\nc\t4\t\n");
+    expect("ORDER BY an aggregate", run(db, "SELECT g, SUM(v) FROM t GROUP BY g ORDER BY sum(v) DESC"),
+           "g\tSUM(v)\t\nb\t10\t\na\t5\t\nc\t1\t\n");
+    expect("ORDER BY a hidden aggregate with LIMIT",
+           run(db, "SELECT g FROM t GROUP BY g ORDER BY COUNT(*) DESC, g DESC LIMIT 2"), "g\t\nb\t\na\t\n");
+    expect("OFFSET after HAVING and ORDER BY",
+           run(db, "SELECT g FROM t GROUP BY g HAVING COUNT(*) > 1 ORDER BY g LIMIT 5 OFFSET 1"), "g\t\nb\t\n");
+
+    // Large enough to be aggregated in parallel morsels.
+    std::string rows;
+    for (int i = 0; i < 100000; ++i)
+        rows += std::string(rows.empty() ? "" : ", ") + "(" + std::to_string(i) + ", " + std::to_string(i % 3) + ")";
+    run(db, "CREATE TABLE big (id INT, k INT); INSERT INTO big VALUES " + rows + "; SET PARALLELISM 4");
+    expect("parallel aggregation", run(db, "SELECT k, COUNT(*), MIN(id), MAX(id) FROM big GROUP BY k ORDER BY k"),
+           "k\tCOUNT(*)\tMIN(id)\tMAX(id)\t\n0\t33334\t0\t99999\t\n1\t33333\t1\t99997\t\n2\t33333\t2\t99998\t\n");
+    return failures == 0 ? 0 : 1;
+}
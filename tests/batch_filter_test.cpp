@@ -0,0 +1,88 @@
+// Conditions evaluated a batch at a time (selection vectors and SIMD masks)
+// select exactly the rows that evaluating them row by row does.
+
+#include "TestUtil.h"
+#include <numeric>
+#include <vector>
+
+int main() {
+    // A few batches (BatchSize rows) of every column type, with NULLs.
+    Table table;
+    table.addColumn("i", "INT");
+    table.addColumn("f", "FLOAT");
+    table.addColumn("b", "BOOLEAN");
+    table.addColumn("s", "TEXT");
+    const size_t rows = 3 * BatchSize + 100;
+    for (size_t row = 0; row < rows; ++row) {
+        bool isNull = row % 13 == 0;
+        table.addRow({isNull ? "NULL" : std::to_string(static_cast<int>(row % 20) - 10),
+                      isNull ? "NULL" : std::to_string(static_cast<double>(row % 8) / 4),
+                      isNull ? "NULL" : (row % 3 ? "true" : "false"),
+                      "s" + std::to_string(row % 5)});
+    }
+
+    const char* conditions[] = {
+        "i = 3", "i != 3", "i < 0", "i <= -10", "i > 5", "i >= 9",
+        "f = 0.5", "f > 1", "f <= 0.25", "b = true", "b != false", "s = 's2'", "s > 's3'",
+        "i > 0 AND f < 1", "i < -5 OR s = 's1'", "i >= 0 AND (b = true OR f = 0)",
+        "(i = 1 OR i = 2 OR i = 3) AND s != 's0'", "i > 100", "i > -100 OR f > 100",
+    };
+    for (const char* text : conditions) {
+        ConditionExprPtr expr = ConditionParser(text).compile(table);
+        std::vector<size_t> expected;
+        for (size_t row = 0; row < rows; ++row) {
+            if (expr->evaluate(table, row))
+                expected.push_back(row);
+        }
+
+        // Selection vectors: every other row, a batch at a time.
+        std::vector<size_t> selected;
+        for (size_t begin = 0; begin < rows; begin += BatchSize) {
+            std::vector<size_t> batch;
+            for (size_t row = begin; row < std::min(rows, begin + BatchSize); row += 2)
+                batch.push_back(row);
+            batch.resize(expr->filter(table, batch.data(), batch.size()));
+            selected.insert(selected.end(), batch.begin(), batch.end());
+        }
+        std::vector<size_t> everyOther;
+        for (size_t row : expected) {
+            if (row % 2 == 0)
+                everyOther.push_back(row);
+        }
+        expectTrue(std::string("selection vector: ") + text, selected == everyOther);
+
+        // Bitmasks, where the expression has kernels for all its parts.
+        std::vector<size_t> masked;
+        bool dense = true;
+        for (size_t begin = 0; begin < rows && dense; begin += BatchSize) {
+            size_t end = std::min(rows, begin + BatchSize);
+            uint64_t mask[BatchSize / 64];
+            dense = expr->filterMask(table, begin, end, mask);
+            for (size_t row = begin; row < end && dense; ++row) {
+                if ((mask[(row - begin) / 64] >> ((row - begin) % 64)) & 1)
+                    masked.push_back(row);
+            }
+        }
+        if (dense)
+            expectTrue(std::string("bitmask: ") + text, masked == expected);
+    }
+
+    // The numeric comparisons have kernels; text ones do not.
+    uint64_t mask[BatchSize / 64];
+    expectTrue("int comparison has a kernel", ConditionParser("i > 0 AND f < 1").compile(table)->filterMask(
+                                                  table, 0, BatchSize, mask));
+    expectTrue("text comparison has none", !ConditionParser("s = 's1'").compile(table)->filterMask(
+                                                table, 0, BatchSize, mask));
+
+    // Through SQL: filter evaluation is reported by EXPLAIN.
+    Database db;
+    run(db, "CREATE TABLE t (i INT, s TEXT); INSERT INTO t VALUES (1, 'a'), (2, 'b'), (NULL, 'c'), (4, NULL)");
+    expect("comparison on NULL fails", run(db, "SELECT s FROM t WHERE i > 0 AND i < 10"), "s\t\na\t\nb\t\nNULL\t\n");
+    expect("SIMD filter", run(db, "EXPLAIN SELECT s FROM t WHERE i > 1"),
+           "-> Project\n     Columns: s\n    -> Seq Scan on t\n         Filter: i > 1\n"
+           "         Filter evaluation: SIMD bitmask\n");
+    expect("selection vector filter", run(db, "EXPLAIN SELECT i FROM t WHERE s = 'a' OR i = 4"),
+           "-> Project\n     Columns: i\n    -> Seq Scan on t\n         Filter: s = 'a' OR i = 4\n"
+           "         Filter evaluation: selection vector\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+// WHERE conditions are bound to the table once: column names become column
+// positions and literals are converted to the column's type.
+
+#include "TestUtil.h"
+
+int main() {
+    Database db;
+    run(db, "CREATE TABLE t (id INT, a INT, f FLOAT, s TEXT, b BOOLEAN);"
+            "INSERT INTO t VALUES (1, 1, 0.5, 'ann', true), (2, 3, 2.25, 'bob', false), (3, 5, -1, NULL, true)");
+
+    expect("int literal against a float column", run(db, "SELECT id FROM t WHERE f >= 0.5 AND f < 3"),
+           "id\t\n1\t\n2\t\n");
+    expect("float literal against an int column", run(db, "SELECT id FROM t WHERE a = 3.0"), "id\t\n2\t\n");
+    expect("text comparison", run(db, "SELECT id FROM t WHERE s > 'b'"), "id\t\n2\t\n");
+    expect("boolean comparison", run(db, "SELECT id FROM t WHERE b = true"), "id\t\n1\t\n3\t\n");
+    expect("AND binds tighter than OR", run(db, "SELECT id FROM t WHERE s = 'ann' OR a = 5 AND f < 0"),
+           "id\t\n1\t\n3\t\n");
+    expect("parentheses", run(db, "SELECT id FROM t WHERE (s = 'ann' OR a = 5) AND f > 0"), "id\t\n1\t\n");
+    expect("unknown column matches nothing", run(db, "SELECT id FROM t WHERE nope = 1"), "id\t\n");
+
+    // A prepared condition is bound again when it runs, so it follows the
+    // column to its new position after an earlier column is dropped.
+    run(db, "PREPARE p AS SELECT id, s FROM t WHERE f > $1");
+    const std::string before = run(db, "EXECUTE p(0)");
+    expect("prepared condition", before, "id\ts\t\n1\tann\t\n2\tbob\t\n");
+    run(db, "ALTER TABLE t DROP COLUMN a");
+    expect("prepared condition after DROP COLUMN", run(db, "EXECUTE p(0)"), before);
+    expect("ad hoc condition after DROP COLUMN", run(db, "SELECT id FROM t WHERE f < 0"), "id\t\n3\t\n");
+    return failures == 0 ? 0 : 1;
+}
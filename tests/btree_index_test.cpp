@@ -0,0 +1,35 @@
+// B+tree indexes answer range predicates and give ORDER BY its order
+// without sorting.
+
+#include "TestUtil.h"
+
+int main() {
+    Database db;
+    run(db, "CREATE TABLE t (id INT, v INT, s TEXT);"
+            "INSERT INTO t VALUES (1, 50, 'e'), (2, 10, 'a'), (3, 40, 'd'), (4, 20, 'b'), (5, 30, 'c'), (6, 20, 'bb');"
+            "CREATE INDEX vi ON t (v) USING BTREE");
+
+    expect("range uses the index", run(db, "EXPLAIN SELECT id FROM t WHERE v >= 20 AND v < 40"),
+           "-> Project\n     Columns: id\n    -> Index Scan on t\n         Index: BTREE on v\n"
+           "         Index candidates: 3\n         Filter: v >= 20 AND v < 40\n");
+    expect("closed range", run(db, "SELECT id FROM t WHERE v >= 20 AND v < 40 ORDER BY id"),
+           "id\t\n4\t\n5\t\n6\t\n");
+    expect("open range", run(db, "SELECT id FROM t WHERE v > 20 ORDER BY id"), "id\t\n1\t\n3\t\n5\t\n");
+
+    expect("ORDER BY reads the index", run(db, "EXPLAIN SELECT id, v FROM t ORDER BY v"),
+           "-> Project\n     Columns: id, v\n    -> Index Order\n         Index: BTREE on v\n"
+           "        -> Seq Scan on t\n");
+    expect("index order", run(db, "SELECT id, v FROM t ORDER BY v"),
+           "id\tv\t\n2\t10\t\n4\t20\t\n6\t20\t\n5\t30\t\n3\t40\t\n1\t50\t\n");
+    expect("descending index order with LIMIT", run(db, "SELECT id, v FROM t ORDER BY v DESC LIMIT 2"),
+           "id\tv\t\n1\t50\t\n3\t40\t\n");
+
+    run(db, "CREATE INDEX si ON t (s) USING BTREE");
+    expect("text keys", run(db, "SELECT id FROM t WHERE s < 'c' ORDER BY id"), "id\t\n2\t\n4\t\n6\t\n");
+
+    run(db, "UPDATE t SET v = 5 WHERE id = 1; DELETE FROM t WHERE id = 2");
+    expect("index follows UPDATE and DELETE", run(db, "SELECT id, v FROM t ORDER BY v LIMIT 3"),
+           "id\tv\t\n1\t5\t\n4\t20\t\n6\t20\t\n");
+    expect("range after changes", run(db, "SELECT id FROM t WHERE v < 20"), "id\t\n1\t\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+// Typed column storage: values are checked against the column type on the
+// way in, and a statement with one bad value changes nothing.
+
+#include "TestUtil.h"
+
+int main() {
+    Database db;
+    run(db, "CREATE TABLE t (id INT PRIMARY KEY, v INT, s TEXT, f FLOAT);"
+            "INSERT INTO t VALUES (1, 10, 'a', 1.5), (2, 20, NULL, 2)");
+    const std::string rows = "id\tv\ts\tf\t\n1\t10\ta\t1.5\t\n2\t20\tNULL\t2\t\n";
+    expect("typed values read back", run(db, "SELECT * FROM t ORDER BY id"), rows);
+
+    // Each UPDATE below has one valid and one invalid assignment.
+    expect("update of an unknown column is rejected",
+           run(db, "UPDATE t SET s = 'z', nope = 1 WHERE id = 1"), "Error: Column nope does not exist.\n");
+    expect("NULL into a NOT NULL column is rejected",
+           run(db, "UPDATE t SET s = 'z', id = NULL WHERE id = 1"),
+           "Error: NOT NULL constraint violated for column id.\n");
+    expect("a value the type rejects is rejected",
+           run(db, "UPDATE t SET s = 'z', f = 'abc' WHERE id = 1"),
+           "Error: Invalid value 'abc' for FLOAT column f.\n");
+    expect("rejected updates change nothing", run(db, "SELECT * FROM t ORDER BY id"), rows);
+
+    // Inside a transaction the rejected statement leaves earlier ones alone.
+    run(db, "BEGIN; UPDATE t SET v = 11 WHERE id = 1; UPDATE t SET v = 'x' WHERE id = 2; COMMIT");
+    expect("earlier statements of the transaction survive", run(db, "SELECT id, v FROM t ORDER BY id"),
+           "id\tv\t\n1\t11\t\n2\t20\t\n");
+
+    expect("valid update applies", run(db, "UPDATE t SET s = 'z', f = 3 WHERE id = 1; SELECT * FROM t WHERE id = 1"),
+           "Records updated in t.\nid\tv\ts\tf\t\n1\t11\tz\t3\t\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+// EXPLAIN prints the chosen plan without running it; EXPLAIN ANALYZE runs
+// the statement, discards its rows, and reports time, rows, memory and
+// spill per operator.
+
+#include "TestUtil.h"
+#include "QueryProfile.h"
+
+// Lines of 'text' that contain 'part'.
+static size_t countLines(const std::string& text, const std::string& part) {
+    std::istringstream lines(text);
+    std::string line;
+    size_t count = 0;
+    while (std::getline(lines, line))
+        count += line.find(part) != std::string::npos;
+    return count;
+}
+
+int main() {
+    expect("bytes", QueryProfile::formatBytes(1023), "1023 B");
+    expect("kilobytes", QueryProfile::formatBytes(1536), "1.5 KB");
+    expect("megabytes", QueryProfile::formatBytes(size_t(3) << 20), "3.0 MB");
+
+    // Operators print from the root, each under the one reading it.
+    QueryProfile profile(false);
+    size_t a = profile.add("Seq Scan on a");
+    size_t b = profile.add("Seq Scan on b");
+    size_t join = profile.add("Hash Join", {a, b});
+    profile.at(join).details.push_back("Hash cond: a.id = b.id");
+    profile.add("Project", {join});
+    std::ostringstream tree;
+    profile.print(tree);
+    expect("tree", tree.str(),
+           "-> Project\n    -> Hash Join\n         Hash cond: a.id = b.id\n        -> Seq Scan on a\n"
+           "        -> Seq Scan on b\n");
+
+    Database db;
+    std::string rows;
+    for (int i = 0; i < 40000; ++i)
+        rows += std::string(rows.empty() ? "" : ", ") + "(" + std::to_string(i) + ", " + std::to_string(i % 10) +
+                ", 'k" + std::to_string(i % 3) + "')";
+    run(db, "CREATE TABLE t (id INT, g INT, s TEXT); INSERT INTO t VALUES " + rows + ";"
+            "CREATE INDEX gi ON t (g); CREATE TABLE u (id INT, tag TEXT); INSERT INTO u VALUES (1, 'a'), (2, 'b');"
+            "SET PARALLELISM 4");
+
+    // Scan type and index.
+    expect("index scan", run(db, "EXPLAIN SELECT id FROM t WHERE g = 3"),
+           "-> Project\n     Columns: id\n    -> Index Scan on t\n         Index: HASH on g\n"
+           "         Index candidates: 4000\n         Filter: g = 3\n");
+    expect("parallel scan", run(db, "EXPLAIN SELECT id FROM t WHERE id > 5"),
+           "-> Project\n     Columns: id\n    -> Parallel Seq Scan on t\n         Filter: id > 5\n"
+           "         Filter evaluation: SIMD bitmask\n         Workers: 4, morsels: 3\n");
+    // Join algorithm.
+    expect("hash join", run(db, "EXPLAIN SELECT t.id, u.tag FROM t JOIN u ON t.id = u.id"),
+           "-> Hash Join\n     Hash cond: t.id = u.id\n     Build side: smaller input after filtering\n"
+           "     Columns: t.id, u.tag\n    -> Seq Scan on t\n    -> Seq Scan on u\n");
+    // Sort strategy.
+    std::string sort = run(db, "EXPLAIN SELECT s FROM t ORDER BY s LIMIT 3");
+    expectTrue("sort strategy", sort.find("-> Sort\n             Sort key: s\n             Keeps: first 3 rows\n"
+                                          "             Strategy: top-N partial sort, estimated ") != std::string::npos);
+    expectTrue("plain EXPLAIN has no timings", countLines(sort, "Actual:") == 0 &&
+                                                  countLines(sort, "Execution time") == 0);
+
+    // EXPLAIN ANALYZE: one Actual line per operator, no result rows.
+    std::string analyzed = run(db, "EXPLAIN ANALYZE SELECT g, COUNT(*) FROM t WHERE s = 'k1' GROUP BY g");
+    expect("an Actual line per operator", std::to_string(countLines(analyzed, "Actual: time=")),
+           std::to_string(countLines(analyzed, "-> ")));
+    expectTrue("rows in and out", analyzed.find("rows in=40000, rows out=13333") != std::string::npos &&
+                                      analyzed.find("rows in=13333, rows out=10") != std::string::npos);
+    expectTrue("memory and spill", countLines(analyzed, "memory peak=") == 2 && countLines(analyzed, "spill=0 B") == 2);
+    expectTrue("total time last", analyzed.rfind("Execution time: ") == analyzed.rfind('\n', analyzed.size() - 2) + 1);
+    expectTrue("no result rows", analyzed.find("COUNT(*)\t") == std::string::npos);
+
+    std::string joined = run(db, "EXPLAIN ANALYZE SELECT t.id, u.tag FROM t JOIN u ON t.id = u.id");
+    expectTrue("join rows", joined.find("Build side: u") != std::string::npos &&
+                                joined.find("rows in=40002, rows out=2") != std::string::npos);
+
+    // A sort past SORT_MEMORY reports its runs; running it changes no rows.
+    run(db, "SET SORT_MEMORY 1MB");
+    std::string spilled = run(db, "EXPLAIN ANALYZE SELECT id FROM t ORDER BY s DESC, id");
+    expectTrue("spill reported", spilled.find("Strategy: external merge sort") != std::string::npos);
+    expect("table unchanged", run(db, "SELECT COUNT(*) FROM t"), "40000\t\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+// Sorts larger than their memory budget spill sorted runs to temporary
+// files and merge them back: the rows come out exactly as an in-memory
+// sort puts them, through however many merge levels.
+
+#include "TestUtil.h"
+#include "Sort.h"
+#include <numeric>
+#include <random>
+#include <vector>
+
+int main() {
+    Table table;
+    table.addColumn("k", "INT");
+    table.addColumn("s", "TEXT");
+    std::mt19937 random(18);
+    const size_t rows = 20000;
+    for (size_t row = 0; row < rows; ++row)
+        table.addRow({random() % 50 == 0 ? "NULL" : std::to_string(static_cast<int>(random() % 3000) - 1500),
+                      "v" + std::to_string(random() % 997)});
+    std::vector<SortKey> keys = {{&table.getColumnData(0), true}, {&table.getColumnData(1), false}};
+
+    std::vector<size_t> expected(rows);
+    std::iota(expected.begin(), expected.end(), size_t(0));
+    RowSorter::Stats stats;
+    RowSorter::sort(expected, keys, rows, RowSorter::DefaultMemoryBudget, 1, &stats);
+    expect("fits in memory", std::to_string(stats.runs), "0");
+
+    // A few runs, then more than one merge can take at once (so runs are
+    // merged in levels).
+    for (size_t budget : {size_t(256) << 10, size_t(8) << 10}) {
+        std::string name = std::to_string(budget >> 10) + " KB budget";
+        std::vector<size_t> sorted(rows);
+        std::iota(sorted.begin(), sorted.end(), size_t(0));
+        RowSorter::sort(sorted, keys, rows, budget, 1, &stats);
+        expectTrue(name + ": same order as in memory", sorted == expected);
+        expectTrue(name + ": spilled runs", stats.runs > 1 && stats.spillBytes > 0);
+        if (budget < (size_t(64) << 10))
+            expectTrue(name + ": more runs than one merge takes", stats.runs > 64);
+        expectTrue(name + ": memory held near the budget", stats.memoryPeak <= budget + 1024);
+        expect(name + ": strategy", stats.strategy.substr(0, 19), "external merge sort");
+
+        // With a LIMIT each run keeps only its first rows.
+        std::vector<size_t> top(rows);
+        std::iota(top.begin(), top.end(), size_t(0));
+        RowSorter::sort(top, keys, 300, budget, 1, &stats);
+        expectTrue(name + ": top 300", top.size() == 300 && std::equal(top.begin(), top.end(), expected.begin()));
+    }
+
+    // Through SQL: SORT_MEMORY sets the budget, EXPLAIN ANALYZE shows the
+    // spill, and the result does not change.
+    Database db;
+    std::string values;
+    for (int i = 0; i < 40000; ++i)
+        values += std::string(values.empty() ? "" : ", ") + "(" + std::to_string(i) + ", 'key-" +
+                  std::to_string((i * 7919) % 40000 + 100000) + "')";
+    run(db, "CREATE TABLE t (id INT, s TEXT); INSERT INTO t VALUES " + values);
+    std::string inMemory = run(db, "SELECT id, s FROM t ORDER BY s DESC");
+    expect("too small a budget", run(db, "SET SORT_MEMORY 1000"), "Error: SORT_MEMORY must be at least 1MB.\n");
+    run(db, "SET SORT_MEMORY 1MB");
+    expect("spilled ORDER BY", run(db, "SELECT id, s FROM t ORDER BY s DESC"), inMemory);
+    std::string plan = run(db, "EXPLAIN ANALYZE SELECT id FROM t ORDER BY s DESC");
+    expectTrue("EXPLAIN ANALYZE shows runs", plan.find("Strategy: external merge sort") != std::string::npos &&
+                                                 plan.find(" runs)") != std::string::npos);
+    size_t actual = plan.find("Actual:", plan.find("-> Sort"));
+    std::string sortLine = plan.substr(actual, plan.find('\n', actual) - actual);
+    expectTrue("and bytes spilled", sortLine.find("spill=0 B") == std::string::npos);
+    return failures == 0 ? 0 : 1;
+}
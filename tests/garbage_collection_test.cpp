@@ -0,0 +1,103 @@
+// Garbage collection of row versions: dead versions leave the indexes as
+// soon as no snapshot sees them, the column store is compacted only past
+// Table::CompactionFraction, and both work while writers hold pending rows.
+
+#include "TestUtil.h"
+
+static Transaction writer(uint64_t sequence, uint64_t readTs) {
+    Transaction txn;
+    txn.id = TxnIdBit | sequence;
+    txn.readTs = readTs;
+    return txn;
+}
+
+static Transaction reader(uint64_t readTs) {
+    Transaction txn;
+    txn.readTs = readTs;
+    return txn;
+}
+
+// Visible rows as "id=v" pairs in row order.
+static std::string visible(const Table& table, const Transaction& txn) {
+    std::string text;
+    for (size_t row : table.matchingRows(nullptr, txn))
+        text += table.getValue(row, 0) + "=" + table.getValue(row, 1) + " ";
+    return text;
+}
+
+// The id column of the rows that the index on 'column' holds under 'key'.
+static std::string indexed(const Table& table, const std::string& column, const std::string& key) {
+    std::string text;
+    for (size_t row : table.findIndex(table.getColumnIndex(column))->lookup(key))
+        text += table.getValue(row, 0) + " ";
+    return text;
+}
+
+int main() {
+    Table table;
+    table.addColumn("id", "INT");
+    table.addColumn("v", "TEXT");
+    table.setPrimaryKey("id");
+    table.createIndex("v");
+    table.createIndex("id", IndexType::BTree);
+
+    Transaction load = writer(1, 0);
+    for (int i = 0; i < 8; ++i)
+        table.addRow({std::to_string(i), i % 2 ? "odd" : "even"}, load);
+    table.commitVersions(load.id, 1);
+
+    Transaction del = writer(2, 1);
+    table.deleteRows("id = 0", del);
+    table.commitVersions(del.id, 2);
+
+    // An old snapshot (at 1) still sees row 0: nothing is reclaimed.
+    expect("nothing below the horizon", std::to_string(table.collectGarbage(1)), "0");
+    expect("old snapshot sees the deleted row", visible(table, reader(1)).substr(0, 7), "0=even ");
+
+    // One dead version of eight stays in the column store but leaves the
+    // indexes.
+    expect("reclaimed", std::to_string(table.collectGarbage(2)), "1");
+    expect("below the compaction fraction", std::to_string(table.rowCount()), "8");
+    expect("dead version out of the hash index", indexed(table, "v", "even"), "2 4 6 ");
+    expect("and out of the primary key", std::to_string(table.findByPrimaryKey("0", reader(9)) == Table::NoRow),
+           "1");
+    expect("examined only once", std::to_string(table.collectGarbage(2)), "0");
+
+    // A writer holds pending versions while GC compacts the table.
+    Transaction pending = writer(3, 2);
+    table.addRow({"8", "even"}, pending);
+    table.updateRows({{"v", "changed"}}, "id = 7", pending);
+    Transaction more = writer(4, 2);
+    table.deleteRows("id < 3", more);
+    table.commitVersions(more.id, 4);
+    expect("reclaimed with a writer pending", std::to_string(table.collectGarbage(4)), "2");
+    expect("compacted", std::to_string(table.rowCount()), "7");
+    table.commitVersions(pending.id, 5);
+    expect("pending versions survive the renumbering", visible(table, reader(5)),
+           "3=odd 4=even 5=odd 6=even 8=even 7=changed ");
+
+    // Indexes follow the new row ids.
+    expect("hash index after compaction", indexed(table, "v", "even"), "4 6 8 ");
+    Index::Bound lo, hi;
+    lo.open = false;
+    lo.number = table.getColumnData(0).orderedKey(table.findByPrimaryKey("5", reader(5)));
+    std::vector<size_t> range;
+    table.findIndex(0)->rangeLookup(lo, hi, range);
+    std::string ids;
+    for (size_t row : range) {
+        if (table.isVisible(row, reader(5)))
+            ids += table.getValue(row, 0) + " ";
+    }
+    expect("btree index after compaction", ids, "5 6 7 8 ");
+    expect("primary key after compaction", table.getValue(table.findByPrimaryKey("8", reader(5)), 1), "even");
+
+    // Aborted inserts are reclaimed too.
+    Transaction aborted = writer(6, 5);
+    for (int i = 10; i < 20; ++i)
+        table.addRow({std::to_string(i), "x"}, aborted);
+    table.abortVersions(aborted.id);
+    expect("aborted inserts reclaimed", std::to_string(table.collectGarbage(5)), "11");
+    expect("and compacted", std::to_string(table.rowCount()), "6");
+    expect("no aborted keys left", indexed(table, "v", "x"), "");
+    return failures == 0 ? 0 : 1;
+}
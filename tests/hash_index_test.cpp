@@ -0,0 +1,46 @@
+// CREATE INDEX builds a hash index that equality predicates use and every
+// change to the table keeps current.
+
+#include "TestUtil.h"
+#include <cstdlib>
+
+int main() {
+    std::system("rm -rf hash_index_test_data");
+    {
+        Database db;
+        db.open("hash_index_test_data");
+        run(db, "CREATE TABLE t (id INT, g INT, s TEXT);"
+                "INSERT INTO t VALUES (1, 10, 'a'), (2, 20, 'b'), (3, 10, 'c'), (4, 30, 'a');"
+                "CREATE INDEX gi ON t (g)");
+        expect("equality uses the index", run(db, "EXPLAIN SELECT id FROM t WHERE g = 10"),
+               "-> Project\n     Columns: id\n    -> Index Scan on t\n         Index: HASH on g\n"
+               "         Index candidates: 2\n         Filter: g = 10\n");
+        expect("index lookup", run(db, "SELECT id FROM t WHERE g = 10"), "id\t\n1\t\n3\t\n");
+
+        run(db, "INSERT INTO t VALUES (5, 10, 'd'); UPDATE t SET g = 20 WHERE id = 1; DELETE FROM t WHERE id = 3");
+        expect("index follows INSERT, UPDATE and DELETE", run(db, "SELECT id FROM t WHERE g = 10"), "id\t\n5\t\n");
+        expect("updated row under its new key", run(db, "SELECT id FROM t WHERE g = 20 ORDER BY id"),
+               "id\t\n1\t\n2\t\n");
+        expect("literal converted to the key type", run(db, "SELECT id FROM t WHERE g = 10.0"), "id\t\n5\t\n");
+
+        run(db, "BEGIN; INSERT INTO t VALUES (6, 10, 'z'); ROLLBACK");
+        expect("rolled back insert leaves the index", run(db, "SELECT id FROM t WHERE g = 10"), "id\t\n5\t\n");
+        db.checkpoint();
+    }
+    {
+        // Index definitions are stored with the table and rebuilt on load.
+        Database db;
+        db.open("hash_index_test_data");
+        expect("index survives reopening", run(db, "EXPLAIN SELECT id FROM t WHERE g = 20"),
+               "-> Project\n     Columns: id\n    -> Index Scan on t\n         Index: HASH on g\n"
+               "         Index candidates: 2\n         Filter: g = 20\n");
+        expect("reopened index lookup", run(db, "SELECT id FROM t WHERE g = 20 ORDER BY id"),
+               "id\t\n1\t\n2\t\n");
+        run(db, "DROP INDEX gi");
+        expect("dropped index is not used", run(db, "EXPLAIN SELECT id FROM t WHERE g = 10"),
+               "-> Project\n     Columns: id\n    -> Seq Scan on t\n         Filter: g = 10\n"
+               "         Filter evaluation: SIMD bitmask\n");
+    }
+    std::system("rm -rf hash_index_test_data");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+// JOIN ... ON a = b runs as a hash join over the two column stores.
+
+#include "TestUtil.h"
+
+int main() {
+    Database db;
+    run(db, "CREATE TABLE a (id INT, name TEXT);"
+            "CREATE TABLE b (aid INT, amount INT);"
+            "INSERT INTO a VALUES (1, 'x'), (2, 'y'), (3, 'z'), (4, NULL);"
+            "INSERT INTO b VALUES (1, 10), (1, 20), (3, 30), (5, 50), (NULL, 60)");
+
+    expect("inner join", run(db, "SELECT a.id, a.name, b.amount FROM a JOIN b ON a.id = b.aid"),
+           "a.id\ta.name\tb.amount\t\n1\tx\t10\t\n1\tx\t20\t\n3\tz\t30\t\n");
+    expect("join with WHERE", run(db, "SELECT * FROM a JOIN b ON a.id = b.aid WHERE b.amount > 15"),
+           "id\tname\taid\tamount\t\n1\tx\t1\t20\t\n3\tz\t3\t30\t\n");
+    expect("keys in either order", run(db, "SELECT name, amount FROM a JOIN b ON b.aid = a.id LIMIT 1"),
+           "name\tamount\t\nx\t10\t\n");
+    expect("WHERE conjuncts are pushed below the join",
+           run(db, "EXPLAIN SELECT a.id, b.amount FROM a JOIN b ON a.id = b.aid WHERE a.name = 'x'"),
+           "-> Hash Join\n     Hash cond: a.id = b.aid\n     Build side: smaller input after filtering\n"
+           "     Columns: a.id, b.amount\n    -> Seq Scan on a\n         Filter: name = 'x'\n"
+           "         Filter evaluation: selection vector\n    -> Seq Scan on b\n");
+
+    run(db, "CREATE TABLE c (name TEXT, f FLOAT); INSERT INTO c VALUES ('y', 1.5), ('z', 2), ('q', 3);"
+            "CREATE TABLE d (k FLOAT); INSERT INTO d VALUES (1.0), (2.5), (3)");
+    expect("text keys", run(db, "SELECT a.id, c.f FROM a JOIN c ON a.name = c.name"),
+           "a.id\tc.f\t\n2\t1.5\t\n3\t2\t\n");
+    expect("int keys against float keys", run(db, "SELECT a.id, d.k FROM a JOIN d ON a.id = d.k"),
+           "a.id\td.k\t\n1\t1\t\n3\t3\t\n");
+
+    run(db, "BEGIN; DELETE FROM c WHERE name = 'y'");
+    expect("join sees the transaction's own changes", run(db, "SELECT a.id, c.f FROM a JOIN c ON a.name = c.name"),
+           "a.id\tc.f\t\n3\t2\t\n");
+    run(db, "ROLLBACK");
+    expect("and not after rollback", run(db, "SELECT a.id, c.f FROM a JOIN c ON a.name = c.name"),
+           "a.id\tc.f\t\n2\t1.5\t\n3\t2\t\n");
+    expect("missing table", run(db, "SELECT * FROM a JOIN nope ON a.id = nope.id"),
+           "One or both tables in JOIN do not exist.\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+// An INSERT with a row that fails validation or the primary key check adds
+// none of its rows, reports no success, and leaves an open transaction's
+// earlier statements in place.
+
+#include "TestUtil.h"
+#include <cstdlib>
+
+int main() {
+    std::system("rm -rf /tmp/insert_constraint_test && mkdir -p /tmp/insert_constraint_test");
+    {
+        Database db;
+        db.open("/tmp/insert_constraint_test");
+        run(db, "CREATE TABLE t (id INT PRIMARY KEY, s TEXT); INSERT INTO t VALUES (1, 'a')");
+
+        expect("duplicate key refuses the statement", run(db, "INSERT INTO t VALUES (2, 'b'), (1, 'dup'), (3, 'c')"),
+               "Error: Duplicate primary key value '1' for column id.\n");
+        expect("no row of it is kept", run(db, "SELECT * FROM t"), "id\ts\t\n1\ta\t\n");
+        expect("duplicate within the statement", run(db, "INSERT INTO t VALUES (4, 'd'), (4, 'e')"),
+               "Error: Duplicate primary key value '4' for column id.\n");
+        expect("wrong value count", run(db, "INSERT INTO t VALUES (5, 'e'), (6)"),
+               "Error: Incorrect number of values for row.\n");
+        expect("bad value", run(db, "INSERT INTO t VALUES (7, 'g'), ('x', 'y')").substr(0, 6), "Error:");
+        // The undone rows left the primary key index too.
+        expect("undone keys are free", run(db, "INSERT INTO t VALUES (2, 'b'), (4, 'd')"),
+               "Record(s) inserted into t.\n");
+
+        // Inside a transaction only the failed statement is taken back.
+        run(db, "BEGIN; INSERT INTO t VALUES (10, 'j')");
+        expect("refused in a transaction", run(db, "INSERT INTO t VALUES (11, 'k'), (10, 'again')"),
+               "Error: Duplicate primary key value '10' for column id.\n");
+        expect("transaction goes on", run(db, "INSERT INTO t VALUES (11, 'k'); COMMIT"),
+               "Record(s) inserted into t.\nTransaction committed.\n");
+        expect("committed rows", run(db, "SELECT id FROM t"), "id\t\n1\t\n2\t\n4\t\n10\t\n11\t\n");
+    }
+
+    // Refused rows were never logged, so reopening replays none of them.
+    Database db;
+    db.open("/tmp/insert_constraint_test");
+    expect("after reopening", run(db, "SELECT id FROM t"), "id\t\n1\t\n2\t\n4\t\n10\t\n11\t\n");
+    return failures == 0 ? 0 : 1;
+}
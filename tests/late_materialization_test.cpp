@@ -0,0 +1,55 @@
+// SELECT carries row ids through filter and sort and reads only the
+// projected columns when writing the result.
+
+#include "TestUtil.h"
+
+// The "memory peak" EXPLAIN ANALYZE reports for the first operator named
+// 'op' in 'plan'.
+static std::string memoryPeak(const std::string& plan, const std::string& op) {
+    size_t at = plan.find("-> " + op);
+    if (at == std::string::npos)
+        return "no " + op;
+    at = plan.find("memory peak=", at);
+    return plan.substr(at + 12, plan.find(',', at) - at - 12);
+}
+
+int main() {
+    Database db;
+    std::string wide = "CREATE TABLE wide (id INT";
+    std::string narrow = "CREATE TABLE narrow (id INT)";
+    for (int c = 0; c < 50; ++c)
+        wide += ", c" + std::to_string(c) + " TEXT";
+    run(db, wide + ")");
+    run(db, narrow);
+    std::string wideRows, narrowRows;
+    for (int i = 0; i < 2000; ++i) {
+        std::string row = "(" + std::to_string(i);
+        for (int c = 0; c < 50; ++c)
+            row += ", 'value of column " + std::to_string(c) + "'";
+        wideRows += std::string(wideRows.empty() ? "" : ", ") + row + ")";
+        narrowRows += std::string(narrowRows.empty() ? "" : ", ") + "(" + std::to_string(i) + ")";
+    }
+    run(db, "INSERT INTO wide VALUES " + wideRows + "; INSERT INTO narrow VALUES " + narrowRows);
+
+    // Without WHERE no row-id list is built, and the output buffer holds
+    // the projected column only, however wide the table.
+    std::string plan = run(db, "EXPLAIN ANALYZE SELECT id FROM wide");
+    expect("scan without WHERE builds no id list", memoryPeak(plan, "Seq Scan"), "0 B");
+    expect("projection reads one column of fifty", memoryPeak(plan, "Project"),
+           memoryPeak(run(db, "EXPLAIN ANALYZE SELECT id FROM narrow"), "Project"));
+
+    // A filter keeps one row id per match.
+    plan = run(db, "EXPLAIN ANALYZE SELECT id FROM wide WHERE id < 1000");
+    expect("filter keeps row ids", memoryPeak(plan, "Seq Scan"),
+           memoryPeak(run(db, "EXPLAIN ANALYZE SELECT id FROM narrow WHERE id < 1000"), "Seq Scan"));
+
+    // Sorting moves ids; the sort key need not be projected.
+    expect("ORDER BY an unprojected column", run(db, "SELECT c3 FROM wide WHERE id >= 1997 ORDER BY id DESC"),
+           "c3\t\nvalue of column 3\t\nvalue of column 3\t\nvalue of column 3\t\n");
+    expect("ids sorted, then projected", run(db, "SELECT id FROM wide WHERE id < 5 ORDER BY id DESC LIMIT 2 OFFSET 1"),
+           "id\t\n3\t\n2\t\n");
+    expect("columns in the order asked for", run(db, "SELECT c49, id, c0 FROM wide WHERE id = 7"),
+           "c49\tid\tc0\t\nvalue of column 49\t7\tvalue of column 0\t\n");
+    expect("all columns", run(db, "SELECT * FROM narrow WHERE id = 1999"), "id\t\n1999\t\n");
+    return failures == 0 ? 0 : 1;
+}
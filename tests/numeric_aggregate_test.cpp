@@ -0,0 +1,54 @@
+// SUM and AVG over typed columns: integer sums are exact int64 values, and
+// a group without non-NULL values sums to NULL.
+
+#include "TestUtil.h"
+
+int main() {
+    Database db;
+    // 2^53 + 1 is the first integer a double cannot hold.
+    run(db, "CREATE TABLE t (id INT, g TEXT, v INT, f FLOAT, b BOOLEAN);"
+            "INSERT INTO t VALUES (1, 'a', 9007199254740993, 0.5, true), (2, 'a', 1, 0.25, true),"
+            " (3, 'b', 3, 1, false), (4, 'c', NULL, NULL, NULL)");
+
+    // Without WHERE the SIMD kernels sum the column; with WHERE the selected
+    // rows are summed one by one; GROUP BY folds batches into groups.
+    expect("exact integer sum over the whole column", run(db, "SELECT SUM(v) FROM t"), "9007199254740997\t\n");
+    expect("exact integer sum over selected rows", run(db, "SELECT SUM(v) FROM t WHERE id < 3"),
+           "9007199254740994\t\n");
+    expect("exact integer sum per group", run(db, "SELECT g, SUM(v) FROM t GROUP BY g ORDER BY g"),
+           "g\tSUM(v)\t\na\t9007199254740994\t\nb\t3\t\nc\t\t\n");
+    expect("HAVING compares the exact sum",
+           run(db, "SELECT g FROM t GROUP BY g HAVING SUM(v) > 9007199254740993"), "g\t\na\t\n");
+    expect("boolean sum counts the true values", run(db, "SELECT SUM(b), AVG(b) FROM t"), "2\t0.666667\t\n");
+    expect("float sum and average", run(db, "SELECT SUM(f), AVG(f) FROM t WHERE id > 1"), "1.25\t0.625\t\n");
+
+    expect("SUM and AVG of no rows are NULL", run(db, "SELECT COUNT(*), SUM(v), AVG(v) FROM t WHERE id > 9"),
+           "0\t\t\t\n");
+    expect("SUM and AVG of only NULLs are NULL", run(db, "SELECT SUM(v), AVG(f), COUNT(v) FROM t WHERE g = 'c'"),
+           "\t\t0\t\n");
+
+    // A sum past the int64 range is reported as a float instead of wrapping.
+    run(db, "CREATE TABLE big (g INT, v INT);"
+            "INSERT INTO big VALUES (1, 9223372036854775807), (1, 9223372036854775807), (2, 5)");
+    expect("overflowing sum", run(db, "SELECT SUM(v) FROM big"), "18446744073709551616\t\n");
+    expect("overflowing group", run(db, "SELECT g, SUM(v) FROM big GROUP BY g ORDER BY g"),
+           "g\tSUM(v)\t\n1\t18446744073709551616\t\n2\t5\t\n");
+    expect("average of values whose sum overflows", run(db, "SELECT AVG(v) FROM big WHERE g = 1"),
+           "9223372036854775808\t\n");
+
+    // Negative values and enough rows for the vector loops and for parallel
+    // morsels; the sums are checked against the sum computed here.
+    std::string rows;
+    long long expected = 0;
+    for (int i = 0; i < 100000; ++i) {
+        long long v = (i % 2 ? -1LL : 1LL) * (4000000000LL + i);
+        expected += v;
+        rows += std::string(rows.empty() ? "" : ", ") + "(" + std::to_string(i % 2) + ", " + std::to_string(v) + ")";
+    }
+    run(db, "CREATE TABLE wide (g INT, v INT); INSERT INTO wide VALUES " + rows + "; SET PARALLELISM 4");
+    expect("vectorized sum of large and negative values", run(db, "SELECT SUM(v) FROM wide"),
+           std::to_string(expected) + "\t\n");
+    expect("same sum over selected rows", run(db, "SELECT SUM(v) FROM wide WHERE g >= 0"),
+           std::to_string(expected) + "\t\n");
+    return failures == 0 ? 0 : 1;
+}
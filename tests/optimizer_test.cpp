@@ -0,0 +1,71 @@
+// The rule-based rewrites: constants folded, AND and OR flattened,
+// equalities on one column merged into IN lists, and join WHERE conjuncts
+// pushed below the join to the input they read.
+
+#include "TestUtil.h"
+#include "Optimizer.h"
+
+static std::string simplified(const std::string& condition) {
+    return Optimizer::describe(Optimizer::simplify(ConditionParser(condition).parsePredicate()));
+}
+
+int main() {
+    expect("true operand dropped", simplified("1 = 1 AND a > 2"), "a > 2");
+    expect("false operand dropped", simplified("1 = 2 OR b = 'x'"), "b = 'x'");
+    expect("text constants", simplified("'x' < 'y' AND a = 1"), "a = 1");
+    expect("numbers compare as numbers", simplified("10 > 9 AND a = 1"), "a = 1");
+    expect("always true", simplified("a = 1 OR 1 = 1"), "TRUE");
+    expect("always false", simplified("(a = 1 OR a = 2) AND (b = 1 AND (c = 2 AND 2 = 3))"), "FALSE");
+    expect("OR of equalities to IN", simplified("a = 1 OR a = 2 OR a = 3"), "a IN (1, 2, 3)");
+    expect("other columns kept apart", simplified("a = 1 OR b = 1 OR a = 2"), "a IN (1, 2) OR b = 1");
+    expect("nested AND flattened", simplified("(a = 1 OR a = 2) AND (b = 1 AND c > 0)"),
+           "a IN (1, 2) AND b = 1 AND c > 0");
+    expect("parameters in IN lists", simplified("a = $1 OR a = 2"), "a IN ($1, 2)");
+
+    // Join planning on two small tables.
+    Table left, right;
+    left.addColumn("id", "INT");
+    left.addColumn("name", "TEXT");
+    left.addColumn("unused", "TEXT");
+    right.addColumn("aid", "INT");
+    right.addColumn("amount", "INT");
+    JoinPlan plan;
+    expectTrue("planned", Optimizer::planJoin(left, "a", right, "b", {"a.name", "amount"}, "a.id = b.aid",
+                                              "a.name = 'x' AND b.amount > 5 AND (a.id = 1 OR b.amount = 7) AND 1 = 1",
+                                              plan));
+    expect("left filter", Optimizer::describe(plan.leftPredicate), "name = 'x'");
+    expect("right filter", Optimizer::describe(plan.rightPredicate), "amount > 5");
+    expect("both sides stay on the join", plan.residualText.size() == 1 ? plan.residualText[0] : "",
+           "a.id = 1 OR b.amount = 7");
+    expect("only selected columns are output", std::to_string(plan.output.size()), "2");
+    expectTrue("output resolved to each side", plan.output[0] == std::make_pair(size_t(1), false) &&
+                                                   plan.output[1] == std::make_pair(size_t(1), true));
+    expectTrue("keys", plan.leftKey == 0 && plan.rightKey == 0 && !plan.empty);
+
+    JoinPlan swapped;
+    Optimizer::planJoin(left, "a", right, "b", {"*"}, "aid = id", "", swapped);
+    expectTrue("keys written right to left", swapped.leftKey == 0 && swapped.rightKey == 0);
+    expectTrue("no filters without WHERE", !swapped.leftFilter && !swapped.rightFilter && swapped.residual.empty());
+    expect("* outputs every column", std::to_string(swapped.output.size()), "5");
+
+    JoinPlan never;
+    Optimizer::planJoin(left, "a", right, "b", {"*"}, "a.id = b.aid", "a.id = 1 AND 1 = 2", never);
+    expectTrue("WHERE that never holds", never.empty);
+
+    // Through SQL: pushed filters narrow the scans, and IN lists select what
+    // the ORs they replace would.
+    Database db;
+    run(db, "CREATE TABLE a (id INT, name TEXT); CREATE TABLE b (aid INT, amount INT);"
+            "INSERT INTO a VALUES (1, 'x'), (2, 'y'), (3, 'x'), (4, 'z');"
+            "INSERT INTO b VALUES (1, 10), (1, 3), (2, 20), (3, 7), (4, 9)");
+    expect("pushdown result",
+           run(db, "SELECT a.id, b.amount FROM a JOIN b ON a.id = b.aid WHERE a.name = 'x' AND b.amount > 5"),
+           "a.id\tb.amount\t\n1\t10\t\n3\t7\t\n");
+    std::string plain = run(db, "EXPLAIN ANALYZE SELECT a.id FROM a JOIN b ON a.id = b.aid WHERE a.name = 'x'");
+    expectTrue("left scan filtered", plain.find("rows in=4, rows out=2") != std::string::npos);
+    expect("IN list", run(db, "SELECT id FROM a WHERE name = 'y' OR name = 'z' OR id = 1"), "id\t\n1\t\n2\t\n4\t\n");
+    std::string in = run(db, "EXPLAIN SELECT id FROM a WHERE name = 'y' OR name = 'z'");
+    expectTrue("EXPLAIN shows the IN list", in.find("Filter: name IN ('y', 'z')") != std::string::npos);
+    expect("false WHERE reads nothing", run(db, "SELECT a.id FROM a JOIN b ON a.id = b.aid WHERE 1 = 2"), "a.id\t\n");
+    return failures == 0 ? 0 : 1;
+}
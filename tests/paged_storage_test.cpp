@@ -0,0 +1,97 @@
+// Stored tables larger than the buffer pool are scanned page by page instead
+// of being loaded, and checkpoints append a table's changes to its file
+// instead of rewriting it.
+
+#include "TestUtil.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+static const std::string Dir = "paged_storage_test_data";
+
+// The data directory's files with 'extension', as "name:size" lines.
+static std::string files(const std::string& extension) {
+    std::vector<std::string> found;
+    for (const auto& entry : fs::directory_iterator(Dir)) {
+        if (entry.path().extension() == extension)
+            found.push_back(entry.path().filename().string() + ":" + std::to_string(fs::file_size(entry.path())));
+    }
+    std::sort(found.begin(), found.end());
+    std::string text;
+    for (const auto& file : found)
+        text += file + "\n";
+    return text;
+}
+
+int main() {
+    std::system(("rm -rf " + Dir).c_str());
+    // More rows than one scan chunk (Table::MorselRows), on far more pages
+    // than the 4-frame pool below holds.
+    {
+        Database db;
+        db.open(Dir);
+        std::string rows;
+        for (int i = 0; i < 40000; ++i)
+            rows += std::string(rows.empty() ? "" : ", ") + "(" + std::to_string(i) + ", 'r" + std::to_string(i) + "')";
+        run(db, "CREATE TABLE t (id INT, s TEXT); INSERT INTO t VALUES " + rows);
+        db.checkpoint();
+    }
+    std::string stored = files(".tbl");
+
+    {
+        Database db(4);
+        db.open(Dir);
+        expect("filtered paged scan across a chunk boundary",
+               run(db, "SELECT id FROM t WHERE id >= 16382 LIMIT 4"), "id\t\n16382\t\n16383\t\n16384\t\n16385\t\n");
+        expect("offset into the second chunk", run(db, "SELECT s FROM t LIMIT 2 OFFSET 16383"), "s\t\nr16383\t\nr16384\t\n");
+        expect("last row", run(db, "SELECT * FROM t WHERE id = 39999"), "id\ts\t\n39999\tr39999\t\n");
+
+        // Changing the table loads it; the checkpoint then appends the new
+        // row and records the deleted ones, leaving the written pages alone.
+        run(db, "DELETE FROM t WHERE id < 10; INSERT INTO t VALUES (40000, 'new')");
+        db.checkpoint();
+        std::string name = stored.substr(0, stored.find(':'));
+        expectTrue("same table file after a small change", files(".tbl").compare(0, name.size(), name) == 0);
+        uint64_t before = std::stoull(stored.substr(stored.find(':') + 1));
+        uint64_t after = fs::file_size(fs::path(Dir) / name);
+        expect("one page appended", std::to_string(after - before), std::to_string(BufferPool::PageSize));
+        expect("deleted record numbers", files(".del").substr(files(".del").find(':')), ":80\n");
+    }
+    {
+        Database db(4);
+        db.open(Dir);
+        expect("paged scan skips deleted records", run(db, "SELECT id FROM t LIMIT 2"), "id\t\n10\t\n11\t\n");
+        expect("paged scan reads appended pages", run(db, "SELECT * FROM t WHERE id > 39998"),
+               "id\ts\t\n39999\tr39999\t\n40000\tnew\t\n");
+        expect("ORDER BY loads the table", run(db, "SELECT id FROM t ORDER BY id DESC LIMIT 1"), "id\t\n40000\t\n");
+    }
+
+    // Pages a crash leaves past the catalog's count are cut off on open.
+    std::string tbl = files(".tbl");
+    {
+        std::ofstream tail(fs::path(Dir) / tbl.substr(0, tbl.find(':')), std::ios::binary | std::ios::app);
+        tail << std::string(BufferPool::PageSize, 'x');
+    }
+    {
+        Database db(4);
+        db.open(Dir);
+        expect("torn tail ignored", files(".tbl"), tbl);
+        expect("rows after the torn tail", run(db, "SELECT id FROM t WHERE id > 39998"), "id\t\n39999\t\n40000\t\n");
+
+        // Once most records are deleted the file is rewritten compactly.
+        run(db, "DELETE FROM t WHERE id < 30000");
+        db.checkpoint();
+        expectTrue("rewritten into a new file", files(".tbl") != tbl);
+        expect("no deletions left", files(".del"), "");
+    }
+    {
+        Database db;
+        db.open(Dir);
+        expect("rows after the rewrite", run(db, "SELECT COUNT(*), MIN(id), MAX(id) FROM t"), "10001\t30000\t40000\t\n");
+    }
+    std::system(("rm -rf " + Dir).c_str());
+    return failures == 0 ? 0 : 1;
+}
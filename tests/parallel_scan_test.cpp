@@ -0,0 +1,66 @@
+// Morsel-driven scans: the work-stealing pool runs every task exactly once,
+// and statements return the same rows, in the same order, at any degree of
+// parallelism.
+
+#include "TestUtil.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <vector>
+
+int main() {
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> runs(1000);
+    std::atomic<bool> slotsInRange{true};
+    pool.run(runs.size(), 3, [&](size_t task, size_t slot) {
+        runs[task]++;
+        if (slot >= 3)
+            slotsInRange = false;
+    });
+    bool once = true;
+    for (const auto& count : runs)
+        once = once && count == 1;
+    expectTrue("every task runs once", once);
+    expectTrue("slots below the parallelism", slotsInRange);
+
+    // A job started from inside another finishes on its caller's thread even
+    // when every worker is taken.
+    std::atomic<int> inner{0};
+    pool.run(8, 8, [&](size_t, size_t) {
+        pool.run(4, 4, [&](size_t, size_t) { inner++; });
+    });
+    expect("nested jobs", std::to_string(inner.load()), "32");
+
+    // Several morsels (Table::MorselRows rows each) of data.
+    Database db;
+    std::string rows;
+    for (int i = 0; i < 70000; ++i)
+        rows += std::string(rows.empty() ? "" : ", ") + "(" + std::to_string(i) + ", " + std::to_string(i % 10) +
+                ", 'k" + std::to_string(i % 3) + "')";
+    run(db, "CREATE TABLE t (id INT, g INT, s TEXT); INSERT INTO t VALUES " + rows);
+
+    const char* queries[] = {
+        "SELECT id FROM t WHERE g = 3 AND s = 'k1'",
+        "SELECT id, s FROM t WHERE id > 16000 LIMIT 10 OFFSET 380",
+        "SELECT g, COUNT(*), SUM(id), MIN(s) FROM t WHERE id >= 100 GROUP BY g",
+        "SELECT COUNT(*), AVG(id) FROM t WHERE s = 'k2'",
+        "SELECT * FROM t ORDER BY g DESC, id LIMIT 5",
+    };
+    std::vector<std::string> serial;
+    run(db, "SET PARALLELISM 1");
+    for (const char* query : queries)
+        serial.push_back(run(db, query));
+    run(db, "SET PARALLELISM 8");
+    for (size_t i = 0; i < serial.size(); ++i)
+        expect(std::string("parallel: ") + queries[i], run(db, queries[i]), serial[i]);
+    std::string window = "id\ts\t\n";
+    for (int i = 16381; i <= 16390; ++i)
+        window += std::to_string(i) + "\tk" + std::to_string(i % 3) + "\t\n";
+    expect("offset and limit across a morsel boundary", serial[1], window);
+    expect("first rows in table order", run(db, "SELECT id FROM t WHERE g = 9 LIMIT 3"), "id\t\n9\t\n19\t\n29\t\n");
+
+    // DELETE and UPDATE find their rows in parallel morsels too.
+    run(db, "DELETE FROM t WHERE g = 0; UPDATE t SET s = 'u' WHERE id >= 69990");
+    expect("deleted across morsels", run(db, "SELECT COUNT(*) FROM t"), "63000\t\n");
+    expect("updated across morsels", run(db, "SELECT COUNT(*) FROM t WHERE s = 'u'"), "9\t\n");
+    return failures == 0 ? 0 : 1;
+}
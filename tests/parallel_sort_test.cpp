@@ -0,0 +1,73 @@
+// Large sorts run as a parallel sample sort over (key, row id) pairs: the
+// order is the one the serial radix sort gives, duplicates and skew
+// included, and Table::sortRows applies it as one permutation.
+
+#include "TestUtil.h"
+#include "Sort.h"
+#include <numeric>
+#include <random>
+#include <vector>
+
+int main() {
+    // Twice the smallest input sorted in parallel, with a heavy duplicate
+    // (every third row) that lands many equal keys in one bucket.
+    const size_t rows = 200000;
+    Table table;
+    table.addColumn("k", "INT");
+    table.addColumn("s", "TEXT");
+    std::mt19937 random(19);
+    for (size_t row = 0; row < rows; ++row)
+        table.addRow({row % 3 == 0 ? "7" : std::to_string(static_cast<int>(random() % 100000) - 50000),
+                      "s" + std::to_string(random() % 50)});
+
+    const std::vector<std::vector<SortKey>> orders = {
+        {{&table.getColumnData(0), false}},
+        {{&table.getColumnData(1), true}, {&table.getColumnData(0), false}},
+    };
+    for (size_t i = 0; i < orders.size(); ++i) {
+        std::string name = "order " + std::to_string(i);
+        std::vector<size_t> serial(rows), parallel(rows);
+        std::iota(serial.begin(), serial.end(), size_t(0));
+        std::iota(parallel.begin(), parallel.end(), size_t(0));
+        RowSorter::Stats stats;
+        RowSorter::sort(serial, orders[i], rows, RowSorter::DefaultMemoryBudget, 1, &stats);
+        expect(name + ": serial strategy", stats.strategy, "radix sort");
+        RowSorter::sort(parallel, orders[i], rows, RowSorter::DefaultMemoryBudget, 8, &stats);
+        expect(name + ": parallel strategy", stats.strategy, "parallel sample sort");
+        expectTrue(name + ": same order", parallel == serial);
+    }
+    std::vector<size_t> small(1000);
+    std::iota(small.begin(), small.end(), size_t(0));
+    RowSorter::Stats stats;
+    RowSorter::sort(small, orders[0], small.size(), RowSorter::DefaultMemoryBudget, 8, &stats);
+    expect("small inputs sort serially", stats.strategy, "radix sort");
+    expect("planned strategy", RowSorter::strategy(rows, rows, 8), "parallel sample sort");
+    expect("a small LIMIT keeps the top-N sort", RowSorter::strategy(rows, 10, 8), "top-N partial sort");
+
+    // Spilled runs are sorted in parallel too.
+    std::vector<size_t> spilled(rows), expected(rows);
+    std::iota(spilled.begin(), spilled.end(), size_t(0));
+    std::iota(expected.begin(), expected.end(), size_t(0));
+    RowSorter::sort(expected, orders[1], rows, RowSorter::DefaultMemoryBudget, 1);
+    RowSorter::sort(spilled, orders[1], rows, size_t(8) << 20, 8, &stats);
+    expect("runs sorted in parallel", stats.strategy, "external merge sort, parallel sample sort per run");
+    expectTrue("spilled parallel order", spilled == expected);
+
+    // Table::sortRows, through sortPhotos, with and without threads.
+    Database serialDb, parallelDb;
+    std::string values;
+    for (int i = 0; i < 100000; ++i)
+        values += std::string(values.empty() ? "" : ", ") + "(" + std::to_string(i) + ", " +
+                  std::to_string((i * 7919) % 1000) + ")";
+    for (Database* db : {&serialDb, &parallelDb})
+        run(*db, "CREATE TABLE t (id INT, v INT); INSERT INTO t VALUES " + values + "; CREATE INDEX vi ON t (v)");
+    run(parallelDb, "SET PARALLELISM 8");
+    serialDb.sortPhotos("t", "v", false);
+    parallelDb.sortPhotos("t", "v", false);
+    std::string sorted = run(serialDb, "SELECT * FROM t");
+    expect("sortRows in parallel", run(parallelDb, "SELECT * FROM t"), sorted);
+    expect("ties keep their order", sorted.substr(0, 25), "id\tv\t\n321\t999\t\n1321\t999\t\n");
+    expect("index after the parallel sortRows", run(parallelDb, "SELECT id FROM t WHERE v = 998 LIMIT 2"),
+           "id\t\n642\t\n1642\t\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+// PREPARE and EXECUTE: arguments fill the parsed statement's slots, quoted
+// arguments stay one value, prepared statements belong to their session,
+// and a session ends, its transaction rolled back, when its thread exits.
+
+#include "TestUtil.h"
+#include <thread>
+
+// Runs 'statements' on a new thread, which is a new session.
+static std::string onThread(Database& db, const std::string& statements) {
+    std::string output;
+    std::thread([&] { output = run(db, statements); }).join();
+    return output;
+}
+
+int main() {
+    Database db;
+    run(db, "CREATE TABLE t (id INT PRIMARY KEY, s TEXT)");
+    expect("prepare", run(db, "PREPARE ins AS INSERT INTO t VALUES ($1, $2)"), "Statement ins prepared.\n");
+    run(db, "EXECUTE ins(1, 'a'); EXECUTE ins(2, 'b'); EXECUTE ins(3, 'it''s')");
+    expect("wrong argument count", run(db, "EXECUTE ins(4)"), "Error: ins takes 2 parameter(s), got 1.\n");
+    run(db, "PREPARE up AS UPDATE t SET s = $2 WHERE id = $1; EXECUTE up(1, 'z');"
+            "PREPARE del AS DELETE FROM t WHERE s = $1; EXECUTE del('b');"
+            "PREPARE rep AS REPLACE INTO t VALUES ($1, $2); EXECUTE rep(4, 'r')");
+    expect("INSERT, UPDATE, DELETE and REPLACE", run(db, "SELECT * FROM t"),
+           "id\ts\t\n3\tit's\t\n1\tz\t\n4\tr\t\n");
+    run(db, "PREPARE sel AS SELECT id FROM t WHERE s = $1");
+    expect("quoted argument", run(db, "EXECUTE sel('it''s')"), "id\t\n3\t\n");
+    expect("not preparable", run(db, "PREPARE bad AS DROP TABLE t"),
+           "Error: Only SELECT, INSERT, REPLACE, UPDATE and DELETE can be prepared.\n");
+
+    // An argument holding quotes is one literal, in the result cache key and
+    // in a join's re-parsed condition alike.
+    run(db, "SET RESULT_CACHE 1MB; EXECUTE ins(5, 'z'' OR s = ''r')");
+    expect("literal query, cached", run(db, "SELECT id FROM t WHERE s = 'z' OR s = 'r'"), "id\t\n1\t\n4\t\n");
+    expect("argument with quotes is not that query", run(db, "EXECUTE sel('z'' OR s = ''r')"), "id\t\n5\t\n");
+    run(db, "CREATE TABLE u (id INT, tag TEXT); INSERT INTO u VALUES (5, 'x'), (1, 'y');"
+            "PREPARE j AS SELECT t.id, u.tag FROM t JOIN u ON t.id = u.id WHERE t.s = $1");
+    expect("join argument with quotes", run(db, "EXECUTE j('z'' OR s = ''r')"), "t.id\tu.tag\t\n5\tx\t\n");
+
+    // Prepared statements are private to the session.
+    expect("other session", onThread(db, "EXECUTE sel('z')"), "Prepared statement sel does not exist.\n");
+    expect("deallocate", run(db, "DEALLOCATE sel; EXECUTE sel('z')"),
+           "Statement sel deallocated.\nPrepared statement sel does not exist.\n");
+
+    // A thread that exits inside a transaction has it rolled back, which
+    // frees the keys it inserted.
+    onThread(db, "BEGIN; INSERT INTO t VALUES (6, 'pending')");
+    expect("key free after the thread exits", run(db, "INSERT INTO t VALUES (6, 'mine')"),
+           "Record(s) inserted into t.\n");
+    expect("its row never committed", run(db, "SELECT s FROM t WHERE id = 6"), "s\t\nmine\t\n");
+
+    // closeSession() ends the calling thread's session at once.
+    run(db, "PREPARE sel AS SELECT id FROM t WHERE s = $1; BEGIN; INSERT INTO t VALUES (7, 'open')");
+    db.closeSession();
+    expect("transaction rolled back", run(db, "SELECT COUNT(*) FROM t WHERE id = 7"), "0\t\n");
+    expect("prepared statements forgotten", run(db, "EXECUTE sel('z')"), "Prepared statement sel does not exist.\n");
+    expect("no transaction left", run(db, "COMMIT"), "No active transaction to commit.\n");
+    return failures == 0 ? 0 : 1;
+}
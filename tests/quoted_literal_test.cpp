@@ -0,0 +1,40 @@
+// A quoted literal is one token however many spaces, operators or doubled
+// quotes it holds, and a doubled quote stands for one quote in its value.
+
+#include "TestUtil.h"
+#include "Lexer.h"
+#include <vector>
+
+int main() {
+    std::vector<Token> tokens;
+    Lexer::tokenize("SELECT * FROM t WHERE s = 'it''s = (x)'", tokens);
+    expect("one String token", std::string(tokens[7].text), "'it''s = (x)'");
+    expectTrue("followed by End", tokens[7].type == TokenType::String && tokens[8].type == TokenType::End);
+    expect("unquote collapses doubled quotes", Lexer::unquote(tokens[7].text), "it's = (x)");
+    expect("only quotes", Lexer::unquote("''''''"), "''");
+    expect("empty literal", Lexer::unquote("''"), "");
+    expect("double quotes", Lexer::unquote("\"say \"\"hi\"\"\""), "say \"hi\"");
+    expect("unterminated literal", Lexer::unquote("'abc"), "abc");
+
+    Database db;
+    run(db, "CREATE TABLE t (id INT, s TEXT);"
+            "INSERT INTO t VALUES (1, 'it''s'), (2, 'a b'), (3, 'x = y'), (4, ''''), (5, 'plain')");
+    expect("INSERT stores one quote", run(db, "SELECT s FROM t WHERE id < 5"),
+           "s\t\nit's\t\na b\t\nx = y\t\n'\t\n");
+    expect("WHERE with a doubled quote", run(db, "SELECT id FROM t WHERE s = 'it''s'"), "id\t\n1\t\n");
+    expect("WHERE with a space", run(db, "SELECT id FROM t WHERE s = 'a b'"), "id\t\n2\t\n");
+    expect("WHERE with an operator", run(db, "SELECT id FROM t WHERE s = 'x = y' OR s = ''''"),
+           "id\t\n3\t\n4\t\n");
+    expect("folded constants", run(db, "SELECT id FROM t WHERE 'a''b' = 'a''b' AND id = 1"), "id\t\n1\t\n");
+    expectTrue("EXPLAIN quotes the literal back",
+               run(db, "EXPLAIN SELECT id FROM t WHERE s = 'it''s'").find("Filter: s = 'it''s'") != std::string::npos);
+
+    run(db, "UPDATE t SET s = 'don''t' WHERE id = 5; REPLACE INTO t VALUES (6, 'r''s')");
+    expect("UPDATE and REPLACE", run(db, "SELECT s FROM t WHERE id >= 5"), "s\t\ndon't\t\nr's\t\n");
+    run(db, "MERGE INTO t USING (SELECT 7 AS id, 'o''k' AS s) ON t.id = src.id "
+            "WHEN MATCHED THEN UPDATE SET s = src.s WHEN NOT MATCHED THEN INSERT VALUES (src.id, src.s);"
+            "MERGE INTO t USING (SELECT 1 AS id) ON t.id = src.id "
+            "WHEN MATCHED THEN UPDATE SET s = 'b''c' WHEN NOT MATCHED THEN INSERT VALUES (src.id, 'n')");
+    expect("MERGE", run(db, "SELECT id, s FROM t WHERE id = 7 OR id = 1"), "id\ts\t\n7\to'k\t\n1\tb'c\t\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+// Crash recovery of transactions interleaved with other sessions.
+//
+//   g++ -std=c++17 -I. tests/recovery_test.cpp $(ls *.cpp | grep -v main.cpp) -o recovery_test -lpthread
+//   ./recovery_test
+//
+// Each case runs its sessions in a child process that exits without shutting
+// the database down (no checkpoint), as if killed after its last commit, then
+// reopens the directory so the log is replayed and checks what survived.
+
+#include "Database.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <functional>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static int failures = 0;
+
+// Runs 'sessions' against a fresh database in 'dir' in a child process that
+// then exits abruptly.
+static void crashAfter(const std::string& dir, const std::function<void(Database&)>& sessions) {
+    std::system(("rm -rf " + dir + " && mkdir -p " + dir).c_str());
+    pid_t pid = fork();
+    if (pid == 0) {
+        std::cout.setstate(std::ios::failbit);
+        std::cerr.setstate(std::ios::failbit);
+        Database* db = new Database();
+        db->open(dir);
+        sessions(*db);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+}
+
+// The rows of 'table' after reopening 'dir', as SELECT * prints them.
+static std::string recovered(const std::string& dir, const std::string& table) {
+    std::ostringstream out;
+    std::streambuf* saved = std::cout.rdbuf(out.rdbuf());
+    {
+        Database db;
+        db.open(dir);
+        db.selectRecords(table, {"*"}, "", {"id"});
+    }
+    std::cout.rdbuf(saved);
+    return out.str();
+}
+
+static void expect(const std::string& name, const std::string& actual, const std::string& expected) {
+    if (actual == expected) {
+        std::cout << "PASS " << name << std::endl;
+        return;
+    }
+    std::cout << "FAIL " << name << "\n--- expected\n" << expected << "--- got\n" << actual;
+    failures++;
+}
+
+// Runs 'fn' as a statement of another session (thread).
+static void otherSession(const std::function<void()>& fn) {
+    std::thread(fn).join();
+}
+
+int main() {
+    // A row committed by another session after the transaction's snapshot
+    // is not touched by the transaction's DELETE, before or after recovery.
+    crashAfter("recovery_test_data", [](Database& db) {
+        db.createTable("t", {{"id", "INT"}, {"v", "INT"}}, "id");
+        db.insertRecord("t", {{"1", "5"}});
+        db.beginTransaction();
+        otherSession([&] { db.insertRecord("t", {{"2", "5"}}); });
+        db.deleteRecords("t", "v = 5");
+        db.commitTransaction();
+    });
+    expect("delete skips rows committed after the snapshot", recovered("recovery_test_data", "t"),
+           "id\tv\t\n2\t5\t\n");
+
+    // The same for UPDATE, on a table without a primary key.
+    crashAfter("recovery_test_data", [](Database& db) {
+        db.createTable("t", {{"id", "INT"}, {"v", "INT"}});
+        db.insertRecord("t", {{"1", "5"}});
+        db.beginTransaction();
+        otherSession([&] { db.insertRecord("t", {{"2", "5"}}); });
+        db.updateRecords("t", {{"v", "6"}}, "v = 5");
+        db.commitTransaction();
+    });
+    expect("update skips rows committed after the snapshot", recovered("recovery_test_data", "t"),
+           "id\tv\t\n1\t6\t\n2\t5\t\n");
+
+    // Changes of a transaction that never committed are dropped, and
+    // changes of a later transaction apply on top of an earlier one's.
+    crashAfter("recovery_test_data", [](Database& db) {
+        db.createTable("t", {{"id", "INT"}, {"v", "INT"}}, "id");
+        db.insertRecord("t", {{"1", "1"}, {"2", "2"}});
+        db.beginTransaction();
+        db.updateRecords("t", {{"v", "10"}}, "id = 1");
+        db.commitTransaction();
+        db.beginTransaction();
+        db.updateRecords("t", {{"v", "11"}}, "id = 1");
+        db.deleteRecords("t", "id = 1");
+        db.commitTransaction();
+        otherSession([&] {
+            db.beginTransaction();
+            db.deleteRecords("t", "id = 2");
+        });
+    });
+    expect("uncommitted changes are dropped", recovered("recovery_test_data", "t"), "id\tv\t\n2\t2\t\n");
+
+    std::system("rm -rf recovery_test_data");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+// The result cache serves a repeated SELECT only while every table it read
+// is unchanged, evicts least recently used entries to stay under its
+// capacity, and is bypassed inside transactions.
+
+#include "TestUtil.h"
+#include "ResultCache.h"
+
+static std::string counts(const ResultCache::Stats& stats) {
+    return std::to_string(stats.hits) + " hits, " + std::to_string(stats.misses) + " misses, " +
+           std::to_string(stats.evictions) + " evictions, " + std::to_string(stats.entries) + " entries";
+}
+
+int main() {
+    ResultCache cache;
+    std::string result;
+    expectTrue("disabled by default", !cache.enabled());
+    cache.setCapacity(1000);
+    cache.insert("a", {1}, std::string(200, 'a'));
+    cache.insert("b", {1, 2}, std::string(200, 'b'));
+    expectTrue("hit at the same versions", cache.lookup("a", {1}, result) && result == std::string(200, 'a'));
+    expectTrue("miss at newer versions", !cache.lookup("b", {1, 3}, result));
+    expectTrue("stale entry dropped", !cache.lookup("b", {1, 2}, result));
+    expect("counters", counts(cache.stats()), "1 hits, 2 misses, 0 evictions, 1 entries");
+
+    // "a" was used more recently than "b", so "b" goes first.
+    cache.insert("b", {1}, std::string(200, 'b'));
+    cache.lookup("a", {1}, result);
+    cache.insert("c", {1}, std::string(400, 'c'));
+    expectTrue("least recently used evicted", !cache.lookup("b", {1}, result));
+    expectTrue("recently used kept", cache.lookup("a", {1}, result) && cache.lookup("c", {1}, result));
+    expectTrue("within capacity", cache.stats().bytes <= 1000);
+    cache.insert("huge", {1}, std::string(2000, 'h'));
+    expectTrue("larger than the capacity not kept", !cache.lookup("huge", {1}, result));
+    cache.setCapacity(500);
+    expect("shrinking evicts", std::to_string(cache.stats().entries), "1");
+    cache.setCapacity(0);
+    expectTrue("capacity 0 disables", !cache.enabled() && cache.stats().entries == 0);
+
+    Database db;
+    run(db, "CREATE TABLE t (id INT, s TEXT); INSERT INTO t VALUES (1, 'a'), (2, 'b');"
+            "CREATE TABLE u (id INT, tag TEXT); INSERT INTO u VALUES (1, 'x')");
+    expect("enable", run(db, "SET RESULT_CACHE 64KB"), "Result cache set to 65536 bytes.\n");
+    run(db, "SELECT id FROM t WHERE s = 'a'");
+    expect("repeated SELECT", run(db, "SELECT id FROM t WHERE  s  =  'a'"), "id\t\n1\t\n");
+    expect("served from the cache", std::to_string(db.resultCacheStats().hits), "1");
+    expect("spaces inside literals count", run(db, "SELECT id FROM t WHERE s = 'a  '"), "id\t\n");
+
+    // Every kind of change invalidates the entries reading the table.
+    const char* changes[][2] = {
+        {"INSERT INTO t VALUES (3, 'a')", "id\t\n1\t\n3\t\n"},
+        {"UPDATE t SET s = 'b' WHERE id = 1", "id\t\n3\t\n"},
+        {"DELETE FROM t WHERE id = 3", "id\t\n"},
+        {"REPLACE INTO t VALUES (2, 'a')", "id\t\n2\t\n"},
+        {"MERGE INTO t USING (SELECT 4 AS id, 'a' AS s) ON t.id = src.id "
+         "WHEN MATCHED THEN UPDATE SET s = src.s WHEN NOT MATCHED THEN INSERT VALUES (src.id, src.s)",
+         "id\t\n2\t\n4\t\n"},
+        {"TRUNCATE TABLE t", "id\t\n"},
+    };
+    for (const auto& change : changes) {
+        run(db, "SELECT id FROM t WHERE s = 'a'");
+        run(db, change[0]);
+        expect(std::string("after ") + change[0], run(db, "SELECT id FROM t WHERE s = 'a'"), change[1]);
+    }
+    run(db, "INSERT INTO t VALUES (1, 'a'); SELECT * FROM t");
+    run(db, "ALTER TABLE t ADD COLUMN n INT");
+    expect("after ALTER TABLE", run(db, "SELECT * FROM t"), "id\ts\tn\t\n1\ta\t\t\n");
+    run(db, "DROP TABLE t; CREATE TABLE t (id INT, s TEXT); INSERT INTO t VALUES (9, 'a')");
+    expect("after DROP and CREATE", run(db, "SELECT * FROM t"), "id\ts\t\n9\ta\t\n");
+
+    // A join depends on both of its tables.
+    run(db, "SELECT t.id, u.tag FROM t JOIN u ON t.id = u.id; INSERT INTO u VALUES (9, 'y')");
+    expect("join after a change to one side", run(db, "SELECT t.id, u.tag FROM t JOIN u ON t.id = u.id"),
+           "t.id\tu.tag\t\n9\ty\t\n");
+
+    // A transaction reads its own snapshot and changes, never the cache.
+    run(db, "SELECT id FROM t");
+    size_t hits = db.resultCacheStats().hits;
+    expect("own change in a transaction", run(db, "BEGIN; INSERT INTO t VALUES (10, 'b'); SELECT id FROM t"),
+           "Transaction started.\nRecord(s) inserted into t.\nid\t\n9\t\n10\t\n");
+    run(db, "ROLLBACK");
+    expect("bypassed in a transaction", std::to_string(db.resultCacheStats().hits), std::to_string(hits));
+    expect("after rollback", run(db, "SELECT id FROM t"), "id\t\n9\t\n");
+    return failures == 0 ? 0 : 1;
+}
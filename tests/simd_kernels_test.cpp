@@ -0,0 +1,145 @@
+// The comparison and summary kernels, whichever instruction set the
+// dispatcher picked, agree with plain loops over the same values, NULLs and
+// partial 64-row words included.
+
+#include "TestUtil.h"
+#include "SimdKernels.h"
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+static const size_t Rows = 1000;
+
+template <typename T>
+static bool compare(FilterOp op, T value, T literal) {
+    switch (op) {
+        case FilterOp::Eq: return value == literal;
+        case FilterOp::Ne: return value != literal;
+        case FilterOp::Lt: return value < literal;
+        case FilterOp::Le: return value <= literal;
+        case FilterOp::Gt: return value > literal;
+        case FilterOp::Ge: return value >= literal;
+    }
+    return false;
+}
+
+// Mismatched rows of a mask over [begin, end), as "row " items.
+template <typename T>
+static std::string maskErrors(const std::vector<T>& values, const std::vector<uint64_t>& nulls, size_t begin,
+                              size_t end, FilterOp op, T literal, const std::vector<uint64_t>& mask) {
+    std::string errors;
+    for (size_t row = begin; row < end; ++row) {
+        bool isNull = (nulls[row >> 6] >> (row & 63)) & 1;
+        bool expected = !isNull && compare(op, values[row], literal);
+        bool actual = (mask[(row - begin) >> 6] >> ((row - begin) & 63)) & 1;
+        if (expected != actual)
+            errors += std::to_string(row) + " ";
+    }
+    return errors;
+}
+
+int main() {
+    std::cout << "ISA " << SimdKernels::activeIsa() << std::endl;
+    std::mt19937_64 random(7);
+    std::vector<int64_t> ints(Rows);
+    std::vector<double> doubles(Rows);
+    std::vector<uint8_t> bools(Rows);
+    std::vector<uint64_t> nulls((Rows + 63) / 64, 0);
+    for (size_t row = 0; row < Rows; ++row) {
+        // Few distinct values so that = and != hit both ways; NULL cells hold
+        // 0, as the column store keeps them.
+        if (random() % 7 == 0) {
+            nulls[row >> 6] |= uint64_t(1) << (row & 63);
+            continue;
+        }
+        ints[row] = static_cast<int64_t>(random() % 11) - 5;
+        doubles[row] = static_cast<double>(ints[row]) / 2;
+        bools[row] = random() % 2;
+    }
+    ints[3] = std::numeric_limits<int64_t>::min();
+    ints[4] = std::numeric_limits<int64_t>::max();
+    doubles[5] = -0.0;
+    nulls[0] &= ~uint64_t(0x38); // rows 3 to 5 hold values
+
+    const FilterOp ops[] = {FilterOp::Eq, FilterOp::Ne, FilterOp::Lt, FilterOp::Le, FilterOp::Gt, FilterOp::Ge};
+    const size_t ranges[][2] = {{0, Rows}, {64, 100}, {128, 128 + 64}, {0, 1}, {896, Rows}};
+    std::string errors;
+    for (const auto& range : ranges) {
+        size_t begin = range[0], end = range[1];
+        std::vector<uint64_t> mask((end - begin + 63) / 64);
+        for (FilterOp op : ops) {
+            for (int64_t literal : {int64_t(-5), int64_t(0), int64_t(3), std::numeric_limits<int64_t>::max()}) {
+                SimdKernels::compareInt64(ints.data(), nulls.data(), begin, end, op, literal, mask.data());
+                errors += maskErrors(ints, nulls, begin, end, op, literal, mask);
+            }
+            for (double literal : {-2.5, 0.0, 1.0, 2.75}) {
+                SimdKernels::compareDouble(doubles.data(), nulls.data(), begin, end, op, literal, mask.data());
+                errors += maskErrors(doubles, nulls, begin, end, op, literal, mask);
+            }
+            for (uint8_t literal : {uint8_t(0), uint8_t(1)}) {
+                SimdKernels::compareBool(bools.data(), nulls.data(), begin, end, op, literal, mask.data());
+                errors += maskErrors(bools, nulls, begin, end, op, literal, mask);
+            }
+        }
+    }
+    expect("comparison masks", errors, "");
+
+    // Masks combine word by word and turn back into ascending row ids.
+    std::vector<uint64_t> low(Rows / 64 + 1), high(Rows / 64 + 1);
+    SimdKernels::compareInt64(ints.data(), nulls.data(), 0, Rows, FilterOp::Ge, -1, low.data());
+    SimdKernels::compareInt64(ints.data(), nulls.data(), 0, Rows, FilterOp::Le, 1, high.data());
+    for (size_t w = 0; w < low.size(); ++w)
+        low[w] &= high[w];
+    std::vector<size_t> rows(Rows);
+    rows.resize(SimdKernels::maskToRows(low.data(), 0, Rows, rows.data()));
+    std::vector<size_t> expected;
+    for (size_t row = 0; row < Rows; ++row) {
+        if (!((nulls[row >> 6] >> (row & 63)) & 1) && ints[row] >= -1 && ints[row] <= 1)
+            expected.push_back(row);
+    }
+    expectTrue("mask to row ids", rows == expected);
+
+    // Summaries over ranges that start and end inside a word.
+    std::string summaries;
+    for (size_t begin : {size_t(0), size_t(5), size_t(70)}) {
+        for (size_t end : {size_t(6), size_t(200), Rows}) {
+            if (end <= begin)
+                continue;
+            NumericSummary sum, real, flags;
+            SimdKernels::summarizeInt64(ints.data(), nulls.data(), begin, end, sum);
+            SimdKernels::summarizeDouble(doubles.data(), nulls.data(), begin, end, real);
+            SimdKernels::summarizeBool(bools.data(), nulls.data(), begin, end, flags);
+            size_t count = 0, trues = 0;
+            __int128 exact = 0;
+            double realSum = 0, realMin = 1e300, realMax = -1e300;
+            for (size_t row = begin; row < end; ++row) {
+                if ((nulls[row >> 6] >> (row & 63)) & 1)
+                    continue;
+                count++;
+                exact += ints[row];
+                realSum += doubles[row];
+                realMin = std::min(realMin, doubles[row]);
+                realMax = std::max(realMax, doubles[row]);
+                trues += bools[row];
+            }
+            bool fits = exact >= std::numeric_limits<int64_t>::min() && exact <= std::numeric_limits<int64_t>::max();
+            std::string where = "[" + std::to_string(begin) + ", " + std::to_string(end) + ") ";
+            if (sum.count != count || sum.exact != fits || (fits && sum.intSum != static_cast<int64_t>(exact)))
+                summaries += where + "int64 ";
+            if (real.count != count || real.sum != realSum ||
+                (count > 0 && (real.min != realMin || real.max != realMax)))
+                summaries += where + "double ";
+            if (flags.count != count || flags.intSum != static_cast<int64_t>(trues))
+                summaries += where + "bool ";
+        }
+    }
+    expect("summaries", summaries, "");
+
+    std::vector<int64_t> large(100, std::numeric_limits<int64_t>::max());
+    std::vector<uint64_t> none(2, 0);
+    NumericSummary overflow;
+    SimdKernels::summarizeInt64(large.data(), none.data(), 0, large.size(), overflow);
+    expectTrue("sum past the int64 range is not exact", !overflow.exact && overflow.count == 100);
+    return failures == 0 ? 0 : 1;
+}
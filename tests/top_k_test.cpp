@@ -0,0 +1,78 @@
+// ORDER BY ... LIMIT keeps only the first offset + limit rows in order, a
+// scan without ORDER BY stops once it has them, and joins sort, limit and
+// group their output like single-table queries.
+
+#include "TestUtil.h"
+#include <sstream>
+
+// The lines of a result after the header, from 'first', at most 'count'.
+static std::string slice(const std::string& result, size_t first, size_t count) {
+    std::istringstream lines(result);
+    std::string line, header, text;
+    std::getline(lines, header);
+    for (size_t i = 0; std::getline(lines, line) && i < first + count; ++i) {
+        if (i >= first)
+            text += line + "\n";
+    }
+    return header + "\n" + text;
+}
+
+int main() {
+    Database db;
+    std::string rows;
+    for (int i = 0; i < 70000; ++i)
+        rows += std::string(rows.empty() ? "" : ", ") + "(" + std::to_string(i) + ", " +
+                std::to_string((i * 7919) % 1000) + ")";
+    run(db, "CREATE TABLE t (id INT, v INT); INSERT INTO t VALUES " + rows);
+
+    // The top rows are those a full sort puts first; id breaks ties in v.
+    std::string sorted = run(db, "SELECT id, v FROM t ORDER BY v DESC, id");
+    for (size_t offset : {0, 1, 69}) {
+        for (size_t limit : {1, 50, 1000}) {
+            std::string query = "SELECT id, v FROM t ORDER BY v DESC, id LIMIT " + std::to_string(limit) +
+                                " OFFSET " + std::to_string(offset);
+            expect(query, run(db, query), slice(sorted, offset, limit));
+        }
+    }
+    expect("LIMIT 0", run(db, "SELECT id FROM t ORDER BY v LIMIT 0"), "id\t\n");
+    expect("OFFSET past the end", run(db, "SELECT id FROM t WHERE id < 5 ORDER BY v LIMIT 3 OFFSET 10"), "id\t\n");
+    std::string plan = run(db, "EXPLAIN SELECT id FROM t ORDER BY v DESC LIMIT 50 OFFSET 10");
+    expectTrue("sort keeps offset + limit rows", plan.find("Keeps: first 60 rows") != std::string::npos);
+
+    // Without ORDER BY the scan stops early, within the first batch here.
+    plan = run(db, "EXPLAIN ANALYZE SELECT id FROM t WHERE v >= 0 LIMIT 5");
+    size_t at = plan.find("rows out=", plan.find("-> Seq Scan"));
+    expectTrue("scan stops after the limit", std::stoul(plan.substr(at + 9)) <= BatchSize);
+
+    // Joins: ORDER BY, LIMIT and OFFSET over the joined rows.
+    run(db, "CREATE TABLE a (id INT, name TEXT);"
+            "CREATE TABLE b (aid INT, amount INT, id INT);"
+            "INSERT INTO a VALUES (1, 'x'), (2, 'y'), (3, 'z'), (4, NULL);"
+            "INSERT INTO b VALUES (1, 10, 7), (1, 20, 8), (3, 30, 9), (5, 50, 1), (NULL, 60, 2), (3, 5, 3)");
+    expect("join ORDER BY", run(db, "SELECT a.name, b.amount FROM a JOIN b ON a.id = b.aid ORDER BY b.amount DESC"),
+           "a.name\tb.amount\t\nz\t30\t\nx\t20\t\nx\t10\t\nz\t5\t\n");
+    expect("join top-K", run(db, "SELECT name, amount FROM a JOIN b ON a.id = b.aid ORDER BY amount LIMIT 2 OFFSET 1"),
+           "name\tamount\t\nx\t10\t\nx\t20\t\n");
+    expect("join ORDER BY with WHERE",
+           run(db, "SELECT amount FROM a JOIN b ON a.id = b.aid WHERE a.name = 'z' ORDER BY amount"),
+           "amount\t\n5\t\n30\t\n");
+    expect("join * names a repeated column by its table",
+           run(db, "SELECT * FROM a JOIN b ON a.id = b.aid ORDER BY b.id LIMIT 2"),
+           "id\tname\taid\tamount\tb.id\t\n3\tz\t3\t5\t3\t\n1\tx\t1\t10\t7\t\n");
+
+    // Joins: aggregates, GROUP BY and HAVING.
+    expect("join GROUP BY",
+           run(db, "SELECT a.name, COUNT(*), SUM(b.amount) FROM a JOIN b ON a.id = b.aid GROUP BY a.name"),
+           "a.name\tCOUNT(*)\tSUM(b.amount)\t\nx\t2\t30\t\nz\t2\t35\t\n");
+    expect("join HAVING",
+           run(db, "SELECT a.name, SUM(b.amount) FROM a JOIN b ON a.id = b.aid GROUP BY a.name "
+                   "HAVING SUM(b.amount) > 30"),
+           "a.name\tSUM(b.amount)\t\nz\t35\t\n");
+    expect("join aggregate without GROUP BY",
+           run(db, "SELECT COUNT(*) FROM a JOIN b ON a.id = b.aid WHERE b.amount > 6"), "3\t\n");
+    plan = run(db, "EXPLAIN SELECT a.name FROM a JOIN b ON a.id = b.aid ORDER BY b.amount LIMIT 1");
+    expectTrue("sort reads the join output",
+               plan.find("-> Sort") < plan.find("-> Materialize") &&
+                   plan.find("-> Materialize") < plan.find("-> Hash Join"));
+    return failures == 0 ? 0 : 1;
+}